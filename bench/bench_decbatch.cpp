@@ -0,0 +1,143 @@
+/*!
+  @file bench_decbatch.cpp
+  @brief benchmark of lazurite_decMacBatch <br>
+  decode a capture of many frames (random layouts, like promiscuous mode) by
+  lazurite_decMac into array of SUBGHZ_MAC, and by lazurite_decMacBatch into columns.
+  "batch(2 columns)" fills only src_short and seq_num.
+  LazDriver is not needed.
+
+  @code
+  bench_decbatch [frames]
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+#define ROUNDS	5		/*!< best of rounds is reported */
+
+/*! frame with random header. returns length */
+static int make_frame(uint8_t *raw)
+{
+	static const uint8_t mode[4] = {0,2,2,3};	// no 8bit address
+	static const uint8_t addr_len[4] = {0,1,2,8};
+	int seq_comp = rand() & 1;
+	int panid_comp = rand() & 1;
+	int dst = mode[rand() & 3];
+	int src = mode[rand() & 3];
+	int addr_type = (dst ? 4 : 0) + (src ? 2 : 0) + panid_comp;
+	uint16_t header = 0x2001 | (panid_comp << 6) | (seq_comp << 8) | (dst << 10) | (src << 14);
+	int len = 0;
+	int i, payload;
+
+	raw[len++] = header & 0xff;
+	raw[len++] = header >> 8;
+	if(!seq_comp) raw[len++] = rand();
+	if((addr_type == 1) || (addr_type == 4) || (addr_type == 6)) {
+		raw[len++] = 0xcd;
+		raw[len++] = 0xab;
+	}
+	for(i=0;i<addr_len[dst];i++) raw[len++] = rand();
+	if(addr_type == 2) {
+		raw[len++] = 0xcd;
+		raw[len++] = 0xab;
+	}
+	for(i=0;i<addr_len[src];i++) raw[len++] = rand();
+	payload = rand() % 40;
+	for(i=0;i<payload;i++) raw[len++] = rand();
+	return len;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	int frames = 1000000;
+	uint8_t *capture;
+	const void **raw;
+	uint16_t *len;
+	SUBGHZ_MAC *mac;
+	LAZURITE_MAC_COLUMNS all, two;
+	double t, per_frame = 0, batch = 0, batch2 = 0;
+	unsigned long sum = 0;
+	size_t offset = 0;
+	int mismatch = 0;
+	int i, r;
+
+	if(argc>1) frames = strtol(argv[1],NULL,0);
+
+	// capture: frames are stored back to back
+	capture = (uint8_t*)malloc((size_t)frames * 64);
+	raw = (const void**)malloc(sizeof(void*) * frames);
+	len = (uint16_t*)malloc(sizeof(uint16_t) * frames);
+	mac = (SUBGHZ_MAC*)malloc(sizeof(SUBGHZ_MAC) * frames);
+	srand(1);
+	for(i=0;i<frames;i++) {
+		raw[i] = capture + offset;
+		len[i] = make_frame(capture + offset);
+		offset += len[i];
+	}
+
+	memset(&all,0,sizeof(all));
+	all.status = (int16_t*)malloc(sizeof(int16_t) * frames);
+	all.frame_type = (uint8_t*)malloc(frames);
+	all.addr_type = (uint8_t*)malloc(frames);
+	all.seq_num = (uint8_t*)malloc(frames);
+	all.dst_panid = (uint16_t*)malloc(sizeof(uint16_t) * frames);
+	all.src_panid = (uint16_t*)malloc(sizeof(uint16_t) * frames);
+	all.dst_short = (uint16_t*)malloc(sizeof(uint16_t) * frames);
+	all.src_short = (uint16_t*)malloc(sizeof(uint16_t) * frames);
+	all.dst_addr = (uint64_t*)malloc(sizeof(uint64_t) * frames);
+	all.src_addr = (uint64_t*)malloc(sizeof(uint64_t) * frames);
+	all.payload_offset = (uint16_t*)malloc(sizeof(uint16_t) * frames);
+	all.payload_len = (uint16_t*)malloc(sizeof(uint16_t) * frames);
+	memset(&two,0,sizeof(two));
+	two.src_short = all.src_short;
+	two.seq_num = all.seq_num;
+
+	for(r=0;r<ROUNDS;r++) {
+		t = now();
+		for(i=0;i<frames;i++) {
+			lazurite_decMac(&mac[i],(void*)raw[i],len[i]);
+		}
+		t = frames / (now() - t);
+		if(t > per_frame) per_frame = t;
+
+		t = now();
+		lazurite_decMacBatch(&all,raw,len,frames);
+		t = frames / (now() - t);
+		if(t > batch) batch = t;
+
+		t = now();
+		lazurite_decMacBatch(&two,raw,len,frames);
+		t = frames / (now() - t);
+		if(t > batch2) batch2 = t;
+		sum += all.src_short[r] + mac[r].payload_len;
+	}
+
+	// columns must be same as SUBGHZ_MAC
+	for(i=0;i<frames;i++) {
+		uint64_t src;
+		memcpy(&src,mac[i].src_addr,8);
+		if((all.status[i] != 0) || (all.payload_offset[i] != mac[i].payload_offset) ||
+				(all.seq_num[i] != mac[i].seq_num) || (all.dst_panid[i] != mac[i].dst_panid) ||
+				(all.src_panid[i] != mac[i].src_panid) || (all.src_addr[i] != src)) mismatch++;
+	}
+
+	printf("method\tframes/s\n");
+	printf("decMac\t%.0f\n",per_frame);
+	printf("batch\t%.0f\n",batch);
+	printf("batch(2 columns)\t%.0f\n",batch2);
+	if(mismatch) printf("mismatch: %d\n",mismatch);
+	return (sum == 0) || mismatch ? EXIT_FAILURE : 0;
+}
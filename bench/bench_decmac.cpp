@@ -0,0 +1,270 @@
+/*!
+  @file bench_decmac.cpp
+  @brief benchmark of lazurite_decMac <br>
+  compare the decoder before mac-lazurite.cpp (switch per field, copied below as legacy_decMac),
+  mac_decodeGeneric (mac_layout table) and lazurite_decMac (decoder specialized for the layout).
+  frames per second are measured for each header layout and for a mix of all 64 layouts,
+  where branches of legacy decoder are not predictable.
+  "view" gets only src address and sequence number by LAZURITE_VIEW, like a gateway routing frames.
+  LazDriver is not needed.
+
+  @code
+  bench_decmac [frames]
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "../lib/liblazurite.h"
+#include "../lib/mac-lazurite.h"
+
+using namespace lazurite;
+
+#define FRAMES	1024		/*!< frames in a set */
+#define PAYLOAD	16
+#define ROUNDS	10		/*!< best of rounds is reported */
+
+typedef struct {
+	uint8_t frame_type:3;
+	uint8_t sec_enb:1;
+	uint8_t pending:1;
+	uint8_t ack_req:1;
+	uint8_t panid_comp:1;
+	uint8_t nop:1;
+	uint8_t seq_comp:1;
+	uint8_t ielist:1;
+	uint8_t dst_addr_type:2;
+	uint8_t frame_ver:2;
+	uint8_t src_addr_type:2;
+} LEGACY_BITS;
+
+typedef union {
+	uint8_t data[2];
+	uint16_t header;
+	LEGACY_BITS alignment;
+} LEGACY_HEADER;
+
+/*! subghz_decMac and lazurite_decMac before mac_layout */
+__attribute__((noinline)) static int legacy_decMac(SUBGHZ_MAC *mac, void *raw, uint16_t raw_len)
+{
+	LEGACY_HEADER h;
+	int i;
+	int16_t offset=0;
+	uint8_t addr_type;
+	char* buf = (char*) raw;
+	h.data[0] = buf[offset],offset++;
+	h.data[1] = buf[offset],offset++;
+	if(!h.alignment.seq_comp) {
+		mac->seq_num = buf[offset],offset++;
+	}
+	if(h.alignment.dst_addr_type) addr_type = 4;
+	else addr_type = 0;
+	if(h.alignment.src_addr_type) addr_type += 2;
+	if(h.alignment.panid_comp) addr_type += 1;
+	mac->addr_type = addr_type;
+	switch(addr_type){
+		case 1:
+		case 4:
+		case 6:
+			mac->dst_panid = buf[offset+1];
+			mac->dst_panid = (mac->dst_panid<<8) + buf[offset];
+			offset+=2;
+			break;
+		default:
+			mac->src_panid = 0xffff;
+			break;
+	}
+	switch(h.alignment.dst_addr_type) {
+		case 1:
+			mac->dst_addr[0] = buf[offset],offset++;
+			for(i=1;i<8;i++) mac->dst_addr[i] = 0;
+			break;
+		case 2:
+			mac->dst_addr[0] = buf[offset],offset++;
+			mac->dst_addr[1] = buf[offset],offset++;
+			for(i=2;i<8;i++) mac->dst_addr[i] = 0;
+			break;
+		case 3:
+			for(i=0;i<8;i++) mac->dst_addr[i] = buf[offset],offset++;
+		default:
+			break;
+	}
+	switch(mac->addr_type){
+		case 2:
+			mac->src_panid = buf[offset+1];
+			mac->src_panid = (mac->src_panid<<8) + buf[offset];
+			offset+=2;
+			break;
+		default:
+			mac->src_panid = 0xffff;
+			break;
+	}
+	memset(mac->src_addr,0xffff,sizeof(mac->src_addr));
+	switch(h.alignment.src_addr_type) {
+		case 1:
+			mac->src_addr[0] = buf[offset],offset++;
+			for(i=1;i<8;i++) mac->src_addr[i] = 0;
+			break;
+		case 2:
+			mac->src_addr[0] = buf[offset],offset++;
+			mac->src_addr[1] = buf[offset],offset++;
+			for(i=2;i<8;i++) mac->src_addr[i] = 0;
+			break;
+		case 3:
+			for(i=0;i<8;i++) mac->src_addr[i] = buf[offset],offset++;
+		default:
+			break;
+	}
+	mac->header = h.header;
+	mac->frame_type = h.alignment.frame_type;
+	mac->sec_enb = h.alignment.sec_enb;
+	mac->pending = h.alignment.pending;
+	mac->ack_req = h.alignment.ack_req;
+	mac->panid_comp = h.alignment.panid_comp;
+	mac->seq_comp = h.alignment.seq_comp;
+	mac->ielist = h.alignment.ielist;
+	mac->src_addr_type = h.alignment.src_addr_type;
+	mac->frame_ver = h.alignment.frame_ver;
+	mac->dst_addr_type = h.alignment.dst_addr_type;
+	mac->payload_offset = offset;
+	mac->payload_len = raw_len - offset;
+	return raw_len;
+}
+
+static int generic_decMac(SUBGHZ_MAC *mac, void *raw, uint16_t raw_len)
+{
+	return mac_decodeGeneric(mac,(const uint8_t*)raw,raw_len);
+}
+
+typedef struct {
+	uint16_t len;
+	uint8_t raw[64];
+} BENCH_FRAME;
+
+/*! frame with header of index (seq_comp<<5 | panid_comp<<4 | dst_addr_type<<2 | src_addr_type) */
+static void make_frame(BENCH_FRAME *frame, int index)
+{
+	static const uint8_t addr_len[4] = {0,1,2,8};
+	int seq_comp = (index >> 5) & 1;
+	int panid_comp = (index >> 4) & 1;
+	int dst = (index >> 2) & 3;
+	int src = index & 3;
+	int addr_type = (dst ? 4 : 0) + (src ? 2 : 0) + panid_comp;
+	uint16_t header = 0x2001 | (panid_comp << 6) | (seq_comp << 8) | (dst << 10) | (src << 14);
+	int len = 0;
+	int i;
+
+	frame->raw[len++] = header & 0xff;
+	frame->raw[len++] = header >> 8;
+	if(!seq_comp) frame->raw[len++] = index;
+	if((addr_type == 1) || (addr_type == 4) || (addr_type == 6)) {
+		frame->raw[len++] = 0xcd;
+		frame->raw[len++] = 0xab;
+	}
+	for(i=0;i<addr_len[dst];i++) frame->raw[len++] = 0x10 + i;
+	if(addr_type == 2) {
+		frame->raw[len++] = 0xcd;
+		frame->raw[len++] = 0xab;
+	}
+	for(i=0;i<addr_len[src];i++) frame->raw[len++] = 0x20 + i;
+	for(i=0;i<PAYLOAD;i++) frame->raw[len++] = 'a' + i;
+	frame->len = len;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double run(int (*decode)(SUBGHZ_MAC*,void*,uint16_t), BENCH_FRAME *set, long frames, unsigned long *sum)
+{
+	SUBGHZ_MAC mac;
+	double t;
+	long i;
+
+	t = now();
+	for(i=0;i<frames;i++) {
+		BENCH_FRAME *frame = &set[i % FRAMES];
+		decode(&mac,frame->raw,frame->len);
+		*sum += mac.payload_offset + mac.src_addr[0] + mac.dst_addr[1];
+	}
+	return frames / (now() - t);
+}
+
+static double run_view(BENCH_FRAME *set, long frames, unsigned long *sum)
+{
+	LAZURITE_VIEW view;
+	const uint8_t *src;
+	double t;
+	long i;
+
+	t = now();
+	for(i=0;i<frames;i++) {
+		BENCH_FRAME *frame = &set[i % FRAMES];
+		lazurite_setView(&view,frame->raw,frame->len);
+		*sum += lazurite_viewSrcAddr(&view,&src) + lazurite_viewSeq(&view);
+		if(src) *sum += src[0];
+	}
+	return frames / (now() - t);
+}
+
+int main(int argc, char **argv)
+{
+	static BENCH_FRAME set[FRAMES];
+	static const struct {
+		const char *name;
+		int index;	/*!< -1 = mix of all layouts */
+	} cases[] = {
+		{"16bit/16bit panid_comp (addr_type 7)", (1 << 4) | (2 << 2) | 2},
+		{"16bit/16bit panid_comp seq_comp", (1 << 5) | (1 << 4) | (2 << 2) | 2},
+		{"16bit/64bit panid_comp", (1 << 4) | (2 << 2) | 3},
+		{"64bit/64bit", (3 << 2) | 3},
+		{"broadcast seq_comp", (1 << 5) | (2 << 2)},
+		{"8bit/8bit (generic)", (1 << 2) | 1},
+		{"mix of 64 layouts", -1},
+	};
+	long frames = 2000000;
+	unsigned long sum = 0;
+	double before, generic, after, view, t;
+	int mismatch = 0;
+	SUBGHZ_MAC a, b;
+	int c, i, r;
+
+	if(argc>1) frames = strtol(argv[1],NULL,0);
+
+	// layouts of both decoders must be same for valid frames
+	for(i=0;i<64;i++) {
+		make_frame(&set[0],i);
+		legacy_decMac(&a,set[0].raw,set[0].len);
+		lazurite_decMac(&b,set[0].raw,set[0].len);
+		if((a.payload_offset != b.payload_offset) || (a.addr_type != b.addr_type) ||
+				memcmp(a.src_addr,b.src_addr,8)) mismatch++;
+	}
+
+	printf("header\tbefore(frames/s)\tgeneric(frames/s)\tspecialized(frames/s)\tratio\tview(frames/s)\n");
+	for(c=0;c<(int)(sizeof(cases)/sizeof(cases[0]));c++) {
+		srand(1);
+		for(i=0;i<FRAMES;i++) {
+			make_frame(&set[i],cases[c].index < 0 ? rand() % 64 : cases[c].index);
+		}
+		// best of rounds. both decoders run in each round to share noise of the machine
+		before = generic = after = view = 0;
+		for(r=0;r<ROUNDS;r++) {
+			t = run(legacy_decMac,set,frames,&sum);
+			if(t > before) before = t;
+			t = run(generic_decMac,set,frames,&sum);
+			if(t > generic) generic = t;
+			t = run(lazurite_decMac,set,frames,&sum);
+			if(t > after) after = t;
+			t = run_view(set,frames,&sum);
+			if(t > view) view = t;
+		}
+		printf("%s\t%.0f\t%.0f\t%.0f\t%.2f\t%.0f\n",cases[c].name,before,generic,after,after / before,view);
+	}
+	if(mismatch) printf("mismatch of layout: %d\n",mismatch);
+	return (sum == 0) || mismatch ? EXIT_FAILURE : 0;
+}
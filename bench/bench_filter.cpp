@@ -0,0 +1,122 @@
+/*!
+  @file bench_filter.cpp
+  @brief benchmark of lazurite_matchFilter <br>
+  select frames of a capture (random layouts, frame types and PANIDs, like promiscuous mode)
+  by "frame_type==1 && dst_panid==0xabcd && len>20".
+  "decMac" decodes every frame by lazurite_decMac and checks SUBGHZ_MAC in application,
+  "filter" runs the compiled filter on raw frames.
+  LazDriver is not needed.
+
+  @code
+  bench_filter [frames] [expression]
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+#define ROUNDS	5		/*!< best of rounds is reported */
+
+/*! frame with random header. returns length */
+static int make_frame(uint8_t *raw)
+{
+	static const uint8_t mode[4] = {0,2,2,3};	// no 8bit address
+	static const uint8_t addr_len[4] = {0,1,2,8};
+	int seq_comp = rand() & 1;
+	int panid_comp = rand() & 1;
+	int dst = mode[rand() & 3];
+	int src = mode[rand() & 3];
+	int addr_type = (dst ? 4 : 0) + (src ? 2 : 0) + panid_comp;
+	uint16_t header = 0x2000 | (rand() & 3) | (panid_comp << 6) | (seq_comp << 8) | (dst << 10) | (src << 14);
+	uint16_t panid = rand() & 1 ? 0xabcd : 0x1234;
+	int len = 0;
+	int i, payload;
+
+	raw[len++] = header & 0xff;
+	raw[len++] = header >> 8;
+	if(!seq_comp) raw[len++] = rand();
+	if((addr_type == 1) || (addr_type == 4) || (addr_type == 6)) {
+		raw[len++] = panid & 0xff;
+		raw[len++] = panid >> 8;
+	}
+	for(i=0;i<addr_len[dst];i++) raw[len++] = rand();
+	if(addr_type == 2) {
+		raw[len++] = panid & 0xff;
+		raw[len++] = panid >> 8;
+	}
+	for(i=0;i<addr_len[src];i++) raw[len++] = rand();
+	payload = rand() % 40;
+	for(i=0;i<payload;i++) raw[len++] = rand();
+	return len;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	int frames = 1000000;
+	const char *expr = "frame_type==1 && dst_panid==0xabcd && len>20";
+	LAZURITE_FILTER *filter;
+	uint8_t *capture;
+	const uint8_t **raw;
+	uint16_t *len;
+	SUBGHZ_MAC mac;
+	double t, decode = 0, compiled = 0;
+	long by_decode = 0, by_filter = 0;
+	size_t offset = 0;
+	int error_pos;
+	int i, r;
+
+	if(argc>1) frames = strtol(argv[1],NULL,0);
+	if(argc>2) expr = argv[2];
+	filter = lazurite_compileFilter(expr,&error_pos);
+	if(!filter) {
+		fprintf(stderr,"filter error at %d: %s\n",error_pos,expr);
+		return EXIT_FAILURE;
+	}
+
+	capture = (uint8_t*)malloc((size_t)frames * 64);
+	raw = (const uint8_t**)malloc(sizeof(uint8_t*) * frames);
+	len = (uint16_t*)malloc(sizeof(uint16_t) * frames);
+	srand(1);
+	for(i=0;i<frames;i++) {
+		raw[i] = capture + offset;
+		len[i] = make_frame(capture + offset);
+		offset += len[i];
+	}
+
+	for(r=0;r<ROUNDS;r++) {
+		by_decode = by_filter = 0;
+		t = now();
+		for(i=0;i<frames;i++) {
+			lazurite_decMac(&mac,(void*)raw[i],len[i]);
+			if((mac.frame_type == 1) && (mac.dst_panid == 0xabcd) && (len[i] > 20)) by_decode++;
+		}
+		t = frames / (now() - t);
+		if(t > decode) decode = t;
+
+		t = now();
+		for(i=0;i<frames;i++) {
+			by_filter += lazurite_matchFilter(filter,raw[i],len[i]);
+		}
+		t = frames / (now() - t);
+		if(t > compiled) compiled = t;
+	}
+
+	printf("method\tframes/s\tmatched\n");
+	printf("decMac\t%.0f\t%ld\n",decode,by_decode);
+	printf("filter\t%.0f\t%ld\n",compiled,by_filter);
+	lazurite_freeFilter(filter);
+	// matched frames are compared only for default expression
+	return (argc <= 2) && (by_decode != by_filter) ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,124 @@
+/*!
+  @file bench_format.cpp
+  @brief benchmark of lazurite_formatFrames <br>
+  frames read by lazurite_readBatch are written as text. "snprintf" writes the same CSV line
+  by snprintf for each frame, and others write all frames by lazurite_formatFrames into one buffer.
+  runs on lazurite_backend_sim, so LazDriver is not needed.
+
+  @code
+  bench_format [frames]
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+#define ROUNDS	5		/*!< best of rounds is reported */
+#define BATCH	64
+#define PANID	0xabcd
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*! CSV line by snprintf (printable payload only) */
+static size_t by_snprintf(char *out, size_t size, const LAZURITE_FRAME *frames, int num)
+{
+	const LAZURITE_FRAME *f;
+	size_t used = 0;
+	int i;
+
+	for(i=0;i<num;i++) {
+		f = &frames[i];
+		used += snprintf(out + used,size - used,"%ld,%ld,%u,%u,,0x%04x,%.*s\n",
+				(long)f->tv_sec,f->tv_nsec,f->raw[f->seq_offset],f->rssi,
+				f->raw[f->src_addr_offset] | (f->raw[f->src_addr_offset + 1] << 8),
+				f->payload_len,(const char*)f->raw + f->payload_offset);
+	}
+	return used;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct {
+		const char *name;
+		int format;
+	} methods[] = {
+		{"snprintf", -1},
+		{"csv", LAZURITE_FORMAT_CSV},
+		{"jsonl", LAZURITE_FORMAT_JSONL},
+		{"csv_hex", LAZURITE_FORMAT_CSV_HEX},
+		{"jsonl_hex", LAZURITE_FORMAT_JSONL_HEX},
+	};
+	static LAZURITE_FRAME batch[BATCH];
+	LAZURITE_FRAME *frames;
+	LAZURITE_CTX *tx, *rx;
+	uint16_t rx_addr;
+	char payload[64];
+	char *out;
+	size_t size, bytes = 0;
+	double t, best;
+	int count = 100000;
+	int received = 0;
+	int i, r, n;
+	size_t m;
+
+	if(argc>1) count = strtol(argv[1],NULL,0);
+	frames = (LAZURITE_FRAME*)malloc(sizeof(LAZURITE_FRAME) * count);
+	out = (char*)malloc((size_t)count * LAZURITE_FORMAT_LINE_MAX / 8);
+
+	// frames which look like sensor gateway
+	lazurite_backend_sim.load(0);
+	tx = lazurite_openCtx(&lazurite_backend_sim,NULL);
+	rx = lazurite_openCtx(&lazurite_backend_sim,NULL);
+	lazurite_ctx_begin(tx,36,PANID,100,20);
+	lazurite_ctx_begin(rx,36,PANID,100,20);
+	lazurite_ctx_rxEnable(rx);
+	rx_addr = lazurite_ctx_getMyAddress(rx);
+	while(received < count) {
+		for(i=0;(i<BATCH) && (i < count - received);i++) {
+			n = snprintf(payload,sizeof(payload),"temp=%d.%d,hum=%d,id=%d",20 + (rand() % 10),rand() % 10,rand() % 100,received + i);
+			lazurite_ctx_send(tx,PANID,rx_addr,payload,n);
+		}
+		n = lazurite_ctx_readBatch(rx,batch,BATCH);
+		if(n <= 0) continue;
+		memcpy(frames + received,batch,sizeof(LAZURITE_FRAME) * n);
+		received += n;
+	}
+	lazurite_closeCtx(tx);
+	lazurite_closeCtx(rx);
+
+	printf("method\tframes/s\tMB/s\n");
+	for(m=0;m<sizeof(methods)/sizeof(methods[0]);m++) {
+		best = 0;
+		for(r=0;r<ROUNDS;r++) {
+			size = (size_t)count * LAZURITE_FORMAT_LINE_MAX / 8;
+			t = now();
+			if(methods[m].format < 0) {
+				bytes = by_snprintf(out,size,frames,count);
+			} else {
+				// one call for each batch as gateway does
+				bytes = 0;
+				for(i=0;i<count;i+=BATCH) {
+					size = (size_t)count * LAZURITE_FORMAT_LINE_MAX / 8 - bytes;
+					lazurite_formatFrames(out + bytes,&size,frames + i,count - i < BATCH ? count - i : BATCH,methods[m].format);
+					bytes += size;
+				}
+			}
+			t = now() - t;
+			if(count / t > best) best = count / t;
+		}
+		printf("%s\t%.0f\t%.1f\n",methods[m].name,best,bytes * best / count / 1e6);
+	}
+	free(out);
+	free(frames);
+	return 0;
+}
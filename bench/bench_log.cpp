@@ -0,0 +1,158 @@
+/*!
+  @file bench_log.cpp
+  @brief benchmark of binary log <br>
+  frames from many nodes (one frame per 10ms in total) are written by lazurite_writeLog,
+  then frames of one node in a time window are read by lazurite_seekLog + lazurite_readLog.
+  "indexed" uses the query, and "scan" reads all frames and selects them in application.
+  LazDriver is not needed.
+
+  @code
+  bench_log [frames] [nodes] [window(sec)] [dir]
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+#define BATCH	64
+#define QUERIES	200
+#define PANID	0xabcd
+#define START	1700000000LL	/*!< receiving time of 1st frame */
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*! frame of sensor node (16bit addresses) */
+static void make_frame(LAZURITE_FRAME *frame, long i, uint16_t src)
+{
+	uint8_t *raw = frame->raw;
+	int len = 0;
+	int n;
+
+	raw[len++] = 0x21;		// data, ack_req
+	raw[len++] = 0xa8;		// 16bit addresses, frame version 2
+	raw[len++] = i;
+	raw[len++] = PANID & 0xff;
+	raw[len++] = PANID >> 8;
+	raw[len++] = 0x00;
+	raw[len++] = 0x00;
+	raw[len++] = src & 0xff;
+	raw[len++] = src >> 8;
+	n = snprintf((char*)raw + len,64,"temp=%ld.%ld,hum=%ld",20 + i % 10,i % 7,i % 100);
+	frame->len = len + n;
+	frame->rssi = 100 + (i & 63);
+	frame->tv_sec = START + i / 100;
+	frame->tv_nsec = (i % 100) * 10000000;
+}
+
+static void remove_log(const char *dir)
+{
+	char path[1024];
+	struct dirent *e;
+	DIR *d = opendir(dir);
+
+	if(!d) return;
+	while((e = readdir(d))) {
+		if(e->d_name[0] == '.') continue;
+		snprintf(path,sizeof(path),"%s/%s",dir,e->d_name);
+		unlink(path);
+	}
+	closedir(d);
+	rmdir(dir);
+}
+
+int main(int argc, char **argv)
+{
+	static LAZURITE_FRAME batch[BATCH];
+	LAZURITE_LOG *log;
+	LAZURITE_LOG_READER *reader;
+	LAZURITE_LOG_STATS stats;
+	LAZURITE_LOG_QUERY query;
+	const char *dir = "/tmp/bench_log";
+	long frames = 2000000;
+	long nodes = 1000;
+	long window = 60;
+	long i, found, indexed_found = 0, scan_found = 0;
+	double t, write_time, indexed = 0, scan = 0;
+	time_t from;
+	uint16_t src;
+	int q, n, k;
+
+	if(argc>1) frames = strtol(argv[1],NULL,0);
+	if(argc>2) nodes = strtol(argv[2],NULL,0);
+	if(argc>3) window = strtol(argv[3],NULL,0);
+	if(argc>4) dir = argv[4];
+
+	remove_log(dir);
+	log = lazurite_openLog(dir,NULL);
+	if(!log) {
+		perror(dir);
+		return EXIT_FAILURE;
+	}
+	srand(1);
+	t = now();
+	for(i=0;i<frames;i+=n) {
+		n = frames - i < BATCH ? frames - i : BATCH;
+		for(k=0;k<n;k++) make_frame(&batch[k],i + k,1 + rand() % nodes);
+		lazurite_writeLog(log,batch,n);
+	}
+	lazurite_getLogStats(log,&stats);
+	lazurite_closeLog(log);
+	write_time = now() - t;
+	printf("write\t%.0f frames/s\t%.1f MB/s\t%lu segments\n",frames / write_time,
+			stats.bytes / write_time / 1e6,stats.segments);
+
+	reader = lazurite_openLogReader(dir);
+	for(q=0;q<QUERIES;q++) {
+		src = 1 + rand() % nodes;
+		from = START + rand() % (frames / 100 > window ? frames / 100 - window : 1);
+
+		// indexed
+		memset(&query,0,sizeof(query));
+		query.from_sec = from;
+		query.to_sec = from + window;
+		query.src_addr = src;
+		t = now();
+		lazurite_seekLog(reader,&query);
+		found = 0;
+		while((n = lazurite_readLog(reader,batch,BATCH)) > 0) found += n;
+		t = now() - t;
+		indexed += t;
+		indexed_found += found;
+
+		// full scan (a few queries only)
+		if(q >= QUERIES / 20) continue;
+		memset(&query,0,sizeof(query));
+		query.src_addr = ~0ULL;
+		t = now();
+		lazurite_seekLog(reader,&query);
+		found = 0;
+		while((n = lazurite_readLog(reader,batch,BATCH)) > 0) {
+			for(k=0;k<n;k++) {
+				if((batch[k].tv_sec < from) || (batch[k].tv_sec > from + window) ||
+						((batch[k].tv_sec == from + window) && batch[k].tv_nsec)) continue;
+				if((batch[k].raw[batch[k].src_addr_offset] | (batch[k].raw[batch[k].src_addr_offset + 1] << 8)) == src) found++;
+			}
+		}
+		t = now() - t;
+		scan += t;
+		scan_found += found;
+	}
+	lazurite_closeLogReader(reader);
+	printf("lookup\tframes\tlatency(us)\n");
+	printf("indexed\t%.1f\t%.1f\n",(double)indexed_found / QUERIES,indexed / QUERIES * 1e6);
+	printf("scan\t%.1f\t%.1f\n",(double)scan_found / (QUERIES / 20),scan / (QUERIES / 20) * 1e6);
+	if(argc<=4) remove_log(dir);
+	return 0;
+}
@@ -0,0 +1,135 @@
+/*!
+  @file bench_readbatch.cpp
+  @brief benchmark of lazurite_readBatch <br>
+  compare the per-frame loop of sample_rx_raw.cpp (lazurite_read + lazurite_decMac)
+  with lazurite_readBatch. runs on lazurite_backend_sim, so LazDriver is not needed.
+
+  @code
+  bench_readbatch [rounds] [batch]
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "../lib/ioctl-lazurite.h"
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+#define FRAMES_PER_ROUND	200
+
+static LAZURITE_BACKEND counting;
+static unsigned long calls;
+
+static int count_ioctl(int fd, unsigned long cmd, unsigned long arg)
+{
+	calls++;
+	return lazurite_backend_sim.ioctl(fd,cmd,arg);
+}
+static int count_read(int fd, void* buf, size_t count)
+{
+	calls++;
+	return lazurite_backend_sim.read(fd,buf,count);
+}
+static int count_recv(int fd, LAZURITE_FRAME* frames, int num)
+{
+	calls++;
+	return lazurite_backend_sim.recv(fd,frames,num);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*! fill rx queue of receiver from peer */
+static void flood(int peer, uint16_t dst)
+{
+	const LAZURITE_BACKEND *sim = &lazurite_backend_sim;
+	char payload[32];
+	int i;
+	sim->ioctl(peer,IOCTL_PARAM | IOCTL_SET_DST_PANID,0xabcd);
+	sim->ioctl(peer,IOCTL_PARAM | IOCTL_SET_DST_ADDR0,dst);
+	for(i=0;i<FRAMES_PER_ROUND;i++) {
+		snprintf(payload,sizeof(payload),"frame %d",i);
+		sim->write(peer,payload,strlen(payload));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const LAZURITE_BACKEND *sim = &lazurite_backend_sim;
+	int rounds = 2000;
+	int batch = 32;
+	int peer;
+	uint16_t myaddr;
+	int r, n, result;
+	unsigned long frames;
+	double t, elapsed;
+	unsigned long call_count;
+	static LAZURITE_FRAME slots[256];
+
+	if(argc>1) rounds = strtol(argv[1],NULL,0);
+	if(argc>2) batch = strtol(argv[2],NULL,0);
+	if((batch < 1) || (batch > 256)) batch = 32;
+
+	counting = lazurite_backend_sim;
+	counting.ioctl = count_ioctl;
+	counting.read = count_read;
+	counting.recv = count_recv;
+	lazurite_setBackend(&counting);
+	if(lazurite_init() < 0) return EXIT_FAILURE;
+	lazurite_begin(36,0xabcd,100,20);
+	lazurite_rxEnable();
+	myaddr = lazurite_getMyAddress();
+
+	peer = sim->open(sim->path);
+	sim->ioctl(peer,IOCTL_PARAM | IOCTL_SET_CH,36);
+	sim->ioctl(peer,IOCTL_PARAM | IOCTL_SET_MY_PANID,0xabcd);
+	sim->ioctl(peer,IOCTL_CMD | IOCTL_SET_BEGIN,0);
+
+	printf("method\tframes\tns/frame\tcalls/frame\n");
+
+	// per-frame loop of sample_rx_raw.cpp
+	frames = 0; elapsed = 0; call_count = 0;
+	for(r=0;r<rounds;r++) {
+		flood(peer,myaddr);
+		calls = 0;
+		t = now();
+		for(;;) {
+			uint16_t size;
+			SUBGHZ_MAC mac;
+			char raw[256];
+			result = lazurite_read(raw,&size);
+			if(result <= 0) break;
+			lazurite_decMac(&mac,raw,size);
+			frames++;
+		}
+		elapsed += now() - t;
+		call_count += calls;
+	}
+	printf("read\t%lu\t%.1f\t%.2f\n",frames,elapsed*1e9/frames,(double)call_count/frames);
+
+	// lazurite_readBatch
+	frames = 0; elapsed = 0; call_count = 0;
+	for(r=0;r<rounds;r++) {
+		flood(peer,myaddr);
+		calls = 0;
+		t = now();
+		while((n = lazurite_readBatch(slots,batch)) > 0) {
+			frames += n;
+		}
+		elapsed += now() - t;
+		call_count += calls;
+	}
+	printf("readBatch(%d)\t%lu\t%.1f\t%.2f\n",batch,frames,elapsed*1e9/frames,(double)call_count/frames);
+
+	sim->close(peer);
+	lazurite_close();
+	lazurite_remove();
+	return 0;
+}
@@ -0,0 +1,233 @@
+/*!
+  @file bench_replay.cpp
+  @brief benchmark of receive path by lazurite_backend_replay <br>
+  frames of a capture file are replayed as fast as possible, and maximum frames/s of
+  lazurite_read, lazurite_readPayload, lazurite_readLink, lazurite_readBatch (with and without filter)
+  and dispatcher are measured. capture of random frames is written first when file is not given.
+  LazDriver is not needed.
+
+  @code
+  bench_replay [frames] [file]
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+#define ROUNDS	3		/*!< best of rounds is reported */
+#define BATCH	64
+#define EXPR	"frame_type==1 && dst_panid==0xabcd && len>20"
+
+/*! frame with random header. returns length */
+static int make_frame(uint8_t *raw)
+{
+	static const uint8_t mode[4] = {0,2,2,3};	// no 8bit address
+	static const uint8_t addr_len[4] = {0,1,2,8};
+	int seq_comp = rand() & 1;
+	int panid_comp = rand() & 1;
+	int dst = mode[rand() & 3];
+	int src = mode[rand() & 3];
+	int addr_type = (dst ? 4 : 0) + (src ? 2 : 0) + panid_comp;
+	uint16_t header = 0x2000 | (rand() & 3) | (panid_comp << 6) | (seq_comp << 8) | (dst << 10) | (src << 14);
+	uint16_t panid = rand() & 1 ? 0xabcd : 0x1234;
+	int len = 0;
+	int i, payload;
+
+	raw[len++] = header & 0xff;
+	raw[len++] = header >> 8;
+	if(!seq_comp) raw[len++] = rand();
+	if((addr_type == 1) || (addr_type == 4) || (addr_type == 6)) {
+		raw[len++] = panid & 0xff;
+		raw[len++] = panid >> 8;
+	}
+	for(i=0;i<addr_len[dst];i++) raw[len++] = rand();
+	if(addr_type == 2) {
+		raw[len++] = panid & 0xff;
+		raw[len++] = panid >> 8;
+	}
+	for(i=0;i<addr_len[src];i++) raw[len++] = rand();
+	payload = rand() % 40;
+	for(i=0;i<payload;i++) raw[len++] = rand();
+	return len;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*! write capture of random frames */
+static int make_capture(const char *path, int frames)
+{
+	static LAZURITE_FRAME batch[BATCH];
+	LAZURITE_CAPTURE_STATS stats;
+	LAZURITE_CAPTURE *capture;
+	int i, n;
+
+	capture = lazurite_openCapture(path,NULL);
+	if(!capture) return -1;
+	srand(1);
+	for(i=0;i<frames;i+=n) {
+		n = frames - i < BATCH ? frames - i : BATCH;
+		for(int j=0;j<n;j++) {
+			batch[j].len = make_frame(batch[j].raw);
+			batch[j].rssi = 100 + (rand() & 63);
+			batch[j].tv_sec = 1700000000 + (i + j) / 1000;
+			batch[j].tv_nsec = ((i + j) % 1000) * 1000000;
+		}
+		// wait for writer instead of dropping frames
+		while(lazurite_writeCapture(capture,batch,n) < n) usleep(1000);
+	}
+	lazurite_getCaptureStats(capture,&stats);
+	lazurite_closeCapture(capture);
+	return stats.error ? -1 : 0;
+}
+
+typedef long (*RECEIVER)(LAZURITE_CTX* ctx);
+
+static long by_read(LAZURITE_CTX* ctx)
+{
+	char raw[256];
+	uint16_t size;
+	long count = 0;
+	while(lazurite_ctx_read(ctx,raw,&size) > 0) count++;
+	return count;
+}
+
+static long total;
+
+static long by_payload(LAZURITE_CTX* ctx)
+{
+	char payload[256];
+	uint16_t size;
+	long count = 0;
+	long i;
+	// empty payload also returns 0, so one frame is read by each call
+	for(i=0;i<total;i++) {
+		if(lazurite_ctx_readPayload(ctx,payload,&size) > 0) count++;
+	}
+	return count;
+}
+
+static long by_link(LAZURITE_CTX* ctx)
+{
+	LAZURITE_LINK_STATS stats;
+	char payload[256];
+	uint16_t size;
+	long count = 0;
+	int result;
+
+	// every frame is looked up in link set
+	lazurite_ctx_setLinkMode(ctx,LAZURITE_LINK_DENY);
+	lazurite_ctx_addLink(ctx,0xfffe);
+	for(;;) {
+		result = lazurite_ctx_readLink(ctx,payload,&size);
+		if(result > 0) count++;
+		if(result != 0) continue;
+		// 0 is also returned when 16 frames are rejected
+		lazurite_ctx_getLinkStats(ctx,&stats,false);
+		if(stats.accepted + stats.rejected >= (unsigned long)total) break;
+	}
+	return count;
+}
+
+static long by_batch(LAZURITE_CTX* ctx)
+{
+	static LAZURITE_FRAME frames[BATCH];
+	long count = 0;
+	int result;
+	while((result = lazurite_ctx_readBatch(ctx,frames,BATCH)) > 0) count += result;
+	return count;
+}
+
+static LAZURITE_FILTER *filter;
+
+static long by_filter(LAZURITE_CTX* ctx)
+{
+	lazurite_ctx_setFilter(ctx,filter);
+	return by_batch(ctx);
+}
+
+static volatile long dispatched;
+
+static void callback(const LAZURITE_FRAME* frame, void* arg)
+{
+	__atomic_add_fetch(&dispatched,1,__ATOMIC_RELAXED);
+}
+
+static long by_dispatcher(LAZURITE_CTX* ctx)
+{
+	struct timespec wait = {0, 100000};
+	dispatched = 0;
+	if(lazurite_ctx_startDispatcher(ctx,callback,NULL) != 0) return -1;
+	while(__atomic_load_n(&dispatched,__ATOMIC_RELAXED) < total) nanosleep(&wait,NULL);
+	lazurite_ctx_stopDispatcher(ctx);
+	return dispatched;
+}
+
+int main(int argc, char **argv)
+{
+	static const struct {
+		const char *name;
+		RECEIVER receiver;
+	} methods[] = {
+		{"read", by_read},
+		{"readPayload", by_payload},
+		{"readLink", by_link},
+		{"readBatch", by_batch},
+		{"readBatch+filter", by_filter},
+		{"dispatcher", by_dispatcher},
+	};
+	char path[] = "/tmp/bench_replay.pcapng";
+	const char *file = path;
+	LAZURITE_CTX *ctx;
+	double t, best;
+	long count = 0;
+	int frames = 1000000;
+	int error_pos;
+	size_t m;
+	int r;
+
+	if(argc>1) frames = strtol(argv[1],NULL,0);
+	if(argc>2) file = argv[2];
+	else if(make_capture(path,frames) != 0) {
+		fprintf(stderr,"failed to write %s\n",path);
+		return EXIT_FAILURE;
+	}
+	filter = lazurite_compileFilter(EXPR,&error_pos);
+
+	// frames in the file
+	ctx = lazurite_openCtx(&lazurite_backend_replay,file);
+	if(!ctx) {
+		fprintf(stderr,"failed to open %s\n",file);
+		return EXIT_FAILURE;
+	}
+	total = by_batch(ctx);
+	lazurite_closeCtx(ctx);
+
+	printf("method\tframes/s\tframes\n");
+	for(m=0;m<sizeof(methods)/sizeof(methods[0]);m++) {
+		best = 0;
+		for(r=0;r<ROUNDS;r++) {
+			ctx = lazurite_openCtx(&lazurite_backend_replay,file);
+			if(!ctx) return EXIT_FAILURE;
+			t = now();
+			count = methods[m].receiver(ctx);
+			t = total / (now() - t);
+			if(t > best) best = t;
+			lazurite_closeCtx(ctx);
+		}
+		printf("%s\t%.0f\t%ld\n",methods[m].name,best,count);
+	}
+	lazurite_freeFilter(filter);
+	if(argc<=2) unlink(path);
+	return 0;
+}
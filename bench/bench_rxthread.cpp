@@ -0,0 +1,146 @@
+/*!
+  @file bench_rxthread.cpp
+  @brief benchmark of rx thread <br>
+  a sender thread sends bursts of frames to the receiver, and the receiver gets them by
+  lazurite_wait + lazurite_readBatch in application thread, or by rx thread + lazurite_getRxFrames.
+  application stalls for a while every STALL_INTERVAL frames (flush to storage and so on).
+  frames are lost when queue of driver is overflowed during the stall.
+  runs on lazurite_backend_sim, so LazDriver is not needed.
+
+  @code
+  bench_rxthread [frames] [depth] [stall(us)]
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+#define PANID	0xabcd
+#define BURST	16		/*!< frames sent at once */
+#define BURST_INTERVAL	200000	/*!< ns between bursts */
+#define STALL_INTERVAL	2000	/*!< frames between stalls of application */
+
+static LAZURITE_CTX *tx;
+static uint16_t dst;
+static int frames = 100000;
+static int sent;
+static int finished;
+static long stall = 5000;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*! latency from sending (CLOCK_REALTIME in frame) */
+static double latency(const LAZURITE_FRAME *frame)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME,&ts);
+	return (ts.tv_sec - frame->tv_sec) + (ts.tv_nsec - frame->tv_nsec) * 1e-9;
+}
+
+static void* sender_main(void* arg)
+{
+	struct timespec interval = {0, BURST_INTERVAL};
+	char payload[32];
+	int i;
+
+	sent = 0;
+	for(i=0;i<frames;i++) {
+		snprintf(payload,sizeof(payload),"frame %d",i);
+		if(lazurite_ctx_send(tx,PANID,dst,payload,strlen(payload)) >= 0) sent++;
+		if((i % BURST) == BURST - 1) nanosleep(&interval,NULL);
+	}
+	__atomic_store_n(&finished,1,__ATOMIC_RELEASE);
+	return NULL;
+}
+
+/*! work of application */
+static void consume(int received, int n)
+{
+	struct timespec ts = {stall / 1000000, (stall % 1000000) * 1000};
+	if((received / STALL_INTERVAL) != ((received + n) / STALL_INTERVAL)) nanosleep(&ts,NULL);
+}
+
+static void result(const char *method, int received, double elapsed, double total_latency)
+{
+	printf("%s\t%d\t%d\t%.0f\t%.1f\n",method,received,sent - received,
+			received / elapsed,received ? total_latency * 1e6 / received : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+	static LAZURITE_FRAME slots[64];
+	LAZURITE_CTX *rx;
+	pthread_t thread;
+	int depth = 4096;
+	int received;
+	double t, total_latency;
+	int n, i;
+
+	if(argc>1) frames = strtol(argv[1],NULL,0);
+	if(argc>2) depth = strtol(argv[2],NULL,0);
+	if(argc>3) stall = strtol(argv[3],NULL,0);
+	if((depth < 1) || (depth > 32768)) depth = 4096;
+
+	rx = lazurite_openCtx(&lazurite_backend_sim,NULL);
+	tx = lazurite_openCtx(&lazurite_backend_sim,NULL);
+	if(!rx || !tx) return EXIT_FAILURE;
+	lazurite_ctx_begin(rx,36,PANID,100,20);
+	lazurite_ctx_begin(tx,36,PANID,100,20);
+	lazurite_ctx_rxEnable(rx);
+	dst = lazurite_ctx_getMyAddress(rx);
+
+	printf("method\treceived\tlost\tframes/s\tlatency(us)\n");
+
+	// application thread reads from device
+	received = 0; total_latency = 0; finished = 0;
+	t = now();
+	pthread_create(&thread,NULL,sender_main,NULL);
+	for(;;) {
+		n = lazurite_ctx_readBatch(rx,slots,sizeof(slots)/sizeof(slots[0]));
+		if(n < 0) break;
+		if(n == 0) {
+			if(__atomic_load_n(&finished,__ATOMIC_ACQUIRE)) break;
+			lazurite_ctx_wait(rx,10);
+			continue;
+		}
+		for(i=0;i<n;i++) total_latency += latency(&slots[i]);
+		consume(received,n);
+		received += n;
+	}
+	pthread_join(thread,NULL);
+	result("readBatch",received,now() - t,total_latency);
+
+	// rx thread pushes to ring
+	lazurite_ctx_startRxThread(rx,depth,-1);
+	received = 0; total_latency = 0; finished = 0;
+	t = now();
+	pthread_create(&thread,NULL,sender_main,NULL);
+	for(;;) {
+		n = lazurite_ctx_getRxFrames(rx,slots,sizeof(slots)/sizeof(slots[0]),10);
+		if(n < 0) break;
+		if(n == 0) {
+			if(__atomic_load_n(&finished,__ATOMIC_ACQUIRE)) break;
+			continue;
+		}
+		for(i=0;i<n;i++) total_latency += latency(&slots[i]);
+		consume(received,n);
+		received += n;
+	}
+	pthread_join(thread,NULL);
+	result("rxThread",received,now() - t,total_latency);
+
+	lazurite_closeCtx(tx);
+	lazurite_closeCtx(rx);
+	return 0;
+}
@@ -0,0 +1,110 @@
+/*!
+  @file bench_startup.cpp
+  @brief benchmark of startup <br>
+  measure time from lazurite_init to the first received frame, and lazurite_remove.
+  with lzgw, LazDriver is loaded and removed in each round, and the first frame is
+  any frame on the ch (waits 10s in maximum).
+  with sim, a peer sends a frame just after lazurite_rxEnable.
+  "system" is the cost of one system() call, which old lazurite_init called twice
+  and old lazurite_remove called once after sleeping 100ms.
+
+  @code
+  bench_startup [sim|lzgw] [rounds] [ch] [panid]
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "../lib/ioctl-lazurite.h"
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	const LAZURITE_BACKEND *sim = &lazurite_backend_sim;
+	bool use_sim = true;
+	int rounds = 100;
+	uint8_t ch = 36;
+	uint16_t panid = 0xabcd;
+	int peer = -1;
+	uint16_t myaddr;
+	double t0, t1, t2, t3, t4;
+	double init = 0, ready = 0, first = 0, remove = 0, shell = 0;
+	int frames = 0;
+	LAZURITE_FRAME frame;
+	int r, result;
+
+	if(argc>1) use_sim = strcmp(argv[1],"lzgw") != 0;
+	if(argc>2) rounds = strtol(argv[2],NULL,0);
+	if(argc>3) ch = strtol(argv[3],NULL,0);
+	if(argc>4) panid = strtol(argv[4],NULL,0);
+	if(!use_sim && (rounds > 10)) rounds = 10;
+
+	if(use_sim) {
+		lazurite_setBackend(sim);
+		peer = sim->open(sim->path);
+		sim->ioctl(peer,IOCTL_PARAM | IOCTL_SET_CH,ch);
+		sim->ioctl(peer,IOCTL_PARAM | IOCTL_SET_MY_PANID,panid);
+		sim->ioctl(peer,IOCTL_CMD | IOCTL_SET_BEGIN,0);
+		sim->ioctl(peer,IOCTL_PARAM | IOCTL_SET_DST_PANID,panid);
+		sim->ioctl(peer,IOCTL_PARAM | IOCTL_SET_DST_ADDR0,0xffff);
+	}
+
+	for(r=0;r<rounds;r++) {
+		t0 = now();
+		result = lazurite_init();
+		if(result < 0) {
+			fprintf(stderr,"lazurite_init error %d\n",result);
+			return EXIT_FAILURE;
+		}
+		t1 = now();
+		lazurite_begin(ch,panid,100,20);
+		lazurite_rxEnable();
+		myaddr = lazurite_getMyAddress();
+		t2 = now();
+		if(use_sim) sim->write(peer,&myaddr,sizeof(myaddr));
+		result = 0;
+		while(now() - t2 < 10) {
+			result = lazurite_readFrame(&frame);
+			if(result != 0) break;
+			lazurite_wait(100);
+		}
+		t3 = now();
+		lazurite_close();
+		lazurite_remove();
+		t4 = now();
+
+		init += t1 - t0;
+		ready += t2 - t1;
+		if(result > 0) {
+			first += t3 - t0;
+			frames++;
+		}
+		remove += t4 - t3;
+	}
+
+	for(r=0;r<rounds;r++) {
+		t0 = now();
+		system("true");
+		shell += now() - t0;
+	}
+
+	printf("backend\trounds\tinit(us)\tbegin(us)\tfirst frame(us)\tremove(us)\tsystem(us)\n");
+	printf("%s\t%d\t%.1f\t%.1f\t",use_sim ? "sim" : "lzgw",rounds,init*1e6/rounds,ready*1e6/rounds);
+	if(frames) printf("%.1f\t",first*1e6/frames);
+	else printf("-\t");
+	printf("%.1f\t%.1f\n",remove*1e6/rounds,shell*1e6/rounds);
+
+	if(peer >= 0) sim->close(peer);
+	return 0;
+}
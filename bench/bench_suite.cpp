@@ -0,0 +1,368 @@
+/*!
+  @file bench_suite.cpp
+  @brief benchmarks of hot paths of the library in JSON <br>
+  results can be kept for each release and compared to find regressions.
+  runs on lazurite_backend_sim and lazurite_backend_replay, so LazDriver is not needed
+  (lib is built with ioctl-lazurite.h when drv-lazurite.h is not found).
+
+  - decmac: lazurite_decMac for every addr_type, with 16bit and 64bit addresses
+  - rx: lazurite_read, lazurite_readPayload, lazurite_readLink and lazurite_readStream
+    on frames replayed from a capture, and read calls of backend for each frame
+  - tx: lazurite_send, lazurite_send64le and lazurite_send64be to the same and to
+    alternating destinations, and ioctl/write calls of backend for each frame (lazurite_getMetrics).
+    destinations are different only in lower 16bit, so DST_ADDR0 is set for each frame of
+    16bit address, and DST_ADDR0..3 of 64bit address (driver clears DST_ADDR1..3 by DST_ADDR0).
+    every frame must be acked.
+
+  exit status is EXIT_FAILURE when frames are lost or calls of backend are not expected.
+
+  @code
+  bench_suite [frames] > bench_suite.json
+  @endcode
+  @code
+  {"frames": 200000, "results": [
+    {"group": "decmac", "name": "addr_type=6/16bit", "frames_per_sec": 98765432},
+    {"group": "tx", "name": "send64le/alternate", "frames_per_sec": 1234567, "sent": 200000, "ioctl_per_frame": 4.00, "write_per_frame": 1.00},
+    ...
+  ]}
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+#define ROUNDS	3		/*!< best of rounds is reported */
+#define FRAMES	1024	/*!< frames in a set of decmac */
+#define BATCH	64
+#define PAYLOAD	16
+#define PANID	0xabcd
+
+typedef struct {
+	uint16_t len;
+	uint8_t raw[64];
+} BENCH_FRAME;
+
+static int results;
+static int failures;		/*!< checks failed */
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*! one object of "results". extra is members after frames_per_sec, or NULL */
+static void result(const char *group, const char *name, double rate, const char *extra)
+{
+	printf("%s\n    {\"group\": \"%s\", \"name\": \"%s\", \"frames_per_sec\": %.0f%s%s}",
+			results++ ? "," : "",group,name,rate,extra ? ", " : "",extra ? extra : "");
+}
+
+/*! frame of addr_type. address is 2 or 8 bytes, or none when addr_type has no address */
+static int make_frame(uint8_t *raw, int addr_type, int addr_len, uint8_t seq)
+{
+	int dst = addr_type & 4 ? (addr_len == 8 ? 3 : 2) : 0;
+	int src = addr_type & 2 ? (addr_len == 8 ? 3 : 2) : 0;
+	int panid_comp = addr_type & 1;
+	uint16_t header = 0x2001 | (panid_comp << 6) | (dst << 10) | (src << 14);
+	int len = 0;
+	int i;
+
+	raw[len++] = header & 0xff;
+	raw[len++] = header >> 8;
+	raw[len++] = seq;
+	if((addr_type == 1) || (addr_type == 4) || (addr_type == 6)) {
+		raw[len++] = PANID & 0xff;
+		raw[len++] = PANID >> 8;
+	}
+	for(i=0;i<(dst ? addr_len : 0);i++) raw[len++] = 0x10 + i;
+	if(addr_type == 2) {
+		raw[len++] = PANID & 0xff;
+		raw[len++] = PANID >> 8;
+	}
+	for(i=0;i<(src ? addr_len : 0);i++) raw[len++] = 0x20 + i;
+	for(i=0;i<PAYLOAD;i++) raw[len++] = 'a' + i;
+	return len;
+}
+
+static void bench_decmac(long frames)
+{
+	static BENCH_FRAME set[FRAMES];
+	SUBGHZ_MAC mac;
+	unsigned long sum = 0;
+	char name[32];
+	double t, best;
+	int addr_type, addr_len;
+	long i;
+	int r;
+
+	for(addr_type=0;addr_type<8;addr_type++) {
+		for(addr_len=2;addr_len<=8;addr_len+=6) {
+			// addr_type 0 and 1 have no address
+			if((addr_type < 2) && (addr_len == 8)) continue;
+			for(i=0;i<FRAMES;i++) set[i].len = make_frame(set[i].raw,addr_type,addr_len,i);
+			best = 0;
+			for(r=0;r<ROUNDS;r++) {
+				t = now();
+				for(i=0;i<frames;i++) {
+					BENCH_FRAME *frame = &set[i % FRAMES];
+					lazurite_decMac(&mac,frame->raw,frame->len);
+					sum += mac.payload_offset + mac.src_addr[0];
+				}
+				t = frames / (now() - t);
+				if(t > best) best = t;
+			}
+			if(addr_type < 2) snprintf(name,sizeof(name),"addr_type=%d",addr_type);
+			else snprintf(name,sizeof(name),"addr_type=%d/%dbit",addr_type,addr_len * 8);
+			result("decmac",name,best,NULL);
+		}
+	}
+	// keep decoding from being removed
+	if(sum == 0) {
+		fprintf(stderr,"decmac: no result\n");
+		failures++;
+	}
+}
+
+/*! capture of frames with short addresses and payload, like a sensor network */
+static int make_capture(const char *path, int frames)
+{
+	static LAZURITE_FRAME batch[BATCH];
+	LAZURITE_CAPTURE_STATS stats;
+	LAZURITE_CAPTURE *capture;
+	int i, j, n;
+
+	capture = lazurite_openCapture(path,NULL);
+	if(!capture) return -1;
+	for(i=0;i<frames;i+=n) {
+		n = frames - i < BATCH ? frames - i : BATCH;
+		for(j=0;j<n;j++) {
+			batch[j].len = make_frame(batch[j].raw,(i + j) & 1 ? 7 : 6,2,i + j);
+			batch[j].rssi = 150;
+			batch[j].tv_sec = 1700000000 + (i + j) / 1000;
+			batch[j].tv_nsec = ((i + j) % 1000) * 1000000;
+		}
+		// wait for writer instead of dropping frames
+		while(lazurite_writeCapture(capture,batch,n) < n) usleep(1000);
+	}
+	lazurite_getCaptureStats(capture,&stats);
+	lazurite_closeCapture(capture);
+	return stats.error ? -1 : 0;
+}
+
+static long by_read(LAZURITE_CTX* ctx, int frames)
+{
+	char raw[256];
+	uint16_t size;
+	long count = 0;
+	while(lazurite_ctx_read(ctx,raw,&size) > 0) count++;
+	return count;
+}
+
+static long by_payload(LAZURITE_CTX* ctx, int frames)
+{
+	char payload[256];
+	uint16_t size;
+	long count = 0;
+	while(lazurite_ctx_readPayload(ctx,payload,&size) > 0) count++;
+	return count;
+}
+
+static long by_link(LAZURITE_CTX* ctx, int frames)
+{
+	LAZURITE_LINK_STATS stats;
+	char payload[256];
+	uint16_t size;
+	long count = 0;
+	int result;
+
+	// every frame is looked up in link set
+	lazurite_ctx_setLinkMode(ctx,LAZURITE_LINK_DENY);
+	lazurite_ctx_addLink(ctx,0xfffe);
+	for(;;) {
+		result = lazurite_ctx_readLink(ctx,payload,&size);
+		if(result > 0) count++;
+		if(result != 0) continue;
+		// 0 is also returned when 16 frames are rejected
+		lazurite_ctx_getLinkStats(ctx,&stats,false);
+		if(stats.accepted + stats.rejected >= (unsigned long)frames) break;
+	}
+	return count;
+}
+
+static long by_stream(LAZURITE_CTX* ctx, int frames)
+{
+	char stream[LAZURITE_FORMAT_LINE_MAX];
+	uint16_t size;
+	long count = 0;
+	for(;;) {
+		size = sizeof(stream);
+		if(lazurite_ctx_readStream(ctx,stream,&size) <= 0) break;
+		count++;
+	}
+	return count;
+}
+
+static void bench_rx(int frames)
+{
+	static const struct {
+		const char *name;
+		long (*receiver)(LAZURITE_CTX* ctx, int frames);
+	} methods[] = {
+		{"read", by_read},
+		{"readPayload", by_payload},
+		{"readLink", by_link},
+		{"readStream", by_stream},
+	};
+	char path[] = "/tmp/bench_suite.pcapng";
+	LAZURITE_METRICS *metrics;
+	LAZURITE_CTX *ctx;
+	char extra[64];
+	double t, best;
+	long count = 0;
+	size_t m;
+	int r;
+
+	if(make_capture(path,frames) != 0) {
+		fprintf(stderr,"failed to write %s\n",path);
+		failures++;
+		return;
+	}
+	// too large for stack
+	metrics = (LAZURITE_METRICS*)malloc(sizeof(LAZURITE_METRICS));
+	for(m=0;m<sizeof(methods)/sizeof(methods[0]);m++) {
+		best = 0;
+		for(r=0;r<ROUNDS;r++) {
+			ctx = lazurite_openCtx(&lazurite_backend_replay,path);
+			if(!ctx) break;
+			t = now();
+			count = methods[m].receiver(ctx,frames);
+			t = frames / (now() - t);
+			if(t > best) best = t;
+			lazurite_ctx_getMetrics(ctx,metrics);
+			lazurite_closeCtx(ctx);
+		}
+		if(count != frames) {
+			fprintf(stderr,"%s: %ld of %d frames\n",methods[m].name,count,frames);
+			failures++;
+		}
+		snprintf(extra,sizeof(extra),"\"read_per_frame\": %.2f",(double)metrics->read_calls / frames);
+		result("rx",methods[m].name,best,extra);
+	}
+	free(metrics);
+	unlink(path);
+}
+
+static void bench_tx(int frames)
+{
+	static const struct {
+		const char *name;
+		int method;		/*!< 0 = send, 1 = send64le, 2 = send64be */
+		bool alternate;	/*!< destination is changed for each frame */
+		int ioctl;		/*!< expected ioctl for each frame */
+	} cases[] = {
+		{"send/same", 0, false, 0},
+		{"send/alternate", 0, true, 1},
+		{"send64le/same", 1, false, 0},
+		{"send64le/alternate", 1, true, 4},
+		{"send64be/same", 2, false, 0},
+		{"send64be/alternate", 2, true, 4},
+	};
+	LAZURITE_METRICS *before, *after;
+	LAZURITE_CTX *tx, *rx[2];
+	uint16_t addr16[2];
+	uint8_t addr_be[2][8];
+	uint8_t addr_le[2][8];
+	char payload[PAYLOAD];
+	char extra[128];
+	double t, best;
+	double ioctl_per_frame, write_per_frame;
+	long sent = 0;
+	size_t c;
+	int i, j, k, r;
+
+	memset(payload,'a',sizeof(payload));
+	before = (LAZURITE_METRICS*)malloc(sizeof(LAZURITE_METRICS));
+	after = (LAZURITE_METRICS*)malloc(sizeof(LAZURITE_METRICS));
+	tx = lazurite_openCtx(&lazurite_backend_sim,NULL);
+	lazurite_ctx_begin(tx,36,PANID,100,20);
+	for(i=0;i<2;i++) {
+		// frames are not read. sim drops them when its queue is full, but they are acked
+		rx[i] = lazurite_openCtx(&lazurite_backend_sim,NULL);
+		lazurite_ctx_begin(rx[i],36,PANID,100,20);
+		lazurite_ctx_rxEnable(rx[i]);
+		// not lower 16bit of 64bit address, so a frame sent by 16bit address by mistake is not acked
+		addr16[i] = 0x1000 + i;
+		lazurite_ctx_setMyAddress(rx[i],addr16[i]);
+		lazurite_ctx_getMyAddr64(rx[i],addr_be[i]);
+		for(k=0;k<8;k++) addr_le[i][k] = addr_be[i][7-k];
+	}
+
+	for(c=0;c<sizeof(cases)/sizeof(cases[0]);c++) {
+		best = 0;
+		for(r=0;r<ROUNDS;r++) {
+			lazurite_ctx_getMetrics(tx,before);
+			sent = 0;
+			t = now();
+			for(i=0;i<frames;i++) {
+				j = cases[c].alternate ? i & 1 : 0;
+				switch(cases[c].method) {
+					case 0:
+						k = lazurite_ctx_send(tx,PANID,addr16[j],payload,sizeof(payload));
+						break;
+					case 1:
+						k = lazurite_ctx_send64le(tx,addr_le[j],payload,sizeof(payload));
+						break;
+					default:
+						k = lazurite_ctx_send64be(tx,addr_be[j],payload,sizeof(payload));
+						break;
+				}
+				if(k >= 0) sent++;
+			}
+			t = frames / (now() - t);
+			if(t > best) best = t;
+			lazurite_ctx_getMetrics(tx,after);
+		}
+		// calls of last round. shadow registers of the first frame are not counted again
+		ioctl_per_frame = (double)(after->ioctl_calls - before->ioctl_calls) / frames;
+		write_per_frame = (double)(after->write_calls - before->write_calls) / frames;
+		if((sent != frames) || (ioctl_per_frame > cases[c].ioctl + 0.01) || (ioctl_per_frame < cases[c].ioctl - 0.01)) {
+			fprintf(stderr,"%s: %ld of %d frames sent, %.2f ioctl for each frame (expected %d)\n",
+					cases[c].name,sent,frames,ioctl_per_frame,cases[c].ioctl);
+			failures++;
+		}
+		snprintf(extra,sizeof(extra),"\"sent\": %ld, \"ioctl_per_frame\": %.2f, \"write_per_frame\": %.2f",
+				sent,ioctl_per_frame,write_per_frame);
+		result("tx",cases[c].name,best,extra);
+	}
+	lazurite_closeCtx(tx);
+	lazurite_closeCtx(rx[0]);
+	lazurite_closeCtx(rx[1]);
+	free(before);
+	free(after);
+}
+
+int main(int argc, char **argv)
+{
+	int frames = 200000;
+
+	if(argc>1) frames = strtol(argv[1],NULL,0);
+	if(frames <= 0) {
+		fprintf(stderr,"bad frames: %s\n",argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	printf("{\"frames\": %d, \"results\": [",frames);
+	bench_decmac(frames * 10L);
+	bench_rx(frames);
+	bench_tx(frames);
+	printf("\n]}\n");
+	return failures ? EXIT_FAILURE : 0;
+}
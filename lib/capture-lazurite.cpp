@@ -0,0 +1,411 @@
+/*!
+  @file capture-lazurite.cpp
+  @brief capture of received frames to pcapng file <br>
+  used by lazurite_openCapture, lazurite_writeCapture and lazurite_setCapture.
+
+  frames are put into chunks of memory as enhanced packet blocks, and a writer thread
+  writes filled chunks to file. the thread which receives frames never waits for the disk.
+  when all chunks are waiting for the disk, frames are dropped and counted.<br>
+  rotation is decided when a frame is put, so each file starts with section header and
+  interface description, and ends at a block boundary.
+
+  block of a file | contents
+  ----------------| --------
+  section header  | user application "liblazurite"
+  interface       | link type 230 (IEEE 802.15.4 without FCS), timestamp resolution nsec
+  packet          | receiving time, raw frame, comment "rssi=N"
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "liblazurite.h"
+#include "pcap-lazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define CAPTURE_CHUNK_SIZE		65536		/*!< bytes of one write */
+#define CAPTURE_BUFFER_SIZE		(4 * 1024 * 1024)	/*!< default of buffer_size */
+#define CAPTURE_FLUSH_SEC		1			/*!< partial chunk is written after this time */
+#define CAPTURE_EPB_LEN(len)	(48 + PCAPNG_ALIGN(len))	/*!< enhanced packet block. comment is 8 bytes at most */
+#define CAPTURE_EPB_MAX			CAPTURE_EPB_LEN(256)
+
+	typedef struct {
+		uint8_t *data;
+		uint32_t len;
+		bool rotate;			/*!< next file is opened before data is written */
+	} CAPTURE_CHUNK;
+
+	struct lazurite_capture {
+		char path[PATH_MAX];
+		LAZURITE_CAPTURE_PARAM param;
+		int fd;
+		unsigned long index;	/*!< number of current file (writer) */
+		pthread_t thread;
+		pthread_mutex_t lock;
+		pthread_cond_t cond;	/*!< chunk is queued or stop */
+		bool stop;
+		CAPTURE_CHUNK *chunk;
+		uint32_t num;
+		uint32_t *free_list;	/*!< stack of free chunks */
+		uint32_t free_count;
+		uint32_t *queue;		/*!< chunks to be written */
+		uint32_t queue_head;
+		uint32_t queue_count;
+		CAPTURE_CHUNK *current;	/*!< chunk being filled. NULL = not taken */
+		uint32_t header_len;	/*!< section header and interface description */
+		unsigned long long file_bytes;	/*!< bytes put for current file */
+		time_t file_start;		/*!< receiving time of first frame of current file */
+		LAZURITE_CAPTURE_STATS stats;
+	};
+
+	static uint8_t* capture_put16(uint8_t *p, uint16_t value)
+	{
+		memcpy(p,&value,2);
+		return p + 2;
+	}
+
+	static uint8_t* capture_put32(uint8_t *p, uint32_t value)
+	{
+		memcpy(p,&value,4);
+		return p + 4;
+	}
+
+	static uint8_t* capture_putOption(uint8_t *p, uint16_t code, const void *value, uint16_t len)
+	{
+		p = capture_put16(p,code);
+		p = capture_put16(p,len);
+		if(len) memcpy(p,value,len);
+		memset(p + len,0,PCAPNG_ALIGN(len) - len);
+		return p + PCAPNG_ALIGN(len);
+	}
+
+	/******************************************************************************/
+	/*! @brief put total length to top and end of block
+		@return         end of block
+	 ******************************************************************************/
+	static uint8_t* capture_endBlock(uint8_t *top, uint8_t *p)
+	{
+		uint32_t len = p - top + 4;
+		capture_put32(top + 4,len);
+		return capture_put32(p,len);
+	}
+
+	/******************************************************************************/
+	/*! @brief section header and interface description
+		@return         length of header
+	 ******************************************************************************/
+	static uint32_t capture_header(uint8_t *buf)
+	{
+		static const char appl[] = "liblazurite";
+		uint8_t tsresol = 9;
+		uint8_t *p = buf, *top;
+		uint64_t section_len = ~0ULL;
+
+		top = p;
+		p = capture_put32(p,PCAPNG_SHB);
+		p += 4;
+		p = capture_put32(p,PCAPNG_BYTE_ORDER);
+		p = capture_put16(p,1);
+		p = capture_put16(p,0);
+		memcpy(p,&section_len,8);
+		p += 8;
+		p = capture_putOption(p,PCAPNG_OPT_SHB_USERAPPL,appl,sizeof(appl) - 1);
+		p = capture_putOption(p,PCAPNG_OPT_END,NULL,0);
+		p = capture_endBlock(top,p);
+
+		top = p;
+		p = capture_put32(p,PCAPNG_IDB);
+		p += 4;
+		p = capture_put16(p,PCAP_LINKTYPE_IEEE802_15_4_NOFCS);
+		p = capture_put16(p,0);
+		p = capture_put32(p,sizeof(((LAZURITE_FRAME*)0)->raw));
+		p = capture_putOption(p,PCAPNG_OPT_IF_TSRESOL,&tsresol,1);
+		p = capture_putOption(p,PCAPNG_OPT_END,NULL,0);
+		p = capture_endBlock(top,p);
+		return p - buf;
+	}
+
+	/******************************************************************************/
+	/*! @brief enhanced packet block of frame
+		@return         length of block
+	 ******************************************************************************/
+	static uint32_t capture_packet(uint8_t *buf, const LAZURITE_FRAME *frame, uint64_t ts)
+	{
+		char comment[16];
+		uint8_t *p = buf;
+		int len;
+
+		p = capture_put32(p,PCAPNG_EPB);
+		p += 4;
+		p = capture_put32(p,0);
+		p = capture_put32(p,(uint32_t)(ts >> 32));
+		p = capture_put32(p,(uint32_t)ts);
+		p = capture_put32(p,frame->len);
+		p = capture_put32(p,frame->len);
+		memcpy(p,frame->raw,frame->len);
+		memset(p + frame->len,0,PCAPNG_ALIGN(frame->len) - frame->len);
+		p += PCAPNG_ALIGN(frame->len);
+		len = snprintf(comment,sizeof(comment),"rssi=%u",frame->rssi);
+		p = capture_putOption(p,PCAPNG_OPT_COMMENT,comment,len);
+		p = capture_putOption(p,PCAPNG_OPT_END,NULL,0);
+		return capture_endBlock(buf,p) - buf;
+	}
+
+	/******************************************************************************/
+	/*! @brief name of file
+		index is put before extension when files are rotated. (ex) rx.pcapng -> rx_00001.pcapng
+	 ******************************************************************************/
+	static void capture_name(const LAZURITE_CAPTURE *capture, unsigned long index, char *name, size_t size)
+	{
+		const char *ext = strrchr(capture->path,'.');
+		const char *dir = strrchr(capture->path,'/');
+
+		if(!capture->param.rotate_size && !capture->param.rotate_sec) {
+			snprintf(name,size,"%s",capture->path);
+			return;
+		}
+		if(!ext || (dir && (ext < dir))) ext = capture->path + strlen(capture->path);
+		snprintf(name,size,"%.*s_%05lu%s",(int)(ext - capture->path),capture->path,index,ext);
+	}
+
+	static int capture_write(int fd, const uint8_t *data, uint32_t len)
+	{
+		ssize_t result;
+
+		while(len) {
+			result = write(fd,data,len);
+			if(result < 0) {
+				if(errno == EINTR) continue;
+				return -errno;
+			}
+			data += result;
+			len -= result;
+		}
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief close current file and open next one with header
+		@return         0=success <br> 0 > fail
+	 ******************************************************************************/
+	static int capture_open(LAZURITE_CAPTURE *capture, unsigned long index)
+	{
+		char name[PATH_MAX + 8];
+		uint8_t header[128];
+		uint32_t len;
+		int result;
+
+		if(capture->fd >= 0) close(capture->fd);
+		capture->index = index;
+		capture_name(capture,index,name,sizeof(name));
+		capture->fd = open(name,O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,0644);
+		if(capture->fd < 0) return -errno;
+		len = capture_header(header);
+		result = capture_write(capture->fd,header,len);
+		pthread_mutex_lock(&capture->lock);
+		capture->stats.files++;
+		if(!result) capture->stats.bytes += len;
+		pthread_mutex_unlock(&capture->lock);
+		return result;
+	}
+
+	/******************************************************************************/
+	/*! @brief queue chunk to writer. called under lock
+	 ******************************************************************************/
+	static void capture_queue(LAZURITE_CAPTURE *capture)
+	{
+		capture->queue[(capture->queue_head + capture->queue_count) % capture->num] = capture->current - capture->chunk;
+		capture->queue_count++;
+		capture->current = NULL;
+		pthread_cond_signal(&capture->cond);
+	}
+
+	/******************************************************************************/
+	/*! @brief main loop of writer thread
+	 ******************************************************************************/
+	static void* capture_main(void* arg)
+	{
+		LAZURITE_CAPTURE *capture = (LAZURITE_CAPTURE*)arg;
+		CAPTURE_CHUNK *chunk;
+		struct timespec ts;
+		int result;
+
+		pthread_mutex_lock(&capture->lock);
+		for(;;) {
+			while(!capture->queue_count && !capture->stop) {
+				clock_gettime(CLOCK_REALTIME,&ts);
+				ts.tv_sec += CAPTURE_FLUSH_SEC;
+				if((pthread_cond_timedwait(&capture->cond,&capture->lock,&ts) == ETIMEDOUT) &&
+						capture->current && capture->current->len) {
+					capture_queue(capture);
+				}
+			}
+			if(!capture->queue_count) break;
+			chunk = &capture->chunk[capture->queue[capture->queue_head]];
+			capture->queue_head = (capture->queue_head + 1) % capture->num;
+			capture->queue_count--;
+			pthread_mutex_unlock(&capture->lock);
+
+			result = 0;
+			if(chunk->rotate) result = capture_open(capture,capture->index + 1);
+			if(!result && chunk->len) result = capture_write(capture->fd,chunk->data,chunk->len);
+
+			pthread_mutex_lock(&capture->lock);
+			if(result) capture->stats.error = result;
+			else capture->stats.bytes += chunk->len;
+			chunk->len = 0;
+			chunk->rotate = false;
+			capture->free_list[capture->free_count++] = chunk - capture->chunk;
+		}
+		pthread_mutex_unlock(&capture->lock);
+		return NULL;
+	}
+
+	extern "C" LAZURITE_CAPTURE* lazurite_openCapture(const char* path, const LAZURITE_CAPTURE_PARAM* param)
+	{
+		LAZURITE_CAPTURE *capture;
+		uint8_t header[128];
+		unsigned long buffer_size;
+		uint32_t i;
+		int result;
+
+		if(!path || (strlen(path) >= PATH_MAX)) {
+			errno = EINVAL;
+			return NULL;
+		}
+		capture = (LAZURITE_CAPTURE*)calloc(1,sizeof(LAZURITE_CAPTURE));
+		if(!capture) return NULL;
+		snprintf(capture->path,sizeof(capture->path),"%s",path);
+		if(param) capture->param = *param;
+		buffer_size = capture->param.buffer_size ? capture->param.buffer_size : CAPTURE_BUFFER_SIZE;
+		capture->num = buffer_size / CAPTURE_CHUNK_SIZE;
+		if(capture->num < 2) capture->num = 2;
+		capture->fd = -1;
+		capture->chunk = (CAPTURE_CHUNK*)calloc(capture->num,sizeof(CAPTURE_CHUNK));
+		capture->free_list = (uint32_t*)calloc(capture->num,sizeof(uint32_t));
+		capture->queue = (uint32_t*)calloc(capture->num,sizeof(uint32_t));
+		result = (capture->chunk && capture->free_list && capture->queue) ? 0 : -ENOMEM;
+		for(i=0;!result && (i<capture->num);i++) {
+			capture->chunk[i].data = (uint8_t*)malloc(CAPTURE_CHUNK_SIZE);
+			if(!capture->chunk[i].data) result = -ENOMEM;
+			capture->free_list[capture->free_count++] = i;
+		}
+		pthread_mutex_init(&capture->lock,NULL);
+		pthread_cond_init(&capture->cond,NULL);
+		capture->header_len = capture_header(header);
+		if(!result) result = capture_open(capture,0);
+		capture->file_bytes = capture->header_len;
+		if(!result) result = -pthread_create(&capture->thread,NULL,capture_main,capture);
+		if(result) {
+			if(capture->fd >= 0) close(capture->fd);
+			for(i=0;capture->chunk && (i<capture->num);i++) free(capture->chunk[i].data);
+			free(capture->chunk);
+			free(capture->free_list);
+			free(capture->queue);
+			pthread_cond_destroy(&capture->cond);
+			pthread_mutex_destroy(&capture->lock);
+			free(capture);
+			errno = -result;
+			return NULL;
+		}
+		return capture;
+	}
+
+	extern "C" int lazurite_writeCapture(LAZURITE_CAPTURE* capture, const LAZURITE_FRAME* frames, int num)
+	{
+		const LAZURITE_FRAME *frame;
+		struct timespec now;
+		uint64_t ts;
+		time_t sec;
+		bool rotate;
+		int written = 0;
+		int i;
+
+		if(!capture || !frames || (num < 0)) return -EINVAL;
+		pthread_mutex_lock(&capture->lock);
+		for(i=0;i<num;i++) {
+			frame = &frames[i];
+			if(frame->tv_sec) {
+				sec = frame->tv_sec;
+				ts = (uint64_t)frame->tv_sec * 1000000000ULL + frame->tv_nsec;
+			} else {
+				// time is not given by driver
+				clock_gettime(CLOCK_REALTIME,&now);
+				sec = now.tv_sec;
+				ts = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+			}
+			if(!capture->file_start) capture->file_start = sec;
+			// a file has one frame at least
+			rotate = (capture->file_bytes > capture->header_len) &&
+				((capture->param.rotate_size &&
+				  (capture->file_bytes + CAPTURE_EPB_LEN(frame->len) > capture->param.rotate_size)) ||
+				 (capture->param.rotate_sec && (sec - capture->file_start >= (time_t)capture->param.rotate_sec)));
+			if(rotate || !capture->current || (capture->current->len + CAPTURE_EPB_MAX > CAPTURE_CHUNK_SIZE)) {
+				if(capture->current) capture_queue(capture);
+				if(!capture->free_count) {
+					capture->stats.dropped++;
+					continue;
+				}
+				capture->current = &capture->chunk[capture->free_list[--capture->free_count]];
+				if(rotate) {
+					capture->current->rotate = true;
+					capture->file_bytes = capture->header_len;
+					capture->file_start = sec;
+				}
+			}
+			capture->current->len += capture_packet(capture->current->data + capture->current->len,frame,ts);
+			capture->file_bytes += CAPTURE_EPB_LEN(frame->len);
+			capture->stats.frames++;
+			written++;
+		}
+		pthread_mutex_unlock(&capture->lock);
+		return written;
+	}
+
+	extern "C" int lazurite_getCaptureStats(LAZURITE_CAPTURE* capture, LAZURITE_CAPTURE_STATS* stats)
+	{
+		if(!capture || !stats) return -EINVAL;
+		pthread_mutex_lock(&capture->lock);
+		*stats = capture->stats;
+		pthread_mutex_unlock(&capture->lock);
+		return 0;
+	}
+
+	extern "C" int lazurite_closeCapture(LAZURITE_CAPTURE* capture)
+	{
+		int result;
+		uint32_t i;
+
+		if(!capture) return -EINVAL;
+		pthread_mutex_lock(&capture->lock);
+		if(capture->current) capture_queue(capture);
+		capture->stop = true;
+		pthread_cond_signal(&capture->cond);
+		pthread_mutex_unlock(&capture->lock);
+		pthread_join(capture->thread,NULL);
+		result = capture->stats.error;
+		if((capture->fd >= 0) && (close(capture->fd) < 0) && !result) result = -errno;
+		for(i=0;i<capture->num;i++) free(capture->chunk[i].data);
+		free(capture->chunk);
+		free(capture->free_list);
+		free(capture->queue);
+		pthread_cond_destroy(&capture->cond);
+		pthread_mutex_destroy(&capture->lock);
+		free(capture);
+		return result;
+	}
+
+#ifdef __cplusplus
+};
+#endif
@@ -0,0 +1,125 @@
+/*!
+  @file dedup-lazurite.cpp
+  @brief suppression of retransmitted frames <br>
+  used by lazurite_setDedup. see dedup-lazurite.h.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include "dedup-lazurite.h"
+#include "mac-lazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define DEDUP_EMPTY		(~0ULL)
+
+	extern DEDUP_TABLE* dedup_create(const LAZURITE_DEDUP_PARAM *param)
+	{
+		DEDUP_TABLE *table;
+		unsigned long capacity = param->capacity ? param->capacity : DEDUP_CAPACITY;
+		uint32_t slots;
+		uint32_t i;
+
+		if((param->window > 64) || (capacity > (1UL << 24))) {
+			errno = EINVAL;
+			return NULL;
+		}
+		for(slots=DEDUP_PROBE;slots<capacity;slots*=2);
+		table = (DEDUP_TABLE*)calloc(1,sizeof(DEDUP_TABLE));
+		if(!table) return NULL;
+		table->entry = (DEDUP_ENTRY*)malloc(sizeof(DEDUP_ENTRY) * slots);
+		if(!table->entry) {
+			free(table);
+			return NULL;
+		}
+		for(i=0;i<slots;i++) table->entry[i].addr = DEDUP_EMPTY;
+		table->mask = slots - 1;
+		table->window = param->window ? param->window : DEDUP_WINDOW;
+		table->timeout = param->timeout_ms ? param->timeout_ms : DEDUP_TIMEOUT;
+		pthread_mutex_init(&table->lock,NULL);
+		return table;
+	}
+
+	extern void dedup_free(DEDUP_TABLE *table)
+	{
+		if(!table) return;
+		pthread_mutex_destroy(&table->lock);
+		free(table->entry);
+		free(table);
+	}
+
+	extern bool dedup_check(DEDUP_TABLE *table, const uint8_t *raw, uint16_t len, int64_t now)
+	{
+		const MAC_LAYOUT *layout;
+		DEDUP_ENTRY *entry, *victim = NULL;
+		uint64_t addr;
+		uint32_t i, slot;
+		uint8_t seq, back, ahead;
+		bool fresh;
+
+		if((len < 2) || (len < (layout = mac_getLayout(raw))->header_len)) return false;
+		if(!layout->seq_offset || !layout->src_addr_len) return false;
+		seq = raw[layout->seq_offset];
+		switch(layout->src_addr_len) {
+			case 1:
+				addr = raw[layout->src_addr_offset];
+				break;
+			case 2:
+				addr = mac_load16(raw + layout->src_addr_offset);
+				break;
+			default:
+				addr = mac_load64(raw + layout->src_addr_offset);
+				break;
+		}
+
+		slot = (uint32_t)((addr * 0x9e3779b97f4a7c15ULL) >> 32);
+		for(i=0;i<DEDUP_PROBE;i++) {
+			entry = &table->entry[(slot + i) & table->mask];
+			if(entry->addr == addr) break;
+			// free slot, forgotten source or the oldest one is used for new source
+			if(!victim || (victim->addr != DEDUP_EMPTY && ((entry->addr == DEDUP_EMPTY) || (entry->time < victim->time)))) {
+				victim = entry;
+			}
+		}
+		if(i == DEDUP_PROBE) {
+			entry = victim;
+			if((entry->addr != DEDUP_EMPTY) && (now - entry->time <= table->timeout)) table->stats.evicted++;
+			entry->addr = addr;
+			fresh = true;
+		} else {
+			// silent for long time. sequence number may have wrapped
+			fresh = now - entry->time > table->timeout;
+		}
+		entry->time = now;
+		if(fresh) {
+			entry->seen = 1;
+			entry->last = seq;
+			table->stats.passed++;
+			return false;
+		}
+		back = entry->last - seq;
+		if(back < table->window) {
+			if(entry->seen & (1ULL << back)) {
+				table->stats.duplicated++;
+				return true;
+			}
+			entry->seen |= 1ULL << back;
+			table->stats.passed++;
+			return false;
+		}
+		// newer frame. window is moved to it
+		ahead = seq - entry->last;
+		entry->seen = (ahead >= 64 ? 0 : entry->seen << ahead) | 1;
+		entry->last = seq;
+		table->stats.passed++;
+		return false;
+	}
+
+#ifdef __cplusplus
+};
+#endif
@@ -0,0 +1,76 @@
+/*!
+  @file dedup-lazurite.h
+  @brief suppression of retransmitted frames <br>
+  internal use only. not installed.
+
+  a frame is sent again when its ACK is lost, so the same sequence number arrives
+  from the same source up to tx_retry + 1 times. the table remembers the last sequence
+  number of each source and a bitmap of the window behind it.<br>
+  the table has fixed number of slots. a source is looked up in DEDUP_PROBE slots after
+  its hash, and the oldest of them is replaced when none is free, so memory and time of
+  a lookup are bounded with any number of nodes.
+ */
+#ifndef _DEDUP_LAZURITE_H_
+#define _DEDUP_LAZURITE_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include "liblazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define DEDUP_PROBE			8			/*!< slots searched for one source */
+#define DEDUP_CAPACITY		4096		/*!< default of capacity */
+#define DEDUP_WINDOW		16			/*!< default of window */
+#define DEDUP_TIMEOUT		2000		/*!< default of timeout_ms */
+
+	/*! @struct DEDUP_ENTRY
+	  @brief internal use only
+	  sequence numbers of one source
+	  */
+	typedef struct {
+		uint64_t addr;			/*!< little endian value of tx address. DEDUP_EMPTY = free */
+		uint64_t seen;			/*!< bit n = (last - n) was received */
+		int64_t time;			/*!< ms of last frame (CLOCK_MONOTONIC) */
+		uint8_t last;			/*!< newest sequence number */
+	} DEDUP_ENTRY;
+
+	/*! @struct DEDUP_TABLE
+	  @brief internal use only
+	  */
+	typedef struct {
+		pthread_mutex_t lock;	/*!< readBatch may be called without rx_lock */
+		DEDUP_ENTRY *entry;
+		uint32_t mask;			/*!< number of slots - 1 */
+		uint8_t window;
+		int64_t timeout;
+		LAZURITE_DEDUP_STATS stats;
+	} DEDUP_TABLE;
+
+	/******************************************************************************/
+	/*! @brief allocate table
+	  @return         table <br> NULL = fail (errno is set)
+	 ******************************************************************************/
+	extern DEDUP_TABLE* dedup_create(const LAZURITE_DEDUP_PARAM *param);
+
+	extern void dedup_free(DEDUP_TABLE *table);
+
+	/******************************************************************************/
+	/*! @brief check sequence number of frame and remember it
+	  table->lock must be held.
+	  @param[in]      *raw    frame
+	  @param[in]      len     length of raw
+	  @param[in]      now     ms (CLOCK_MONOTONIC)
+	  @return         true = duplicate of frame received before
+	  @note  frames without sequence number or tx address are never duplicate.
+	 ******************************************************************************/
+	extern bool dedup_check(DEDUP_TABLE *table, const uint8_t *raw, uint16_t len, int64_t now);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif	// _DEDUP_LAZURITE_H_
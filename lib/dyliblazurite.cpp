@@ -56,8 +56,21 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
-#include "drv-lazurite.h"
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <limits.h>
+#include "ioctl-lazurite.h"
 #include "liblazurite.h"
+#include "mac-lazurite.h"
+#include "link-lazurite.h"
+#include "dedup-lazurite.h"
+#include "neighbor-lazurite.h"
+#include "metrics-lazurite.h"
+#include "probe-lazurite.h"
 #include <unistd.h> 
 #include <errno.h> 
 
@@ -68,16 +81,178 @@
 namespace lazurite
 {
 #endif
-	static int fp = 0;  /*< file descripter fo IOCTL */
-	/*! @brief 
-	  linkedAddr=0xffff:  receive from all device<br>
-	  linkedAddr!=0xffff: receive from specific device<br>
+	/*! @brief
+	  index of parameters in shadow
+	  */
+	enum {
+		SHADOW_DST_PANID,
+		SHADOW_DST_ADDR0,
+		SHADOW_DST_ADDR1,
+		SHADOW_DST_ADDR2,
+		SHADOW_DST_ADDR3,
+		SHADOW_MY_SHORT_ADDR,
+		SHADOW_MY_ADDR0,
+		SHADOW_MY_ADDR1,
+		SHADOW_MY_ADDR2,
+		SHADOW_MY_ADDR3,
+		SHADOW_NUM
+	};
+	/*! @struct LAZURITE_TX_REQ
+	  @brief internal use only
+	  frame in tx queue
+	  */
+	typedef struct {
+		long handle;
+		bool addr64;
+		uint16_t panid;
+		uint16_t a16[4];
+		uint16_t length;
+		uint8_t payload[256];
+	} LAZURITE_TX_REQ;
+	/*! @struct lazurite_ctx
+	  @brief state of one device (LAZURITE_CTX)
 	  */
-	static uint16_t linkedAddr;
+	struct lazurite_ctx {
+		int fp;  /*< file descripter fo IOCTL */
+		/*! @brief
+		  backend to access radio. /dev/lzgw in default
+		  */
+		const LAZURITE_BACKEND *backend;
+		/*! @brief
+		  filter of source address in lazurite_readLink. accessed under rx_lock
+		  */
+		struct {
+			uint8_t mode;			/*!< LAZURITE_LINK_xxx */
+			LINK_SET set;
+			LAZURITE_LINK_STATS stats;
+		} link;
+		/*! @brief
+		  filter of received frames (lazurite_setFilter). NULL = all frames
+		  */
+		const LAZURITE_FILTER *filter;
+		/*! @brief
+		  rssi and receiving time of each frame are got by ioctl when backend doesn't have recv
+		  (lazurite_setRxInfo). false = lazurite_readBatch reads only length and body
+		  */
+		bool rx_info;
+		/*! @brief
+		  capture of received frames (lazurite_setCapture). NULL = not captured
+		  */
+		LAZURITE_CAPTURE *capture;
+		/*! @brief
+		  binary log of received frames (lazurite_setLog). NULL = not logged
+		  */
+		LAZURITE_LOG *log;
+		/*! @brief
+		  duplicate suppression (lazurite_setDedup). NULL = off
+		  */
+		DEDUP_TABLE *dedup;
+		/*! @brief
+		  link quality of each node (lazurite_setNeighborTable). NULL = off.
+		  written under rx_lock and tx_lock
+		  */
+		NEIGHBOR_TABLE *neighbor;
+		/*! @brief
+		  counters and histograms (lazurite_getMetrics). always updated
+		  */
+		METRICS metrics;
+		/*! @brief
+		  buffer for receiving data. accessed under rx_lock
+		  */
+		char buf[256];
+		/*! @brief
+		  serialize reading length and body of frame
+		  */
+		pthread_mutex_t rx_lock;
+		/*! @brief
+		  serialize setting of destination and write
+		  */
+		pthread_mutex_t tx_lock;
+		/*! @brief
+		  copy of parameters in driver. ioctl is skipped when the value is already set.
+		  accessed under tx_lock.
+		  */
+		struct {
+			uint32_t valid;			/*!< bit of SHADOW_xxx */
+			uint16_t value[SHADOW_NUM];
+			uint8_t dst_mode;		/*!< 16 or 64 = destination set last. 0 = unknown */
+			LAZURITE_SEND_MODE mode;	/*!< parameters of IOCTL_GET_SEND_MODE/IOCTL_SET_SEND_MODE */
+			bool mode_valid;
+			unsigned long saved;	/*!< number of ioctl skipped */
+		} shadow;
+		/*! @brief
+		  tx queue and worker
+		  */
+		struct {
+			pthread_t thread;
+			pthread_mutex_t lock;
+			pthread_cond_t cond;	/*!< request is queued or stop */
+			pthread_cond_t done;	/*!< completion is queued */
+			bool running;
+			bool stop;
+			uint16_t depth;
+			LAZURITE_TX_REQ *req;
+			uint16_t head;
+			uint16_t count;
+			LAZURITE_TX_COMPLETION *comp;
+			uint16_t comp_head;
+			uint16_t comp_count;
+			uint16_t outstanding;	/*!< requests + completions not got */
+			long handle;
+			LAZURITE_TX_CALLBACK callback;
+			void *arg;
+		} txq;
+		/*! @brief
+		  dispatcher thread
+		  */
+		struct {
+			pthread_t thread;
+			bool running;
+			int stop;				/*!< eventfd to wake up thread */
+			LAZURITE_RX_CALLBACK callback;
+			void *arg;
+			LAZURITE_FRAME frames[16];
+		} dispatcher;
+		/*! @brief
+		  rx thread and single-producer/single-consumer ring of frames.
+		  tail is written only by rx thread, head only by lazurite_getRxFrames.
+		  */
+		struct {
+			pthread_t thread;
+			bool running;
+			bool exited;			/*!< rx thread ended by error of device */
+			int stop;				/*!< eventfd to wake up rx thread */
+			int ready;				/*!< eventfd. written by rx thread when frames are pushed */
+			int freed;				/*!< eventfd. written by consumer when slots are freed while full */
+			bool full;				/*!< rx thread waits for freed */
+			uint32_t mask;			/*!< number of slots - 1 */
+			LAZURITE_FRAME *slot;
+			char pad0[64];
+			uint32_t tail;			/*!< next slot to be pushed */
+			char pad1[64];
+			uint32_t head;			/*!< next slot to be popped */
+		} rxq;
+	};
 	/*! @brief
-	  buffer for receiving data
+	  context of functions without ctx (lazurite_init, lazurite_begin, ...)
 	  */
-	static char buf[256];
+	static LAZURITE_CTX default_ctx = {
+		-1,
+		&lazurite_backend_lzgw,
+		{LAZURITE_LINK_ALL},
+		NULL,
+		false,
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+		{&default_ctx.metrics.local, {LAZURITE_METRICS_MAGIC, sizeof(LAZURITE_METRICS)}},
+		{0},
+		PTHREAD_MUTEX_INITIALIZER,
+		PTHREAD_MUTEX_INITIALIZER,
+		{0},
+		{0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER},
+	};
 
 #define DEFAULT_CH		36 /*!< default channel */
 #define DEFAULT_PANID	0xFFFF  /*!< default panid*/
@@ -85,201 +260,570 @@ namespace lazurite
 #define DEFAULT_RATE	100  /*!< default of bit rate*/
 #define DEFAULT_PWR		20  /*!< default of tx power*/
 
+#define LZGW_MODULE		"lazdriver"	/*!< name of LazDriver in kernel */
+#define LZGW_DEVICE		"/dev/lzgw"	/*!< device node created by LazDriver */
+#define LZGW_TIMEOUT	2000	/*!< ms to wait for device node and unloading */
 
-	/*! @struct s_MAC_HEADER_BIT_ALIGNMENT
-	  @brief  abstruct
-	  internal use only
-	  bit alightment of mac header
-	  */
-	typedef struct {
-		uint8_t frame_type:3;
-		uint8_t sec_enb:1;
-		uint8_t pending:1;
-		uint8_t ack_req:1;
-		uint8_t panid_comp:1;
-		uint8_t nop:1;
-		uint8_t seq_comp:1;
-		uint8_t ielist:1;
-		uint8_t dst_addr_type:2;
-		uint8_t frame_ver:2;
-		uint8_t src_addr_type:2;
-	} s_MAC_HEADER_BIT_ALIGNMENT;
-
-	/*! @union u_MAC_HEADER
-	  @brief  internal use only
-	  mac header
-	  data[] 8x2byte
-	  header short type
-	  alignment bit alignment
+	/*! @brief
+	  LazDriver loaded by lzgw_load. lazurite_setModulePath
 	  */
-	typedef union {
-		uint8_t data[2];
-		uint16_t header;
-		s_MAC_HEADER_BIT_ALIGNMENT alignment;
-	} u_MAC_HEADER;
+	static char module_path[PATH_MAX] = "/home/pi/driver/LazDriver/lazdriver.ko";
 
-	/*! @struct SUBGHZ_MAC_PARAM
-	  @brief internal use only
-	  mac data format
-	  */
-	typedef struct
-	{
-		u_MAC_HEADER mac_header;
-		uint8_t seq_num;
-		uint8_t addr_type;
-		uint16_t dst_panid;
-		uint8_t  dst_addr[8];
-		uint16_t src_panid;
-		uint8_t  src_addr[8];
-		char *raw;
-		int16_t raw_len;
-		char *payload;
-		int16_t payload_len;
-	} SUBGHZ_MAC_PARAM;
-
-	/******************************************************************************/
-	/*! @brief ieee802154e mac decoder
-	  @param[out]     *mac    result of decoding raw
-	  @param[in]      *raw    raw data of ieee802154
-	  @param[in]      raw_len length of raw
-	  @par            Refer
-	  - referene of grobal parameters none
-	  @par            Modify
-	  - modifying grobal parameterx none
-	  @return         none
-	  @exception      none
+	/******************************************************************************/
+	/*! @brief access to backend
+	  every ioctl/read/write of the library is issued through these functions,
+	  and they are counted in metrics of context and traced by probes (probe-lazurite.h).
+	 ******************************************************************************/
+	static inline int drv_ioctl(LAZURITE_CTX* ctx,unsigned long cmd, unsigned long arg)
+	{
+		LAZURITE_METRICS *metrics = metrics_live(&ctx->metrics);
+		int result;
+
+		PROBE3(ioctl_entry,ctx,cmd,arg);
+		result = ctx->backend->ioctl(ctx->fp,cmd,arg);
+		PROBE3(ioctl_return,ctx,cmd,result);
+		metrics_add(&metrics->ioctl_calls,1);
+		if(result < 0) metrics_add(&metrics->ioctl_errors,1);
+		return result;
+	}
+	static inline int drv_read(LAZURITE_CTX* ctx,void* data, size_t size)
+	{
+		LAZURITE_METRICS *metrics = metrics_live(&ctx->metrics);
+		uint64_t start = metrics_now();
+		int result = ctx->backend->read(ctx->fp,data,size);
+		uint64_t ns = metrics_now() - start;
+
+		PROBE4(rx_syscall,ctx,size,result,ns);
+		metrics_record(&metrics->rx_syscall,ns);
+		metrics_add(&metrics->read_calls,1);
+		if(result > 0) metrics_add(&metrics->read_bytes,result);
+		return result;
+	}
+	static inline int drv_write(LAZURITE_CTX* ctx,const void* data, size_t size)
+	{
+		LAZURITE_METRICS *metrics = metrics_live(&ctx->metrics);
+		int result;
+
+		PROBE2(write_entry,ctx,size);
+		result = ctx->backend->write(ctx->fp,data,size);
+		PROBE3(write_return,ctx,size,result);
+		metrics_add(&metrics->write_calls,1);
+		if(result > 0) metrics_add(&metrics->write_bytes,result);
+		return result;
+	}
+	/*! @brief count frames got from backend */
+	static inline void drv_received(LAZURITE_CTX* ctx,int frames)
+	{
+		metrics_add(&metrics_live(&ctx->metrics)->rx_frames,frames);
+	}
+	/******************************************************************************/
+	/*! @brief shadow of driver parameters. tx_lock must be held.
 	 ******************************************************************************/
-	static void subghz_decMac(SUBGHZ_MAC_PARAM *mac,void *raw,uint16_t raw_len)
+	static inline void shadow_invalidate(LAZURITE_CTX* ctx,uint32_t mask)
+	{
+		ctx->shadow.valid &= ~mask;
+	}
+	/*! @brief set parameter only when it is different from shadow
+	  driver clears DST_ADDR1..3 by DST_ADDR0, so they are set again after it.
+	  @return same as ioctl (value which is set)
+	 */
+	static int shadow_set(LAZURITE_CTX* ctx,int id, unsigned long cmd, uint16_t value)
+	{
+		int result;
+
+		if((ctx->shadow.valid & (1 << id)) && (ctx->shadow.value[id] == value)) {
+			ctx->shadow.saved++;
+			return value;
+		}
+		if(id == SHADOW_DST_ADDR0) {
+			shadow_invalidate(ctx,(1 << SHADOW_DST_ADDR1) | (1 << SHADOW_DST_ADDR2) | (1 << SHADOW_DST_ADDR3));
+		}
+		result = drv_ioctl(ctx,cmd,value);
+		if(result == value) {
+			ctx->shadow.value[id] = value;
+			ctx->shadow.valid |= 1 << id;
+		} else {
+			shadow_invalidate(ctx,1 << id);
+		}
+		return result;
+	}
+	/*! @brief get parameter from shadow, or from driver at 1st time
+	  @return same as ioctl
+	 */
+	static int shadow_get(LAZURITE_CTX* ctx,int id, unsigned long cmd)
+	{
+		int result;
+
+		if(ctx->shadow.valid & (1 << id)) {
+			ctx->shadow.saved++;
+			return ctx->shadow.value[id];
+		}
+		result = drv_ioctl(ctx,cmd,0);
+		if(result >= 0) {
+			ctx->shadow.value[id] = result;
+			ctx->shadow.valid |= 1 << id;
+		}
+		return result;
+	}
+	/*! @brief destination is set by 16bit or 64bit address.
+	  when it is changed, all of DST_ADDR are set again.
+	 */
+	static void shadow_dst_mode(LAZURITE_CTX* ctx,uint8_t mode)
+	{
+		if(ctx->shadow.dst_mode != mode) {
+			shadow_invalidate(ctx,(1 << SHADOW_DST_ADDR0) | (1 << SHADOW_DST_ADDR1) |
+					(1 << SHADOW_DST_ADDR2) | (1 << SHADOW_DST_ADDR3));
+			ctx->shadow.dst_mode = mode;
+		}
+	}
+	static void shadow_reset(LAZURITE_CTX* ctx)
+	{
+		pthread_mutex_lock(&ctx->tx_lock);
+		ctx->shadow.valid = 0;
+		ctx->shadow.dst_mode = 0;
+		ctx->shadow.mode_valid = false;
+		pthread_mutex_unlock(&ctx->tx_lock);
+	}
+
+	/*! @brief receiving time of last frame in driver */
+	static int drv_rxtime(LAZURITE_CTX* ctx,time_t* tv_sec,long* tv_nsec)
+	{
+		time_t sec;
+		long nsec;
+		int result;
+		int errcode=0;
+
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_GET_RX_SEC1,0),errcode--;
+		if(result < 0) return errcode;
+		sec = result;
+
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_GET_RX_SEC0,0),errcode--;
+		if(result < 0) return errcode;
+		sec = (sec << 16) + result;
+
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_GET_RX_NSEC1,0),errcode--;
+		if(result < 0) return errcode;
+		nsec = result;
+
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_GET_RX_NSEC0,0),errcode--;
+		if(result < 0) return errcode;
+		nsec = (nsec << 16) + result;
+
+		*tv_sec = sec;
+		*tv_nsec = nsec;
+
+		return 0;
+	}
+	/*! @brief recv of backend */
+	static int drv_recvFrames(LAZURITE_CTX* ctx,LAZURITE_FRAME* frames, int num)
+	{
+		LAZURITE_METRICS *metrics = metrics_live(&ctx->metrics);
+		uint64_t start = metrics_now();
+		int result = ctx->backend->recv(ctx->fp,frames,num);
+		uint64_t ns = metrics_now() - start;
+		int i;
+
+		PROBE4(rx_syscall,ctx,num,result,ns);
+		metrics_record(&metrics->rx_syscall,ns);
+		metrics_add(&metrics->read_calls,1);
+		if(result <= 0) return result;
+		metrics_add(&metrics->rx_frames,result);
+		for(i=0;i<result;i++) metrics_add(&metrics->read_bytes,frames[i].len);
+		return result;
+	}
+	/*! @brief receive frames into slots. by read of backend when it doesn't have recv.
+	  @param[in]      info      true = rssi and time are got by ioctl after each frame (5 ioctl).
+	  false = they are 0, and only length and body are read
+	 */
+	static int drv_recv(LAZURITE_CTX* ctx,LAZURITE_FRAME* frames, int num, bool info)
 	{
 		int i;
-		int16_t offset=0;
-		uint8_t addr_type;
-		char* buf = (char*) raw;
-		mac->mac_header.data[0] = buf[offset],offset++;
-		mac->mac_header.data[1] = buf[offset],offset++;
-		if(!mac->mac_header.alignment.seq_comp) {
-			mac->seq_num = buf[offset],offset++;
+		int result = 0;
+		uint16_t tmp_size;
+
+		if(ctx->backend->recv) return drv_recvFrames(ctx,frames,num);
+		pthread_mutex_lock(&ctx->rx_lock);
+		for(i=0;i<num;i++) {
+			result = drv_read(ctx,&tmp_size,2);
+			if(result <= 0) break;
+			if(tmp_size > sizeof(frames[i].raw)) tmp_size = sizeof(frames[i].raw);
+			result = drv_read(ctx,frames[i].raw,tmp_size);
+			if(result < 0) break;
+			frames[i].len = result;
+			frames[i].rssi = 0;
+			frames[i].tv_sec = 0;
+			frames[i].tv_nsec = 0;
+			if(!info) continue;
+			result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_GET_RX_RSSI,0);
+			if(result >= 0) frames[i].rssi = result;
+			if(drv_rxtime(ctx,&frames[i].tv_sec,&frames[i].tv_nsec) < 0) {
+				frames[i].tv_sec = 0;
+				frames[i].tv_nsec = 0;
+			}
 		}
-		if(mac->mac_header.alignment.dst_addr_type) addr_type = 4;
-		else addr_type = 0;
-		if(mac->mac_header.alignment.src_addr_type) addr_type += 2;
-		if(mac->mac_header.alignment.panid_comp) addr_type += 1;
-		mac->addr_type = addr_type;
-		//dst_panid
-		switch(addr_type){
-			case 1:
-			case 4:
-			case 6:
-				mac->dst_panid = buf[offset+1];
-				mac->dst_panid = (mac->dst_panid<<8) + buf[offset];
-				offset+=2;
-				break;
-			default:
-				mac->src_panid = 0xffff;
+		pthread_mutex_unlock(&ctx->rx_lock);
+		drv_received(ctx,i);
+		if((i == 0) && (result < 0)) return result;
+		return i;
+	}
+
+	static int64_t monotonic_ms(void)
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+	}
+
+	/******************************************************************************/
+	/*! @brief duplicate of frame received before (lazurite_setDedup)
+		@return         true = frame should be dropped
+	 ******************************************************************************/
+	static bool dedup_drop(LAZURITE_CTX* ctx, const uint8_t* raw, uint16_t len)
+	{
+		bool result;
+
+		pthread_mutex_lock(&ctx->dedup->lock);
+		result = dedup_check(ctx->dedup,raw,len,monotonic_ms());
+		pthread_mutex_unlock(&ctx->dedup->lock);
+		return result;
+	}
+
+	/******************************************************************************/
+	/*! @brief update neighbor table by frame read last (lazurite_setNeighborTable)
+		only length and body are read on this path, so rssi is unknown. time is when the
+		frame was read, as lazurite_ctx_readBatch.
+	 ******************************************************************************/
+	static void neighbor_received(LAZURITE_CTX* ctx, const uint8_t* raw, uint16_t len)
+	{
+		struct timespec now;
+
+		clock_gettime(CLOCK_REALTIME,&now);
+		neighbor_rx(ctx->neighbor,raw,len,-1,now.tv_sec,now.tv_nsec);
+	}
+
+	/******************************************************************************/
+	/*! @brief run command by system
+	  @return         0=success <br> 0 > fail (-EIO = command exited with error)
+	 ******************************************************************************/
+	static int lzgw_system(const char* command)
+	{
+		int status = system(command);
+
+		if(status < 0) return -errno;
+		if(!WIFEXITED(status)) return -EINTR;
+		if(WEXITSTATUS(status) != 0) return -EIO;
+		return 0;
+	}
+
+#ifndef LAZURITE_NO_LAZDRIVER
+	/******************************************************************************/
+	/*! @brief check /proc/modules
+	  @return         true = LazDriver is in kernel
+	 ******************************************************************************/
+	static bool lzgw_loaded(void)
+	{
+		FILE *modules;
+		char line[256];
+		bool result = false;
+
+		modules = fopen("/proc/modules","r");
+		if(!modules) return false;
+		while(fgets(line,sizeof(line),modules)) {
+			if(strncmp(line,LZGW_MODULE " ",sizeof(LZGW_MODULE)) == 0) {
+				result = true;
 				break;
+			}
 		}
-		//dst_addr
-		switch(mac->mac_header.alignment.dst_addr_type)
-		{
-			case 1:
-				mac->dst_addr[0] = buf[offset],offset++;
-				for(i=1;i<8;i++) {
-					mac->dst_addr[i] = 0;
-				}
-				break;
-			case 2:
-				mac->dst_addr[0] = buf[offset],offset++;
-				mac->dst_addr[1] = buf[offset],offset++;
-				for(i=2;i<8;i++) {
-					mac->dst_addr[i] = 0;
-				}
-				break;
-			case 3:
-				for(i=0;i<8;i++){
-					mac->dst_addr[i] = buf[offset],offset++;
-				}
-			default:
-				break;
+		fclose(modules);
+		return result;
+	}
+
+	/******************************************************************************/
+	/*! @brief wait until device node is created, by inotify of its directory
+	  @param[in]      path      device node
+	  @param[in]      timeout   timeout(ms)
+	  @return         0=success <br> 0 > fail (-ETIMEDOUT)
+	 ******************************************************************************/
+	static int lzgw_waitNode(const char* path, int timeout)
+	{
+		char dir[PATH_MAX];
+		char events[sizeof(struct inotify_event) + NAME_MAX + 1];
+		struct pollfd pfd;
+		int64_t limit = monotonic_ms() + timeout;
+		int remain;
+		int result = 0;
+
+		if(access(path,F_OK) == 0) return 0;
+		snprintf(dir,sizeof(dir),"%s",path);
+		if(strrchr(dir,'/')) *strrchr(dir,'/') = 0;
+		pfd.fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+		if(pfd.fd < 0) return -errno;
+		pfd.events = POLLIN;
+		if(inotify_add_watch(pfd.fd,dir[0] ? dir : "/",IN_CREATE | IN_ATTRIB) < 0) {
+			result = -errno;
+			close(pfd.fd);
+			return result;
 		}
-		// src_panid
-		switch(mac->addr_type){
-			case 2:
-				mac->src_panid = buf[offset+1];
-				mac->src_panid = (mac->src_panid<<8) + buf[offset];
-				offset+=2;
-				break;
-			default:
-				mac->src_panid = 0xffff;
+		// node may be created before watch is added
+		while(access(path,F_OK) != 0) {
+			remain = limit - monotonic_ms();
+			if(remain <= 0) {
+				result = -ETIMEDOUT;
 				break;
+			}
+			if(poll(&pfd,1,remain) > 0) {
+				while(read(pfd.fd,events,sizeof(events)) > 0);
+			}
 		}
-		//src_addr
-		memset(mac->src_addr,0xffff,sizeof(mac->src_addr));
-		switch(mac->mac_header.alignment.src_addr_type)
-		{
-			case 1:
-				mac->src_addr[0] = buf[offset],offset++;
-				for(i=1;i<8;i++) {
-					mac->src_addr[i] = 0;
-				}
-				break;
-			case 2:
-				mac->src_addr[0] = buf[offset],offset++;
-				mac->src_addr[1] = buf[offset],offset++;
-				for(i=2;i<8;i++) {
-					mac->src_addr[i] = 0;
-				}
-				break;
-			case 3:
-				for(i=0;i<8;i++){
-					mac->src_addr[i] = buf[offset],offset++;
-				}
-			default:
-				break;
+		close(pfd.fd);
+		return result;
+	}
+#endif
+
+	/******************************************************************************/
+	/*! @brief load lazdriver.ko
+	  nothing is done when LazDriver is in kernel. otherwise it is loaded by finit_module,
+	  or by sudo insmod when the process is not permitted.
+	  @param[in]      testmode  module_test parameter. 0 = normal
+	  @return         0=success <br> 256= driver is existed in kernel <br> 0 > fail (-EIO = insmod failed)
+	 ******************************************************************************/
+	static int lzgw_load(uint16_t testmode)
+	{
+#ifdef LAZURITE_NO_LAZDRIVER
+		// built without drv-lazurite.h. IOCTL numbers of the driver are unknown
+		return -ENODEV;
+#else
+		int result;
+		int fd;
+		char param[32];
+		char insmod[PATH_MAX + 64];
+
+		if(lzgw_loaded()) {
+			result = 256;
+		} else {
+			if(testmode) {
+				sprintf(param,"module_test=0x%04x",testmode);
+			} else {
+				param[0] = 0;
+			}
+			fd = open(module_path,O_RDONLY | O_CLOEXEC);
+			if(fd < 0) return -errno;
+			result = syscall(SYS_finit_module,fd,param,0);
+			if(result < 0) result = -errno;
+			close(fd);
+			if(result == -EEXIST) {
+				result = 256;
+			} else if((result == -EPERM) || (result == -ENOSYS)) {
+				snprintf(insmod,sizeof(insmod),"sudo insmod %s %s",module_path,param);
+				result = lzgw_system(insmod);
+			}
+			if(result < 0) return result;
 		}
-		mac->raw = buf;
-		mac->raw_len = raw_len;
-		mac->payload=buf+offset;
-		mac->payload_len = raw_len-offset;
-		return;
+		if(lzgw_waitNode(LZGW_DEVICE,LZGW_TIMEOUT) < 0) return -ENODEV;
+		if(access(LZGW_DEVICE,R_OK | W_OK) != 0) system("sudo chmod 777 " LZGW_DEVICE);
+		return result;
+#endif
 	}
 
 	/******************************************************************************/
-	/*! @brief get all data by text format
-	  @param[out]     addr   linked address
-	  @par            Refer
-	  @return         0=success <br> 0 < fail
+	/*! @brief remove lazdriver.ko by delete_module, or by sudo rmmod when the process is not permitted.
+	  retried while driver is busy.
+	  @return         0=success <br> 0 > fail (-EIO = rmmod failed)
+	 ******************************************************************************/
+	static int lzgw_unload(void)
+	{
+		int64_t limit = monotonic_ms() + LZGW_TIMEOUT;
+		struct timespec ts = {0, 1000000};
+
+		for(;;) {
+			if(syscall(SYS_delete_module,LZGW_MODULE,O_NONBLOCK) == 0) return 0;
+			if((errno == EPERM) || (errno == ENOSYS)) return lzgw_system("sudo rmmod " LZGW_MODULE);
+			if((errno != EBUSY) && (errno != EAGAIN)) return -errno;
+			if(monotonic_ms() > limit) return -errno;
+			nanosleep(&ts,NULL);
+		}
+	}
+
+	static int lzgw_open(const char* path)
+	{
+#ifdef LAZURITE_NO_LAZDRIVER
+		errno = ENODEV;
+		return -1;
+#else
+		return open(path,O_RDWR);
+#endif
+	}
+
+	static int lzgw_ioctl(int fd, unsigned long cmd, unsigned long arg)
+	{
+		return ioctl(fd,cmd,arg);
+	}
+
+	static int lzgw_read(int fd, void* data, size_t size)
+	{
+		return read(fd,data,size);
+	}
+
+	static int lzgw_write(int fd, const void* data, size_t size)
+	{
+		return write(fd,data,size);
+	}
+
+	extern "C" const LAZURITE_BACKEND lazurite_backend_lzgw = {
+		"lzgw",
+		LZGW_DEVICE,
+		lzgw_load,
+		lzgw_unload,
+		lzgw_open,
+		close,
+		lzgw_ioctl,
+		lzgw_read,
+		lzgw_write,
+		NULL,
+	};
+
+	/******************************************************************************/
+	/*! @brief select backend
+	  @param[in]      backend  &lazurite_backend_lzgw or &lazurite_backend_sim
+	  @return         0=success <br> 0 < fail (-EBUSY = device is opened)
 	  @exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_readStream(char* stream, uint16_t* size){
-		char raw[256];
-		uint16_t rawSize;
-		int result;
-		time_t sec;
-		long nsec;
-		uint8_t rssi;
+	extern "C" int lazurite_setBackend(const LAZURITE_BACKEND* tmp_backend)
+	{
+		if(!tmp_backend) return -EINVAL;
+		if(default_ctx.fp >= 0) return -EBUSY;
+		default_ctx.backend = tmp_backend;
+		return 0;
+	}
 
-		SUBGHZ_MAC mac;
+	/******************************************************************************/
+	/*! @brief set path of lazdriver.ko loaded by lazurite_init/lazurite_test
+		@param[in]      path     path of lazdriver.ko
+		@return         0=success <br> 0 > fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_setModulePath(const char* path)
+	{
+		if(!path) return -EINVAL;
+		if(strlen(path) >= sizeof(module_path)) return -ENAMETOOLONG;
+		strcpy(module_path,path);
+		return 0;
+	}
 
-		result = lazurite_read(raw,&rawSize);
-		if(result <= 0) return result;
+	/******************************************************************************/
+	/*! @brief stop threads and close device of context
+	 ******************************************************************************/
+	static void ctx_shutdown(LAZURITE_CTX* ctx)
+	{
+		if(ctx->dispatcher.running) lazurite_ctx_stopDispatcher(ctx);
+		if(ctx->rxq.running) lazurite_ctx_stopRxThread(ctx);
+		if(ctx->txq.running) lazurite_ctx_stopTxQueue(ctx);
+		shadow_reset(ctx);
+		if(ctx->fp >= 0) ctx->backend->close(ctx->fp);
+		ctx->fp = -1;
+		metrics_close(&ctx->metrics);
+	}
 
-		raw[rawSize]=0;								// force to write NULL
-		result = lazurite_getRxRssi();
-		result = lazurite_getRxTime(&sec,&nsec);
-		result = lazurite_decMac(&mac,raw,rawSize);
-		sprintf(stream,"%d,%d,%d,%d,0x%04x,0x%04x,%s",
-			sec,
-			nsec,
-			mac.seq_num,
-			rssi,
-			mac.src_panid,
-			mac.src_addr,
-			raw[mac.payload_offset]
-			);
-		*size = strnlen(stream,512);
-		result = *size;
+	/******************************************************************************/
+	/*! @brief open device as new context
+		driver must be loaded by lazurite_init or backend->load in advance.
+		@param[in]      backend  &lazurite_backend_lzgw or &lazurite_backend_sim. NULL = lzgw
+		@param[in]      path     device node. NULL = backend->path
+		@return         context <br> NULL = fail (errno is set)
+		@exception      none
+	 ******************************************************************************/
+	extern "C" LAZURITE_CTX* lazurite_openCtx(const LAZURITE_BACKEND* backend, const char* path)
+	{
+		LAZURITE_CTX *ctx;
+		int err;
+
+		if(!backend) backend = &lazurite_backend_lzgw;
+		if(!path) path = backend->path;
+		ctx = (LAZURITE_CTX*)calloc(1,sizeof(LAZURITE_CTX));
+		if(!ctx) return NULL;
+		ctx->backend = backend;
+		ctx->link.mode = LAZURITE_LINK_ALL;
+		metrics_init(&ctx->metrics);
+		pthread_mutex_init(&ctx->rx_lock,NULL);
+		pthread_mutex_init(&ctx->tx_lock,NULL);
+		pthread_mutex_init(&ctx->txq.lock,NULL);
+		pthread_cond_init(&ctx->txq.cond,NULL);
+		pthread_cond_init(&ctx->txq.done,NULL);
+		ctx->fp = backend->open(path);
+		if(ctx->fp < 0) {
+			err = errno;
+			lazurite_closeCtx(ctx);
+			errno = err;
+			return NULL;
+		}
+		return ctx;
+	}
 
-		return result;
+	/******************************************************************************/
+	/*! @brief close context opened by lazurite_openCtx
+		dispatcher and tx queue of the context are stopped.
+		@param[in]      ctx      context
+		@return         0=success <br> 0 > fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_closeCtx(LAZURITE_CTX* ctx)
+	{
+		if(!ctx || (ctx == &default_ctx)) return -EINVAL;
+		ctx_shutdown(ctx);
+		pthread_cond_destroy(&ctx->txq.done);
+		pthread_cond_destroy(&ctx->txq.cond);
+		pthread_mutex_destroy(&ctx->txq.lock);
+		pthread_mutex_destroy(&ctx->tx_lock);
+		pthread_mutex_destroy(&ctx->rx_lock);
+		link_clear(&ctx->link.set);
+		dedup_free(ctx->dedup);
+		neighbor_free(ctx->neighbor);
+		free(ctx);
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief context used by functions without ctx
+		@return         context of lazurite_init
+		@exception      none
+	 ******************************************************************************/
+	extern "C" LAZURITE_CTX* lazurite_getDefaultCtx(void)
+	{
+		return &default_ctx;
+	}
+
+	/******************************************************************************/
+	/*! @brief read one frame as line of CSV
+	  @param[out]     *stream   text terminated by NULL
+	  @param[in,out]  *size     in: bytes of stream. out: length of text
+	  @return         length of text <br> 0 = no frame <br> 0 > fail
+	  @exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_readStream(LAZURITE_CTX* ctx, char* stream, uint16_t* size){
+		LAZURITE_FRAME frame;
+		size_t len;
+		int result;
+
+		if(!stream || !size) return -EINVAL;
+		result = lazurite_ctx_readFrame(ctx,&frame);
+		if(result <= 0) {
+			*size = 0;
+			return result;
+		}
+		len = *size;
+		result = lazurite_formatFrames(stream,&len,&frame,1,LAZURITE_FORMAT_CSV);
+		if(result < 0) {
+			*size = 0;
+			return result;
+		}
+		stream[--len] = 0;							// without '\n'
+		*size = len;
+		return len;
+	}
+
+	extern "C" int lazurite_readStream(char* stream, uint16_t* size)
+	{
+		return lazurite_ctx_readStream(&default_ctx,stream,size);
 	}
 
 	/******************************************************************************/
@@ -291,481 +835,1873 @@ namespace lazurite
 	  @return         0=success <br> 0 < fail
 	  @exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_link(uint16_t addr) {
+	extern "C" int lazurite_ctx_link(LAZURITE_CTX* ctx, uint16_t addr) {
 		int result=0;
-		linkedAddr = addr;
+		pthread_mutex_lock(&ctx->rx_lock);
+		link_clear(&ctx->link.set);
+		if(addr == 0xffff) {
+			ctx->link.mode = LAZURITE_LINK_ALL;
+		} else {
+			result = link_add16(&ctx->link.set,addr);
+			ctx->link.mode = LAZURITE_LINK_ALLOW;
+		}
+		pthread_mutex_unlock(&ctx->rx_lock);
 		return result;
 	}
+
+	extern "C" int lazurite_link(uint16_t addr)
+	{
+		return lazurite_ctx_link(&default_ctx,addr);
+	}
+
 	/******************************************************************************/
-	/*! @brief load LazDriver
-	  @param      none
-	  @return         0=success <br> 0 < fail <br> 256= driver is existed in kernel
-	  @exception  none
-	  @todo  must be change folder name of lazdriver
+	/*! @brief set mode of link filter
+	  @param[in]      mode   LAZURITE_LINK_ALL/LAZURITE_LINK_ALLOW/LAZURITE_LINK_DENY
+	  @return         0=success <br> -EINVAL = mode error
+	  @exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_init(void)
+	extern "C" int lazurite_ctx_setLinkMode(LAZURITE_CTX* ctx, uint8_t mode)
 	{
-		int errcode = 0;
-		int result;
-
-		// open device driver
-		result = system("sudo insmod /home/pi/driver/LazDriver/lazdriver.ko");
-		//system("sudo insmod /home/pi/driver/LazDriver/lazdriver.ko module_test=0xFFFF");
-		system("sudo chmod 777 /dev/lzgw");
-		fp = open("/dev/lzgw",O_RDWR),errcode--;
-		if(fp<0) return -1;
-
-		// initializing paramteters..
-		linkedAddr = 0xffff;
+		if(mode > LAZURITE_LINK_DENY) return -EINVAL;
+		pthread_mutex_lock(&ctx->rx_lock);
+		ctx->link.mode = mode;
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return 0;
+	}
 
-		return result;
+	extern "C" int lazurite_setLinkMode(uint8_t mode)
+	{
+		return lazurite_ctx_setLinkMode(&default_ctx,mode);
 	}
 
 	/******************************************************************************/
-	/*! @brief initializing LazDriver as test mode
-		@param      none
-		@return         0=success <br> 0 < fail
-		@exception  none
-		@todo  must be change folder name of lazdriver
+	/*! @brief add/remove source address to/from link set
+	  @param[in]      addr   16bit address
+	  @return         0=success <br> 0 > fail
+	  @exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_test(uint16_t testmode)
+	extern "C" int lazurite_ctx_addLink(LAZURITE_CTX* ctx, uint16_t addr)
 	{
 		int result;
-		int errcode = 0;
-		char insmod[128];
-		// open device driver
-		sprintf(insmod,"sudo insmod /home/pi/driver/LazDriver/lazdriver.ko module_test=%0x%04x",testmode);
-		system(insmod);
-		system("sudo chmod 777 /dev/lzgw");
-		fp = open("/dev/lzgw",O_RDWR),errcode--;
-		if(fp<0) return -1;
-
-		// initializing paramteters..
-		linkedAddr = 0xffff;
+		pthread_mutex_lock(&ctx->rx_lock);
+		result = link_add16(&ctx->link.set,addr);
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return result;
+	}
 
+	extern "C" int lazurite_addLink(uint16_t addr)
+	{
+		return lazurite_ctx_addLink(&default_ctx,addr);
+	}
+
+	extern "C" int lazurite_ctx_removeLink(LAZURITE_CTX* ctx, uint16_t addr)
+	{
+		int result;
+		pthread_mutex_lock(&ctx->rx_lock);
+		result = link_remove16(&ctx->link.set,addr);
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return result;
+	}
+
+	extern "C" int lazurite_removeLink(uint16_t addr)
+	{
+		return lazurite_ctx_removeLink(&default_ctx,addr);
+	}
+
+	extern "C" int lazurite_ctx_addLink64le(LAZURITE_CTX* ctx, uint8_t *addr_le)
+	{
+		int result;
+		if(!addr_le) return -EINVAL;
+		pthread_mutex_lock(&ctx->rx_lock);
+		result = link_add64(&ctx->link.set,mac_load64(addr_le));
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return result;
+	}
+
+	extern "C" int lazurite_addLink64le(uint8_t *addr_le)
+	{
+		return lazurite_ctx_addLink64le(&default_ctx,addr_le);
+	}
+
+	extern "C" int lazurite_ctx_removeLink64le(LAZURITE_CTX* ctx, uint8_t *addr_le)
+	{
+		int result;
+		if(!addr_le) return -EINVAL;
+		pthread_mutex_lock(&ctx->rx_lock);
+		result = link_remove64(&ctx->link.set,mac_load64(addr_le));
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return result;
+	}
+
+	extern "C" int lazurite_removeLink64le(uint8_t *addr_le)
+	{
+		return lazurite_ctx_removeLink64le(&default_ctx,addr_le);
+	}
+
+	/******************************************************************************/
+	/*! @brief remove all addresses from link set
+	  @return         0=success
+	  @exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_clearLink(LAZURITE_CTX* ctx)
+	{
+		pthread_mutex_lock(&ctx->rx_lock);
+		link_clear(&ctx->link.set);
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return 0;
+	}
+
+	extern "C" int lazurite_clearLink(void)
+	{
+		return lazurite_ctx_clearLink(&default_ctx);
+	}
+
+	/******************************************************************************/
+	/*! @brief get counters of link filter
+	  @param[out]     *stats  counters
+	  @param[in]      clear   true = counters are cleared
+	  @return         0=success <br> -EINVAL = stats is NULL
+	  @exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_getLinkStats(LAZURITE_CTX* ctx, LAZURITE_LINK_STATS* stats, bool clear)
+	{
+		if(!stats) return -EINVAL;
+		pthread_mutex_lock(&ctx->rx_lock);
+		*stats = ctx->link.stats;
+		if(clear) memset(&ctx->link.stats,0,sizeof(ctx->link.stats));
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return 0;
+	}
+
+	extern "C" int lazurite_getLinkStats(LAZURITE_LINK_STATS* stats, bool clear)
+	{
+		return lazurite_ctx_getLinkStats(&default_ctx,stats,clear);
+	}
+
+	/******************************************************************************/
+	/*! @brief check source address of received frame by link filter
+	  only source address in raw is read. called under rx_lock.
+	  @return         true = accepted
+	 ******************************************************************************/
+	static bool link_accept(LAZURITE_CTX* ctx, const uint8_t *raw, const MAC_LAYOUT *layout)
+	{
+		const uint8_t *src = raw + layout->src_addr_offset;
+		bool found;
+
+		if(ctx->link.mode == LAZURITE_LINK_ALL) return true;
+		switch(layout->src_addr_len) {
+			case 0:
+				found = false;
+				break;
+			case 8:
+				found = link_find64(&ctx->link.set,mac_load64(src)) || link_find16(&ctx->link.set,mac_load16(src));
+				break;
+			default:
+				found = link_find16(&ctx->link.set,mac_getSrcShort(raw,layout));
+				break;
+		}
+		return found == (ctx->link.mode == LAZURITE_LINK_ALLOW);
+	}
+
+	/******************************************************************************/
+	/*! @brief load LazDriver
+	  @param      none
+	  @return         0=success <br> 0 < fail <br> 256= driver is existed in kernel
+	  @exception  none
+	  @note  path of lazdriver.ko is set by lazurite_setModulePath
+	 ******************************************************************************/
+	extern "C" int lazurite_init(void)
+	{
+		LAZURITE_CTX *ctx = &default_ctx;
+		int errcode = 0;
+		int result;
+
+		// open device driver
+		result = ctx->backend->load(0);
+		//result = ctx->backend->load(0xFFFF);
+		ctx->fp = ctx->backend->open(ctx->backend->path),errcode--;
+		if(ctx->fp<0) return -1;
+
+		// initializing paramteters..
+		lazurite_ctx_link(ctx,0xffff);
+
+		return result;
+	}
+
+	/******************************************************************************/
+	/*! @brief initializing LazDriver as test mode
+		@param      none
+		@return         0=success <br> 0 < fail
+		@exception  none
+		@note  path of lazdriver.ko is set by lazurite_setModulePath
+	 ******************************************************************************/
+	extern "C" int lazurite_test(uint16_t testmode)
+	{
+		LAZURITE_CTX *ctx = &default_ctx;
+		int result;
+		int errcode = 0;
+		// open device driver
+		ctx->backend->load(testmode);
+		ctx->fp = ctx->backend->open(ctx->backend->path),errcode--;
+		if(ctx->fp<0) return -1;
+
+		// initializing paramteters..
+		lazurite_ctx_link(ctx,0xffff);
+
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief remove driver from kernel
+		@param     none
+		@return         0=success <br> 0 < fail
+		@exception none
+	 ******************************************************************************/
+	extern "C" int lazurite_remove(void) 
+	{
+		int result;
+		ctx_shutdown(&default_ctx);
+		result = default_ctx.backend->unload();
+		return result;
+	}
+
+	/******************************************************************************/
+	/*! @brief set rx address to be sent
+		@param[out]     tmp_rxaddr   rxaddr to be sent
+		@return         0=success <br> 0 < fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_setRxAddr(LAZURITE_CTX* ctx, uint16_t tmp_rxaddr)
+	{
+		int result;
+		pthread_mutex_lock(&ctx->tx_lock);
+		shadow_dst_mode(ctx,16);
+		result = shadow_set(ctx,SHADOW_DST_ADDR0,IOCTL_PARAM | IOCTL_SET_DST_ADDR0,tmp_rxaddr);
+		pthread_mutex_unlock(&ctx->tx_lock);
+		if(result != tmp_rxaddr) {
+			return -1;
+		}
+		return 0;
+	}
+
+	extern "C" int lazurite_setRxAddr(uint16_t tmp_rxaddr)
+	{
+		return lazurite_ctx_setRxAddr(&default_ctx,tmp_rxaddr);
+	}
+
+	/******************************************************************************/
+	/*! @brief set PANID for TX
+		@param[out]     txpanid    set PANID(Personal Area Network ID) for sending
+		@return         0=success <br> 0 < fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_setTxPanid(LAZURITE_CTX* ctx, uint16_t txpanid)
+	{
+		int result;
+		pthread_mutex_lock(&ctx->tx_lock);
+		result = shadow_set(ctx,SHADOW_DST_PANID,IOCTL_PARAM | IOCTL_SET_DST_PANID,txpanid);
+		pthread_mutex_unlock(&ctx->tx_lock);
+		if(result != txpanid) return -1;
+		return 0;
+	}
+
+	extern "C" int lazurite_setTxPanid(uint16_t txpanid)
+	{
+		return lazurite_ctx_setTxPanid(&default_ctx,txpanid);
+	}
+
+	/******************************************************************************/
+	/*! @brief setup lazurite module
+		@param[in]  ch (RF frequency)<br>
+		in case of 100kbps, ch is 24-31, 33-60<br>
+		in case of 50kbps, ch is 24-61
+		@param[in]  mypanid
+		set my PANID.
+		@param[in] rate 50 or 100<br>
+		100 = 100kbps<br>
+		50  = 50kbps 
+		@param[in] pwr 1 or 20<br>
+		1  = 1mW<br>
+		20 = 20mW
+		@return         0=success <br> 0 < fail
+		@exception  none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_begin(LAZURITE_CTX* ctx, uint8_t ch, uint16_t mypanid, uint8_t rate,uint8_t pwr)
+	{
+		int result;
+		int errcode = 0;
+
+		shadow_reset(ctx);
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_CH,ch), errcode--;
+		if(result != ch) {
+			fprintf(stderr,"%s(%d) %s(%d,%04x,%d,%d)¥n",__FILE__,__LINE__,__func__,ch,mypanid,rate,pwr);
+			return errcode;
+		}
+
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_MY_PANID,mypanid), errcode--;
+		if(result != mypanid) {
+			fprintf(stderr,"%s(%d) %s(%d,%04x,%d,%d)¥n",__FILE__,__LINE__,__func__,ch,mypanid,rate,pwr);
+			return errcode;
+		}
+
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_BPS,rate), errcode--;
+		if(result != rate) {
+			fprintf(stderr,"%s(%d) %s(%d,%04x,%d,%d)¥n",__FILE__,__LINE__,__func__,ch,mypanid,rate,pwr);
+			return errcode;
+		}
+
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_PWR,pwr), errcode--;
+		if(result != pwr) {
+			fprintf(stderr,"%s(%d) %s(%d,%04x,%d,%d)¥n",__FILE__,__LINE__,__func__,ch,mypanid,rate,pwr);
+			return errcode;
+		}
+
+		result = drv_ioctl(ctx,IOCTL_CMD | IOCTL_SET_BEGIN,0), errcode--;
+		if(result != 0) {
+			fprintf(stderr,"%s(%d) %s(%d,%04x,%d,%d)¥n",__FILE__,__LINE__,__func__,ch,mypanid,rate,pwr);
+			return errcode;
+		}
+
+		return 0;
+	}
+
+	extern "C" int lazurite_begin(uint8_t ch, uint16_t mypanid, uint8_t rate,uint8_t pwr)
+	{
+		return lazurite_ctx_begin(&default_ctx,ch,mypanid,rate,pwr);
+	}
+
+	/******************************************************************************/
+	/*! @brief close driver (stop RF)
+		@param     none
+		@return         0=success <br> 0 < fail
+		@exception none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_close(LAZURITE_CTX* ctx)
+	{
+		int result;
+		int errcode = 0;
+
+		shadow_reset(ctx);
+		result = drv_ioctl(ctx,IOCTL_CMD | IOCTL_SET_CLOSE,0), errcode--;
+		if(result != 0) return errcode;
+
+		return 0;
+	}
+
+	extern "C" int lazurite_close(void)
+	{
+		return lazurite_ctx_close(&default_ctx);
+	}
+
+	/*! @brief little endian value of 64bit address. a16[0] is lower 16bit */
+	static inline uint64_t addr64_value(const uint16_t *a16)
+	{
+		return ((uint64_t)a16[3] << 48) | ((uint64_t)a16[2] << 32) | ((uint32_t)a16[1] << 16) | a16[0];
+	}
+
+	/******************************************************************************/
+	/*! @brief update neighbor table by result of send (lazurite_setNeighborTable). tx_lock must be held.
+		@param[in]     addr64     true = a16 is 64bit address
+		@param[in]     a16        destination. a16[0] is lower 16bit
+		@param[in]     result     result of send_addr64/send_addr16
+		@param[in]     rssi       rssi of ack. 0 > got from driver when result is success
+	 ******************************************************************************/
+	static void neighbor_sent(LAZURITE_CTX* ctx, bool addr64, const uint16_t *a16, int result, int rssi)
+	{
+		uint64_t addr;
+
+		if(addr64) {
+			addr = addr64_value(a16);
+		} else {
+			// broadcast
+			if(a16[0] == 0xffff) return;
+			addr = a16[0];
+		}
+		if((result >= 0) && (rssi < 0)) rssi = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_GET_TX_RSSI,0);
+		neighbor_tx(ctx->neighbor,addr,addr64 ? 8 : 2,result,rssi);
+	}
+
+	/******************************************************************************/
+	/*! @brief send data to 64bit address. tx_lock must be held.
+		@param[in]     a16        64bit MAC address. a16[0] is lower 16bit
+		@param[in]     payload start poiter of data to be sent
+		@param[in]     length length of payload
+		@return         0=success=0 <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail
+	 ******************************************************************************/
+	static int send_addr64(LAZURITE_CTX* ctx,const uint16_t *a16,const void* payload, uint16_t length)
+	{
+		int result;
+		int errcode=-1;
+
+		shadow_dst_mode(ctx,64);
+		result = shadow_set(ctx,SHADOW_DST_ADDR0,IOCTL_PARAM | IOCTL_SET_DST_ADDR0,a16[0]), errcode--;
+		if(result != a16[0]) return errcode;
+		result = shadow_set(ctx,SHADOW_DST_ADDR1,IOCTL_PARAM | IOCTL_SET_DST_ADDR1,a16[1]), errcode--;
+		if(result != a16[1]) return errcode;
+		result = shadow_set(ctx,SHADOW_DST_ADDR2,IOCTL_PARAM | IOCTL_SET_DST_ADDR2,a16[2]), errcode--;
+		if(result != a16[2]) return errcode;
+		result = shadow_set(ctx,SHADOW_DST_ADDR3,IOCTL_PARAM | IOCTL_SET_DST_ADDR3,a16[3]), errcode--;
+		if(result != a16[3]) return errcode;
+
+		result = drv_write(ctx,payload,length);
+		if(result < 0) result = errno*-1;
+		return result;
+	}
+
+	/******************************************************************************/
+	/*! @brief send data to 16bit address. tx_lock must be held.
+		@param[in]     rxpanid	panid of receiver
+		@param[in]     rxaddr     16bit short address of receiver
+		@param[in]     payload start poiter of data to be sent
+		@param[in]     length length of payload
+		@return         0=success=0 <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail
+	 ******************************************************************************/
+	static int send_addr16(LAZURITE_CTX* ctx,uint16_t rxpanid,uint16_t rxaddr,const void* payload, uint16_t length)
+	{
+		int result;
+		int errcode=0;
+
+		result = shadow_set(ctx,SHADOW_DST_PANID,IOCTL_PARAM | IOCTL_SET_DST_PANID,rxpanid), errcode--;
+		if(result != rxpanid) return errcode;
+
+		shadow_dst_mode(ctx,16);
+		result = shadow_set(ctx,SHADOW_DST_ADDR0,IOCTL_PARAM | IOCTL_SET_DST_ADDR0,rxaddr), errcode--;
+		if(result != rxaddr) return errcode;
+
+		result = drv_write(ctx,payload,length);
+		if(result < 0) result = errno*-1;
+		return result;
+	}
+
+	static void addr64_be(uint16_t *a16,const uint8_t *dst_be)
+	{
+		a16[3] = dst_be[0];
+		a16[3] = (a16[3] << 8) + dst_be[1];
+		a16[2] = dst_be[2];
+		a16[2] = (a16[2] << 8) + dst_be[3];
+		a16[1] = dst_be[4];
+		a16[1] = (a16[1] << 8) + dst_be[5];
+		a16[0] = dst_be[6];
+		a16[0] = (a16[0] << 8) + dst_be[7];
+	}
+
+	static void addr64_le(uint16_t *a16,const uint8_t *dst_le)
+	{
+		for(int i=0;i<4;i++) {
+			a16[i] = dst_le[i*2+1];
+			a16[i] = (a16[i] << 8) + dst_le[i*2];
+		}
+	}
+
+	/******************************************************************************/
+	/*! @brief send data
+		@param[in]     rxpanid	panid of receiver
+		@param[in]     dst_be     8x8bit address pointer for 64bit MAC address(big endian)<br>
+		rxpanid & txaddr = 0xffff = broadcast <br>
+		others = unicast <br>
+		@param[in]     payload start poiter of data to be sent
+		@param[in]     length length of payload
+		@return         0=success=0 <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail
+		@exception none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_send64be(LAZURITE_CTX* ctx, uint8_t *dst_be,const void* payload, uint16_t length)
+	{
+		int result;
+		uint16_t a16[4];
+		uint64_t start = metrics_now();
+		uint64_t ns;
+
+		if(!dst_be) return -1;
+		addr64_be(a16,dst_be);
+		PROBE5(send_entry,ctx,length,addr64_value(a16),8,0);
+		pthread_mutex_lock(&ctx->tx_lock);
+		result = send_addr64(ctx,a16,payload,length);
+		if(ctx->neighbor) neighbor_sent(ctx,true,a16,result,-1);
+		pthread_mutex_unlock(&ctx->tx_lock);
+		ns = metrics_sent(&ctx->metrics,result,start);
+		PROBE5(send_return,ctx,length,addr64_value(a16),result,ns);
+		return result;
+	}
+
+	extern "C" int lazurite_send64be(uint8_t *dst_be,const void* payload, uint16_t length)
+	{
+		return lazurite_ctx_send64be(&default_ctx,dst_be,payload,length);
+	}
+
+	/******************************************************************************/
+	/*! @brief send data
+		@param[in]     rxpanid	panid of receiver
+		@param[in]     dst_le     8x8bit address pointer for 64bit MAC address(big endian)<br>
+		rxpanid & txaddr = 0xffff = broadcast <br>
+		others = unicast <br>
+		@param[in]     payload start poiter of data to be sent
+		@param[in]     length length of payload
+		@return         0=success=0 <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail
+		@exception none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_send64le(LAZURITE_CTX* ctx, uint8_t *dst_le,const void* payload, uint16_t length)
+	{
+		int result;
+		uint16_t a16[4];
+		uint64_t start = metrics_now();
+		uint64_t ns;
+
+		if(!dst_le) return -1;
+		addr64_le(a16,dst_le);
+		PROBE5(send_entry,ctx,length,addr64_value(a16),8,0);
+		pthread_mutex_lock(&ctx->tx_lock);
+		result = send_addr64(ctx,a16,payload,length);
+		if(ctx->neighbor) neighbor_sent(ctx,true,a16,result,-1);
+		pthread_mutex_unlock(&ctx->tx_lock);
+		ns = metrics_sent(&ctx->metrics,result,start);
+		PROBE5(send_return,ctx,length,addr64_value(a16),result,ns);
+		return result;
+	}
+
+	extern "C" int lazurite_send64le(uint8_t *dst_le,const void* payload, uint16_t length)
+	{
+		return lazurite_ctx_send64le(&default_ctx,dst_le,payload,length);
+	}
+
+	/******************************************************************************/
+	/*! @brief send data
+		@param[in]     rxpanid	panid of receiver
+		@param[in]     txaddr     16bit short address of receiver<br>
+		rxpanid & txaddr = 0xffff = broadcast <br>
+		others = unicast <br>
+		@param[in]     payload start poiter of data to be sent
+		@param[in]     length length of payload
+		@return         0=success=0 <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail
+		@exception none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_send(LAZURITE_CTX* ctx, uint16_t rxpanid,uint16_t rxaddr,const void* payload, uint16_t length)
+	{
+		int result;
+		uint64_t start = metrics_now();
+		uint64_t ns;
+
+		PROBE5(send_entry,ctx,length,rxaddr,2,rxpanid);
+		pthread_mutex_lock(&ctx->tx_lock);
+		result = send_addr16(ctx,rxpanid,rxaddr,payload,length);
+		if(ctx->neighbor) neighbor_sent(ctx,false,&rxaddr,result,-1);
+		pthread_mutex_unlock(&ctx->tx_lock);
+		ns = metrics_sent(&ctx->metrics,result,start);
+		PROBE5(send_return,ctx,length,rxaddr,result,ns);
+		return result;
+	}
+
+	extern "C" int lazurite_send(uint16_t rxpanid,uint16_t rxaddr,const void* payload, uint16_t length)
+	{
+		return lazurite_ctx_send(&default_ctx,rxpanid,rxaddr,payload,length);
+	}
+
+	/******************************************************************************/
+	/*! @brief main loop of tx worker
+	 ******************************************************************************/
+	static void* txq_main(void* arg)
+	{
+		LAZURITE_CTX *ctx = (LAZURITE_CTX*)arg;
+		LAZURITE_TX_REQ *req;
+		LAZURITE_TX_COMPLETION comp;
+		uint64_t start;
+		uint64_t ns;
+		bool cancel;
+
+		pthread_mutex_lock(&ctx->txq.lock);
+		for(;;) {
+			while(!ctx->txq.stop && (ctx->txq.count == 0)) {
+				pthread_cond_wait(&ctx->txq.cond,&ctx->txq.lock);
+			}
+			if(ctx->txq.count == 0) break;
+			req = &ctx->txq.req[ctx->txq.head];
+			// stop is written under lock, so it is read here and not after unlock
+			cancel = ctx->txq.stop;
+			pthread_mutex_unlock(&ctx->txq.lock);
+
+			comp.handle = req->handle;
+			if(cancel) {
+				comp.result = -ECANCELED;
+				comp.rssi = -1;
+			} else {
+				start = metrics_now();
+				PROBE5(send_entry,ctx,req->length,req->addr64 ? addr64_value(req->a16) : req->a16[0],req->addr64 ? 8 : 2,req->addr64 ? 0 : req->panid);
+				pthread_mutex_lock(&ctx->tx_lock);
+				if(req->addr64) {
+					comp.result = send_addr64(ctx,req->a16,req->payload,req->length);
+				} else {
+					comp.result = send_addr16(ctx,req->panid,req->a16[0],req->payload,req->length);
+				}
+				comp.rssi = comp.result >= 0 ? drv_ioctl(ctx,IOCTL_PARAM | IOCTL_GET_TX_RSSI,0) : -1;
+				if(ctx->neighbor) neighbor_sent(ctx,req->addr64,req->a16,comp.result,comp.rssi);
+				pthread_mutex_unlock(&ctx->tx_lock);
+				ns = metrics_sent(&ctx->metrics,comp.result,start);
+				PROBE5(send_return,ctx,req->length,req->addr64 ? addr64_value(req->a16) : req->a16[0],comp.result,ns);
+			}
+
+			pthread_mutex_lock(&ctx->txq.lock);
+			ctx->txq.head = (ctx->txq.head + 1) % ctx->txq.depth;
+			ctx->txq.count--;
+			if(ctx->txq.callback) {
+				pthread_mutex_unlock(&ctx->txq.lock);
+				ctx->txq.callback(&comp,ctx->txq.arg);
+				pthread_mutex_lock(&ctx->txq.lock);
+				ctx->txq.outstanding--;
+			} else {
+				ctx->txq.comp[(ctx->txq.comp_head + ctx->txq.comp_count) % ctx->txq.depth] = comp;
+				ctx->txq.comp_count++;
+				pthread_cond_broadcast(&ctx->txq.done);
+			}
+		}
+		pthread_mutex_unlock(&ctx->txq.lock);
+		return NULL;
+	}
+
+	/******************************************************************************/
+	/*! @brief start tx queue
+		@param[in]      depth     max number of frames in queue (and completions not got)
+		@param[in]      callback  called by tx worker when frame is completed.<br>
+		NULL = completions are got by lazurite_getTxCompletion
+		@param[in]      arg       argument of callback
+		@return         0=success <br> 0 > fail (-EBUSY = already started)
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_startTxQueue(LAZURITE_CTX* ctx, uint16_t depth, LAZURITE_TX_CALLBACK callback, void* arg)
+	{
+		int result;
+
+		if(depth == 0) return -EINVAL;
+		if(ctx->txq.running) return -EBUSY;
+		ctx->txq.req = (LAZURITE_TX_REQ*)malloc(sizeof(LAZURITE_TX_REQ) * depth);
+		ctx->txq.comp = (LAZURITE_TX_COMPLETION*)malloc(sizeof(LAZURITE_TX_COMPLETION) * depth);
+		if(!ctx->txq.req || !ctx->txq.comp) {
+			free(ctx->txq.req);
+			free(ctx->txq.comp);
+			return -ENOMEM;
+		}
+		ctx->txq.depth = depth;
+		ctx->txq.head = ctx->txq.count = 0;
+		ctx->txq.comp_head = ctx->txq.comp_count = 0;
+		ctx->txq.outstanding = 0;
+		ctx->txq.stop = false;
+		ctx->txq.callback = callback;
+		ctx->txq.arg = arg;
+		result = pthread_create(&ctx->txq.thread,NULL,txq_main,ctx);
+		if(result != 0) {
+			free(ctx->txq.req);
+			free(ctx->txq.comp);
+			return -result;
+		}
+		ctx->txq.running = true;
+		return 0;
+	}
+
+	extern "C" int lazurite_startTxQueue(uint16_t depth, LAZURITE_TX_CALLBACK callback, void* arg)
+	{
+		return lazurite_ctx_startTxQueue(&default_ctx,depth,callback,arg);
+	}
+
+	/******************************************************************************/
+	/*! @brief stop tx queue
+		frame being sent is completed. frames in queue are completed with -ECANCELED.
+		@param      none
+		@return     0=success <br> 0 > fail
+		@exception  none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_stopTxQueue(LAZURITE_CTX* ctx)
+	{
+		if(!ctx->txq.running) return -EINVAL;
+		pthread_mutex_lock(&ctx->txq.lock);
+		ctx->txq.stop = true;
+		pthread_cond_broadcast(&ctx->txq.cond);
+		pthread_cond_broadcast(&ctx->txq.done);
+		pthread_mutex_unlock(&ctx->txq.lock);
+		pthread_join(ctx->txq.thread,NULL);
+		free(ctx->txq.req);
+		free(ctx->txq.comp);
+		ctx->txq.req = NULL;
+		ctx->txq.comp = NULL;
+		ctx->txq.running = false;
+		return 0;
+	}
+
+	extern "C" int lazurite_stopTxQueue(void)
+	{
+		return lazurite_ctx_stopTxQueue(&default_ctx);
+	}
+
+	/******************************************************************************/
+	/*! @brief put frame in tx queue
+	 ******************************************************************************/
+	static long txq_submit(LAZURITE_CTX* ctx,bool addr64, uint16_t panid, const uint16_t *a16, const void* payload, uint16_t length)
+	{
+		LAZURITE_TX_REQ *req;
+		long handle;
+
+		if(length > sizeof(req->payload)) return -EMSGSIZE;
+		if(!ctx->txq.running) return -EINVAL;
+		pthread_mutex_lock(&ctx->txq.lock);
+		if(ctx->txq.stop || (ctx->txq.outstanding >= ctx->txq.depth)) {
+			pthread_mutex_unlock(&ctx->txq.lock);
+			return -EAGAIN;
+		}
+		req = &ctx->txq.req[(ctx->txq.head + ctx->txq.count) % ctx->txq.depth];
+		handle = ctx->txq.handle = (ctx->txq.handle % 0x7fffffff) + 1;
+		req->handle = handle;
+		req->addr64 = addr64;
+		req->panid = panid;
+		memcpy(req->a16,a16,sizeof(req->a16));
+		req->length = length;
+		memcpy(req->payload,payload,length);
+		ctx->txq.count++;
+		ctx->txq.outstanding++;
+		pthread_cond_signal(&ctx->txq.cond);
+		pthread_mutex_unlock(&ctx->txq.lock);
+		return handle;
+	}
+
+	/******************************************************************************/
+	/*! @brief submit data to tx queue (lazurite_send without blocking)
+		@param[in]     rxpanid	panid of receiver
+		@param[in]     rxaddr     16bit short address of receiver
+		@param[in]     payload start poiter of data to be sent
+		@param[in]     length length of payload
+		@return         0 < handle <br> -EAGAIN = queue is full <br> 0 > fail
+		@exception none
+	 ******************************************************************************/
+	extern "C" long lazurite_ctx_submit(LAZURITE_CTX* ctx, uint16_t rxpanid,uint16_t rxaddr,const void* payload, uint16_t length)
+	{
+		uint16_t a16[4] = {rxaddr,0,0,0};
+		return txq_submit(ctx,false,rxpanid,a16,payload,length);
+	}
+
+	extern "C" long lazurite_submit(uint16_t rxpanid,uint16_t rxaddr,const void* payload, uint16_t length)
+	{
+		return lazurite_ctx_submit(&default_ctx,rxpanid,rxaddr,payload,length);
+	}
+
+	/******************************************************************************/
+	/*! @brief submit data to tx queue (lazurite_send64be without blocking)
+		@param[in]     dst_be     8x8bit address pointer for 64bit MAC address(big endian)
+		@param[in]     payload start poiter of data to be sent
+		@param[in]     length length of payload
+		@return         0 < handle <br> -EAGAIN = queue is full <br> 0 > fail
+		@exception none
+	 ******************************************************************************/
+	extern "C" long lazurite_ctx_submit64be(LAZURITE_CTX* ctx, uint8_t *dst_be,const void* payload, uint16_t length)
+	{
+		uint16_t a16[4];
+
+		if(!dst_be) return -EINVAL;
+		addr64_be(a16,dst_be);
+		return txq_submit(ctx,true,0,a16,payload,length);
+	}
+
+	extern "C" long lazurite_submit64be(uint8_t *dst_be,const void* payload, uint16_t length)
+	{
+		return lazurite_ctx_submit64be(&default_ctx,dst_be,payload,length);
+	}
+
+	/******************************************************************************/
+	/*! @brief submit data to tx queue (lazurite_send64le without blocking)
+		@param[in]     dst_le     8x8bit address pointer for 64bit MAC address(little endian)
+		@param[in]     payload start poiter of data to be sent
+		@param[in]     length length of payload
+		@return         0 < handle <br> -EAGAIN = queue is full <br> 0 > fail
+		@exception none
+	 ******************************************************************************/
+	extern "C" long lazurite_ctx_submit64le(LAZURITE_CTX* ctx, uint8_t *dst_le,const void* payload, uint16_t length)
+	{
+		uint16_t a16[4];
+
+		if(!dst_le) return -EINVAL;
+		addr64_le(a16,dst_le);
+		return txq_submit(ctx,true,0,a16,payload,length);
+	}
+
+	extern "C" long lazurite_submit64le(uint8_t *dst_le,const void* payload, uint16_t length)
+	{
+		return lazurite_ctx_submit64le(&default_ctx,dst_le,payload,length);
+	}
+
+	/******************************************************************************/
+	/*! @brief get completions of tx queue
+		@param[out]     *completions  array of completion
+		@param[in]      num           size of array
+		@param[in]      timeout       timeout(ms) until 1st completion. -1 = wait forever, 0 = no wait
+		@return         number of completions <br> 0 > fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_getTxCompletion(LAZURITE_CTX* ctx, LAZURITE_TX_COMPLETION* completions, int num, int timeout)
+	{
+		struct timespec limit;
+		int result = 0;
+		int i;
+
+		if(!ctx->txq.running) return -EINVAL;
+		if(ctx->txq.callback || !completions || (num <= 0)) return -EINVAL;
+		if(timeout > 0) {
+			clock_gettime(CLOCK_REALTIME,&limit);
+			limit.tv_sec += timeout / 1000;
+			limit.tv_nsec += (timeout % 1000) * 1000000;
+			if(limit.tv_nsec >= 1000000000) {
+				limit.tv_sec++;
+				limit.tv_nsec -= 1000000000;
+			}
+		}
+		pthread_mutex_lock(&ctx->txq.lock);
+		while((ctx->txq.comp_count == 0) && !ctx->txq.stop && (timeout != 0)) {
+			if(timeout < 0) {
+				pthread_cond_wait(&ctx->txq.done,&ctx->txq.lock);
+			} else if(pthread_cond_timedwait(&ctx->txq.done,&ctx->txq.lock,&limit) == ETIMEDOUT) {
+				break;
+			}
+		}
+		for(i=0;(i<num) && ctx->txq.comp_count;i++) {
+			completions[i] = ctx->txq.comp[ctx->txq.comp_head];
+			ctx->txq.comp_head = (ctx->txq.comp_head + 1) % ctx->txq.depth;
+			ctx->txq.comp_count--;
+			ctx->txq.outstanding--;
+			result++;
+		}
+		pthread_mutex_unlock(&ctx->txq.lock);
+		return result;
+	}
+
+	extern "C" int lazurite_getTxCompletion(LAZURITE_TX_COMPLETION* completions, int num, int timeout)
+	{
+		return lazurite_ctx_getTxCompletion(&default_ctx,completions,num,timeout);
+	}
+
+	/******************************************************************************/
+	/*! @brief enable RX
+		@param     none
+		@return         0=success <br> 0 < fail
+		@exception none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_rxEnable(LAZURITE_CTX* ctx)
+	{
+		int result;
+		int errcode=0;
+
+		result = drv_ioctl(ctx,IOCTL_CMD | IOCTL_SET_RXON,0), errcode--;
+		if(result != 0) return errcode;
+
+		return 0;
+	}
+
+	extern "C" int lazurite_rxEnable(void)
+	{
+		return lazurite_ctx_rxEnable(&default_ctx);
+	}
+
+	/******************************************************************************/
+	/*! @brief disable RX
+		@param     none
+		@return         0=success <br> 0 < fail
+		@exception none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_rxDisable(LAZURITE_CTX* ctx)
+	{
+		int result;
+		int errcode=0;
+
+		result = drv_ioctl(ctx,IOCTL_CMD | IOCTL_SET_RXOFF,0), errcode--;
+		if(result != 0) return errcode;
+
+		return 0;
+	}
+
+	extern "C" int lazurite_rxDisable(void)
+	{
+		return lazurite_ctx_rxDisable(&default_ctx);
+	}
+
+	/******************************************************************************/
+	/*! @brief get my address
+		@param[out]     short pointer to return my address
+		@return         0=success <br> 0 < fail
+		@exception none
+	 ******************************************************************************/
+
+	extern "C" int lazurite_ctx_getMyAddr64(LAZURITE_CTX* ctx, uint8_t *addr)
+	{
+		static const unsigned long cmd[4] = {
+			IOCTL_PARAM | IOCTL_GET_MY_ADDR0,
+			IOCTL_PARAM | IOCTL_GET_MY_ADDR1,
+			IOCTL_PARAM | IOCTL_GET_MY_ADDR2,
+			IOCTL_PARAM | IOCTL_GET_MY_ADDR3,
+		};
+		int result = 0;
+		int errcode=-1;
+		int i;
+
+		if(!addr) return errcode;
+		pthread_mutex_lock(&ctx->tx_lock);
+		for(i=0;i<4;i++) {
+			result = shadow_get(ctx,SHADOW_MY_ADDR0+i,cmd[i]), errcode--;
+			if(result < 0) break;
+			addr[i*2] = (result >> 8 )&0x00FF;
+			addr[i*2+1] = (result >> 0 )&0x00FF;
+		}
+		pthread_mutex_unlock(&ctx->tx_lock);
+		if(result < 0) return errcode;
+
+		return 0;
+	}
+
+	extern "C" int lazurite_getMyAddr64(uint8_t *addr)
+	{
+		return lazurite_ctx_getMyAddr64(&default_ctx,addr);
+	}
+
+	/******************************************************************************/
+	/*! @brief get my address
+		@param[out]     short pointer to return my address
+		@return         0=success <br> 0 < fail
+		@exception none
+	 ******************************************************************************/
+
+	extern "C" long lazurite_ctx_getMyAddress(LAZURITE_CTX* ctx)
+	{
+		int result;
+		int errcode=0;
+
+		pthread_mutex_lock(&ctx->tx_lock);
+		result = shadow_get(ctx,SHADOW_MY_SHORT_ADDR,IOCTL_PARAM | IOCTL_GET_MY_SHORT_ADDR), errcode--;
+		pthread_mutex_unlock(&ctx->tx_lock);
+		if(result < 0) return errcode;
+
+		return (uint16_t)result;
+	}
+
+	extern "C" long lazurite_getMyAddress(void)
+	{
+		return lazurite_ctx_getMyAddress(&default_ctx);
+	}
+
+	/******************************************************************************/
+	/*! @brief set my short address
+		@param[in]      my_addr(0x0000-0xfffe) last 2byte of 64bit MAC address is in default.
+		@param[out]     0: OK, -1:error (my_addr == 0xFFFF) 0xFFFF is reserved for broadcast
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_setMyAddress(LAZURITE_CTX* ctx, uint16_t my_addr)
+	{
+		int result;
+		int errcode=0;
+		pthread_mutex_lock(&ctx->tx_lock);
+		result = shadow_set(ctx,SHADOW_MY_SHORT_ADDR,IOCTL_PARAM | IOCTL_SET_MY_SHORT_ADDR,my_addr), errcode--;
+		pthread_mutex_unlock(&ctx->tx_lock);
+		if(result != my_addr) return errcode;
+		return 0;
+	}
+
+	extern "C" int lazurite_setMyAddress(uint16_t my_addr)
+	{
+		return lazurite_ctx_setMyAddress(&default_ctx,my_addr);
+	}
+
+	/******************************************************************************/
+	/*! @brief number of ioctl skipped by shadow of parameters
+		@param      none
+		@return     number of ioctl which was not issued
+		@exception  none
+	 ******************************************************************************/
+	extern "C" unsigned long lazurite_ctx_getIoctlSaved(LAZURITE_CTX* ctx)
+	{
+		unsigned long result;
+		pthread_mutex_lock(&ctx->tx_lock);
+		result = ctx->shadow.saved;
+		pthread_mutex_unlock(&ctx->tx_lock);
+		return result;
+	}
+
+	extern "C" unsigned long lazurite_getIoctlSaved(void)
+	{
+		return lazurite_ctx_getIoctlSaved(&default_ctx);
+	}
+
+	/******************************************************************************/
+	/*! @brief send data via 920MHz
+		@param[in]     *payload     data 
+		@param[in]      size        data of length
+		@return         0=success=0 <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_write(LAZURITE_CTX* ctx, const char* payload, uint16_t size)
+	{
+		int result;
+		pthread_mutex_lock(&ctx->tx_lock);
+		result = drv_write(ctx,payload,size);
+		pthread_mutex_unlock(&ctx->tx_lock);
+		return result;
+	}
+
+	extern "C" int lazurite_write(const char* payload, uint16_t size)
+	{
+		return lazurite_ctx_write(&default_ctx,payload,size);
+	}
+
+	/******************************************************************************/
+	/*! @brief decoding mac header for external function
+		@param[out]     *mac    result of decoding raw
+		@param[in]      *raw    raw data of ieee802154
+		@param[in]      raw_len length of raw
+		@return         length of raw data <br> -EBADMSG = raw is shorter than mac header
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_decMac(SUBGHZ_MAC* mac,void* raw,uint16_t raw_size){
+		int result;
+		//lazurite_ctx_getRxRssi(ctx,&mac->rssi);
+		//lazurite_ctx_getRxTime(ctx,&mac->tv_sec,&mac->tv_nsec);
+		// not timed. clock_gettime takes longer than decoding
+		PROBE1(decmac_entry,raw_size);
+		result = mac_decode(mac,(const uint8_t*)raw,raw_size);
+		PROBE2(decmac_return,raw_size,result);
+		return result;
+	}
+
+	/******************************************************************************/
+	/*! @brief get size of receiving data
+		@param      none
+		@return     length of receiving packet
+		@exception  none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_available(LAZURITE_CTX* ctx)
+	{
+		int result;
+		short tmp_size;
+		pthread_mutex_lock(&ctx->rx_lock);
+		result=drv_read(ctx,&tmp_size,2);
+		pthread_mutex_unlock(&ctx->rx_lock);
+		if(result != 0) result = (int)tmp_size;
+		return result;
+	}
+
+	extern "C" int lazurite_available(void)
+	{
+		return lazurite_ctx_available(&default_ctx);
+	}
+
+	/******************************************************************************/
+	/*! @brief read raw data
+		@param[out]     *raw
+		pointer to write received packet data.<br>
+		255 byte should be reserved.
+		@param[out]     size
+		size of raw data
+		@return     length of receiving packet
+		@exception  none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_read(LAZURITE_CTX* ctx, void* raw, uint16_t* size){
+		int result;
+		uint16_t tmp_size;
+
+		PROBE1(read_entry,ctx);
+		pthread_mutex_lock(&ctx->rx_lock);
+		do {
+			result = drv_read(ctx,&tmp_size,2);
+			if(result <= 0){
+				pthread_mutex_unlock(&ctx->rx_lock);
+				*size=0;
+				PROBE3(read_return,ctx,result,0);
+				return result;
+			}
+			if(tmp_size > sizeof(ctx->buf)) tmp_size = sizeof(ctx->buf);
+			result=drv_read(ctx,ctx->buf,tmp_size);
+			drv_received(ctx,1);
+		} while((ctx->filter && !lazurite_matchFilter(ctx->filter,ctx->buf,tmp_size)) ||
+				(ctx->dedup && dedup_drop(ctx,(uint8_t*)ctx->buf,tmp_size)));
+		if(ctx->neighbor) neighbor_received(ctx,(uint8_t*)ctx->buf,tmp_size);
+		memcpy(raw,ctx->buf,tmp_size);
+		pthread_mutex_unlock(&ctx->rx_lock);
+		*size = tmp_size;
+		PROBE3(read_return,ctx,tmp_size,tmp_size);
+		return tmp_size;
+	}
+
+	extern "C" int lazurite_read(void* raw, uint16_t* size)
+	{
+		return lazurite_ctx_read(&default_ctx,raw,size);
+	}
+
+	/******************************************************************************/
+	/*! @brief set filter of received frames
+		@param[in]      *filter   filter of lazurite_compileFilter. NULL = all frames
+		@return         0=success <br> -EBUSY = rx thread or dispatcher is running
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_setFilter(LAZURITE_CTX* ctx, const LAZURITE_FILTER* filter)
+	{
+		// threads read filter without rx_lock
+		if(ctx->dispatcher.running || ctx->rxq.running) return -EBUSY;
+		pthread_mutex_lock(&ctx->rx_lock);
+		ctx->filter = filter;
+		pthread_mutex_unlock(&ctx->rx_lock);
 		return 0;
 	}
 
+	extern "C" int lazurite_setFilter(const LAZURITE_FILTER* filter)
+	{
+		return lazurite_ctx_setFilter(&default_ctx,filter);
+	}
+
+	/******************************************************************************/
+	/*! @brief get rssi and receiving time of each frame in lazurite_readBatch
+		@param[in]      on        true = got by ioctl after each frame. false = 0 (default)
+		@return         0=success <br> -EBUSY = rx thread or dispatcher is running
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_setRxInfo(LAZURITE_CTX* ctx, bool on)
+	{
+		// threads read rx_info without rx_lock
+		if(ctx->dispatcher.running || ctx->rxq.running) return -EBUSY;
+		pthread_mutex_lock(&ctx->rx_lock);
+		ctx->rx_info = on;
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return 0;
+	}
+
+	extern "C" int lazurite_setRxInfo(bool on)
+	{
+		return lazurite_ctx_setRxInfo(&default_ctx,on);
+	}
+	/******************************************************************************/
+	/*! @brief read queued frames at once
+		frames which do not match filter are dropped before mac header is decoded.
+		@param[out]     *frames   array of slots
+		@param[in]      num       number of slots
+		@param[in]      info      get rssi and time of each frame (drv_recv)
+		@return         number of frames <br> 0 = no frame <br> 0 > fail
+	 ******************************************************************************/
+	static int ctx_readBatch(LAZURITE_CTX* ctx, LAZURITE_FRAME* frames, int num, bool info)
+	{
+		const LAZURITE_FILTER *filter = ctx->filter;
+		DEDUP_TABLE *dedup = ctx->dedup;
+		NEIGHBOR_TABLE *neighbor = ctx->neighbor;
+		struct timespec read_time;
+		int64_t now = 0;
+		uint64_t start;
+		int result;
+		int received;
+		int i;
+
+		if(!frames || (num <= 0)) return -EINVAL;
+		for(;;) {
+			result = drv_recv(ctx,frames,num,info);
+			if((!filter && !dedup) || (result <= 0)) break;
+			received = result;
+			if(dedup) {
+				now = monotonic_ms();
+				pthread_mutex_lock(&dedup->lock);
+			}
+			for(i=0,result=0;i<received;i++) {
+				if(filter && !lazurite_matchFilter(filter,frames[i].raw,frames[i].len)) continue;
+				if(dedup && dedup_check(dedup,frames[i].raw,frames[i].len,now)) continue;
+				if(i != result) memcpy(&frames[result],&frames[i],offsetof(LAZURITE_FRAME,raw) + frames[i].len);
+				result++;
+			}
+			if(dedup) pthread_mutex_unlock(&dedup->lock);
+			// all slots were filled and dropped. more frames may be in driver
+			if(result || (received < num)) break;
+		}
+		if(ctx->capture && (result > 0)) lazurite_writeCapture(ctx->capture,frames,result);
+		if(result > 0) {
+			start = metrics_now();
+			for(i=0;i<result;i++) {
+				mac_layoutFrame(&frames[i]);
+			}
+			metrics_record(&metrics_live(&ctx->metrics)->decode,metrics_now() - start);
+		}
+		if(neighbor && (result > 0)) {
+			// same clock as lazurite_read and send. time of frame may be one of the file on replay
+			clock_gettime(CLOCK_REALTIME,&read_time);
+			for(i=0;i<result;i++) {
+				neighbor_rx(neighbor,frames[i].raw,frames[i].len,(info || ctx->backend->recv) ? frames[i].rssi : -1,
+						read_time.tv_sec,read_time.tv_nsec);
+			}
+		}
+		if(ctx->log && (result > 0)) lazurite_writeLog(ctx->log,frames,result);
+		return result;
+	}
+
+	/******************************************************************************/
+	/*! @brief read queued frames at once
+		@param[out]     *frames   array of slots
+		@param[in]      num       number of slots
+		@return         number of frames <br> 0 = no frame <br> 0 > fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_readBatch(LAZURITE_CTX* ctx, LAZURITE_FRAME* frames, int num)
+	{
+		return ctx_readBatch(ctx,frames,num,ctx->rx_info);
+	}
+
+	extern "C" int lazurite_readBatch(LAZURITE_FRAME* frames, int num)
+	{
+		return lazurite_ctx_readBatch(&default_ctx,frames,num);
+	}
+	/******************************************************************************/
+	/*! @brief read one frame with RSSI and receiving time
+		@param[out]     *frame    slot of frame
+		@return         length of receiving packet <br> 0 = no frame <br> 0 > fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_readFrame(LAZURITE_CTX* ctx, LAZURITE_FRAME* frame)
+	{
+		int result;
+
+		// rssi and time are always got, so one frame costs 2 read and 5 ioctl on lzgw
+		result = ctx_readBatch(ctx,frame,1,true);
+		if(result <= 0) return result;
+		return frame->len;
+	}
+
+	extern "C" int lazurite_readFrame(LAZURITE_FRAME* frame)
+	{
+		return lazurite_ctx_readFrame(&default_ctx,frame);
+	}
+
+	/******************************************************************************/
+	/*! @brief get descriptor of device
+		@param      none
+		@return     descriptor <br> 0 > not opened
+		@exception  none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_getFd(LAZURITE_CTX* ctx)
+	{
+		return ctx->fp;
+	}
+
+	extern "C" int lazurite_getFd(void)
+	{
+		return lazurite_ctx_getFd(&default_ctx);
+	}
+
+	/******************************************************************************/
+	/*! @brief wait until frame is received
+		@param[in]      timeout   timeout(ms). -1 = wait forever
+		@return         1 = frame is received <br> 0 = timeout <br> 0 > fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_wait(LAZURITE_CTX* ctx, int timeout)
+	{
+		struct pollfd pfd;
+		int result;
+
+		if(ctx->fp < 0) return -EBADF;
+		pfd.fd = ctx->fp;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		do {
+			result = poll(&pfd,1,timeout);
+		} while((result < 0) && (errno == EINTR));
+		if(result < 0) return -errno;
+		if(result && !(pfd.revents & POLLIN)) return -EIO;
+		return result;
+	}
+
+	extern "C" int lazurite_wait(int timeout)
+	{
+		return lazurite_ctx_wait(&default_ctx,timeout);
+	}
+
+	/******************************************************************************/
+	/*! @brief sleep a moment when descriptor was readable but no frame.
+	  (driver without poll reports always readable)
+	 ******************************************************************************/
+	static void spurious_wait(void)
+	{
+		struct timespec ts = {0, 1000000};
+		nanosleep(&ts,NULL);
+	}
+
+	/******************************************************************************/
+	/*! @brief read raw data with timeout
+		@param[out]     *raw      pointer to write received packet data. 255 byte should be reserved.
+		@param[out]     size      size of raw data
+		@param[in]      timeout   timeout(ms). -1 = wait forever
+		@return         length of receiving packet <br> 0 = timeout <br> 0 > fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_readTimeout(LAZURITE_CTX* ctx, void* raw, uint16_t* size, int timeout)
+	{
+		int result;
+		int remain = timeout;
+		int64_t limit = monotonic_ms() + timeout;
+
+		for(;;) {
+			result = lazurite_ctx_read(ctx,raw,size);
+			if(result != 0) return result;
+			if(timeout >= 0) {
+				remain = limit - monotonic_ms();
+				if(remain <= 0) return 0;
+			}
+			result = lazurite_ctx_wait(ctx,remain);
+			if(result <= 0) {
+				*size = 0;
+				return result;
+			}
+			result = lazurite_ctx_read(ctx,raw,size);
+			if(result != 0) return result;
+			spurious_wait();
+		}
+	}
+
+	extern "C" int lazurite_readTimeout(void* raw, uint16_t* size, int timeout)
+	{
+		return lazurite_ctx_readTimeout(&default_ctx,raw,size,timeout);
+	}
+
+	/******************************************************************************/
+	/*! @brief main loop of dispatcher thread
+	 ******************************************************************************/
+	static void* dispatcher_main(void* arg)
+	{
+		LAZURITE_CTX *ctx = (LAZURITE_CTX*)arg;
+		LAZURITE_FRAME *frames = ctx->dispatcher.frames;
+		struct pollfd pfd[2];
+		eventfd_t tmp;
+		int result;
+		int i;
+
+		pfd[0].fd = ctx->fp;
+		pfd[0].events = POLLIN;
+		pfd[1].fd = ctx->dispatcher.stop;
+		pfd[1].events = POLLIN;
+		for(;;) {
+			result = lazurite_ctx_readBatch(ctx,frames,sizeof(ctx->dispatcher.frames)/sizeof(frames[0]));
+			if(result > 0) {
+				for(i=0;i<result;i++) {
+					ctx->dispatcher.callback(&frames[i],ctx->dispatcher.arg);
+				}
+				continue;
+			}
+			pfd[0].revents = pfd[1].revents = 0;
+			result = poll(pfd,2,-1);
+			if((result < 0) && (errno != EINTR)) break;
+			if(pfd[1].revents & POLLIN) {
+				eventfd_read(ctx->dispatcher.stop,&tmp);
+				break;
+			}
+			if(pfd[0].revents & (POLLERR|POLLHUP|POLLNVAL)) break;
+			if(pfd[0].revents & POLLIN) {
+				result = lazurite_ctx_readBatch(ctx,frames,sizeof(ctx->dispatcher.frames)/sizeof(frames[0]));
+				if(result == 0) spurious_wait();
+				for(i=0;i<result;i++) {
+					ctx->dispatcher.callback(&frames[i],ctx->dispatcher.arg);
+				}
+			}
+		}
+		return NULL;
+	}
+
+	/******************************************************************************/
+	/*! @brief start dispatcher thread
+		@param[in]      callback  function to be called
+		@param[in]      arg       argument of callback
+		@return         0=success <br> 0 > fail (-EBUSY = dispatcher or rx thread is running)
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_startDispatcher(LAZURITE_CTX* ctx, LAZURITE_RX_CALLBACK callback, void* arg)
+	{
+		int result;
+
+		if(!callback) return -EINVAL;
+		if(ctx->fp < 0) return -EBADF;
+		if(ctx->dispatcher.running || ctx->rxq.running) return -EBUSY;
+		ctx->dispatcher.stop = eventfd(0,EFD_CLOEXEC);
+		if(ctx->dispatcher.stop < 0) return -errno;
+		ctx->dispatcher.callback = callback;
+		ctx->dispatcher.arg = arg;
+		result = pthread_create(&ctx->dispatcher.thread,NULL,dispatcher_main,ctx);
+		if(result != 0) {
+			close(ctx->dispatcher.stop);
+			return -result;
+		}
+		ctx->dispatcher.running = true;
+		return 0;
+	}
+
+	extern "C" int lazurite_startDispatcher(LAZURITE_RX_CALLBACK callback, void* arg)
+	{
+		return lazurite_ctx_startDispatcher(&default_ctx,callback,arg);
+	}
+
+	/******************************************************************************/
+	/*! @brief stop dispatcher thread
+		@param      none
+		@return     0=success <br> 0 > fail
+		@exception  none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_stopDispatcher(LAZURITE_CTX* ctx)
+	{
+		if(!ctx->dispatcher.running) return -EINVAL;
+		eventfd_write(ctx->dispatcher.stop,1);
+		pthread_join(ctx->dispatcher.thread,NULL);
+		close(ctx->dispatcher.stop);
+		ctx->dispatcher.running = false;
+		return 0;
+	}
+
+	extern "C" int lazurite_stopDispatcher(void)
+	{
+		return lazurite_ctx_stopDispatcher(&default_ctx);
+	}
+
 	/******************************************************************************/
-	/*! @brief remove driver from kernel
-		@param     none
-		@return         0=success <br> 0 < fail
-		@exception none
+	/*! @brief main loop of rx thread
+		frames are read into free slots of ring directly, then published by tail.
 	 ******************************************************************************/
-	extern "C" int lazurite_remove(void) 
+	static void* rxq_main(void* arg)
 	{
+		LAZURITE_CTX *ctx = (LAZURITE_CTX*)arg;
+		struct pollfd pfd[2];
+		eventfd_t tmp;
+		uint32_t head, tail, space, index;
+		bool polled = false;
 		int result;
-		close(fp);
-		usleep(100000);
-		result = system("sudo rmmod lazdriver");
-		return result;
+
+		pfd[0].events = POLLIN;
+		pfd[1].fd = ctx->rxq.stop;
+		pfd[1].events = POLLIN;
+		tail = ctx->rxq.tail;
+		for(;;) {
+			head = __atomic_load_n(&ctx->rxq.head,__ATOMIC_ACQUIRE);
+			space = ctx->rxq.mask + 1 - (tail - head);
+			if(space) {
+				index = tail & ctx->rxq.mask;
+				if(space > ctx->rxq.mask + 1 - index) space = ctx->rxq.mask + 1 - index;
+				result = lazurite_ctx_readBatch(ctx,&ctx->rxq.slot[index],space);
+				if(result > 0) {
+					tail += result;
+					__atomic_store_n(&ctx->rxq.tail,tail,__ATOMIC_RELEASE);
+					eventfd_write(ctx->rxq.ready,1);
+					polled = false;
+					continue;
+				}
+				if(polled) spurious_wait();
+				pfd[0].fd = ctx->fp;
+			} else {
+				// frames are kept in driver until consumer frees slots
+				__atomic_store_n(&ctx->rxq.full,true,__ATOMIC_SEQ_CST);
+				if(__atomic_load_n(&ctx->rxq.head,__ATOMIC_SEQ_CST) != head) {
+					__atomic_store_n(&ctx->rxq.full,false,__ATOMIC_RELAXED);
+					continue;
+				}
+				pfd[0].fd = ctx->rxq.freed;
+			}
+			pfd[0].revents = pfd[1].revents = 0;
+			result = poll(pfd,2,-1);
+			if((result < 0) && (errno != EINTR)) break;
+			if(pfd[1].revents & POLLIN) {
+				eventfd_read(ctx->rxq.stop,&tmp);
+				return NULL;
+			}
+			if(!space) {
+				eventfd_read(ctx->rxq.freed,&tmp);
+				__atomic_store_n(&ctx->rxq.full,false,__ATOMIC_RELAXED);
+				polled = false;
+				continue;
+			}
+			if(pfd[0].revents & (POLLERR|POLLHUP|POLLNVAL)) break;
+			polled = (pfd[0].revents & POLLIN) != 0;
+		}
+		__atomic_store_n(&ctx->rxq.exited,true,__ATOMIC_RELEASE);
+		eventfd_write(ctx->rxq.ready,1);
+		return NULL;
 	}
 
 	/******************************************************************************/
-	/*! @brief set rx address to be sent
-		@param[out]     tmp_rxaddr   rxaddr to be sent
-		@return         0=success <br> 0 < fail
+	/*! @brief start rx thread
+		@param[in]      depth     number of frames in ring. rounded up to power of 2
+		@param[in]      cpu       cpu which rx thread is pinned to. -1 = not pinned
+		@return         0=success <br> 0 > fail (-EBUSY = rx thread or dispatcher is running)
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setRxAddr(uint16_t tmp_rxaddr)
+	extern "C" int lazurite_ctx_startRxThread(LAZURITE_CTX* ctx, uint16_t depth, int cpu)
 	{
+		cpu_set_t cpus;
+		uint32_t size = 2;
 		int result;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_ADDR0,tmp_rxaddr);
-		if(result != tmp_rxaddr) {
-			return -1;
+
+		if(depth == 0) return -EINVAL;
+		if(ctx->fp < 0) return -EBADF;
+		if(ctx->rxq.running || ctx->dispatcher.running) return -EBUSY;
+		while(size < depth) size <<= 1;
+		ctx->rxq.slot = (LAZURITE_FRAME*)malloc(sizeof(LAZURITE_FRAME) * size);
+		if(!ctx->rxq.slot) return -ENOMEM;
+		ctx->rxq.stop = eventfd(0,EFD_CLOEXEC);
+		ctx->rxq.ready = eventfd(0,EFD_CLOEXEC | EFD_NONBLOCK);
+		ctx->rxq.freed = eventfd(0,EFD_CLOEXEC | EFD_NONBLOCK);
+		if((ctx->rxq.stop < 0) || (ctx->rxq.ready < 0) || (ctx->rxq.freed < 0)) {
+			result = -errno;
+			goto error;
+		}
+		ctx->rxq.mask = size - 1;
+		ctx->rxq.head = ctx->rxq.tail = 0;
+		ctx->rxq.exited = false;
+		ctx->rxq.full = false;
+		result = pthread_create(&ctx->rxq.thread,NULL,rxq_main,ctx);
+		if(result != 0) {
+			result = -result;
+			goto error;
 		}
+		if(cpu >= 0) {
+			CPU_ZERO(&cpus);
+			CPU_SET(cpu,&cpus);
+			pthread_setaffinity_np(ctx->rxq.thread,sizeof(cpus),&cpus);
+		}
+		ctx->rxq.running = true;
 		return 0;
+	error:
+		if(ctx->rxq.stop >= 0) close(ctx->rxq.stop);
+		if(ctx->rxq.ready >= 0) close(ctx->rxq.ready);
+		if(ctx->rxq.freed >= 0) close(ctx->rxq.freed);
+		free(ctx->rxq.slot);
+		ctx->rxq.slot = NULL;
+		return result;
+	}
+
+	extern "C" int lazurite_startRxThread(uint16_t depth, int cpu)
+	{
+		return lazurite_ctx_startRxThread(&default_ctx,depth,cpu);
 	}
 
 	/******************************************************************************/
-	/*! @brief set PANID for TX
-		@param[out]     txpanid    set PANID(Personal Area Network ID) for sending
-		@return         0=success <br> 0 < fail
-		@exception      none
+	/*! @brief stop rx thread. frames left in ring are abandoned.
+		@param      none
+		@return     0=success <br> 0 > fail
+		@exception  none
 	 ******************************************************************************/
-	extern "C" int lazurite_setTxPanid(uint16_t txpanid)
+	extern "C" int lazurite_ctx_stopRxThread(LAZURITE_CTX* ctx)
 	{
-		int result;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_PANID,txpanid);
-		if(result != txpanid) return -1;
+		if(!ctx->rxq.running) return -EINVAL;
+		eventfd_write(ctx->rxq.stop,1);
+		pthread_join(ctx->rxq.thread,NULL);
+		close(ctx->rxq.stop);
+		close(ctx->rxq.ready);
+		close(ctx->rxq.freed);
+		free(ctx->rxq.slot);
+		ctx->rxq.slot = NULL;
+		ctx->rxq.running = false;
 		return 0;
 	}
 
+	extern "C" int lazurite_stopRxThread(void)
+	{
+		return lazurite_ctx_stopRxThread(&default_ctx);
+	}
+
 	/******************************************************************************/
-	/*! @brief setup lazurite module
-		@param[in]  ch (RF frequency)<br>
-		in case of 100kbps, ch is 24-31, 33-60<br>
-		in case of 50kbps, ch is 24-61
-		@param[in]  mypanid
-		set my PANID.
-		@param[in] rate 50 or 100<br>
-		100 = 100kbps<br>
-		50  = 50kbps 
-		@param[in] pwr 1 or 20<br>
-		1  = 1mW<br>
-		20 = 20mW
-		@return         0=success <br> 0 < fail
-		@exception  none
+	/*! @brief get frames received by rx thread
+		only one thread may call this function at a time.
+		@param[out]     *frames   array of slots
+		@param[in]      num       number of slots
+		@param[in]      timeout   timeout(ms) until 1st frame. -1 = wait forever, 0 = no wait
+		@return         number of frames <br> 0 = timeout <br> 0 > fail (-EIO = rx thread ended by error)
+		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_begin(uint8_t ch, uint16_t mypanid, uint8_t rate,uint8_t pwr)
+	extern "C" int lazurite_ctx_getRxFrames(LAZURITE_CTX* ctx, LAZURITE_FRAME* frames, int num, int timeout)
 	{
+		struct pollfd pfd;
+		eventfd_t tmp;
+		uint32_t head, tail, count, i;
+		int64_t limit = monotonic_ms() + timeout;
+		int remain = timeout;
 		int result;
-		int errcode = 0;
-
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_CH,ch), errcode--;
-		if(result != ch) {
-			fprintf(stderr,"%s(%d) %s(%d,%04x,%d,%d)¥n",__FILE__,__LINE__,__func__,ch,mypanid,rate,pwr);
-			return errcode;
-		}
-
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_MY_PANID,mypanid), errcode--;
-		if(result != mypanid) {
-			fprintf(stderr,"%s(%d) %s(%d,%04x,%d,%d)¥n",__FILE__,__LINE__,__func__,ch,mypanid,rate,pwr);
-			return errcode;
-		}
-
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_BPS,rate), errcode--;
-		if(result != rate) {
-			fprintf(stderr,"%s(%d) %s(%d,%04x,%d,%d)¥n",__FILE__,__LINE__,__func__,ch,mypanid,rate,pwr);
-			return errcode;
-		}
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_PWR,pwr), errcode--;
-		if(result != pwr) {
-			fprintf(stderr,"%s(%d) %s(%d,%04x,%d,%d)¥n",__FILE__,__LINE__,__func__,ch,mypanid,rate,pwr);
-			return errcode;
+		if(!ctx->rxq.running) return -EINVAL;
+		if(!frames || (num <= 0)) return -EINVAL;
+		pfd.fd = ctx->rxq.ready;
+		pfd.events = POLLIN;
+		head = ctx->rxq.head;
+		for(;;) {
+			tail = __atomic_load_n(&ctx->rxq.tail,__ATOMIC_ACQUIRE);
+			count = tail - head;
+			if(count) break;
+			if(__atomic_load_n(&ctx->rxq.exited,__ATOMIC_ACQUIRE)) return -EIO;
+			if(timeout == 0) return 0;
+			if(timeout > 0) {
+				remain = limit - monotonic_ms();
+				if(remain <= 0) return 0;
+			}
+			pfd.revents = 0;
+			result = poll(&pfd,1,remain);
+			if((result < 0) && (errno != EINTR)) return -errno;
+			eventfd_read(ctx->rxq.ready,&tmp);
 		}
-
-		result = ioctl(fp,IOCTL_CMD | IOCTL_SET_BEGIN,0), errcode--;
-		if(result != 0) {
-			fprintf(stderr,"%s(%d) %s(%d,%04x,%d,%d)¥n",__FILE__,__LINE__,__func__,ch,mypanid,rate,pwr);
-			return errcode;
+		if(count > (uint32_t)num) count = num;
+		for(i=0;i<count;i++) {
+			const LAZURITE_FRAME *slot = &ctx->rxq.slot[(head + i) & ctx->rxq.mask];
+			// raw is copied only for its length
+			memcpy(&frames[i],slot,offsetof(LAZURITE_FRAME,raw) + slot->len);
 		}
+		__atomic_store_n(&ctx->rxq.head,head + count,__ATOMIC_SEQ_CST);
+		if(__atomic_load_n(&ctx->rxq.full,__ATOMIC_SEQ_CST)) eventfd_write(ctx->rxq.freed,1);
+		return count;
+	}
 
-		return 0;
+	extern "C" int lazurite_getRxFrames(LAZURITE_FRAME* frames, int num, int timeout)
+	{
+		return lazurite_ctx_getRxFrames(&default_ctx,frames,num,timeout);
 	}
 
 	/******************************************************************************/
-	/*! @brief close driver (stop RF)
-		@param     none
-		@return         0=success <br> 0 < fail
-		@exception none
+	/*! @brief capture frames got by lazurite_readBatch
+		@param[in]      *capture  capture of lazurite_openCapture. NULL = stop
+		@return         0=success <br> -EBUSY = rx thread or dispatcher is running
+		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_close(void)
+	extern "C" int lazurite_ctx_setCapture(LAZURITE_CTX* ctx, LAZURITE_CAPTURE* capture)
 	{
-		int result;
-		int errcode = 0;
-
-		result = ioctl(fp,IOCTL_CMD | IOCTL_SET_CLOSE,0), errcode--;
-		if(result != 0) return errcode;
-
+		// threads read capture without rx_lock
+		if(ctx->dispatcher.running || ctx->rxq.running) return -EBUSY;
+		pthread_mutex_lock(&ctx->rx_lock);
+		ctx->capture = capture;
+		pthread_mutex_unlock(&ctx->rx_lock);
 		return 0;
 	}
 
+	extern "C" int lazurite_setCapture(LAZURITE_CAPTURE* capture)
+	{
+		return lazurite_ctx_setCapture(&default_ctx,capture);
+	}
+
 	/******************************************************************************/
-	/*! @brief send data
-		@param[in]     rxpanid	panid of receiver
-		@param[in]     dst_be     8x8bit address pointer for 64bit MAC address(big endian)<br>
-		rxpanid & txaddr = 0xffff = broadcast <br>
-		others = unicast <br>
-		@param[in]     payload start poiter of data to be sent
-		@param[in]     length length of payload
-		@return         0=success=0 <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail
-		@exception none
+	/*! @brief write frames got by lazurite_readBatch to binary log
+		@param[in]      *log      log of lazurite_openLog. NULL = stop
+		@return         0=success <br> -EBUSY = rx thread or dispatcher is running
+		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_send64be(uint8_t *dst_be,const void* payload, uint16_t length)
+	extern "C" int lazurite_ctx_setLog(LAZURITE_CTX* ctx, LAZURITE_LOG* log)
 	{
-		int result;
-		int errcode=-1;
-		uint16_t a16[4];
-
-		if(!dst_be) return errcode;
-		a16[3] = dst_be[0];
-		a16[3] = (a16[3] << 8) + dst_be[1];
-		a16[2] = dst_be[2];
-		a16[2] = (a16[2] << 8) + dst_be[3];
-		a16[1] = dst_be[4];
-		a16[1] = (a16[1] << 8) + dst_be[5];
-		a16[0] = dst_be[6];
-		a16[0] = (a16[0] << 8) + dst_be[7];
-
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_ADDR0,a16[0]), errcode--;
-		if(result != a16[0]) return errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_ADDR1,a16[1]), errcode--;
-		if(result != a16[1]) return errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_ADDR2,a16[2]), errcode--;
-		if(result != a16[2]) return errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_ADDR3,a16[3]), errcode--;
-		if(result != a16[3]) return errcode;
+		// threads read log without rx_lock
+		if(ctx->dispatcher.running || ctx->rxq.running) return -EBUSY;
+		pthread_mutex_lock(&ctx->rx_lock);
+		ctx->log = log;
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return 0;
+	}
 
-		result = write(fp,payload,length);
-		if(result < 0) result = errno*-1;
-		return result;
+	extern "C" int lazurite_setLog(LAZURITE_LOG* log)
+	{
+		return lazurite_ctx_setLog(&default_ctx,log);
 	}
 
 	/******************************************************************************/
-	/*! @brief send data
-		@param[in]     rxpanid	panid of receiver
-		@param[in]     dst_le     8x8bit address pointer for 64bit MAC address(big endian)<br>
-		rxpanid & txaddr = 0xffff = broadcast <br>
-		others = unicast <br>
-		@param[in]     payload start poiter of data to be sent
-		@param[in]     length length of payload
-		@return         0=success=0 <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail
-		@exception none
+	/*! @brief drop frames retransmitted because ACK was lost
+		@param[in]      *param    size of table, window and timeout. NULL = stop
+		@return         0=success <br> 0 > fail (-EBUSY = rx thread or dispatcher is running)
+		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_send64le(uint8_t *dst_le,const void* payload, uint16_t length)
+	extern "C" int lazurite_ctx_setDedup(LAZURITE_CTX* ctx, const LAZURITE_DEDUP_PARAM* param)
 	{
-		int result;
-		int errcode=-1;
-		uint16_t a16[4];
-
-		if(!dst_le) return errcode;
-		for(int i=0;i<4;i++) {
-			a16[i] = dst_le[i*2+1];
-			a16[i] = (a16[i] << 8) + dst_le[i*2];
+		DEDUP_TABLE *table = NULL;
+		DEDUP_TABLE *old;
+
+		// threads read table without rx_lock
+		if(ctx->dispatcher.running || ctx->rxq.running) return -EBUSY;
+		if(param) {
+			table = dedup_create(param);
+			if(!table) return -errno;
 		}
+		pthread_mutex_lock(&ctx->rx_lock);
+		old = ctx->dedup;
+		ctx->dedup = table;
+		pthread_mutex_unlock(&ctx->rx_lock);
+		dedup_free(old);
+		return 0;
+	}
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_ADDR0,a16[0]), errcode--;
-		if(result != a16[0]) return errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_ADDR1,a16[1]), errcode--;
-		if(result != a16[1]) return errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_ADDR2,a16[2]), errcode--;
-		if(result != a16[2]) return errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_ADDR3,a16[3]), errcode--;
-		if(result != a16[3]) return errcode;
-
-		result = write(fp,payload,length);
-		if(result < 0) result = errno*-1;
-		return result;
+	extern "C" int lazurite_setDedup(const LAZURITE_DEDUP_PARAM* param)
+	{
+		return lazurite_ctx_setDedup(&default_ctx,param);
 	}
 
 	/******************************************************************************/
-	/*! @brief send data
-		@param[in]     rxpanid	panid of receiver
-		@param[in]     txaddr     16bit short address of receiver<br>
-		rxpanid & txaddr = 0xffff = broadcast <br>
-		others = unicast <br>
-		@param[in]     payload start poiter of data to be sent
-		@param[in]     length length of payload
-		@return         0=success=0 <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail
-		@exception none
+	/*! @brief get counters of duplicate suppression
+		@param[out]     *stats    counters
+		@param[in]      clear     true = counters are cleared after read
+		@return         0=success <br> -EINVAL = suppression is not set
+		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_send(uint16_t rxpanid,uint16_t rxaddr,const void* payload, uint16_t length)
+	extern "C" int lazurite_ctx_getDedupStats(LAZURITE_CTX* ctx, LAZURITE_DEDUP_STATS* stats, bool clear)
 	{
-		int result;
-		int errcode=0;
-
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_PANID,rxpanid), errcode--;
-		if(result != rxpanid) return errcode;
-
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_DST_ADDR0,rxaddr), errcode--;
-		if(result != rxaddr) return errcode;
+		DEDUP_TABLE *table;
+
+		if(!stats) return -EINVAL;
+		pthread_mutex_lock(&ctx->rx_lock);
+		table = ctx->dedup;
+		if(!table) {
+			pthread_mutex_unlock(&ctx->rx_lock);
+			return -EINVAL;
+		}
+		pthread_mutex_lock(&table->lock);
+		*stats = table->stats;
+		if(clear) memset(&table->stats,0,sizeof(table->stats));
+		pthread_mutex_unlock(&table->lock);
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return 0;
+	}
 
-		result = write(fp,payload,length);
-		if(result < 0) result = errno*-1;
-		return result;
+	extern "C" int lazurite_getDedupStats(LAZURITE_DEDUP_STATS* stats, bool clear)
+	{
+		return lazurite_ctx_getDedupStats(&default_ctx,stats,clear);
 	}
 
 	/******************************************************************************/
-	/*! @brief enable RX
-		@param     none
-		@return         0=success <br> 0 < fail
-		@exception none
+	/*! @brief keep link quality of each node
+		@param[in]      *param    size of table and weight of average. NULL = stop
+		@return         0=success <br> 0 > fail (-EBUSY = rx thread or dispatcher is running)
+		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_rxEnable(void)
+	extern "C" int lazurite_ctx_setNeighborTable(LAZURITE_CTX* ctx, const LAZURITE_NEIGHBOR_PARAM* param)
 	{
-		int result;
-		int errcode=0;
-
-		result = ioctl(fp,IOCTL_CMD | IOCTL_SET_RXON,0), errcode--;
-		if(result != 0) return errcode;
-
+		NEIGHBOR_TABLE *table = NULL;
+		NEIGHBOR_TABLE *old;
+
+		// threads read table without rx_lock
+		if(ctx->dispatcher.running || ctx->rxq.running) return -EBUSY;
+		if(param) {
+			table = neighbor_create(param);
+			if(!table) return -errno;
+		}
+		pthread_mutex_lock(&ctx->rx_lock);
+		pthread_mutex_lock(&ctx->tx_lock);
+		old = ctx->neighbor;
+		ctx->neighbor = table;
+		pthread_mutex_unlock(&ctx->tx_lock);
+		pthread_mutex_unlock(&ctx->rx_lock);
+		neighbor_free(old);
 		return 0;
 	}
 
+	extern "C" int lazurite_setNeighborTable(const LAZURITE_NEIGHBOR_PARAM* param)
+	{
+		return lazurite_ctx_setNeighborTable(&default_ctx,param);
+	}
+
 	/******************************************************************************/
-	/*! @brief disable RX
-		@param     none
-		@return         0=success <br> 0 < fail
-		@exception none
+	/*! @brief get link quality of one node
+		@param[in]      addr_len    2 or 8
+		@return         0=success <br> -ENOENT = node is not in table <br> -EINVAL = table is not set
 	 ******************************************************************************/
-	extern "C" int lazurite_rxDisable(void)
+	static int neighbor_lookup(LAZURITE_CTX* ctx, uint64_t addr, uint8_t addr_len, LAZURITE_NEIGHBOR* neighbor)
 	{
 		int result;
-		int errcode=0;
-
-		result = ioctl(fp,IOCTL_CMD | IOCTL_SET_RXOFF,0), errcode--;
-		if(result != 0) return errcode;
 
-		return 0;
+		if(!neighbor) return -EINVAL;
+		// entry is copied without lock of table. rx_lock only keeps the table
+		pthread_mutex_lock(&ctx->rx_lock);
+		if(ctx->neighbor) result = neighbor_get(ctx->neighbor,addr,addr_len,neighbor);
+		else result = -EINVAL;
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return result;
 	}
 
-	/******************************************************************************/
-	/*! @brief get my address
-		@param[out]     short pointer to return my address
-		@return         0=success <br> 0 < fail
-		@exception none
-	 ******************************************************************************/
+	extern "C" int lazurite_ctx_getNeighbor(LAZURITE_CTX* ctx, uint16_t addr, LAZURITE_NEIGHBOR* neighbor)
+	{
+		return neighbor_lookup(ctx,addr,2,neighbor);
+	}
 
-	extern "C" int lazurite_getMyAddr64(uint8_t *addr)
+	extern "C" int lazurite_getNeighbor(uint16_t addr, LAZURITE_NEIGHBOR* neighbor)
 	{
-		int result;
-		int errcode=-1;
+		return lazurite_ctx_getNeighbor(&default_ctx,addr,neighbor);
+	}
 
-		if(!addr) return errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_MY_ADDR0,0), errcode--;
-		if(result < 0) return errcode;
-		else {
-			addr[0] = (result >> 8 )&0x00FF;
-			addr[1] = (result >> 0 )&0x00FF;
-		}
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_MY_ADDR1,0), errcode--;
-		if(result < 0) return errcode;
-		else {
-			addr[2] = (result >> 8 )&0x00FF;
-			addr[3] = (result >> 0 )&0x00FF;
-		}
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_MY_ADDR2,0), errcode--;
-		if(result < 0) return errcode;
-		else {
-			addr[4] = (result >> 8 )&0x00FF;
-			addr[5] = (result >> 0 )&0x00FF;
-		}
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_MY_ADDR3,0), errcode--;
-		if(result < 0) return errcode;
-		else {
-			addr[6] = (result >> 8 )&0x00FF;
-			addr[7] = (result >> 0 )&0x00FF;
-		}
+	extern "C" int lazurite_ctx_getNeighbor64le(LAZURITE_CTX* ctx, uint8_t *addr_le, LAZURITE_NEIGHBOR* neighbor)
+	{
+		if(!addr_le) return -EINVAL;
+		return neighbor_lookup(ctx,mac_load64(addr_le),8,neighbor);
+	}
 
-		return 0;
+	extern "C" int lazurite_getNeighbor64le(uint8_t *addr_le, LAZURITE_NEIGHBOR* neighbor)
+	{
+		return lazurite_ctx_getNeighbor64le(&default_ctx,addr_le,neighbor);
 	}
 
 	/******************************************************************************/
-	/*! @brief get my address
-		@param[out]     short pointer to return my address
-		@return         0=success <br> 0 < fail
-		@exception none
+	/*! @brief get link quality of all nodes
+		@param[out]     *neighbors  array of nodes
+		@param[in]      num         number of array
+		@return         number of nodes <br> -EINVAL = table is not set
+		@exception      none
 	 ******************************************************************************/
-
-	extern "C" long lazurite_getMyAddress(void)
+	extern "C" int lazurite_ctx_getNeighbors(LAZURITE_CTX* ctx, LAZURITE_NEIGHBOR* neighbors, int num)
 	{
 		int result;
-		int errcode=0;
-		uint16_t addr;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_MY_SHORT_ADDR,0), errcode--;
-		if((addr = result )<0) return errcode;
-
-		return addr;
+		if(!neighbors || (num < 0)) return -EINVAL;
+		pthread_mutex_lock(&ctx->rx_lock);
+		if(ctx->neighbor) result = neighbor_list(ctx->neighbor,neighbors,num);
+		else result = -EINVAL;
+		pthread_mutex_unlock(&ctx->rx_lock);
+		return result;
 	}
 
-	/******************************************************************************/
-	/*! @brief set my short address
-		@param[in]      my_addr(0x0000-0xfffe) last 2byte of 64bit MAC address is in default.
-		@param[out]     0: OK, -1:error (my_addr == 0xFFFF) 0xFFFF is reserved for broadcast
-	 ******************************************************************************/
-	extern "C" int lazurite_setMyAddress(uint16_t my_addr)
+	extern "C" int lazurite_getNeighbors(LAZURITE_NEIGHBOR* neighbors, int num)
 	{
-		int result;
-		int errcode=0;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_MY_SHORT_ADDR,my_addr), errcode--;
-		if(result != my_addr) return errcode;
-		return 0;
+		return lazurite_ctx_getNeighbors(&default_ctx,neighbors,num);
 	}
 
 	/******************************************************************************/
-	/*! @brief send data via 920MHz
-		@param[in]     *payload     data 
-		@param[in]      size        data of length
-		@return         0=success=0 <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail
+	/*! @brief get counters and histograms
+		@param[out]     *metrics    copy of counters
+		@return         0=success <br> -EINVAL = parameter error
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_write(const char* payload, uint16_t size)
+	extern "C" int lazurite_ctx_getMetrics(LAZURITE_CTX* ctx, LAZURITE_METRICS* metrics)
 	{
-		int result;
-		result = write(fp,payload,size);
-		return result;
+		if(!metrics) return -EINVAL;
+		metrics_snapshot(&ctx->metrics,metrics);
+		return 0;
+	}
+
+	extern "C" int lazurite_getMetrics(LAZURITE_METRICS* metrics)
+	{
+		return lazurite_ctx_getMetrics(&default_ctx,metrics);
 	}
 
 	/******************************************************************************/
-	/*! @brief decoding mac header for external function
-		@param[out]     *mac    result of decoding raw
-		@param[in]      *raw    raw data of ieee802154
-		@param[in]      raw_len length of raw
-		@return         length of raw data
+	/*! @brief write counters and histograms as text format of Prometheus
+		@param[in]      *path     file
+		@return         0=success <br> 0 > fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_decMac(SUBGHZ_MAC* mac,void* raw,uint16_t raw_size){
-		int result;
-		uint16_t tmp_size;
-		SUBGHZ_MAC_PARAM param;
-		subghz_decMac(&param,raw,raw_size);
-		//lazurite_getRxRssi(&mac->rssi);
-		//lazurite_getRxTime(&mac->tv_sec,&mac->tv_nsec);
-		mac->header = param.mac_header.header;
-		mac->frame_type = param.mac_header.alignment.frame_type;
-		mac->sec_enb = param.mac_header.alignment.sec_enb;
-		mac->pending = param.mac_header.alignment.pending;
-		mac->ack_req = param.mac_header.alignment.ack_req;
-		mac->panid_comp = param.mac_header.alignment.panid_comp;
-		mac->seq_comp = param.mac_header.alignment.seq_comp;
-		mac->ielist = param.mac_header.alignment.ielist;
-		mac->src_addr_type = param.mac_header.alignment.src_addr_type;
-		mac->frame_ver = param.mac_header.alignment.frame_ver;
-		mac->dst_addr_type = param.mac_header.alignment.dst_addr_type;
-		mac->seq_num = param.seq_num;
-		mac->addr_type = param.addr_type;
-		mac->dst_panid = param.dst_panid;
-		memcpy(mac->dst_addr,param.dst_addr,8);
-		mac->src_panid = param.src_panid;
-		memcpy(mac->src_addr,param.src_addr,8);
-		mac->payload_offset = param.raw_len - param.payload_len;
-		mac->payload_len = param.payload_len;
-		return param.raw_len;
+	extern "C" int lazurite_ctx_writeMetrics(LAZURITE_CTX* ctx, const char* path)
+	{
+		if(!path) return -EINVAL;
+		return metrics_write(&ctx->metrics,path);
 	}
 
-	/******************************************************************************/
-	/*! @brief get size of receiving data
-		@param      none
-		@return     length of receiving packet
-		@exception  none
-	 ******************************************************************************/
-	extern "C" int lazurite_available(void)
+	extern "C" int lazurite_writeMetrics(const char* path)
 	{
-		int result;
-		short tmp_size;
-		result=read(fp,&tmp_size,2);
-		if(result != 0) result = (int)tmp_size;
-		return result;
+		return lazurite_ctx_writeMetrics(&default_ctx,path);
 	}
 
 	/******************************************************************************/
-	/*! @brief read raw data
-		@param[out]     *raw
-		pointer to write received packet data.<br>
-		255 byte should be reserved.
-		@param[out]     size
-		size of raw data
-		@return     length of receiving packet
-		@exception  none
+	/*! @brief share counters by POSIX shared memory
+		@param[in]      *name     name of shm_open. NULL = stop sharing
+		@return         0=success <br> 0 > fail (-EBUSY = already shared or thread of context is running)
+		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_read(void* raw, uint16_t* size){
-		int result;
-		uint16_t tmp_size;
-		SUBGHZ_MAC_PARAM mac;
-
-		result = read(fp,&tmp_size,2);
-		if(result == 0){
-			*size=0;
+	extern "C" int lazurite_ctx_shareMetrics(LAZURITE_CTX* ctx, const char* name)
+	{
+		// threads of context would update old counters while they are copied
+		if(ctx->dispatcher.running || ctx->rxq.running || ctx->txq.running) return -EBUSY;
+		if(!name) {
+			metrics_unshare(&ctx->metrics);
 			return 0;
 		}
-		result=read(fp,buf,tmp_size);
-		memcpy(raw,buf,tmp_size);
-		*size = tmp_size;
-		return tmp_size;
+		if(ctx->metrics.name) return -EBUSY;
+		return metrics_share(&ctx->metrics,name);
+	}
+
+	extern "C" int lazurite_shareMetrics(const char* name)
+	{
+		return lazurite_ctx_shareMetrics(&default_ctx,name);
 	}
+
 	/******************************************************************************/
 	/*! @brief read only payload. header is abandoned.
 		@param[out]     *payload    memory for payload to be written. need to reserve 250 byte in maximum.
@@ -775,22 +2711,44 @@ namespace lazurite
 		@note           about lazurite_readPayload:
 		mac header is abandoned.
 	 ******************************************************************************/
-	extern "C" int lazurite_readPayload(char* payload, uint16_t* size)
+	extern "C" int lazurite_ctx_readPayload(LAZURITE_CTX* ctx, char* payload, uint16_t* size)
 	{
 		int result;
 		uint16_t tmp_size;
-		SUBGHZ_MAC_PARAM mac;
+		const MAC_LAYOUT *layout;
 
-		result = read(fp,&tmp_size,2);
-		if(result == 0){
-			*size=0;
-			return 0;
-		}
-		result=read(fp,buf,tmp_size);
-		subghz_decMac(&mac,buf,tmp_size);
-		memcpy(payload,mac.payload,mac.payload_len);
-		*size = mac.payload_len;
-		return mac.payload_len;
+		PROBE1(read_payload_entry,ctx);
+		pthread_mutex_lock(&ctx->rx_lock);
+		do {
+			result = drv_read(ctx,&tmp_size,2);
+			if(result <= 0){
+				pthread_mutex_unlock(&ctx->rx_lock);
+				*size=0;
+				PROBE3(read_payload_return,ctx,result,0);
+				return result;
+			}
+			if(tmp_size > sizeof(ctx->buf)) tmp_size = sizeof(ctx->buf);
+			result=drv_read(ctx,ctx->buf,tmp_size);
+			drv_received(ctx,1);
+			if((tmp_size < 2) || (tmp_size < (layout = mac_getLayout((uint8_t*)ctx->buf))->header_len)) {
+				pthread_mutex_unlock(&ctx->rx_lock);
+				*size=0;
+				PROBE3(read_payload_return,ctx,-EBADMSG,0);
+				return -EBADMSG;
+			}
+		} while(ctx->dedup && dedup_drop(ctx,(uint8_t*)ctx->buf,tmp_size));
+		if(ctx->neighbor) neighbor_received(ctx,(uint8_t*)ctx->buf,tmp_size);
+		result = tmp_size - layout->header_len;
+		memcpy(payload,ctx->buf + layout->header_len,result);
+		pthread_mutex_unlock(&ctx->rx_lock);
+		*size = result;
+		PROBE3(read_payload_return,ctx,result,result);
+		return result;
+	}
+
+	extern "C" int lazurite_readPayload(char* payload, uint16_t* size)
+	{
+		return lazurite_ctx_readPayload(&default_ctx,payload,size);
 	}
 	/******************************************************************************/
 	/*! @brief read payload from linked address
@@ -801,38 +2759,65 @@ namespace lazurite
 		@note  About linkedAddress mode:
 		The size is length of receiving packet in kernel driver.
 		When tx address is wrong in linked address mode, lazurite_readPayload or lazurite_read return 0.
-		mac header is abandoned in this mode.
+		mac header is abandoned in this mode.<br>
+		source address is checked by link filter (lazurite_link/lazurite_addLink/lazurite_setLinkMode)
+		before payload is copied. up to 16 frames (with duplicates of lazurite_setDedup) are dropped in one call.
 	 ******************************************************************************/
-	extern "C" int lazurite_readLink(char* payload, uint16_t* size)
+	extern "C" int lazurite_ctx_readLink(LAZURITE_CTX* ctx, char* payload, uint16_t* size)
 	{
 		int result;
 		uint16_t tmp_size;
 		int i;
-		SUBGHZ_MAC_PARAM mac;
+		const MAC_LAYOUT *layout;
+		uint8_t *raw = (uint8_t*)ctx->buf;
+		PROBE1(read_link_entry,ctx);
+		pthread_mutex_lock(&ctx->rx_lock);
 		for (i=0;i<16;i++) {
-			result = read(fp,&tmp_size,2);
+			result = drv_read(ctx,&tmp_size,2);
 			if(result <= 0){
 				*size=0;
 				break;
 			}
-			result=read(fp,buf,tmp_size);
-			subghz_decMac(&mac,buf,tmp_size);
-			uint16_t *src_addr = (uint16_t*)mac.src_addr;
-			if ((*src_addr == linkedAddr) || (linkedAddr == 0xFFFF))
+			if(tmp_size > sizeof(ctx->buf)) tmp_size = sizeof(ctx->buf);
+			result=drv_read(ctx,ctx->buf,tmp_size);
+			drv_received(ctx,1);
+			if((tmp_size < 2) || (tmp_size < (layout = mac_getLayout(raw))->header_len)) {
+				ctx->link.stats.rejected++;
+				*size=0;
+				result = -EBADMSG;
+				continue;
+			}
+			if (link_accept(ctx,raw,layout))
 			{
-				*size = mac.payload_len;
-				result = mac.payload_len;
-				mac.payload[result]=0;
-				memcpy(payload,mac.payload,*size);
+				if(ctx->dedup && dedup_drop(ctx,raw,tmp_size)) {
+					*size=0;
+					result = 0;
+					continue;
+				}
+				if(ctx->neighbor) neighbor_received(ctx,raw,tmp_size);
+				ctx->link.stats.accepted++;
+				*size = tmp_size - layout->header_len;
+				result = *size;
+				memcpy(payload,raw + layout->header_len,*size);
 				break;
 			}
 			else
 			{
+				ctx->link.stats.rejected++;
+				*size=0;
+				result = 0;
 				continue;
 			}
 		}
+		pthread_mutex_unlock(&ctx->rx_lock);
+		PROBE3(read_link_return,ctx,result,*size);
 		return result;
 	}
+
+	extern "C" int lazurite_readLink(char* payload, uint16_t* size)
+	{
+		return lazurite_ctx_readLink(&default_ctx,payload,size);
+	}
 	/******************************************************************************/
 	/*! @brief get Receiving time
 		@param[out]     *tv_sec     32bit linux time data
@@ -840,33 +2825,14 @@ namespace lazurite
 		@return         0=success <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_getRxTime(time_t* tv_sec,long* tv_nsec)
+	extern "C" int lazurite_ctx_getRxTime(LAZURITE_CTX* ctx, time_t* tv_sec,long* tv_nsec)
 	{
-		time_t sec;
-		long nsec;
-		int result;
-		int errcode=0;
-
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_RX_SEC1,0),errcode--;
-		if(result < 0) return errcode;
-		sec = result;
-
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_RX_SEC0,0),errcode--;
-		if(result < 0) return errcode;
-		sec = (sec << 16) + result;
-
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_RX_NSEC1,0),errcode--;
-		if(result < 0) return errcode;
-		nsec = result;
-
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_RX_NSEC0,0),errcode--;
-		if(result < 0) return errcode;
-		nsec = (nsec << 16) + result;
-
-		*tv_sec = sec;
-		*tv_nsec = nsec;
+		return drv_rxtime(ctx,tv_sec,tv_nsec);
+	}
 
-		return 0;
+	extern "C" int lazurite_getRxTime(time_t* tv_sec,long* tv_nsec)
+	{
+		return lazurite_ctx_getRxTime(&default_ctx,tv_sec,tv_nsec);
 	}
 	/******************************************************************************/
 	/*! @brief get RSSI of last receiving packet
@@ -874,15 +2840,20 @@ namespace lazurite
 		@return         0 > rssi <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_getRxRssi(void)
+	extern "C" int lazurite_ctx_getRxRssi(LAZURITE_CTX* ctx)
 	{
 		int result;
-		int errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_RX_RSSI,0),errcode--;
+		int errcode=0;
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_GET_RX_RSSI,0),errcode--;
 		if(result < 0) return errcode;
 
 		return result;
 	}
+
+	extern "C" int lazurite_getRxRssi(void)
+	{
+		return lazurite_ctx_getRxRssi(&default_ctx);
+	}
 	/******************************************************************************/
 	/*! @brief get RSSI of ack in last tx packet
 		@param[out]     *rssi   value of RSSI.  0-255. 255 is in maxim
@@ -890,15 +2861,150 @@ namespace lazurite
 		@return         0 > rssi <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_getTxRssi(void)
+	extern "C" int lazurite_ctx_getTxRssi(LAZURITE_CTX* ctx)
 	{
 		int result;
 		int errcode=0;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_TX_RSSI,0),errcode--;
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_GET_TX_RSSI,0),errcode--;
 		if(result < 0) return errcode;
 		return result;
 	}
 
+	extern "C" int lazurite_getTxRssi(void)
+	{
+		return lazurite_ctx_getTxRssi(&default_ctx);
+	}
+
+	/******************************************************************************/
+	/*! @brief get all parameters of send mode
+		1st call reads them from driver. after that, they are returned from the library
+		until lazurite_begin/lazurite_close/lazurite_remove.
+		@param[out]     *mode   parameters of send mode
+		@return         0=success <br> 0 > fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_getSendMode(LAZURITE_CTX* ctx, LAZURITE_SEND_MODE* mode)
+	{
+		static const unsigned long cmd[5] = {
+			IOCTL_PARAM | IOCTL_GET_ADDR_TYPE,
+			IOCTL_PARAM | IOCTL_GET_SENSE_TIME,
+			IOCTL_PARAM | IOCTL_GET_TX_RETRY,
+			IOCTL_PARAM | IOCTL_GET_TX_INTERVAL,
+			IOCTL_PARAM | IOCTL_GET_CCA_WAIT,
+		};
+		int value[5];
+		int result;
+		int errcode=0;
+		int i;
+
+		if(!mode) return -EINVAL;
+		pthread_mutex_lock(&ctx->tx_lock);
+		if(ctx->shadow.mode_valid) {
+			*mode = ctx->shadow.mode;
+			ctx->shadow.saved += 6;
+			pthread_mutex_unlock(&ctx->tx_lock);
+			return 0;
+		}
+		result = drv_ioctl(ctx,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
+		if(result != 0) {
+			pthread_mutex_unlock(&ctx->tx_lock);
+			return errcode;
+		}
+		for(i=0;i<5;i++) {
+			result = drv_ioctl(ctx,cmd[i],0), errcode--;
+			if(result < 0) {
+				pthread_mutex_unlock(&ctx->tx_lock);
+				return errcode;
+			}
+			value[i] = result;
+		}
+		ctx->shadow.mode.addr_type = value[0];
+		ctx->shadow.mode.sense_time = value[1];
+		ctx->shadow.mode.tx_retry = value[2];
+		ctx->shadow.mode.tx_interval = value[3];
+		ctx->shadow.mode.cca_wait = value[4];
+		ctx->shadow.mode_valid = true;
+		*mode = ctx->shadow.mode;
+		pthread_mutex_unlock(&ctx->tx_lock);
+
+		return 0;
+	}
+
+	extern "C" int lazurite_getSendMode(LAZURITE_SEND_MODE* mode)
+	{
+		return lazurite_ctx_getSendMode(&default_ctx,mode);
+	}
+
+	/******************************************************************************/
+	/*! @brief set all parameters of send mode at once
+		only parameters which are changed are written between IOCTL_GET_SEND_MODE and IOCTL_SET_SEND_MODE.
+		@param[in]      *mode   parameters of send mode
+		@return         0=success <br> 0 > fail
+		@exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_ctx_setSendMode(LAZURITE_CTX* ctx, const LAZURITE_SEND_MODE* mode)
+	{
+		static const unsigned long cmd[5] = {
+			IOCTL_PARAM | IOCTL_SET_ADDR_TYPE,
+			IOCTL_PARAM | IOCTL_SET_SENSE_TIME,
+			IOCTL_PARAM | IOCTL_SET_TX_RETRY,
+			IOCTL_PARAM | IOCTL_SET_TX_INTERVAL,
+			IOCTL_PARAM | IOCTL_SET_CCA_WAIT,
+		};
+		int value[5];
+		int old[5];
+		int result;
+		int errcode=0;
+		int i;
+
+		if(!mode) return -EINVAL;
+		value[0] = mode->addr_type;
+		value[1] = mode->sense_time;
+		value[2] = mode->tx_retry;
+		value[3] = mode->tx_interval;
+		value[4] = mode->cca_wait;
+		pthread_mutex_lock(&ctx->tx_lock);
+		if(ctx->shadow.mode_valid) {
+			old[0] = ctx->shadow.mode.addr_type;
+			old[1] = ctx->shadow.mode.sense_time;
+			old[2] = ctx->shadow.mode.tx_retry;
+			old[3] = ctx->shadow.mode.tx_interval;
+			old[4] = ctx->shadow.mode.cca_wait;
+			if(memcmp(old,value,sizeof(value)) == 0) {
+				ctx->shadow.saved += 7;
+				pthread_mutex_unlock(&ctx->tx_lock);
+				return 0;
+			}
+		}
+		result = drv_ioctl(ctx,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
+		if(result != 0) goto error;
+		for(i=0;i<5;i++) {
+			errcode--;
+			if(ctx->shadow.mode_valid && (old[i] == value[i])) {
+				ctx->shadow.saved++;
+				continue;
+			}
+			result = drv_ioctl(ctx,cmd[i],value[i]);
+			if(result != value[i]) goto error;
+		}
+		result = drv_ioctl(ctx,IOCTL_CMD | IOCTL_SET_SEND_MODE,0), errcode--;
+		if(result != 0) goto error;
+		ctx->shadow.mode = *mode;
+		ctx->shadow.mode_valid = true;
+		pthread_mutex_unlock(&ctx->tx_lock);
+
+		return 0;
+	error:
+		ctx->shadow.mode_valid = false;
+		pthread_mutex_unlock(&ctx->tx_lock);
+		return errcode;
+	}
+
+	extern "C" int lazurite_setSendMode(const LAZURITE_SEND_MODE* mode)
+	{
+		return lazurite_ctx_setSendMode(&default_ctx,mode);
+	}
+
 	/******************************************************************************/
 	/*! @brief get address type
 		@param[in]     none 
@@ -915,18 +3021,20 @@ namespace lazurite
 		7 | Y | Y | 1 | N | N
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_getAddrType(void)
+	extern "C" int lazurite_ctx_getAddrType(LAZURITE_CTX* ctx)
 	{
+		LAZURITE_SEND_MODE mode;
 		int result;
-		int errcode=0;
 
-		result = ioctl(fp,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
+		result = lazurite_ctx_getSendMode(ctx,&mode);
+		if(result != 0) return result;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_ADDR_TYPE,0), errcode--;
-		if(result < 0 ) return errcode;
+		return mode.addr_type;
+	}
 
-		return result;
+	extern "C" int lazurite_getAddrType(void)
+	{
+		return lazurite_ctx_getAddrType(&default_ctx);
 	}
 
 	/******************************************************************************/
@@ -935,21 +3043,21 @@ namespace lazurite
 		@return         0=success <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setAddrType(uint8_t addr_type)
+	extern "C" int lazurite_ctx_setAddrType(LAZURITE_CTX* ctx, uint8_t addr_type)
 	{
+		LAZURITE_SEND_MODE mode;
 		int result;
-		int errcode=0;
-
-		result = ioctl(fp,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_ADDR_TYPE,addr_type), errcode--;
-		if(result != addr_type) return errcode;
+		result = lazurite_ctx_getSendMode(ctx,&mode);
+		if(result != 0) return result;
 
-		result = ioctl(fp,IOCTL_CMD | IOCTL_SET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
+		mode.addr_type = addr_type;
+		return lazurite_ctx_setSendMode(ctx,&mode);
+	}
 
-		return 0;
+	extern "C" int lazurite_setAddrType(uint8_t addr_type)
+	{
+		return lazurite_ctx_setAddrType(&default_ctx,addr_type);
 	}
 
 	/******************************************************************************/
@@ -958,18 +3066,20 @@ namespace lazurite
 		@return         0 > senseTime <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_getSenseTime(void)
+	extern "C" int lazurite_ctx_getSenseTime(LAZURITE_CTX* ctx)
 	{
+		LAZURITE_SEND_MODE mode;
 		int result;
-		int errcode=0;
 
-		result = ioctl(fp,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
+		result = lazurite_ctx_getSendMode(ctx,&mode);
+		if(result != 0) return result;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_SENSE_TIME,0), errcode--;
-		if(result < 0 ) return errcode;
+		return mode.sense_time;
+	}
 
-		return result;
+	extern "C" int lazurite_getSenseTime(void)
+	{
+		return lazurite_ctx_getSenseTime(&default_ctx);
 	}
 
 	/******************************************************************************/
@@ -978,21 +3088,21 @@ namespace lazurite
 		@return         0=success <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setSenseTime(uint8_t senseTime)
+	extern "C" int lazurite_ctx_setSenseTime(LAZURITE_CTX* ctx, uint8_t senseTime)
 	{
+		LAZURITE_SEND_MODE mode;
 		int result;
-		int errcode=0;
-
-		result = ioctl(fp,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_SENSE_TIME,senseTime), errcode--;
-		if(result != senseTime) return errcode;
+		result = lazurite_ctx_getSendMode(ctx,&mode);
+		if(result != 0) return result;
 
-		result = ioctl(fp,IOCTL_CMD | IOCTL_SET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
+		mode.sense_time = senseTime;
+		return lazurite_ctx_setSendMode(ctx,&mode);
+	}
 
-		return 0;
+	extern "C" int lazurite_setSenseTime(uint8_t senseTime)
+	{
+		return lazurite_ctx_setSenseTime(&default_ctx,senseTime);
 	}
 
 	/******************************************************************************/
@@ -1001,18 +3111,20 @@ namespace lazurite
 		@return         0 > txretry <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_getTxRetry(void)
+	extern "C" int lazurite_ctx_getTxRetry(LAZURITE_CTX* ctx)
 	{
+		LAZURITE_SEND_MODE mode;
 		int result;
-		int errcode=0;
 
-		result = ioctl(fp,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
+		result = lazurite_ctx_getSendMode(ctx,&mode);
+		if(result != 0) return result;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_TX_RETRY,0), errcode--;
-		if(result < 0 ) return errcode;
+		return mode.tx_retry;
+	}
 
-		return result;
+	extern "C" int lazurite_getTxRetry(void)
+	{
+		return lazurite_ctx_getTxRetry(&default_ctx);
 	}
 
 	/******************************************************************************/
@@ -1021,21 +3133,21 @@ namespace lazurite
 		@return         0=success <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setTxRetry(uint8_t retry)
+	extern "C" int lazurite_ctx_setTxRetry(LAZURITE_CTX* ctx, uint8_t retry)
 	{
+		LAZURITE_SEND_MODE mode;
 		int result;
-		int errcode=0;
-
-		result = ioctl(fp,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_TX_RETRY,retry), errcode--;
-		if(result != retry) return errcode;
+		result = lazurite_ctx_getSendMode(ctx,&mode);
+		if(result != 0) return result;
 
-		result = ioctl(fp,IOCTL_CMD | IOCTL_SET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
+		mode.tx_retry = retry;
+		return lazurite_ctx_setSendMode(ctx,&mode);
+	}
 
-		return 0;
+	extern "C" int lazurite_setTxRetry(uint8_t retry)
+	{
+		return lazurite_ctx_setTxRetry(&default_ctx,retry);
 	}
 
 	/******************************************************************************/
@@ -1044,18 +3156,20 @@ namespace lazurite
 		@return         txinterval(ms) >0 <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_getTxInterval(void)
+	extern "C" int lazurite_ctx_getTxInterval(LAZURITE_CTX* ctx)
 	{
+		LAZURITE_SEND_MODE mode;
 		int result;
-		int errcode=0;
 
-		result = ioctl(fp,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
+		result = lazurite_ctx_getSendMode(ctx,&mode);
+		if(result != 0) return result;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_TX_INTERVAL,0), errcode--;
-		if(result < 0 ) return errcode;
+		return mode.tx_interval;
+	}
 
-		return result;
+	extern "C" int lazurite_getTxInterval(void)
+	{
+		return lazurite_ctx_getTxInterval(&default_ctx);
 	}
 
 	/******************************************************************************/
@@ -1064,21 +3178,21 @@ namespace lazurite
 		@return         0=success <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setTxInterval(uint16_t txinterval)
+	extern "C" int lazurite_ctx_setTxInterval(LAZURITE_CTX* ctx, uint16_t txinterval)
 	{
+		LAZURITE_SEND_MODE mode;
 		int result;
-		int errcode=0;
-
-		result = ioctl(fp,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_TX_INTERVAL,txinterval), errcode--;
-		if(result != txinterval) return errcode;
+		result = lazurite_ctx_getSendMode(ctx,&mode);
+		if(result != 0) return result;
 
-		result = ioctl(fp,IOCTL_CMD | IOCTL_SET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
+		mode.tx_interval = txinterval;
+		return lazurite_ctx_setSendMode(ctx,&mode);
+	}
 
-		return 0;
+	extern "C" int lazurite_setTxInterval(uint16_t txinterval)
+	{
+		return lazurite_ctx_setTxInterval(&default_ctx,txinterval);
 	}
 
 	/******************************************************************************/
@@ -1088,18 +3202,20 @@ namespace lazurite
 		backoff time = 320us * 2^cca_wait
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_getCcaWait(void)
+	extern "C" int lazurite_ctx_getCcaWait(LAZURITE_CTX* ctx)
 	{
+		LAZURITE_SEND_MODE mode;
 		int result;
-		int errcode=0;
 
-		result = ioctl(fp,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
+		result = lazurite_ctx_getSendMode(ctx,&mode);
+		if(result != 0) return result;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_TX_INTERVAL,0), errcode--;
-		if(result < 0 ) return errcode;
+		return mode.cca_wait;
+	}
 
-		return result;
+	extern "C" int lazurite_getCcaWait(void)
+	{
+		return lazurite_ctx_getCcaWait(&default_ctx);
 	}
 
 	/******************************************************************************/
@@ -1109,21 +3225,21 @@ namespace lazurite
 		@return         0=success <br> 0 < fail
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setCcaWait(uint8_t ccawait)
+	extern "C" int lazurite_ctx_setCcaWait(LAZURITE_CTX* ctx, uint8_t ccawait)
 	{
+		LAZURITE_SEND_MODE mode;
 		int result;
-		int errcode=0;
-
-		result = ioctl(fp,IOCTL_CMD | IOCTL_GET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
 
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_CCA_WAIT,ccawait), errcode--;
-		if(result != ccawait) return errcode;
+		result = lazurite_ctx_getSendMode(ctx,&mode);
+		if(result != 0) return result;
 
-		result = ioctl(fp,IOCTL_CMD | IOCTL_SET_SEND_MODE,0), errcode--;
-		if(result != 0) return errcode;
+		mode.cca_wait = ccawait;
+		return lazurite_ctx_setSendMode(ctx,&mode);
+	}
 
-		return 0;
+	extern "C" int lazurite_setCcaWait(uint8_t ccawait)
+	{
+		return lazurite_ctx_setCcaWait(&default_ctx,ccawait);
 	}
 
 	/******************************************************************************/
@@ -1131,91 +3247,121 @@ namespace lazurite
 		@param[in]     true : promiscuous mode, false: normal mode
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setPromiscuous(bool on)
+	extern "C" int lazurite_ctx_setPromiscuous(LAZURITE_CTX* ctx, bool on)
 	{
 		int result;
 		int errcode=0;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_PROMISCUOUS,on), errcode--;
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_PROMISCUOUS,on), errcode--;
 		if(result != 0) return errcode;
 		return 0;
 	}
 
+	extern "C" int lazurite_setPromiscuous(bool on)
+	{
+		return lazurite_ctx_setPromiscuous(&default_ctx,on);
+	}
+
 	/******************************************************************************/
 	/*! @brief set ack request
 		@param[in]     true : ack requested, false: force to set non-ack
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setAckReq(bool on)
+	extern "C" int lazurite_ctx_setAckReq(LAZURITE_CTX* ctx, bool on)
 	{
 		int result;
 		int errcode=0;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_ACK_REQ,on), errcode--;
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_ACK_REQ,on), errcode--;
 		if(result != 0) return errcode;
 		return 0;
 	}
+
+	extern "C" int lazurite_setAckReq(bool on)
+	{
+		return lazurite_ctx_setAckReq(&default_ctx,on);
+	}
 	/******************************************************************************/
 	/*! @brief set broadcast
 		@param[in]     true : enable to receive broadcast, false: ignore to receive broadcast
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setBroadcastEnb(bool on)
+	extern "C" int lazurite_ctx_setBroadcastEnb(LAZURITE_CTX* ctx, bool on)
 	{
 		int result;
 		int errcode=0;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_BROADCAST,on), errcode--;
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_BROADCAST,on), errcode--;
 		if(result != 0) return errcode;
 		return 0;
 	}
+
+	extern "C" int lazurite_setBroadcastEnb(bool on)
+	{
+		return lazurite_ctx_setBroadcastEnb(&default_ctx,on);
+	}
 	/******************************************************************************/
 	/*! @brief set AES Key 
 		@param[in]     set pointer of 128bit AES key
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setKey(char *key)
+	extern "C" int lazurite_ctx_setKey(LAZURITE_CTX* ctx, char *key)
 	{
 		int result;
 		int errcode=0;
-		result = ioctl(fp,IOCTL_CMD | IOCTL_SET_AES,key), errcode--;
+		result = drv_ioctl(ctx,IOCTL_CMD | IOCTL_SET_AES,(unsigned long)key), errcode--;
 		if(result != 0) return errcode;
 		return 0;
 	}
 
+	extern "C" int lazurite_setKey(char *key)
+	{
+		return lazurite_ctx_setKey(&default_ctx,key);
+	}
+
 	/******************************************************************************/
 	/*! @brief set enhance ACK
 		@param[in]     set pointer of enhance ACK data
 		@param[in]     set size of enhance ACK data
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_setEnhanceAck(uint8_t *data, uint16_t size)
+	extern "C" int lazurite_ctx_setEnhanceAck(LAZURITE_CTX* ctx, uint8_t *data, uint16_t size)
 	{
 		int result;
 		int errcode=0;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_EACK_ENB,0), errcode--;
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_EACK_ENB,0), errcode--;
 		if(result < 0) return errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_EACK_LEN,size), errcode--;
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_EACK_LEN,size), errcode--;
 		if(result < 0) return errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_EACK_DATA,data), errcode--;
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_EACK_DATA,(unsigned long)data), errcode--;
 		if(result < 0) return errcode;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_SET_EACK_ENB,1), errcode--;
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_SET_EACK_ENB,1), errcode--;
 		if(result < 0) return errcode;
 		return 0;
 	}
 
+	extern "C" int lazurite_setEnhanceAck(uint8_t *data, uint16_t size)
+	{
+		return lazurite_ctx_setEnhanceAck(&default_ctx,data,size);
+	}
+
 	/******************************************************************************/
 	/*! @brief get enhance ACK
 		@param[out]     set pointer's pointer of enhance ACK data
 		@param[out]     set pointer of enhance ACK size
 		@exception      none
 	 ******************************************************************************/
-	extern "C" int lazurite_getEnhanceAck(char* data, uint16_t* size)
+	extern "C" int lazurite_ctx_getEnhanceAck(LAZURITE_CTX* ctx, char* data, uint16_t* size)
 	{
 		int result;
 		int errcode=0;
-		result = ioctl(fp,IOCTL_PARAM | IOCTL_GET_EACK,data), errcode--;
+		result = drv_ioctl(ctx,IOCTL_PARAM | IOCTL_GET_EACK,(unsigned long)data), errcode--;
 		if(result < 0) return errcode;
 		*size = result;
 		return 0;
 	}
+
+	extern "C" int lazurite_getEnhanceAck(char* data, uint16_t* size)
+	{
+		return lazurite_ctx_getEnhanceAck(&default_ctx,data,size);
+	}
 #ifdef __cplusplus
 };
 #endif
@@ -0,0 +1,486 @@
+/*!
+  @file filter-lazurite.cpp
+  @brief filter of received frames by expression of mac header fields <br>
+  used by lazurite_compileFilter, lazurite_matchFilter and lazurite_setFilter.
+
+  expression is compiled once into flat code like BPF. each instruction compares
+  one field of mac header with a constant (or another field) and jumps to next
+  instruction by the result. jumps go only forward, so any code ends at FILTER_RET.
+  fields are loaded from raw by mac_layout, so nothing is decoded or copied.
+
+  @code
+  expr    := and ('||' and)*
+  and     := unary ('&&' unary)*
+  unary   := '!' unary | '(' expr ')' | value [relop value]
+  value   := (field | number) ['&' number]
+  relop   := '==' | '!=' | '<' | '<=' | '>' | '>='
+  @endcode
+  value without relop is true when it is not 0 (ex. "ack_req && !sec_enb").
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include "mac-lazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define FILTER_MAX_NODES	128		/*!< nodes of expression. longer expression is E2BIG */
+#define FILTER_MAX_DEPTH	32		/*!< nesting of expression */
+
+	/*! kind of field */
+	enum {
+		FILTER_K = 0,			/*!< constant (not field) */
+		FILTER_FC,				/*!< bits of frame control */
+		FILTER_LEN,
+		FILTER_ADDR_TYPE,
+		FILTER_SEQ,
+		FILTER_DST_PANID,
+		FILTER_SRC_PANID,
+		FILTER_DST_ADDR,
+		FILTER_SRC_ADDR,
+		FILTER_PAYLOAD_OFFSET,
+		FILTER_PAYLOAD_LEN,
+	};
+
+	/*! operation of instruction */
+	enum {
+		FILTER_RET = 0,			/*!< return k */
+		FILTER_EQ,
+		FILTER_NE,
+		FILTER_LT,
+		FILTER_LE,
+		FILTER_GT,
+		FILTER_GE,
+	};
+
+	/*! field name. value is same as member of SUBGHZ_MAC */
+	static const struct {
+		const char *name;
+		uint8_t kind;
+		uint8_t shift;			/*!< FILTER_FC */
+		uint16_t width;			/*!< mask of FILTER_FC */
+	} filter_field[] = {
+		{"header",			FILTER_FC,	0,	0xffff},
+		{"frame_type",		FILTER_FC,	0,	0x7},
+		{"sec_enb",			FILTER_FC,	3,	0x1},
+		{"pending",			FILTER_FC,	4,	0x1},
+		{"ack_req",			FILTER_FC,	5,	0x1},
+		{"panid_comp",		FILTER_FC,	6,	0x1},
+		{"seq_comp",		FILTER_FC,	8,	0x1},
+		{"ielist",			FILTER_FC,	9,	0x1},
+		{"dst_addr_type",	FILTER_FC,	10,	0x3},
+		{"frame_ver",		FILTER_FC,	12,	0x3},
+		{"src_addr_type",	FILTER_FC,	14,	0x3},
+		{"addr_type",		FILTER_ADDR_TYPE,	0,	0},
+		{"seq_num",			FILTER_SEQ,	0,	0},
+		{"dst_panid",		FILTER_DST_PANID,	0,	0},
+		{"src_panid",		FILTER_SRC_PANID,	0,	0},
+		{"dst_addr",		FILTER_DST_ADDR,	0,	0},
+		{"src_addr",		FILTER_SRC_ADDR,	0,	0},
+		{"payload_offset",	FILTER_PAYLOAD_OFFSET,	0,	0},
+		{"payload_len",		FILTER_PAYLOAD_LEN,	0,	0},
+		{"len",				FILTER_LEN,	0,	0},
+	};
+
+	/*! operand of comparison. value = (field or k) >> shift & mask */
+	typedef struct {
+		uint8_t kind;
+		uint8_t shift;
+		uint64_t mask;
+		uint64_t k;
+	} FILTER_OPERAND;
+
+	/*! instruction. pc = result ? jt : jf */
+	typedef struct {
+		uint8_t op;
+		uint16_t jt;
+		uint16_t jf;
+		FILTER_OPERAND a;
+		FILTER_OPERAND b;
+	} FILTER_INSN;
+
+	struct lazurite_filter {
+		uint16_t num;
+		FILTER_INSN insn[1];
+	};
+
+	/*! node of expression tree */
+	typedef struct {
+		uint8_t type;			/*!< FILTER_NODE_xxx */
+		uint8_t op;
+		int16_t left;
+		int16_t right;
+		FILTER_OPERAND a;
+		FILTER_OPERAND b;
+	} FILTER_NODE;
+
+	enum {
+		FILTER_NODE_TRUE,
+		FILTER_NODE_FALSE,
+		FILTER_NODE_CMP,
+		FILTER_NODE_NOT,
+		FILTER_NODE_AND,
+		FILTER_NODE_OR,
+	};
+
+	typedef struct {
+		const char *p;
+		int err;
+		int depth;				/*!< nesting of '!' and '(' */
+		FILTER_NODE node[FILTER_MAX_NODES];
+		int num;
+		int cmp;				/*!< number of FILTER_NODE_CMP */
+	} FILTER_PARSER;
+
+	static int filter_expr(FILTER_PARSER *parser);
+
+	static void filter_skip(FILTER_PARSER *parser)
+	{
+		while(isspace((unsigned char)*parser->p)) parser->p++;
+	}
+
+	static bool filter_token(FILTER_PARSER *parser, const char *token)
+	{
+		size_t len = strlen(token);
+		filter_skip(parser);
+		if(strncmp(parser->p,token,len) != 0) return false;
+		// "&" must not match "&&", "<" must not match "<=", "!" must not match "!="
+		if((len == 1) && strchr("&<>!",token[0]) && (parser->p[1] == '&' || parser->p[1] == '=')) return false;
+		parser->p += len;
+		return true;
+	}
+
+	static int filter_error(FILTER_PARSER *parser, int err)
+	{
+		if(!parser->err) parser->err = err;
+		return -1;
+	}
+
+	static int filter_node(FILTER_PARSER *parser, uint8_t type)
+	{
+		FILTER_NODE *node;
+		if(parser->num >= FILTER_MAX_NODES) return filter_error(parser,E2BIG);
+		node = &parser->node[parser->num];
+		memset(node,0,sizeof(*node));
+		node->type = type;
+		node->left = node->right = -1;
+		return parser->num++;
+	}
+
+	static bool filter_value(FILTER_PARSER *parser, FILTER_OPERAND *operand)
+	{
+		const char *top;
+		char *end;
+		size_t len, i;
+
+		filter_skip(parser);
+		memset(operand,0,sizeof(*operand));
+		operand->mask = ~0ULL;
+		top = parser->p;
+		if(isdigit((unsigned char)*top)) {
+			errno = 0;
+			operand->k = strtoull(top,&end,0);
+			if((errno == ERANGE) || isalnum((unsigned char)*end) || (*end == '_')) return false;
+			parser->p = end;
+			operand->kind = FILTER_K;
+		} else {
+			for(len=0;isalnum((unsigned char)top[len]) || (top[len] == '_');len++);
+			for(i=0;i<sizeof(filter_field)/sizeof(filter_field[0]);i++) {
+				if((strlen(filter_field[i].name) == len) && (strncmp(filter_field[i].name,top,len) == 0)) break;
+			}
+			if(!len || (i == sizeof(filter_field)/sizeof(filter_field[0]))) return false;
+			parser->p = top + len;
+			operand->kind = filter_field[i].kind;
+			if(operand->kind == FILTER_FC) {
+				operand->shift = filter_field[i].shift;
+				operand->mask = filter_field[i].width;
+			}
+		}
+		if(filter_token(parser,"&")) {
+			FILTER_OPERAND mask;
+			if(!filter_value(parser,&mask) || (mask.kind != FILTER_K)) return false;
+			if(operand->kind == FILTER_K) operand->k &= mask.k;
+			else operand->mask &= mask.k;
+		}
+		return true;
+	}
+
+	static uint64_t filter_constant(const FILTER_OPERAND *operand)
+	{
+		return operand->k & operand->mask;
+	}
+
+	static inline bool filter_compare(uint8_t op, uint64_t a, uint64_t b)
+	{
+		switch(op) {
+			case FILTER_EQ: return a == b;
+			case FILTER_NE: return a != b;
+			case FILTER_LT: return a < b;
+			case FILTER_LE: return a <= b;
+			case FILTER_GT: return a > b;
+			default: return a >= b;
+		}
+	}
+
+	static int filter_cmp(FILTER_PARSER *parser)
+	{
+		static const struct {
+			const char *token;
+			uint8_t op;
+			uint8_t swapped;	/*!< op when operands are swapped */
+		} relop[] = {
+			{"==", FILTER_EQ, FILTER_EQ},
+			{"!=", FILTER_NE, FILTER_NE},
+			{"<=", FILTER_LE, FILTER_GE},
+			{">=", FILTER_GE, FILTER_LE},
+			{"<", FILTER_LT, FILTER_GT},
+			{">", FILTER_GT, FILTER_LT},
+		};
+		FILTER_OPERAND a, b, tmp;
+		uint8_t op = FILTER_NE;
+		int index;
+		size_t i;
+
+		if(!filter_value(parser,&a)) return filter_error(parser,EINVAL);
+		memset(&b,0,sizeof(b));
+		b.mask = ~0ULL;
+		filter_skip(parser);
+		for(i=0;i<sizeof(relop)/sizeof(relop[0]);i++) {
+			if(filter_token(parser,relop[i].token)) break;
+		}
+		if(i < sizeof(relop)/sizeof(relop[0])) {
+			op = relop[i].op;
+			if(!filter_value(parser,&b)) return filter_error(parser,EINVAL);
+			// constant is kept in b
+			if((a.kind == FILTER_K) && (b.kind != FILTER_K)) {
+				tmp = a, a = b, b = tmp;
+				op = relop[i].swapped;
+			}
+		}
+		if(a.kind == FILTER_K) {
+			return filter_node(parser,filter_compare(op,filter_constant(&a),filter_constant(&b)) ?
+					FILTER_NODE_TRUE : FILTER_NODE_FALSE);
+		}
+		index = filter_node(parser,FILTER_NODE_CMP);
+		if(index < 0) return index;
+		parser->node[index].op = op;
+		parser->node[index].a = a;
+		parser->node[index].b = b;
+		parser->cmp++;
+		return index;
+	}
+
+	static int filter_unary(FILTER_PARSER *parser)
+	{
+		int left, index;
+
+		if(parser->depth >= FILTER_MAX_DEPTH) return filter_error(parser,E2BIG);
+		if(filter_token(parser,"!")) {
+			parser->depth++;
+			left = filter_unary(parser);
+			parser->depth--;
+			if(left < 0) return left;
+			index = filter_node(parser,FILTER_NODE_NOT);
+			if(index >= 0) parser->node[index].left = left;
+			return index;
+		}
+		if(filter_token(parser,"(")) {
+			parser->depth++;
+			index = filter_expr(parser);
+			parser->depth--;
+			if(index < 0) return index;
+			if(!filter_token(parser,")")) return filter_error(parser,EINVAL);
+			return index;
+		}
+		return filter_cmp(parser);
+	}
+
+	static int filter_binary(FILTER_PARSER *parser, uint8_t type)
+	{
+		int left, right, index;
+
+		left = type == FILTER_NODE_OR ? filter_binary(parser,FILTER_NODE_AND) : filter_unary(parser);
+		while((left >= 0) && filter_token(parser,type == FILTER_NODE_OR ? "||" : "&&")) {
+			right = type == FILTER_NODE_OR ? filter_binary(parser,FILTER_NODE_AND) : filter_unary(parser);
+			if(right < 0) return right;
+			index = filter_node(parser,type);
+			if(index < 0) return index;
+			parser->node[index].left = left;
+			parser->node[index].right = right;
+			left = index;
+		}
+		return left;
+	}
+
+	static int filter_expr(FILTER_PARSER *parser)
+	{
+		return filter_binary(parser,FILTER_NODE_OR);
+	}
+
+	/******************************************************************************/
+	/*! @brief generate code of node
+		code is generated from the end, so label is index from the end of code.
+		label 0 = return true, 1 = return false.
+		@return         label of entry of node
+	 ******************************************************************************/
+	static uint16_t filter_gen(const FILTER_PARSER *parser, int index, uint16_t t, uint16_t f, LAZURITE_FILTER *filter)
+	{
+		const FILTER_NODE *node = &parser->node[index];
+		FILTER_INSN *insn;
+
+		switch(node->type) {
+			case FILTER_NODE_TRUE:
+				return t;
+			case FILTER_NODE_FALSE:
+				return f;
+			case FILTER_NODE_NOT:
+				return filter_gen(parser,node->left,f,t,filter);
+			case FILTER_NODE_AND:
+				return filter_gen(parser,node->left,filter_gen(parser,node->right,t,f,filter),f,filter);
+			case FILTER_NODE_OR:
+				return filter_gen(parser,node->left,t,filter_gen(parser,node->right,t,f,filter),filter);
+			default:
+				insn = &filter->insn[filter->num];
+				insn->op = node->op;
+				insn->jt = t;
+				insn->jf = f;
+				insn->a = node->a;
+				insn->b = node->b;
+				return filter->num++;
+		}
+	}
+
+	extern "C" LAZURITE_FILTER* lazurite_compileFilter(const char* expr, int* error_pos)
+	{
+		FILTER_PARSER *parser;
+		LAZURITE_FILTER *filter = NULL;
+		FILTER_INSN tmp;
+		uint16_t entry, i;
+		int root, err;
+
+		if(error_pos) *error_pos = 0;
+		if(!expr) {
+			errno = EINVAL;
+			return NULL;
+		}
+		parser = (FILTER_PARSER*)calloc(1,sizeof(FILTER_PARSER));
+		if(!parser) return NULL;
+		parser->p = expr;
+		root = filter_expr(parser);
+		filter_skip(parser);
+		if((root >= 0) && *parser->p) root = filter_error(parser,EINVAL);
+		if(root >= 0) {
+			filter = (LAZURITE_FILTER*)calloc(1,sizeof(LAZURITE_FILTER) + sizeof(FILTER_INSN) * (parser->cmp + 2));
+			if(!filter) root = filter_error(parser,ENOMEM);
+		}
+		if(root < 0) {
+			err = parser->err;
+			if(error_pos) *error_pos = parser->p - expr;
+			free(parser);
+			errno = err;
+			return NULL;
+		}
+		filter->insn[0].op = FILTER_RET;
+		filter->insn[0].b.k = 1;
+		filter->insn[1].op = FILTER_RET;
+		filter->insn[1].b.k = 0;
+		filter->num = 2;
+		entry = filter_gen(parser,root,0,1,filter);
+		free(parser);
+
+		// entry is put on top. code after entry is not reached.
+		filter->num = entry + 1;
+		for(i=0;i<filter->num;i++) {
+			filter->insn[i].jt = entry - filter->insn[i].jt;
+			filter->insn[i].jf = entry - filter->insn[i].jf;
+		}
+		for(i=0;i<filter->num/2;i++) {
+			tmp = filter->insn[i];
+			filter->insn[i] = filter->insn[entry - i];
+			filter->insn[entry - i] = tmp;
+		}
+		return filter;
+	}
+
+	extern "C" void lazurite_freeFilter(LAZURITE_FILTER* filter)
+	{
+		free(filter);
+	}
+
+	/******************************************************************************/
+	/*! @brief load field from raw
+		@param[in]      *raw      frame which is longer than header_len of layout
+	 ******************************************************************************/
+	static inline uint64_t filter_load(const FILTER_OPERAND *operand, const uint8_t *raw, uint16_t len, const MAC_LAYOUT *layout)
+	{
+		uint8_t addr_len;
+		uint8_t offset;
+
+		switch(operand->kind) {
+			case FILTER_K:
+				return operand->k;
+			case FILTER_FC:
+				return (uint64_t)(mac_load16(raw) >> operand->shift);
+			case FILTER_LEN:
+				return len;
+			case FILTER_ADDR_TYPE:
+				return layout->addr_type;
+			case FILTER_SEQ:
+				return layout->seq_offset ? raw[layout->seq_offset] : 0;
+			case FILTER_DST_PANID:
+				return layout->dst_panid_offset ? mac_load16(raw + layout->dst_panid_offset) : 0xffff;
+			case FILTER_SRC_PANID:
+				return layout->src_panid_offset ? mac_load16(raw + layout->src_panid_offset) : 0xffff;
+			case FILTER_PAYLOAD_OFFSET:
+				return layout->header_len;
+			case FILTER_PAYLOAD_LEN:
+				return len - layout->header_len;
+			case FILTER_DST_ADDR:
+				addr_len = layout->dst_addr_len;
+				offset = layout->dst_addr_offset;
+				break;
+			default:
+				addr_len = layout->src_addr_len;
+				offset = layout->src_addr_offset;
+				break;
+		}
+		switch(addr_len) {
+			case 0:
+				return ~0ULL;
+			case 1:
+				return raw[offset];
+			case 2:
+				return mac_load16(raw + offset);
+			default:
+				return mac_load64(raw + offset);
+		}
+	}
+
+	extern "C" int lazurite_matchFilter(const LAZURITE_FILTER* filter, const void* raw, uint16_t len)
+	{
+		const uint8_t *p = (const uint8_t*)raw;
+		const MAC_LAYOUT *layout;
+		const FILTER_INSN *insn;
+		uint64_t a, b;
+
+		if(!filter || !raw) return -EINVAL;
+		if(len < 2) return 0;
+		layout = mac_getLayout(p);
+		if(len < layout->header_len) return 0;
+		for(insn = filter->insn;;) {
+			if(insn->op == FILTER_RET) return (int)insn->b.k;
+			a = filter_load(&insn->a,p,len,layout) & insn->a.mask;
+			b = filter_load(&insn->b,p,len,layout) & insn->b.mask;
+			insn = &filter->insn[filter_compare(insn->op,a,b) ? insn->jt : insn->jf];
+		}
+	}
+
+#ifdef __cplusplus
+};
+#endif
@@ -0,0 +1,339 @@
+/*!
+  @file format-lazurite.cpp
+  @brief text output of received frames for liblazurite <br>
+  lazurite_formatFrames writes many frames into one buffer of application as lines of
+  CSV or JSON Lines. numbers and addresses are written by hand-written emitters,
+  so printf is not called and nothing is allocated.
+
+  CSV (same columns as lazurite_readStream)
+  @code
+  sec,nsec,seq_num,rssi,src_panid,src_addr,payload
+  1700000000,120000000,12,180,,0xabcd,"hello, world"
+  @endcode
+
+  JSON Lines
+  @code
+  {"sec":1700000000,"nsec":120000000,"seq":12,"rssi":180,"dst_panid":"0xabcd","dst_addr":"0x1234","src_panid":null,"src_addr":"0xabcd","payload":"hello, world"}
+  @endcode
+  fields which are not in the frame are empty (CSV) or null (JSON).
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include "liblazurite.h"
+#include "mac-lazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define FORMAT_FIXED_MAX	256		/*!< bytes of one line except payload */
+
+	static const char format_hex_digits[] = "0123456789abcdef";
+
+	static const char format_dec_pairs[] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+
+	/******************************************************************************/
+	/*! @brief decimal of unsigned value
+	  @return         next of written digits
+	 ******************************************************************************/
+	static inline char* format_u64(char *p, uint64_t value)
+	{
+		char tmp[20];
+		char *q = tmp + sizeof(tmp);
+		unsigned pair;
+
+		while(value >= 100) {
+			pair = (value % 100) * 2;
+			value /= 100;
+			*--q = format_dec_pairs[pair + 1];
+			*--q = format_dec_pairs[pair];
+		}
+		if(value >= 10) {
+			*--q = format_dec_pairs[value * 2 + 1];
+			*--q = format_dec_pairs[value * 2];
+		} else {
+			*--q = '0' + value;
+		}
+		memcpy(p,q,tmp + sizeof(tmp) - q);
+		return p + (tmp + sizeof(tmp) - q);
+	}
+
+	static inline char* format_i64(char *p, int64_t value)
+	{
+		if(value < 0) {
+			*p++ = '-';
+			return format_u64(p,-(uint64_t)value);
+		}
+		return format_u64(p,value);
+	}
+
+	/******************************************************************************/
+	/*! @brief "0x" and hex of value by digits
+	 ******************************************************************************/
+	static inline char* format_hex(char *p, uint64_t value, int digits)
+	{
+		int i;
+
+		*p++ = '0';
+		*p++ = 'x';
+		for(i=digits-1;i>=0;i--) {
+			p[i] = format_hex_digits[value & 0x0f];
+			value >>= 4;
+		}
+		return p + digits;
+	}
+
+	/******************************************************************************/
+	/*! @brief address in frame by hex. 8bit = 2 digits, 16bit = 4 digits, 64bit = 16 digits
+	 ******************************************************************************/
+	static inline char* format_addr(char *p, const uint8_t *raw, uint8_t offset, uint8_t len)
+	{
+		switch(len) {
+			case 1:
+				return format_hex(p,raw[offset],2);
+			case 2:
+				return format_hex(p,mac_load16(raw + offset),4);
+			default:
+				return format_hex(p,mac_load64(raw + offset),16);
+		}
+	}
+
+	static inline char* format_bytes(char *p, const uint8_t *data, uint16_t len)
+	{
+		uint16_t i;
+
+		for(i=0;i<len;i++) {
+			*p++ = format_hex_digits[data[i] >> 4];
+			*p++ = format_hex_digits[data[i] & 0x0f];
+		}
+		return p;
+	}
+
+	/******************************************************************************/
+	/*! @brief payload as CSV field
+	  quoted only when it has comma or quote (RFC 4180). control characters are
+	  written as '.', so one frame is always one line.
+	 ******************************************************************************/
+	static char* format_csvText(char *p, const uint8_t *data, uint16_t len)
+	{
+		bool quote = false;
+		uint16_t i;
+
+		for(i=0;i<len;i++) {
+			if((data[i] == ',') || (data[i] == '"')) {
+				quote = true;
+				break;
+			}
+		}
+		if(quote) *p++ = '"';
+		for(i=0;i<len;i++) {
+			if((data[i] < 0x20) || (data[i] == 0x7f)) {
+				*p++ = '.';
+				continue;
+			}
+			if(data[i] == '"') *p++ = '"';
+			*p++ = data[i];
+		}
+		if(quote) *p++ = '"';
+		return p;
+	}
+
+	/******************************************************************************/
+	/*! @brief payload as JSON string
+	  bytes out of ASCII are written as \\u00XX, so output is always valid UTF-8.
+	 ******************************************************************************/
+	static char* format_jsonText(char *p, const uint8_t *data, uint16_t len)
+	{
+		uint16_t i;
+
+		*p++ = '"';
+		for(i=0;i<len;i++) {
+			if((data[i] >= 0x20) && (data[i] < 0x7f)) {
+				if((data[i] == '"') || (data[i] == '\\')) *p++ = '\\';
+				*p++ = data[i];
+				continue;
+			}
+			switch(data[i]) {
+				case '\n':
+					*p++ = '\\';
+					*p++ = 'n';
+					break;
+				case '\r':
+					*p++ = '\\';
+					*p++ = 'r';
+					break;
+				case '\t':
+					*p++ = '\\';
+					*p++ = 't';
+					break;
+				default:
+					memcpy(p,"\\u00",4);
+					p[4] = format_hex_digits[data[i] >> 4];
+					p[5] = format_hex_digits[data[i] & 0x0f];
+					p += 6;
+					break;
+			}
+		}
+		*p++ = '"';
+		return p;
+	}
+
+	static inline char* format_put(char *p, const char *s, size_t len)
+	{
+		memcpy(p,s,len);
+		return p + len;
+	}
+
+	/******************************************************************************/
+	/*! @brief maximum length of line of the frame
+	 ******************************************************************************/
+	static inline size_t format_lineMax(const LAZURITE_FRAME *frame, uint8_t format)
+	{
+		switch(format) {
+			case LAZURITE_FORMAT_CSV:
+				return FORMAT_FIXED_MAX + frame->payload_len * 2;
+			case LAZURITE_FORMAT_JSONL:
+				return FORMAT_FIXED_MAX + frame->payload_len * 6;
+			default:
+				return FORMAT_FIXED_MAX + frame->payload_len * 2;
+		}
+	}
+
+	/******************************************************************************/
+	/*! @brief one line of frame
+	  @param[out]     *p      buffer which has format_lineMax bytes
+	  @return         next of line
+	 ******************************************************************************/
+	static char* format_line(char *p, const LAZURITE_FRAME *frame, uint8_t format)
+	{
+		const uint8_t *raw = frame->raw;
+		const uint8_t *payload = raw + frame->payload_offset;
+		bool json = (format == LAZURITE_FORMAT_JSONL) || (format == LAZURITE_FORMAT_JSONL_HEX);
+		bool hex = (format == LAZURITE_FORMAT_CSV_HEX) || (format == LAZURITE_FORMAT_JSONL_HEX);
+
+		if(!json) {
+			p = format_i64(p,frame->tv_sec);
+			*p++ = ',';
+			p = format_i64(p,frame->tv_nsec);
+			*p++ = ',';
+			if(frame->seq_offset) p = format_u64(p,raw[frame->seq_offset]);
+			*p++ = ',';
+			p = format_u64(p,frame->rssi);
+			*p++ = ',';
+			if(frame->src_panid_offset) p = format_hex(p,mac_load16(raw + frame->src_panid_offset),4);
+			*p++ = ',';
+			if(frame->src_addr_len) p = format_addr(p,raw,frame->src_addr_offset,frame->src_addr_len);
+			*p++ = ',';
+			if(hex) p = format_bytes(p,payload,frame->payload_len);
+			else p = format_csvText(p,payload,frame->payload_len);
+			*p++ = '\n';
+			return p;
+		}
+
+		p = format_put(p,"{\"sec\":",7);
+		p = format_i64(p,frame->tv_sec);
+		p = format_put(p,",\"nsec\":",8);
+		p = format_i64(p,frame->tv_nsec);
+		p = format_put(p,",\"seq\":",7);
+		if(frame->seq_offset) p = format_u64(p,raw[frame->seq_offset]);
+		else p = format_put(p,"null",4);
+		p = format_put(p,",\"rssi\":",8);
+		p = format_u64(p,frame->rssi);
+		p = format_put(p,",\"dst_panid\":",13);
+		if(frame->dst_panid_offset) {
+			*p++ = '"';
+			p = format_hex(p,mac_load16(raw + frame->dst_panid_offset),4);
+			*p++ = '"';
+		} else {
+			p = format_put(p,"null",4);
+		}
+		p = format_put(p,",\"dst_addr\":",12);
+		if(frame->dst_addr_len) {
+			*p++ = '"';
+			p = format_addr(p,raw,frame->dst_addr_offset,frame->dst_addr_len);
+			*p++ = '"';
+		} else {
+			p = format_put(p,"null",4);
+		}
+		p = format_put(p,",\"src_panid\":",13);
+		if(frame->src_panid_offset) {
+			*p++ = '"';
+			p = format_hex(p,mac_load16(raw + frame->src_panid_offset),4);
+			*p++ = '"';
+		} else {
+			p = format_put(p,"null",4);
+		}
+		p = format_put(p,",\"src_addr\":",12);
+		if(frame->src_addr_len) {
+			*p++ = '"';
+			p = format_addr(p,raw,frame->src_addr_offset,frame->src_addr_len);
+			*p++ = '"';
+		} else {
+			p = format_put(p,"null",4);
+		}
+		p = format_put(p,",\"payload\":",11);
+		if(hex) {
+			*p++ = '"';
+			p = format_bytes(p,payload,frame->payload_len);
+			*p++ = '"';
+		} else {
+			p = format_jsonText(p,payload,frame->payload_len);
+		}
+		*p++ = '}';
+		*p++ = '\n';
+		return p;
+	}
+
+	/******************************************************************************/
+	/*! @brief write frames as lines of text
+	  @param[out]     *out      buffer
+	  @param[in,out]  *size     in: bytes of out. out: bytes written (without NULL)
+	  @param[in]      *frames   received frames (lazurite_readBatch, lazurite_getRxFrames ...)
+	  @param[in]      num       number of frames
+	  @param[in]      format    LAZURITE_FORMAT_xxx
+	  @return         number of frames written <br> 0 > fail
+	  @exception      none
+	 ******************************************************************************/
+	extern "C" int lazurite_formatFrames(char* out, size_t* size, const LAZURITE_FRAME* frames, int num, uint8_t format)
+	{
+		char line[LAZURITE_FORMAT_LINE_MAX];
+		size_t capacity, used = 0;
+		char *end;
+		int i;
+
+		if(!out || !size || !frames || (num < 0) || (format > LAZURITE_FORMAT_JSONL_HEX)) return -EINVAL;
+		capacity = *size;
+		for(i=0;i<num;i++) {
+			if(capacity - used > format_lineMax(&frames[i],format)) {
+				// fast path. line is written to out directly
+				end = format_line(out + used,&frames[i],format);
+				used = end - out;
+				continue;
+			}
+			end = format_line(line,&frames[i],format);
+			if((size_t)(end - line) >= capacity - used) break;
+			memcpy(out + used,line,end - line);
+			used += end - line;
+		}
+		if(used < capacity) out[used] = 0;
+		*size = used;
+		if((i == 0) && (num > 0)) return -ENOSPC;
+		return i;
+	}
+
+#ifdef __cplusplus
+};
+#endif
@@ -0,0 +1,76 @@
+/*!
+  @file ioctl-lazurite.h
+  @brief IOCTL_PARAM/IOCTL_CMD of LazDriver <br>
+  internal use only. not installed.
+
+  drv-lazurite.h of LazDriver (/home/pi/driver/LazDriver) is used when it is found.
+  otherwise the definitions below are used, so lazurite_backend_sim and
+  lazurite_backend_replay can be built on a box without LazDriver. they are not the
+  numbers of the driver, so LAZURITE_NO_LAZDRIVER is defined and lazurite_backend_lzgw
+  returns -ENODEV in that build.
+ */
+#ifndef _IOCTL_LAZURITE_H_
+#define _IOCTL_LAZURITE_H_
+
+#if defined(__has_include)
+#if __has_include("drv-lazurite.h")
+#include "drv-lazurite.h"
+#else
+#define LAZURITE_NO_LAZDRIVER
+#endif
+#else
+#include "drv-lazurite.h"
+#endif
+
+#ifdef LAZURITE_NO_LAZDRIVER
+#define IOCTL_CMD					0x1000
+#define IOCTL_SET_BEGIN				0x11
+#define IOCTL_SET_RXON				0x13
+#define IOCTL_SET_RXOFF				0x15
+#define IOCTL_SET_CLOSE				0x17
+#define IOCTL_GET_SEND_MODE			0x18
+#define IOCTL_SET_SEND_MODE			0x19
+#define IOCTL_SET_AES				0x1b
+
+#define IOCTL_PARAM					0x2000
+#define IOCTL_SET_CH				0x03
+#define IOCTL_SET_PWR				0x05
+#define IOCTL_SET_BPS				0x07
+#define IOCTL_SET_MY_PANID			0x09
+#define IOCTL_SET_DST_PANID			0x0b
+#define IOCTL_GET_MY_ADDR0			0x0c
+#define IOCTL_GET_MY_ADDR1			0x0e
+#define IOCTL_GET_MY_ADDR2			0x10
+#define IOCTL_GET_MY_ADDR3			0x12
+#define IOCTL_SET_DST_ADDR0			0x15
+#define IOCTL_SET_DST_ADDR1			0x17
+#define IOCTL_SET_DST_ADDR2			0x19
+#define IOCTL_SET_DST_ADDR3			0x1b
+#define IOCTL_GET_MY_SHORT_ADDR		0x1c
+#define IOCTL_SET_MY_SHORT_ADDR		0x1d
+#define IOCTL_GET_ADDR_TYPE			0x1e
+#define IOCTL_SET_ADDR_TYPE			0x1f
+#define IOCTL_GET_SENSE_TIME		0x20
+#define IOCTL_SET_SENSE_TIME		0x21
+#define IOCTL_GET_TX_RETRY			0x22
+#define IOCTL_SET_TX_RETRY			0x23
+#define IOCTL_GET_TX_INTERVAL		0x24
+#define IOCTL_SET_TX_INTERVAL		0x25
+#define IOCTL_GET_CCA_WAIT			0x26
+#define IOCTL_SET_CCA_WAIT			0x27
+#define IOCTL_GET_RX_SEC0			0x28
+#define IOCTL_GET_RX_SEC1			0x2a
+#define IOCTL_GET_RX_NSEC0			0x2c
+#define IOCTL_GET_RX_NSEC1			0x2e
+#define IOCTL_GET_RX_RSSI			0x30
+#define IOCTL_GET_TX_RSSI			0x32
+#define IOCTL_SET_PROMISCUOUS		0x35
+#define IOCTL_SET_ACK_REQ			0x37
+#define IOCTL_SET_BROADCAST			0x39
+#define IOCTL_SET_EACK_ENB			0x3b
+#define IOCTL_SET_EACK_LEN			0x3d
+#define IOCTL_SET_EACK_DATA			0x3f
+#define IOCTL_GET_EACK				0x40
+#endif
+
+#endif	// _IOCTL_LAZURITE_H_
@@ -20,6 +20,9 @@
 
   then liblazurite is copied in /usr/lib
 
+  without LazDriver (lib/drv-lazurite.h is a link to it), "make static" in lib builds
+  lazurite_backend_sim and lazurite_backend_replay only. lazurite_backend_lzgw returns -ENODEV.
+
   @section about sample program
   sample code | build option | operation
   ------------| -------------| --------
@@ -32,6 +35,10 @@
 #ifndef _LIBLAZURITE_H_
 #define _LIBLAZURITE_H_
 
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
 #ifdef __cplusplus
 namespace lazurite
 {
@@ -65,6 +72,352 @@ namespace lazurite
 			//uint8_t rssi;
 		}SUBGHZ_MAC;
 
+		/*! @struct LAZURITE_FRAME
+		  @brief  received frame with RSSI and receiving time (lazurite_readFrame/lazurite_readBatch)
+		  offset of each field is from top of raw. offset 0 means the field is not in the frame,
+		  because raw[0] is always frame control.
+		 */
+		typedef struct {
+			uint16_t len;	/*!< length of raw */
+			int16_t status;	/*!< 0=OK <br> -EBADMSG = mac header is longer than frame */
+			uint8_t addr_type;	/*!< address type. see lazurite_getAddrType */
+			uint8_t seq_offset;	/*!< offset of sequence number */
+			uint8_t dst_panid_offset;	/*!< offset of rx panid */
+			uint8_t dst_addr_offset;	/*!< offset of rx address */
+			uint8_t dst_addr_len;	/*!< length of rx address 0/1/2/8 */
+			uint8_t src_panid_offset;	/*!< offset of tx panid */
+			uint8_t src_addr_offset;	/*!< offset of tx address */
+			uint8_t src_addr_len;	/*!< length of tx address 0/1/2/8 */
+			uint16_t payload_offset;	/*!< offset of payload */
+			uint16_t payload_len;	/*!< length of payload */
+			uint8_t rssi;	/*!< RSSI of this frame. 0-255. 0 = not got (lazurite_setRxInfo) */
+			time_t tv_sec;	/*!< receiving time of this frame (sec). 0 = not got (lazurite_setRxInfo) */
+			long tv_nsec;	/*!< receiving time of this frame (nsec) */
+			uint8_t raw[256];	/*!< raw data of ieee802154 */
+		} LAZURITE_FRAME;
+
+		/*! @struct LAZURITE_VIEW
+		  @brief  frame in buffer of application without decoding (lazurite_setView)
+		  nothing is decoded or copied until lazurite_viewXxx is called, and addresses and
+		  payload are given as pointer into raw. raw must be kept while the view is used.
+		 */
+		typedef struct {
+			const uint8_t *raw;	/*!< raw data of ieee802154 */
+			uint16_t len;	/*!< length of raw */
+		} LAZURITE_VIEW;
+
+		/*! @struct LAZURITE_MAC_COLUMNS
+		  @brief  mac headers of many frames by columns (lazurite_decMacBatch)
+		  each member is array of num frames, allocated by application. NULL = the column is skipped.<br>
+		  short address is lower 16bit of the address. 0xffff = address/PANID is not in the frame.<br>
+		  64bit address is little endian value of the address (short address is extended by 0).
+		  ~0 = address is not in the frame.
+		 */
+		typedef struct {
+			int16_t *status;	/*!< 0=OK <br> -EBADMSG = mac header is longer than frame */
+			uint8_t *frame_type;	/*!< frame type */
+			uint8_t *addr_type;	/*!< address type */
+			uint8_t *seq_num;	/*!< sequence number. 0 when seq_comp */
+			uint16_t *dst_panid;	/*!< rx panid */
+			uint16_t *src_panid;	/*!< tx panid */
+			uint16_t *dst_short;	/*!< rx short address */
+			uint16_t *src_short;	/*!< tx short address */
+			uint64_t *dst_addr;	/*!< rx 64bit address */
+			uint64_t *src_addr;	/*!< tx 64bit address */
+			uint16_t *payload_offset;	/*!< offset of payload */
+			uint16_t *payload_len;	/*!< length of payload */
+		} LAZURITE_MAC_COLUMNS;
+
+		/*! @enum LAZURITE_LINK_MODE
+		  @brief  filter of source address in lazurite_readLink (lazurite_setLinkMode)
+		 */
+		typedef enum {
+			LAZURITE_LINK_ALL = 0,	/*!< receive from all devices */
+			LAZURITE_LINK_ALLOW,	/*!< receive from devices in the link set only */
+			LAZURITE_LINK_DENY		/*!< receive from devices not in the link set */
+		} LAZURITE_LINK_MODE;
+
+		/*! @struct LAZURITE_LINK_STATS
+		  @brief  frames checked by link filter (lazurite_getLinkStats)
+		 */
+		typedef struct {
+			unsigned long accepted;	/*!< frames returned by lazurite_readLink */
+			unsigned long rejected;	/*!< frames dropped by link filter or broken */
+		} LAZURITE_LINK_STATS;
+
+		/*! @struct LAZURITE_DEDUP_PARAM
+		  @brief  parameters of duplicate suppression (lazurite_setDedup). 0 = default
+		 */
+		typedef struct {
+			unsigned long capacity;	/*!< sources remembered. 0 = 4096 */
+			uint8_t window;	/*!< sequence numbers remembered for each source. 1-64, 0 = 16 */
+			unsigned long timeout_ms;	/*!< source silent for this time is forgotten. 0 = 2000 */
+		} LAZURITE_DEDUP_PARAM;
+
+		/*! @struct LAZURITE_DEDUP_STATS
+		  @brief  counters of duplicate suppression (lazurite_getDedupStats)
+		 */
+		typedef struct {
+			unsigned long passed;	/*!< frames with sequence number and tx address which were passed */
+			unsigned long duplicated;	/*!< frames dropped as duplicate */
+			unsigned long evicted;	/*!< sources forgotten because table was full */
+		} LAZURITE_DEDUP_STATS;
+
+		/*! @struct LAZURITE_NEIGHBOR_PARAM
+		  @brief  parameters of neighbor table (lazurite_setNeighborTable). 0 = default
+		 */
+		typedef struct {
+			unsigned long capacity;	/*!< nodes remembered. 0 = 256 */
+			uint8_t ewma_shift;	/*!< weight of new rssi in average = 1/2^ewma_shift. 1-8, 0 = 3 */
+		} LAZURITE_NEIGHBOR_PARAM;
+
+		/*! @struct LAZURITE_NEIGHBOR
+		  @brief  link quality of one node (lazurite_getNeighbor)
+		 */
+		typedef struct {
+			uint64_t addr;	/*!< little endian value of address */
+			uint8_t addr_len;	/*!< 2 = 16bit (or 8bit), 8 = 64bit */
+			time_t last_sec;	/*!< time (CLOCK_REALTIME) when frame of the node was read or its ack was received last */
+			long last_nsec;
+			uint8_t rssi;	/*!< rssi of last frame */
+			uint8_t rssi_min;
+			uint8_t rssi_max;
+			float rssi_avg;	/*!< EWMA of rssi */
+			unsigned long rx_frames;	/*!< frames received */
+			unsigned long rx_lost;	/*!< frames estimated as lost from gaps of sequence number */
+			unsigned long tx_success;	/*!< frames sent to the node */
+			unsigned long tx_cca_fail;	/*!< -EBUSY */
+			unsigned long tx_ack_fail;	/*!< -ENODEV */
+			unsigned long tx_error;	/*!< other errors */
+			uint8_t ack_rssi;	/*!< rssi of last ack */
+			float ack_rssi_avg;	/*!< EWMA of rssi of ack */
+		} LAZURITE_NEIGHBOR;
+
+		/*! @struct LAZURITE_FILTER
+		  @brief  opaque filter of frames compiled from expression (lazurite_compileFilter)
+		 */
+		typedef struct lazurite_filter LAZURITE_FILTER;
+
+		/*! @struct LAZURITE_CAPTURE
+		  @brief  opaque capture of received frames to pcapng file (lazurite_openCapture)
+		 */
+		typedef struct lazurite_capture LAZURITE_CAPTURE;
+
+		/*! @struct LAZURITE_CAPTURE_PARAM
+		  @brief  parameters of capture. 0 = default
+		 */
+		typedef struct {
+			unsigned long rotate_size;	/*!< bytes of one file. 0 = not rotated by size */
+			unsigned long rotate_sec;	/*!< seconds of one file by receiving time. 0 = not rotated by time */
+			unsigned long buffer_size;	/*!< bytes of memory for frames waiting for the disk. 0 = 4MB */
+		} LAZURITE_CAPTURE_PARAM;
+
+		/*! @struct LAZURITE_CAPTURE_STATS
+		  @brief  counters of capture (lazurite_getCaptureStats)
+		 */
+		typedef struct {
+			unsigned long frames;	/*!< frames put to buffer */
+			unsigned long dropped;	/*!< frames dropped because buffer was full */
+			unsigned long files;	/*!< files opened */
+			unsigned long long bytes;	/*!< bytes written to files */
+			int error;	/*!< last error of file. 0 = no error */
+		} LAZURITE_CAPTURE_STATS;
+
+		/*! @struct LAZURITE_LOG
+		  @brief  opaque binary log of received frames (lazurite_openLog)
+		 */
+		typedef struct lazurite_log LAZURITE_LOG;
+
+		/*! @struct LAZURITE_LOG_READER
+		  @brief  opaque reader of binary log (lazurite_openLogReader)
+		 */
+		typedef struct lazurite_log_reader LAZURITE_LOG_READER;
+
+		/*! @struct LAZURITE_LOG_PARAM
+		  @brief  parameters of binary log. 0 = default
+		 */
+		typedef struct {
+			unsigned long segment_size;	/*!< bytes of records in one segment. 0 = 64MB */
+			unsigned long index_interval;	/*!< frames of one block of index. 0 = 256 */
+		} LAZURITE_LOG_PARAM;
+
+		/*! @struct LAZURITE_LOG_STATS
+		  @brief  counters of binary log (lazurite_getLogStats)
+		 */
+		typedef struct {
+			unsigned long frames;	/*!< frames written */
+			unsigned long long bytes;	/*!< bytes of raw frames written */
+			unsigned long segments;	/*!< segments created */
+			int error;	/*!< last error. 0 = no error */
+		} LAZURITE_LOG_STATS;
+
+		/*! @struct LAZURITE_LOG_QUERY
+		  @brief  frames read by lazurite_readLog (lazurite_seekLog)
+		 */
+		typedef struct {
+			time_t from_sec;	/*!< receiving time from (included) */
+			long from_nsec;
+			time_t to_sec;	/*!< receiving time to (included). 0 = no limit */
+			long to_nsec;
+			uint64_t src_addr;	/*!< little endian value of tx address (short address is extended by 0). ~0 = all */
+		} LAZURITE_LOG_QUERY;
+
+		/*! @struct LAZURITE_REPLAY_PARAM
+		  @brief  parameters of lazurite_backend_replay (lazurite_setReplay)
+		 */
+		typedef struct {
+			double speed;	/*!< 1.0 = timing of the file, 2.0 = twice as fast. 0 = as fast as possible */
+			bool loop;	/*!< true = replay from top again at end of file */
+		} LAZURITE_REPLAY_PARAM;
+
+		/*! @enum LAZURITE_FORMAT
+		  @brief  text format of lazurite_formatFrames
+		 */
+		typedef enum {
+			LAZURITE_FORMAT_CSV = 0,	/*!< sec,nsec,seq_num,rssi,src_panid,src_addr,payload */
+			LAZURITE_FORMAT_JSONL,	/*!< one JSON object in one line */
+			LAZURITE_FORMAT_CSV_HEX,	/*!< CSV. payload is written by hex */
+			LAZURITE_FORMAT_JSONL_HEX	/*!< JSON Lines. payload is written by hex */
+		} LAZURITE_FORMAT;
+
+#define LAZURITE_FORMAT_LINE_MAX	2048	/*!< any frame is shorter than this in any format */
+
+#define LAZURITE_METRICS_MAGIC		0x544d5a4c	/*!< "LZMT". 1st word of LAZURITE_METRICS */
+#define LAZURITE_HISTOGRAM_SUB		8		/*!< buckets in one power of 2 */
+#define LAZURITE_HISTOGRAM_BUCKETS	256		/*!< buckets of LAZURITE_HISTOGRAM. up to 2^33 ns */
+#define LAZURITE_METRICS_ERRNO		64		/*!< tx_fail[errno]. tx_fail[0] = errno out of range */
+
+		/*! @struct LAZURITE_HISTOGRAM
+		  @brief  log-linear histogram of ns (lazurite_getMetrics)
+		  values under LAZURITE_HISTOGRAM_SUB ns have own bucket. above that, each power of 2 is
+		  divided into LAZURITE_HISTOGRAM_SUB buckets, so error of a bucket is 1/LAZURITE_HISTOGRAM_SUB at most.
+		  lazurite_getPercentile gets percentile.
+		 */
+		typedef struct {
+			uint64_t count;	/*!< number of values */
+			uint64_t sum;	/*!< total of values (ns) */
+			uint64_t bucket[LAZURITE_HISTOGRAM_BUCKETS];
+		} LAZURITE_HISTOGRAM;
+
+		/*! @struct LAZURITE_METRICS
+		  @brief  counters of one context (lazurite_getMetrics)
+		  every member is 64bit and updated by relaxed atomic add, so a reader of lazurite_shareMetrics
+		  never sees a torn value. members are not updated at one time.
+		 */
+		typedef struct {
+			uint32_t magic;	/*!< LAZURITE_METRICS_MAGIC */
+			uint32_t size;	/*!< sizeof(LAZURITE_METRICS) */
+			uint64_t ioctl_calls;	/*!< ioctl of backend */
+			uint64_t ioctl_errors;	/*!< ioctl which returned error */
+			uint64_t read_calls;	/*!< read and recv of backend */
+			uint64_t read_bytes;
+			uint64_t write_calls;	/*!< write of backend */
+			uint64_t write_bytes;
+			uint64_t rx_frames;	/*!< frames got from backend (before filter) */
+			uint64_t tx_frames;	/*!< frames sent successfully */
+			uint64_t tx_fail[LAZURITE_METRICS_ERRNO];	/*!< failed send by errno. EBUSY = CCA fail, ENODEV = ACK fail */
+			LAZURITE_HISTOGRAM send;	/*!< time of lazurite_send/lazurite_send64be/lazurite_send64le and tx queue */
+			LAZURITE_HISTOGRAM rx_syscall;	/*!< time of read and recv of backend */
+			LAZURITE_HISTOGRAM decode;	/*!< time of decoding mac headers in one lazurite_readBatch */
+		} LAZURITE_METRICS;
+
+		/*! @struct LAZURITE_BACKEND
+		  @brief  transport under lazurite_* API
+		  all of ioctl/read/write of the library are issued through this table.<br>
+		  lazurite_backend_lzgw = /dev/lzgw of LazDriver (default)<br>
+		  lazurite_backend_sim  = simulated radio in this process<br>
+		  lazurite_backend_replay = frames of pcap/pcapng file
+		 */
+		typedef struct {
+			const char* name;	/*!< name of backend */
+			const char* path;	/*!< device to be opened by lazurite_init */
+			int (*load)(uint16_t testmode);	/*!< load driver. 0=success, 256=already loaded, 0 < fail */
+			int (*unload)(void);	/*!< remove driver */
+			int (*open)(const char* path);	/*!< open device. return descriptor, 0 < fail */
+			int (*close)(int fd);	/*!< close descriptor */
+			int (*ioctl)(int fd, unsigned long cmd, unsigned long arg);	/*!< IOCTL_PARAM/IOCTL_CMD */
+			int (*read)(int fd, void* buf, size_t count);	/*!< 2byte length, then frame */
+			int (*write)(int fd, const void* buf, size_t count);	/*!< send payload */
+			int (*recv)(int fd, LAZURITE_FRAME* frames, int num);	/*!< drain up to num frames. set raw, len, rssi and time. NULL = by read */
+		} LAZURITE_BACKEND;
+
+		extern const LAZURITE_BACKEND lazurite_backend_lzgw;	/*!< LazDriver (/dev/lzgw) */
+		extern const LAZURITE_BACKEND lazurite_backend_sim;	/*!< simulated radio */
+		extern const LAZURITE_BACKEND lazurite_backend_replay;	/*!< replay of capture file */
+
+		/*! @struct LAZURITE_CTX
+		  @brief  opaque context of one device (lazurite_openCtx)
+		  each context has own descriptor, buffers, shadow of parameters, tx queue and dispatcher.
+		  functions without ctx use the default context opened by lazurite_init.
+		 */
+		typedef struct lazurite_ctx LAZURITE_CTX;
+
+		/******************************************************************************/
+		/*! @brief select backend
+		  must be called before lazurite_init/lazurite_test.
+		  @param[in]      backend  &lazurite_backend_lzgw or &lazurite_backend_sim
+		  @return         0=success <br> 0 < fail (-EBUSY = device is opened)
+		  @exception      none
+		  @note  all instances opened by lazurite_backend_sim.open() in one process
+		  share the same air. frames sent by one instance are received by others
+		  on the same ch, so the library can run without LazDriver.
+		 ******************************************************************************/
+		int lazurite_setBackend(const LAZURITE_BACKEND* backend);
+
+		/******************************************************************************/
+		/*! @brief set path of lazdriver.ko
+		  lazurite_init/lazurite_test load it by finit_module only when LazDriver is not in kernel
+		  (sudo insmod when the process is not permitted), and wait until /dev/lzgw is created.
+		  @param[in]      path     path of lazdriver.ko. /home/pi/driver/LazDriver/lazdriver.ko in default
+		  @return         0=success <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_setModulePath(const char* path);
+
+		/******************************************************************************/
+		/*! @brief set file replayed by lazurite_backend_replay
+		  applied to replays opened after this. frames of the file are received by
+		  lazurite_read/lazurite_readPayload/lazurite_readLink/lazurite_readBatch, dispatcher and rx thread
+		  at their receiving time, and nothing is sent.
+		  @param[in]      path     pcap/pcapng file opened by path "replay" (lazurite_init, lazurite_openCtx)
+		  @param[in]      *param   speed and loop. NULL = as fast as possible, once
+		  @return         0=success <br> 0 > fail
+		  @exception      none
+		  @note  link type 230 (802.15.4 without FCS) and 195 (FCS is removed) are replayed.
+		  RSSI is read from comment "rssi=N" of lazurite_openCapture.
+		  lazurite_openCtx(&lazurite_backend_replay,path) replays path directly.
+		 ******************************************************************************/
+		int lazurite_setReplay(const char* path, const LAZURITE_REPLAY_PARAM* param);
+
+		/******************************************************************************/
+		/*! @brief open device as new context
+		  driver must be loaded by lazurite_init or backend->load in advance.
+		  @param[in]      backend  &lazurite_backend_lzgw or &lazurite_backend_sim. NULL = lzgw
+		  @param[in]      path     device node. NULL = backend->path
+		  @return         context <br> NULL = fail (errno is set)
+		  @exception      none
+		  @note  lazurite_ctx_xxx(ctx,...) is same as lazurite_xxx(...) for the context.
+		  contexts are independent, so one process can drive several radios,
+		  and each context can be used from its own thread.
+		 ******************************************************************************/
+		LAZURITE_CTX* lazurite_openCtx(const LAZURITE_BACKEND* backend, const char* path);
+
+		/******************************************************************************/
+		/*! @brief close context opened by lazurite_openCtx
+		  dispatcher and tx queue of the context are stopped.
+		  @param[in]      ctx      context
+		  @return         0=success <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_closeCtx(LAZURITE_CTX* ctx);
+
+		/******************************************************************************/
+		/*! @brief context used by functions without ctx
+		  @return         context of lazurite_init
+		  @exception      none
+		 ******************************************************************************/
+		LAZURITE_CTX* lazurite_getDefaultCtx(void);
+
 		/******************************************************************************/
 		/*! @brief set linked address
 		  addr = 0xffff		receiving all data
@@ -75,12 +428,58 @@ namespace lazurite
 		  @exception      none
 		 ******************************************************************************/
 		int lazurite_link(uint16_t addr);
+
+		/******************************************************************************/
+		/*! @brief set mode of link filter
+		  @param[in]      mode   LAZURITE_LINK_ALL/LAZURITE_LINK_ALLOW/LAZURITE_LINK_DENY
+		  @return         0=success <br> -EINVAL = mode error
+		  @exception      none
+		  @note  lazurite_link(addr) is same as lazurite_clearLink, lazurite_addLink(addr) and
+		  lazurite_setLinkMode(LAZURITE_LINK_ALLOW). lazurite_link(0xffff) sets LAZURITE_LINK_ALL.
+		 ******************************************************************************/
+		int lazurite_setLinkMode(uint8_t mode);
+
+		/******************************************************************************/
+		/*! @brief add/remove 16bit source address to/from link set
+		  @param[in]      addr   16bit address. 0xffff can not be added.
+		  @return         0=success <br> -EINVAL = 0xffff <br> -ENOENT = not in the set (remove) <br> -ENOMEM
+		  @exception      none
+		  @note  16bit address also matches a frame from 64bit address whose lower 16bit is same,
+		  because short address of Lazurite is lower 16bit of its 64bit address.
+		 ******************************************************************************/
+		int lazurite_addLink(uint16_t addr);
+		int lazurite_removeLink(uint16_t addr);
+
+		/******************************************************************************/
+		/*! @brief add/remove 64bit source address to/from link set
+		  @param[in]      *addr_le  64bit address (little endian, same order as raw data)
+		  @return         0=success <br> -EINVAL = all 0xff <br> -ENOENT = not in the set (remove) <br> -ENOMEM
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_addLink64le(uint8_t *addr_le);
+		int lazurite_removeLink64le(uint8_t *addr_le);
+
+		/******************************************************************************/
+		/*! @brief remove all addresses from link set
+		  @return         0=success
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_clearLink(void);
+
+		/******************************************************************************/
+		/*! @brief get counters of link filter
+		  @param[out]     *stats  counters
+		  @param[in]      clear   true = counters are cleared after reading
+		  @return         0=success <br> -EINVAL = stats is NULL
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getLinkStats(LAZURITE_LINK_STATS* stats, bool clear);
 		/******************************************************************************/
 		/*! @brief load LazDriver
 		  @param      none
 		  @return         0=success <br> 0 < fail
 		  @exception  none
-		  @todo  must be change folder name of lazdriver
+		  @note  path of lazdriver.ko is set by lazurite_setModulePath
 		 ******************************************************************************/
 		int lazurite_init(void);
 		int lazurite_test(uint16_t testmode);
@@ -171,6 +570,80 @@ namespace lazurite
 		 ******************************************************************************/
 		int lazurite_send(uint16_t dst_panid,uint16_t dst_addr,const void* payload, uint16_t length);
 
+		/*! @struct LAZURITE_TX_COMPLETION
+		  @brief  result of frame submitted to tx queue
+		 */
+		typedef struct {
+			long handle;	/*!< handle returned by lazurite_submit */
+			int result;	/*!< 0 <= success <br> -ENODEV = ACK Fail <br> -EBUSY = CCA Fail <br> -ECANCELED = tx queue is stopped */
+			int rssi;	/*!< RSSI of ACK (lazurite_getTxRssi). -1 = fail */
+		} LAZURITE_TX_COMPLETION;
+
+		/*! @brief callback of tx queue. called by tx worker thread. */
+		typedef void (*LAZURITE_TX_CALLBACK)(const LAZURITE_TX_COMPLETION* completion, void* arg);
+
+		/******************************************************************************/
+		/*! @brief start tx queue
+		  frames submitted by lazurite_submit are sent by tx worker thread in order.
+		  @param[in]      depth     max number of frames in queue (and completions not got)
+		  @param[in]      callback  called by tx worker when frame is completed.<br>
+		  NULL = completions are got by lazurite_getTxCompletion
+		  @param[in]      arg       argument of callback
+		  @return         0=success <br> 0 > fail (-EBUSY = already started)
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_startTxQueue(uint16_t depth, LAZURITE_TX_CALLBACK callback, void* arg);
+
+		/******************************************************************************/
+		/*! @brief stop tx queue
+		  frame being sent is completed. frames in queue are completed with -ECANCELED.
+		  @param      none
+		  @return     0=success <br> 0 > fail
+		  @exception  none
+		 ******************************************************************************/
+		int lazurite_stopTxQueue(void);
+
+		/******************************************************************************/
+		/*! @brief submit data to tx queue (lazurite_send without blocking)
+		  @param[in]     dst_panid	panid of receiver
+		  @param[in]     dst_addr   16bit short address
+		  @param[in]     payload start poiter of data to be sent. it is copied to queue.
+		  @param[in]     length length of payload
+		  @return         0 < handle <br> -EAGAIN = queue is full <br> 0 > fail
+		  @exception none
+		 ******************************************************************************/
+		long lazurite_submit(uint16_t dst_panid,uint16_t dst_addr,const void* payload, uint16_t length);
+
+		/******************************************************************************/
+		/*! @brief submit data to tx queue (lazurite_send64be without blocking)
+		  @param[in]     dst_be     8 x 8bit 64bit MAC address(big endian array)
+		  @param[in]     payload start poiter of data to be sent. it is copied to queue.
+		  @param[in]     length length of payload
+		  @return         0 < handle <br> -EAGAIN = queue is full <br> 0 > fail
+		  @exception none
+		 ******************************************************************************/
+		long lazurite_submit64be(uint8_t *dst_be,const void* payload, uint16_t length);
+
+		/******************************************************************************/
+		/*! @brief submit data to tx queue (lazurite_send64le without blocking)
+		  @param[in]     dst_le     8 x 8bit 64bit MAC address(little endian array)
+		  @param[in]     payload start poiter of data to be sent. it is copied to queue.
+		  @param[in]     length length of payload
+		  @return         0 < handle <br> -EAGAIN = queue is full <br> 0 > fail
+		  @exception none
+		 ******************************************************************************/
+		long lazurite_submit64le(uint8_t *dst_le,const void* payload, uint16_t length);
+
+		/******************************************************************************/
+		/*! @brief get completions of tx queue (when callback is NULL)
+		  @param[out]     *completions  array of completion
+		  @param[in]      num           size of array
+		  @param[in]      timeout       timeout(ms) until 1st completion. -1 = wait forever, 0 = no wait
+		  @return         number of completions <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getTxCompletion(LAZURITE_TX_COMPLETION* completions, int num, int timeout);
+
 		/******************************************************************************/
 		/*! @brief enable RX
 		  @param     none
@@ -209,6 +682,17 @@ namespace lazurite
 		 ******************************************************************************/
 		int lazurite_setMyAddress(uint16_t my_addr);
 
+		/******************************************************************************/
+		/*! @brief number of ioctl skipped by shadow of parameters
+		  destination of lazurite_send/lazurite_send64be/lazurite_send64le and my address are
+		  kept in the library. ioctl is not issued when the value is already set,
+		  and getters return the kept value. it is cleared by lazurite_begin/lazurite_close/lazurite_remove.
+		  @param      none
+		  @return     number of ioctl which was not issued
+		  @exception  none
+		 ******************************************************************************/
+		unsigned long lazurite_getIoctlSaved(void);
+
 		/******************************************************************************/
 		/*! @brief send data via 920MHz
 		  @param[in]     *payload     data 
@@ -228,6 +712,98 @@ namespace lazurite
 		 ******************************************************************************/
 		int lazurite_decMac(SUBGHZ_MAC* mac,void* raw,uint16_t raw_size);
 
+		/******************************************************************************/
+		/*! @brief set frame to view
+		  @param[out]     *view   view of raw
+		  @param[in]      *raw    raw data of ieee802154 (lazurite_read, LAZURITE_FRAME.raw ...)
+		  @param[in]      len     length of raw
+		  @return         0=success <br> -EINVAL = view or raw is NULL
+		  @exception      none
+		  @note  mac header is not checked here. each lazurite_viewXxx returns -EBADMSG when
+		  the frame is shorter than mac header.
+		 ******************************************************************************/
+		int lazurite_setView(LAZURITE_VIEW* view, const void* raw, uint16_t len);
+
+		/******************************************************************************/
+		/*! @brief sequence number of frame
+		  @param[in]      *view   view of frame
+		  @return         0-255 = sequence number <br> -ENOENT = seq_comp <br> -EBADMSG = broken frame
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_viewSeq(const LAZURITE_VIEW* view);
+
+		/******************************************************************************/
+		/*! @brief PANID of frame
+		  @param[in]      *view   view of frame
+		  @return         0-0xffff = PANID <br> -ENOENT = PANID is not in frame <br> -EBADMSG = broken frame
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_viewDstPanid(const LAZURITE_VIEW* view);
+		int lazurite_viewSrcPanid(const LAZURITE_VIEW* view);
+
+		/******************************************************************************/
+		/*! @brief address of frame
+		  @param[in]      *view   view of frame
+		  @param[out]     **addr  pointer of address in raw (little endian). NULL = address is not in frame
+		  @return         length of address 0/1/2/8 <br> -EBADMSG = broken frame
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_viewDstAddr(const LAZURITE_VIEW* view, const uint8_t** addr);
+		int lazurite_viewSrcAddr(const LAZURITE_VIEW* view, const uint8_t** addr);
+
+		/******************************************************************************/
+		/*! @brief payload of frame
+		  @param[in]      *view      view of frame
+		  @param[out]     **payload  pointer of payload in raw
+		  @return         length of payload <br> -EBADMSG = broken frame
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_viewPayload(const LAZURITE_VIEW* view, const uint8_t** payload);
+
+		/******************************************************************************/
+		/*! @brief decoding mac header of many frames
+		  @param[out]     *columns  arrays of result. each array has num entries.
+		  @param[in]      **raw     array of raw data of ieee802154 (lazurite_read)
+		  @param[in]      *len      array of length of raw
+		  @param[in]      num       number of frames
+		  @return         num <br> -EINVAL = parameter error
+		  @exception      none
+		  @note  broken frame does not stop decoding. it is reported by status column.
+		 ******************************************************************************/
+		int lazurite_decMacBatch(LAZURITE_MAC_COLUMNS* columns, const void* const* raw, const uint16_t* len, int num);
+
+		/******************************************************************************/
+		/*! @brief compile filter of frames
+		  @param[in]      *expr       expression of fields of mac header
+		  @param[out]     *error_pos  offset of error in expr. NULL = not needed
+		  @return         filter <br> NULL = fail (errno = EINVAL: syntax error, E2BIG: too long, ENOMEM)
+		  @exception      none
+		  @note  fields are same as SUBGHZ_MAC (frame_type, seq_num, dst_panid, src_addr ...),
+		  and len (length of raw). operators are == != < <= > >= && || ! () and '&' (mask by number).<br>
+		  numbers are decimal or hex (0x). PANID not in the frame is 0xffff, address not in the frame
+		  is ~0, and address is little endian value (short address is extended by 0).<br>
+		  (ex) "frame_type == 1 && dst_panid == 0xabcd && len > 20"
+		 ******************************************************************************/
+		LAZURITE_FILTER* lazurite_compileFilter(const char* expr, int* error_pos);
+
+		/******************************************************************************/
+		/*! @brief free filter
+		  @param[in]      *filter   filter of lazurite_compileFilter. NULL is ignored
+		  @exception      none
+		 ******************************************************************************/
+		void lazurite_freeFilter(LAZURITE_FILTER* filter);
+
+		/******************************************************************************/
+		/*! @brief check frame by filter
+		  @param[in]      *filter   filter of lazurite_compileFilter
+		  @param[in]      *raw      raw data of ieee802154
+		  @param[in]      len       length of raw
+		  @return         1 = match <br> 0 = not match <br> -EINVAL = filter or raw is NULL
+		  @exception      none
+		  @note  only fields in the expression are read from raw. frame shorter than mac header does not match.
+		 ******************************************************************************/
+		int lazurite_matchFilter(const LAZURITE_FILTER* filter, const void* raw, uint16_t len);
+
 		/******************************************************************************/
 		/*! @brief get size of receiving data
 		  @param      none
@@ -248,6 +824,417 @@ namespace lazurite
 		 ******************************************************************************/
 		int lazurite_read(void* raw, uint16_t* size);
 
+		/******************************************************************************/
+		/*! @brief set filter of received frames
+		  @param[in]      *filter   filter of lazurite_compileFilter. NULL = all frames are received
+		  @return         0=success <br> -EBUSY = rx thread or dispatcher is running
+		  @exception      none
+		  @note  frames which do not match are dropped before they are copied by lazurite_read,
+		  lazurite_readTimeout, lazurite_readBatch, lazurite_readFrame, dispatcher and rx thread.
+		  filter must not be freed while it is set.
+		 ******************************************************************************/
+		int lazurite_setFilter(const LAZURITE_FILTER* filter);
+
+		/******************************************************************************/
+		/*! @brief read queued frames at once
+		  frames are received into the slots directly and mac header of each frame is decoded
+		  into offsets of LAZURITE_FRAME.
+		  @param[out]     *frames   array of slots
+		  @param[in]      num       number of slots
+		  @return         number of frames <br> 0 = no frame <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_readBatch(LAZURITE_FRAME* frames, int num);
+
+		/******************************************************************************/
+		/*! @brief get rssi and receiving time of each frame in lazurite_readBatch
+		  lazurite_backend_lzgw has them only by ioctl for the frame read last, so a frame
+		  costs 2 read and 5 ioctl with this, and 2 read without this.
+		  @param[in]      on        true = rssi, tv_sec and tv_nsec of LAZURITE_FRAME are set.
+		  false = they are 0 on lazurite_backend_lzgw (default)
+		  @return         0=success <br> -EBUSY = rx thread or dispatcher is running
+		  @exception      none
+		  @note  applied to lazurite_readBatch, dispatcher and rx thread, and so to capture, log and
+		  rssi of neighbor table. lazurite_readFrame always gets them. backends which receive frames
+		  with rssi and time (lazurite_backend_sim, lazurite_backend_replay) always set them.
+		 ******************************************************************************/
+		int lazurite_setRxInfo(bool on);
+
+		/******************************************************************************/
+		/*! @brief drop frames retransmitted because ACK was lost
+		  last sequence numbers of each tx address are remembered, and frames which have the same
+		  sequence number as one received before are dropped before payload is copied.
+		  @param[in]      *param    size of table, window and timeout. NULL = stop
+		  @return         0=success <br> 0 > fail (-EBUSY = rx thread or dispatcher is running)
+		  @exception      none
+		  @note  applied to lazurite_read, lazurite_readPayload, lazurite_readLink, lazurite_readBatch,
+		  dispatcher and rx thread after filter (lazurite_setFilter). frames without sequence number
+		  (seq_comp) or tx address are not dropped. table has fixed capacity, and the oldest source
+		  is forgotten when it is full. counters are cleared.
+		 ******************************************************************************/
+		int lazurite_setDedup(const LAZURITE_DEDUP_PARAM* param);
+
+		/******************************************************************************/
+		/*! @brief get counters of duplicate suppression
+		  @param[out]     *stats    counters
+		  @param[in]      clear     true = counters are cleared after read
+		  @return         0=success <br> -EINVAL = suppression is not set
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getDedupStats(LAZURITE_DEDUP_STATS* stats, bool clear);
+
+		/******************************************************************************/
+		/*! @brief keep link quality of each node
+		  rssi, sequence number and time of received frames, and results of send are kept for
+		  each tx/rx address, so lazurite_getRxRssi/lazurite_getTxRssi don't need to be called
+		  after every frame.
+		  @param[in]      *param    size of table and weight of average. NULL = stop
+		  @return         0=success <br> 0 > fail (-EBUSY = rx thread or dispatcher is running)
+		  @exception      none
+		  @note  updated by lazurite_read, lazurite_readPayload, lazurite_readLink, lazurite_readBatch,
+		  dispatcher and rx thread after filter and duplicate suppression, and by lazurite_send,
+		  lazurite_send64be, lazurite_send64le and tx queue. broadcast is not counted.<br>
+		  rssi of frames is not available on lazurite_read/lazurite_readPayload/lazurite_readLink,
+		  so rssi, rssi_min, rssi_max and rssi_avg are updated only by the other paths.
+		  send issues one more ioctl for rssi of ack while the table is set.<br>
+		  rx_lost counts gaps of sequence number, so frames which the node sent to other nodes
+		  are also counted when promiscuous mode is off. 16bit and 64bit address of one node are
+		  different nodes. the table has fixed capacity, and the oldest node is replaced when it is full.
+		 ******************************************************************************/
+		int lazurite_setNeighborTable(const LAZURITE_NEIGHBOR_PARAM* param);
+
+		/******************************************************************************/
+		/*! @brief get link quality of one node
+		  all members are copied at one time, even while rx and tx are updating it.
+		  @param[in]      addr        16bit address of node
+		  @param[out]     *neighbor   link quality
+		  @return         0=success <br> -ENOENT = node is not in table <br> -EINVAL = table is not set
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getNeighbor(uint16_t addr, LAZURITE_NEIGHBOR* neighbor);
+
+		/******************************************************************************/
+		/*! @brief get link quality of one node
+		  @param[in]      *addr_le    64bit address of node (little endian)
+		  @param[out]     *neighbor   link quality
+		  @return         0=success <br> -ENOENT = node is not in table <br> -EINVAL = table is not set
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getNeighbor64le(uint8_t *addr_le, LAZURITE_NEIGHBOR* neighbor);
+
+		/******************************************************************************/
+		/*! @brief get link quality of all nodes
+		  @param[out]     *neighbors  array of nodes
+		  @param[in]      num         number of array
+		  @return         number of nodes <br> -EINVAL = table is not set
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getNeighbors(LAZURITE_NEIGHBOR* neighbors, int num);
+
+		/******************************************************************************/
+		/*! @brief get counters and histograms
+		  counters are always kept. they are updated by relaxed atomic add, so rx and tx are not stopped.
+		  @param[out]     *metrics    copy of counters
+		  @return         0=success <br> -EINVAL = parameter error
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getMetrics(LAZURITE_METRICS* metrics);
+
+		/******************************************************************************/
+		/*! @brief write counters and histograms as text format of Prometheus
+		  file is written to path + ".tmp" and renamed, so a scraper (textfile collector of
+		  node_exporter ...) never reads half of it.
+		  @param[in]      *path     file
+		  @return         0=success <br> 0 > fail
+		  @exception      none
+		  @note  buckets of histograms are put together by each power of 2. names start by "lazurite_".
+		 ******************************************************************************/
+		int lazurite_writeMetrics(const char* path);
+
+		/******************************************************************************/
+		/*! @brief share counters by POSIX shared memory
+		  counters are moved to shared memory of name, and updated there directly.
+		  other process can read it by shm_open and mmap of sizeof(LAZURITE_METRICS) while the
+		  radio is running. check magic and size before reading.
+		  @param[in]      *name     name of shm_open ("/lazurite" ...). NULL = stop sharing
+		  @return         0=success <br> 0 > fail (-EBUSY = already shared or thread of context is running)
+		  @exception      none
+		  @note  shared memory is removed by stop sharing, lazurite_remove and lazurite_closeCtx.
+		  its mapping in this process is kept until lazurite_remove and lazurite_closeCtx.
+		 ******************************************************************************/
+		int lazurite_shareMetrics(const char* name);
+
+		/******************************************************************************/
+		/*! @brief percentile of histogram
+		  @param[in]      *hist       histogram of LAZURITE_METRICS
+		  @param[in]      percent     0 - 100
+		  @return         upper bound of bucket which has the percentile (ns). 0 = no value
+		  @exception      none
+		 ******************************************************************************/
+		uint64_t lazurite_getPercentile(const LAZURITE_HISTOGRAM* hist, double percent);
+
+		/******************************************************************************/
+		/*! @brief read one frame with RSSI and receiving time
+		  RSSI and time are received together with the frame, so they are not
+		  changed by next frame as lazurite_getRxRssi/lazurite_getRxTime.
+		  @param[out]     *frame    slot of frame
+		  @return         length of receiving packet <br> 0 = no frame <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_readFrame(LAZURITE_FRAME* frame);
+
+		/******************************************************************************/
+		/*! @brief get descriptor of device
+		  descriptor becomes readable (POLLIN) when frame is received.
+		  it can be used with poll/select/epoll of application.
+		  @param      none
+		  @return     descriptor <br> 0 > not opened
+		  @exception  none
+		 ******************************************************************************/
+		int lazurite_getFd(void);
+
+		/******************************************************************************/
+		/*! @brief wait until frame is received
+		  @param[in]      timeout   timeout(ms). -1 = wait forever
+		  @return         1 = frame is received <br> 0 = timeout <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_wait(int timeout);
+
+		/******************************************************************************/
+		/*! @brief read raw data with timeout
+		  same as lazurite_read, but block until frame is received.
+		  @param[out]     *raw      pointer to write received packet data. 255 byte should be reserved.
+		  @param[out]     size      size of raw data
+		  @param[in]      timeout   timeout(ms). -1 = wait forever
+		  @return         length of receiving packet <br> 0 = timeout <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_readTimeout(void* raw, uint16_t* size, int timeout);
+
+		/*! @brief callback of dispatcher. frame is valid only in callback. */
+		typedef void (*LAZURITE_RX_CALLBACK)(const LAZURITE_FRAME* frame, void* arg);
+
+		/******************************************************************************/
+		/*! @brief start dispatcher thread
+		  the thread sleeps until frame is received, and call callback for each frame.
+		  @param[in]      callback  function to be called
+		  @param[in]      arg       argument of callback
+		  @return         0=success <br> 0 > fail (-EBUSY = dispatcher or rx thread is running)
+		  @exception      none
+		  @note  while dispatcher is running, lazurite_read/readPayload/readLink/readBatch must not be used.
+		 ******************************************************************************/
+		int lazurite_startDispatcher(LAZURITE_RX_CALLBACK callback, void* arg);
+
+		/******************************************************************************/
+		/*! @brief stop dispatcher thread
+		  @param      none
+		  @return     0=success <br> 0 > fail
+		  @exception  none
+		 ******************************************************************************/
+		int lazurite_stopDispatcher(void);
+
+		/******************************************************************************/
+		/*! @brief start rx thread
+		  the thread pulls frames from device into a lock-free single-producer/single-consumer ring,
+		  and they are got by lazurite_getRxFrames. while the ring is full, frames are kept in driver.
+		  @param[in]      depth     number of frames in ring. rounded up to power of 2
+		  @param[in]      cpu       cpu which rx thread is pinned to. -1 = not pinned
+		  @return         0=success <br> 0 > fail (-EBUSY = rx thread or dispatcher is running)
+		  @exception      none
+		  @note  while rx thread is running, lazurite_read/readPayload/readLink/readBatch must not be used.
+		  send functions can be called from other threads at same time.
+		 ******************************************************************************/
+		int lazurite_startRxThread(uint16_t depth, int cpu);
+
+		/******************************************************************************/
+		/*! @brief stop rx thread. frames left in ring are abandoned.
+		  @param      none
+		  @return     0=success <br> 0 > fail
+		  @exception  none
+		 ******************************************************************************/
+		int lazurite_stopRxThread(void);
+
+		/******************************************************************************/
+		/*! @brief get frames received by rx thread
+		  only one thread may call this function at a time (single consumer).
+		  @param[out]     *frames   array of slots
+		  @param[in]      num       number of slots
+		  @param[in]      timeout   timeout(ms) until 1st frame. -1 = wait forever, 0 = no wait
+		  @return         number of frames <br> 0 = timeout <br> 0 > fail (-EIO = rx thread ended by error)
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getRxFrames(LAZURITE_FRAME* frames, int num, int timeout);
+
+		/******************************************************************************/
+		/*! @brief open capture file
+		  frames are written to pcapng file (link type 230 = IEEE 802.15.4 without FCS) by a writer thread.
+		  timestamp is receiving time of the frame, and RSSI is put in comment of the packet ("rssi=N").
+		  @param[in]      *path     file name. when files are rotated, number is put before extension
+		  (ex. rx.pcapng -> rx_00000.pcapng, rx_00001.pcapng ...)
+		  @param[in]      *param    rotation and buffer. NULL = default (not rotated)
+		  @return         capture <br> NULL = fail (errno)
+		  @exception      none
+		 ******************************************************************************/
+		LAZURITE_CAPTURE* lazurite_openCapture(const char* path, const LAZURITE_CAPTURE_PARAM* param);
+
+		/******************************************************************************/
+		/*! @brief put frames to capture
+		  frames are copied to buffer and written by writer thread. this does not wait for the disk.
+		  @param[in]      *capture  capture of lazurite_openCapture
+		  @param[in]      *frames   received frames (lazurite_readBatch, lazurite_getRxFrames ...)
+		  @param[in]      num       number of frames
+		  @return         number of frames put <br> 0 > fail
+		  @exception      none
+		  @note  frames are dropped when buffer is full. see dropped of lazurite_getCaptureStats.
+		 ******************************************************************************/
+		int lazurite_writeCapture(LAZURITE_CAPTURE* capture, const LAZURITE_FRAME* frames, int num);
+
+		/******************************************************************************/
+		/*! @brief get counters of capture
+		  @param[in]      *capture  capture of lazurite_openCapture
+		  @param[out]     *stats    counters
+		  @return         0=success <br> -EINVAL = parameter error
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getCaptureStats(LAZURITE_CAPTURE* capture, LAZURITE_CAPTURE_STATS* stats);
+
+		/******************************************************************************/
+		/*! @brief write buffered frames and close capture
+		  @param[in]      *capture  capture of lazurite_openCapture
+		  @return         0=success <br> 0 > last error of file
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_closeCapture(LAZURITE_CAPTURE* capture);
+
+		/******************************************************************************/
+		/*! @brief capture received frames automatically
+		  @param[in]      *capture  capture of lazurite_openCapture. NULL = stop
+		  @return         0=success <br> -EBUSY = rx thread or dispatcher is running
+		  @exception      none
+		  @note  frames got by lazurite_readBatch, lazurite_readFrame, dispatcher and rx thread are
+		  put to capture after filter (lazurite_setFilter). capture must not be closed while it is set.
+		 ******************************************************************************/
+		int lazurite_setCapture(LAZURITE_CAPTURE* capture);
+
+		/******************************************************************************/
+		/*! @brief open binary log to write
+		  a log is a directory of segment files which are only appended. each record has receiving
+		  time, RSSI, decoded addresses, sequence number and raw frame. when a segment is full,
+		  sparse index by time and tx address is written and new segment is started.
+		  @param[in]      dir      directory of log. created when it does not exist
+		  @param[in]      *param   size of segment and interval of index. NULL = default
+		  @return         log <br> NULL = fail (errno is set)
+		  @exception      none
+		  @note  segments written before are not changed. new segment follows them.
+		 ******************************************************************************/
+		LAZURITE_LOG* lazurite_openLog(const char* dir, const LAZURITE_LOG_PARAM* param);
+
+		/******************************************************************************/
+		/*! @brief append frames to binary log
+		  frames are copied to the segment mapped by mmap. readers can read them at once.
+		  @param[in]      *log      log of lazurite_openLog
+		  @param[in]      *frames   received frames (lazurite_readBatch, lazurite_getRxFrames ...)
+		  @param[in]      num       number of frames
+		  @return         number of frames written <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_writeLog(LAZURITE_LOG* log, const LAZURITE_FRAME* frames, int num);
+
+		/******************************************************************************/
+		/*! @brief get counters of binary log
+		  @param[in]      *log      log of lazurite_openLog
+		  @param[out]     *stats    counters
+		  @return         0=success <br> -EINVAL = parameter error
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getLogStats(LAZURITE_LOG* log, LAZURITE_LOG_STATS* stats);
+
+		/******************************************************************************/
+		/*! @brief write index of current segment and close binary log
+		  @param[in]      *log      log of lazurite_openLog
+		  @return         0=success <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_closeLog(LAZURITE_LOG* log);
+
+		/******************************************************************************/
+		/*! @brief write received frames to binary log automatically
+		  @param[in]      *log      log of lazurite_openLog. NULL = stop
+		  @return         0=success <br> -EBUSY = rx thread or dispatcher is running
+		  @exception      none
+		  @note  frames got by lazurite_readBatch, lazurite_readFrame, dispatcher and rx thread are
+		  written after filter (lazurite_setFilter). log must not be closed while it is set.
+		 ******************************************************************************/
+		int lazurite_setLog(LAZURITE_LOG* log);
+
+		/******************************************************************************/
+		/*! @brief open binary log to read
+		  all frames are read until lazurite_seekLog is called.
+		  @param[in]      dir      directory of log
+		  @return         reader <br> NULL = fail (errno is set)
+		  @exception      none
+		 ******************************************************************************/
+		LAZURITE_LOG_READER* lazurite_openLogReader(const char* dir);
+
+		/******************************************************************************/
+		/*! @brief start to read frames of query
+		  segments and blocks of index which can not have the frames are skipped.
+		  @param[in]      *reader   reader of lazurite_openLogReader
+		  @param[in]      *query    range of receiving time and tx address
+		  @return         0=success <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_seekLog(LAZURITE_LOG_READER* reader, const LAZURITE_LOG_QUERY* query);
+
+		/******************************************************************************/
+		/*! @brief read frames of query
+		  frames are in order of writing. offsets of mac header are set as lazurite_readBatch.
+		  @param[in]      *reader   reader of lazurite_openLogReader
+		  @param[out]     *frames   array of slots
+		  @param[in]      num       number of slots
+		  @return         number of frames <br> 0 = no more frame <br> 0 > fail
+		  @exception      none
+		  @note  when the log is being written, frames written later are read by next call.
+		 ******************************************************************************/
+		int lazurite_readLog(LAZURITE_LOG_READER* reader, LAZURITE_FRAME* frames, int num);
+
+		/******************************************************************************/
+		/*! @brief close reader of binary log
+		  @param[in]      *reader   reader of lazurite_openLogReader
+		  @return         0=success <br> -EINVAL = parameter error
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_closeLogReader(LAZURITE_LOG_READER* reader);
+
+		/******************************************************************************/
+		/*! @brief write frames as lines of text
+		  one line ('\n' terminated) is written for each frame, and lines are written until
+		  out is full. output is terminated by NULL. printf is not used.
+		  @param[out]     *out      buffer
+		  @param[in,out]  *size     in: bytes of out. out: bytes written (without NULL)
+		  @param[in]      *frames   received frames (lazurite_readBatch, lazurite_getRxFrames ...)
+		  @param[in]      num       number of frames
+		  @param[in]      format    LAZURITE_FORMAT_CSV/LAZURITE_FORMAT_JSONL/LAZURITE_FORMAT_CSV_HEX/LAZURITE_FORMAT_JSONL_HEX
+		  @return         number of frames written <br> 0 > fail (-ENOSPC = 1st frame does not fit)
+		  @exception      none
+		  @note  fields which are not in the frame are empty in CSV and null in JSON.
+		  addresses and PANIDs are hex (0x + 2/4/16 digits). payload of CSV is quoted when it has comma or quote,
+		  and control characters are written as '.'. payload of JSON is escaped (\u00XX out of ASCII).
+		  out of LAZURITE_FORMAT_LINE_MAX bytes always has room for one frame.
+		 ******************************************************************************/
+		int lazurite_formatFrames(char* out, size_t* size, const LAZURITE_FRAME* frames, int num, uint8_t format);
+
+		/******************************************************************************/
+		/*! @brief read one frame as line of CSV
+		  same as one line of lazurite_formatFrames (LAZURITE_FORMAT_CSV) without '\n'.
+		  @param[out]     *stream   text terminated by NULL
+		  @param[in,out]  *size     in: bytes of stream. out: length of text
+		  @return         length of text <br> 0 = no frame <br> 0 > fail (-ENOSPC = stream is too short)
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_readStream(char* stream, uint16_t* size);
+
 		/******************************************************************************/
 		/*! @brief read only payload. header is abandoned.
 		  @param[out]     *payload    memory for payload to be written. need to reserve 250 byte in maximum.
@@ -298,6 +1285,38 @@ namespace lazurite
 		 ******************************************************************************/
 		int lazurite_getTxRssi(void);
 
+		/*! @struct LAZURITE_SEND_MODE
+		  @brief  parameters of send mode
+		 */
+		typedef struct {
+			uint8_t addr_type;	/*!< address type. see lazurite_getAddrType */
+			uint8_t sense_time;	/*!< CCA cycle 0-255(20 in default) */
+			uint8_t tx_retry;	/*!< retry cycle 0-255(3 in default) */
+			uint16_t tx_interval;	/*!< interval to resend(ms) 0-500(500 in default) */
+			uint8_t cca_wait;	/*!< backoff time = 320us * 2^cca_wait. 0-7(7 in default) */
+		} LAZURITE_SEND_MODE;
+
+		/******************************************************************************/
+		/*! @brief get all parameters of send mode
+		  1st call reads them from driver. after that, they are returned from the library
+		  until lazurite_begin/lazurite_close/lazurite_remove.
+		  @param[out]     *mode   parameters of send mode
+		  @return         0=success <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_getSendMode(LAZURITE_SEND_MODE* mode);
+
+		/******************************************************************************/
+		/*! @brief set all parameters of send mode at once
+		  only parameters which are changed are written to driver.
+		  lazurite_setAddrType, lazurite_setSenseTime, lazurite_setTxRetry,
+		  lazurite_setTxInterval and lazurite_setCcaWait are same as this function.
+		  @param[in]      *mode   parameters of send mode
+		  @return         0=success <br> 0 > fail
+		  @exception      none
+		 ******************************************************************************/
+		int lazurite_setSendMode(const LAZURITE_SEND_MODE* mode);
+
 		/******************************************************************************/
 		/*! @brief get address type
 		  @param[in]     none 
@@ -432,6 +1451,88 @@ namespace lazurite
 		******************************************************************************/
 		int lazurite_getEnhanceAck(char* data, uint16_t* size);
 
+		/******************************************************************************/
+		/*! @brief functions for context opened by lazurite_openCtx
+		  same as the function without ctx. see it for parameters and return values.
+		 ******************************************************************************/
+		int lazurite_ctx_link(LAZURITE_CTX* ctx, uint16_t addr);
+		int lazurite_ctx_setLinkMode(LAZURITE_CTX* ctx, uint8_t mode);
+		int lazurite_ctx_addLink(LAZURITE_CTX* ctx, uint16_t addr);
+		int lazurite_ctx_removeLink(LAZURITE_CTX* ctx, uint16_t addr);
+		int lazurite_ctx_addLink64le(LAZURITE_CTX* ctx, uint8_t *addr_le);
+		int lazurite_ctx_removeLink64le(LAZURITE_CTX* ctx, uint8_t *addr_le);
+		int lazurite_ctx_clearLink(LAZURITE_CTX* ctx);
+		int lazurite_ctx_getLinkStats(LAZURITE_CTX* ctx, LAZURITE_LINK_STATS* stats, bool clear);
+		int lazurite_ctx_setRxAddr(LAZURITE_CTX* ctx, uint16_t tmp_rxaddr);
+		int lazurite_ctx_setTxPanid(LAZURITE_CTX* ctx, uint16_t txpanid);
+		int lazurite_ctx_begin(LAZURITE_CTX* ctx, uint8_t ch, uint16_t mypanid, uint8_t rate,uint8_t pwr);
+		int lazurite_ctx_close(LAZURITE_CTX* ctx);
+		int lazurite_ctx_send64be(LAZURITE_CTX* ctx, uint8_t *dst_be,const void* payload, uint16_t length);
+		int lazurite_ctx_send64le(LAZURITE_CTX* ctx, uint8_t *dst_le,const void* payload, uint16_t length);
+		int lazurite_ctx_send(LAZURITE_CTX* ctx, uint16_t rxpanid,uint16_t rxaddr,const void* payload, uint16_t length);
+		int lazurite_ctx_startTxQueue(LAZURITE_CTX* ctx, uint16_t depth, LAZURITE_TX_CALLBACK callback, void* arg);
+		int lazurite_ctx_stopTxQueue(LAZURITE_CTX* ctx);
+		long lazurite_ctx_submit(LAZURITE_CTX* ctx, uint16_t rxpanid,uint16_t rxaddr,const void* payload, uint16_t length);
+		long lazurite_ctx_submit64be(LAZURITE_CTX* ctx, uint8_t *dst_be,const void* payload, uint16_t length);
+		long lazurite_ctx_submit64le(LAZURITE_CTX* ctx, uint8_t *dst_le,const void* payload, uint16_t length);
+		int lazurite_ctx_getTxCompletion(LAZURITE_CTX* ctx, LAZURITE_TX_COMPLETION* completions, int num, int timeout);
+		int lazurite_ctx_rxEnable(LAZURITE_CTX* ctx);
+		int lazurite_ctx_rxDisable(LAZURITE_CTX* ctx);
+		int lazurite_ctx_getMyAddr64(LAZURITE_CTX* ctx, uint8_t *addr);
+		long lazurite_ctx_getMyAddress(LAZURITE_CTX* ctx);
+		int lazurite_ctx_setMyAddress(LAZURITE_CTX* ctx, uint16_t my_addr);
+		unsigned long lazurite_ctx_getIoctlSaved(LAZURITE_CTX* ctx);
+		int lazurite_ctx_write(LAZURITE_CTX* ctx, const char* payload, uint16_t size);
+		int lazurite_ctx_available(LAZURITE_CTX* ctx);
+		int lazurite_ctx_read(LAZURITE_CTX* ctx, void* raw, uint16_t* size);
+		int lazurite_ctx_setFilter(LAZURITE_CTX* ctx, const LAZURITE_FILTER* filter);
+		int lazurite_ctx_setRxInfo(LAZURITE_CTX* ctx, bool on);
+		int lazurite_ctx_readBatch(LAZURITE_CTX* ctx, LAZURITE_FRAME* frames, int num);
+		int lazurite_ctx_readFrame(LAZURITE_CTX* ctx, LAZURITE_FRAME* frame);
+		int lazurite_ctx_getFd(LAZURITE_CTX* ctx);
+		int lazurite_ctx_wait(LAZURITE_CTX* ctx, int timeout);
+		int lazurite_ctx_readTimeout(LAZURITE_CTX* ctx, void* raw, uint16_t* size, int timeout);
+		int lazurite_ctx_startDispatcher(LAZURITE_CTX* ctx, LAZURITE_RX_CALLBACK callback, void* arg);
+		int lazurite_ctx_stopDispatcher(LAZURITE_CTX* ctx);
+		int lazurite_ctx_startRxThread(LAZURITE_CTX* ctx, uint16_t depth, int cpu);
+		int lazurite_ctx_stopRxThread(LAZURITE_CTX* ctx);
+		int lazurite_ctx_getRxFrames(LAZURITE_CTX* ctx, LAZURITE_FRAME* frames, int num, int timeout);
+		int lazurite_ctx_setCapture(LAZURITE_CTX* ctx, LAZURITE_CAPTURE* capture);
+		int lazurite_ctx_readStream(LAZURITE_CTX* ctx, char* stream, uint16_t* size);
+		int lazurite_ctx_setLog(LAZURITE_CTX* ctx, LAZURITE_LOG* log);
+		int lazurite_ctx_setDedup(LAZURITE_CTX* ctx, const LAZURITE_DEDUP_PARAM* param);
+		int lazurite_ctx_getDedupStats(LAZURITE_CTX* ctx, LAZURITE_DEDUP_STATS* stats, bool clear);
+		int lazurite_ctx_setNeighborTable(LAZURITE_CTX* ctx, const LAZURITE_NEIGHBOR_PARAM* param);
+		int lazurite_ctx_getNeighbor(LAZURITE_CTX* ctx, uint16_t addr, LAZURITE_NEIGHBOR* neighbor);
+		int lazurite_ctx_getNeighbor64le(LAZURITE_CTX* ctx, uint8_t *addr_le, LAZURITE_NEIGHBOR* neighbor);
+		int lazurite_ctx_getNeighbors(LAZURITE_CTX* ctx, LAZURITE_NEIGHBOR* neighbors, int num);
+		int lazurite_ctx_getMetrics(LAZURITE_CTX* ctx, LAZURITE_METRICS* metrics);
+		int lazurite_ctx_writeMetrics(LAZURITE_CTX* ctx, const char* path);
+		int lazurite_ctx_shareMetrics(LAZURITE_CTX* ctx, const char* name);
+		int lazurite_ctx_readPayload(LAZURITE_CTX* ctx, char* payload, uint16_t* size);
+		int lazurite_ctx_readLink(LAZURITE_CTX* ctx, char* payload, uint16_t* size);
+		int lazurite_ctx_getRxTime(LAZURITE_CTX* ctx, time_t* tv_sec,long* tv_nsec);
+		int lazurite_ctx_getRxRssi(LAZURITE_CTX* ctx);
+		int lazurite_ctx_getTxRssi(LAZURITE_CTX* ctx);
+		int lazurite_ctx_getSendMode(LAZURITE_CTX* ctx, LAZURITE_SEND_MODE* mode);
+		int lazurite_ctx_setSendMode(LAZURITE_CTX* ctx, const LAZURITE_SEND_MODE* mode);
+		int lazurite_ctx_getAddrType(LAZURITE_CTX* ctx);
+		int lazurite_ctx_setAddrType(LAZURITE_CTX* ctx, uint8_t addr_type);
+		int lazurite_ctx_getSenseTime(LAZURITE_CTX* ctx);
+		int lazurite_ctx_setSenseTime(LAZURITE_CTX* ctx, uint8_t senseTime);
+		int lazurite_ctx_getTxRetry(LAZURITE_CTX* ctx);
+		int lazurite_ctx_setTxRetry(LAZURITE_CTX* ctx, uint8_t retry);
+		int lazurite_ctx_getTxInterval(LAZURITE_CTX* ctx);
+		int lazurite_ctx_setTxInterval(LAZURITE_CTX* ctx, uint16_t txinterval);
+		int lazurite_ctx_getCcaWait(LAZURITE_CTX* ctx);
+		int lazurite_ctx_setCcaWait(LAZURITE_CTX* ctx, uint8_t ccawait);
+		int lazurite_ctx_setPromiscuous(LAZURITE_CTX* ctx, bool on);
+		int lazurite_ctx_setAckReq(LAZURITE_CTX* ctx, bool on);
+		int lazurite_ctx_setBroadcastEnb(LAZURITE_CTX* ctx, bool on);
+		int lazurite_ctx_setKey(LAZURITE_CTX* ctx, char *key);
+		int lazurite_ctx_setEnhanceAck(LAZURITE_CTX* ctx, uint8_t *data, uint16_t size);
+		int lazurite_ctx_getEnhanceAck(LAZURITE_CTX* ctx, char* data, uint16_t* size);
+
 #ifdef __cplusplus
 	};
 };
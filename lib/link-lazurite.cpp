@@ -0,0 +1,120 @@
+/*!
+  @file link-lazurite.cpp
+  @brief set of source addresses for lazurite_readLink <br>
+  open addressing with linear probing. tables are doubled when they become half full,
+  and removing shifts following entries back instead of leaving tombstones.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include "link-lazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define LINK_MIN_SLOTS	16		/*!< slots of table allocated first */
+
+	static inline uint32_t link_hash(uint16_t addr) { return link_hash16(addr); }
+	static inline uint32_t link_hash(uint64_t addr) { return link_hash64(addr); }
+
+	/******************************************************************************/
+	/*! @brief insert to table which has empty slot
+	  @return         true = inserted <br> false = addr is already in table
+	 ******************************************************************************/
+	template<typename T>
+	static bool link_insert(T *table, uint32_t mask, T addr, T empty)
+	{
+		uint32_t i;
+		for(i = link_hash(addr) & mask;table[i] != empty;i = (i + 1) & mask) {
+			if(table[i] == addr) return false;
+		}
+		table[i] = addr;
+		return true;
+	}
+
+	template<typename T>
+	static int link_add(T **table, uint32_t *mask, uint32_t *num, T addr, T empty)
+	{
+		T *old = *table;
+		T *grown;
+		uint32_t slots, i;
+
+		if(addr == empty) return -EINVAL;
+		if((*num + 1) * 2 > (old ? *mask + 1 : 0)) {
+			slots = old ? (*mask + 1) * 2 : LINK_MIN_SLOTS;
+			grown = (T*)malloc(sizeof(T) * slots);
+			if(!grown) return -ENOMEM;
+			for(i=0;i<slots;i++) grown[i] = empty;
+			if(old) {
+				for(i=0;i<=*mask;i++) {
+					if(old[i] != empty) link_insert(grown,slots - 1,old[i],empty);
+				}
+				free(old);
+			}
+			*table = grown;
+			*mask = slots - 1;
+		}
+		if(link_insert(*table,*mask,addr,empty)) (*num)++;
+		return 0;
+	}
+
+	template<typename T>
+	static int link_remove(T *table, uint32_t mask, uint32_t *num, T addr, T empty)
+	{
+		uint32_t i, j, home;
+
+		if(!*num || (addr == empty)) return -ENOENT;
+		for(i = link_hash(addr) & mask;table[i] != addr;i = (i + 1) & mask) {
+			if(table[i] == empty) return -ENOENT;
+		}
+		// move back entries whose home slot is not between the hole and themselves
+		for(j = (i + 1) & mask;table[j] != empty;j = (j + 1) & mask) {
+			home = link_hash(table[j]) & mask;
+			if(((j - home) & mask) >= ((j - i) & mask)) {
+				table[i] = table[j];
+				i = j;
+			}
+		}
+		table[i] = empty;
+		(*num)--;
+		return 0;
+	}
+
+	int link_add16(LINK_SET *set, uint16_t addr)
+	{
+		return link_add<uint16_t>(&set->addr16,&set->mask16,&set->num16,addr,LINK_EMPTY16);
+	}
+
+	int link_add64(LINK_SET *set, uint64_t addr)
+	{
+		return link_add<uint64_t>(&set->addr64,&set->mask64,&set->num64,addr,LINK_EMPTY64);
+	}
+
+	int link_remove16(LINK_SET *set, uint16_t addr)
+	{
+		return link_remove<uint16_t>(set->addr16,set->mask16,&set->num16,addr,LINK_EMPTY16);
+	}
+
+	int link_remove64(LINK_SET *set, uint64_t addr)
+	{
+		return link_remove<uint64_t>(set->addr64,set->mask64,&set->num64,addr,LINK_EMPTY64);
+	}
+
+	void link_clear(LINK_SET *set)
+	{
+		free(set->addr16);
+		free(set->addr64);
+		set->addr16 = NULL;
+		set->mask16 = 0;
+		set->num16 = 0;
+		set->addr64 = NULL;
+		set->mask64 = 0;
+		set->num64 = 0;
+	}
+
+#ifdef __cplusplus
+};
+#endif
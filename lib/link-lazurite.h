@@ -0,0 +1,97 @@
+/*!
+  @file link-lazurite.h
+  @brief set of source addresses for lazurite_readLink <br>
+  internal use only. not installed.
+
+  16bit and 64bit addresses are kept in separate open addressing tables
+  (linear probing, at most half full), so a lookup is a few adjacent loads.
+ */
+#ifndef _LINK_LAZURITE_H_
+#define _LINK_LAZURITE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define LINK_EMPTY16	0xffff		/*!< empty slot. broadcast address can not be in the set */
+#define LINK_EMPTY64	(~0ULL)		/*!< empty slot */
+
+	/*! @struct LINK_SET
+	  @brief internal use only
+	  set of source addresses. all members are 0 when the set is empty.
+	  */
+	typedef struct {
+		uint16_t *addr16;
+		uint32_t mask16;		/*!< number of slots - 1. 0 = not allocated */
+		uint32_t num16;
+		uint64_t *addr64;		/*!< little endian value of 64bit address */
+		uint32_t mask64;
+		uint32_t num64;
+	} LINK_SET;
+
+	static inline uint32_t link_hash16(uint16_t addr)
+	{
+		uint32_t h = addr * 0x9e3779b1U;
+		return h ^ (h >> 16);
+	}
+
+	static inline uint32_t link_hash64(uint64_t addr)
+	{
+		return (uint32_t)((addr * 0x9e3779b97f4a7c15ULL) >> 32);
+	}
+
+	/******************************************************************************/
+	/*! @brief find 16bit address
+	  @return         true = addr is in the set
+	 ******************************************************************************/
+	static inline bool link_find16(const LINK_SET *set, uint16_t addr)
+	{
+		uint32_t i;
+		if(!set->num16 || (addr == LINK_EMPTY16)) return false;
+		for(i = link_hash16(addr) & set->mask16;;i = (i + 1) & set->mask16) {
+			if(set->addr16[i] == addr) return true;
+			if(set->addr16[i] == LINK_EMPTY16) return false;
+		}
+	}
+
+	/******************************************************************************/
+	/*! @brief find 64bit address
+	  @return         true = addr is in the set
+	 ******************************************************************************/
+	static inline bool link_find64(const LINK_SET *set, uint64_t addr)
+	{
+		uint32_t i;
+		if(!set->num64 || (addr == LINK_EMPTY64)) return false;
+		for(i = link_hash64(addr) & set->mask64;;i = (i + 1) & set->mask64) {
+			if(set->addr64[i] == addr) return true;
+			if(set->addr64[i] == LINK_EMPTY64) return false;
+		}
+	}
+
+	/******************************************************************************/
+	/*! @brief add address to the set
+	  @return         0=success <br> -EINVAL = addr is empty marker <br> -ENOMEM
+	 ******************************************************************************/
+	extern int link_add16(LINK_SET *set, uint16_t addr);
+	extern int link_add64(LINK_SET *set, uint64_t addr);
+
+	/******************************************************************************/
+	/*! @brief remove address from the set
+	  @return         0=success <br> -ENOENT = addr is not in the set
+	 ******************************************************************************/
+	extern int link_remove16(LINK_SET *set, uint16_t addr);
+	extern int link_remove64(LINK_SET *set, uint64_t addr);
+
+	/******************************************************************************/
+	/*! @brief remove all addresses and free the tables
+	 ******************************************************************************/
+	extern void link_clear(LINK_SET *set);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif	// _LINK_LAZURITE_H_
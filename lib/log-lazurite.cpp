@@ -0,0 +1,821 @@
+/*!
+  @file log-lazurite.cpp
+  @brief binary log of received frames for liblazurite <br>
+  used by lazurite_openLog, lazurite_writeLog, lazurite_setLog and lazurite_openLogReader.
+
+  a log is a directory of segments (NNNNNNNNNN.lzlog). segments are only appended. records are
+  copied into the segment mapped by mmap, and the length in the segment header is
+  updated after them, so readers in other processes never see a half written record.
+  when a segment is full (or the log is closed), a sparse index is appended and the
+  segment is sealed.
+
+  part of a segment | contents
+  ------------------| --------
+  header            | LOG_SEGMENT (64 bytes)
+  records           | LOG_RECORD (40 bytes) + raw frame, aligned by 8 bytes
+  index (sealed)    | LOG_BLOCK x blocks, LOG_SOURCE x sources, block numbers of sources
+
+  one block is index_interval records. LOG_BLOCK has offset and range of receiving time
+  of the block, and LOG_SOURCE lists the blocks which have frames from the source address.
+  reader skips segments and blocks which can not match the query, and scans the rest.
+  segment which is not sealed yet is scanned from top.<br>
+  values are written in byte order of host.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "liblazurite.h"
+#include "mac-lazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define LOG_MAGIC				"LZLOG01\n"
+#define LOG_SUFFIX				".lzlog"
+#define LOG_PATH_SIZE			(PATH_MAX + 32)		/*!< dir, "/", 20 digits of number and LOG_SUFFIX */
+#define LOG_SEGMENT_SIZE		(64 * 1024 * 1024)	/*!< default of segment_size */
+#define LOG_INDEX_INTERVAL		256					/*!< default of index_interval */
+#define LOG_ALIGN(n)			(((n) + 7) & ~7)
+#define LOG_SEALED				0x0001				/*!< index is written */
+#define LOG_HAS_SEQ				0x01				/*!< flags of record */
+#define LOG_NO_ADDR				(~0ULL)
+
+	/*! @struct LOG_SEGMENT
+	  @brief internal use only
+	  header of segment
+	  */
+	typedef struct {
+		char magic[8];
+		uint32_t header_len;
+		uint32_t flags;			/*!< LOG_SEALED */
+		uint64_t used;			/*!< end of records. updated after records are written */
+		int64_t min_time;		/*!< nsec. valid when sealed */
+		int64_t max_time;
+		uint64_t index_offset;
+		uint32_t records;
+		uint32_t interval;		/*!< records of one block */
+		uint32_t blocks;
+		uint32_t sources;
+	} LOG_SEGMENT;
+
+	/*! @struct LOG_RECORD
+	  @brief internal use only
+	  fixed header of one frame. raw frame follows.
+	  addresses are little endian values of the address, LOG_NO_ADDR = not in the frame.
+	  */
+	typedef struct {
+		uint16_t record_len;	/*!< with raw and padding */
+		uint16_t len;			/*!< length of raw */
+		uint8_t rssi;
+		uint8_t seq_num;
+		uint8_t addr_type;
+		uint8_t flags;			/*!< LOG_HAS_SEQ */
+		int64_t time;			/*!< receiving time (nsec) */
+		uint64_t src_addr;
+		uint64_t dst_addr;
+		uint16_t src_panid;		/*!< 0xffff = not in the frame */
+		uint16_t dst_panid;
+		uint32_t reserved;
+	} LOG_RECORD;
+
+	typedef struct {
+		uint64_t offset;		/*!< 1st record of block */
+		int64_t min_time;
+		int64_t max_time;
+	} LOG_BLOCK;
+
+	typedef struct {
+		uint64_t addr;
+		uint32_t first;			/*!< index of block numbers */
+		uint32_t count;
+	} LOG_SOURCE;
+
+	typedef struct {
+		uint64_t addr;
+		uint32_t block;
+	} LOG_PAIR;
+
+	struct lazurite_log {
+		char dir[PATH_MAX];
+		LAZURITE_LOG_PARAM param;
+		pthread_mutex_t lock;
+		unsigned long number;	/*!< number of current segment */
+		int fd;
+		uint8_t *map;
+		uint64_t used;
+		uint32_t records;
+		int64_t min_time;
+		int64_t max_time;
+		LOG_BLOCK *block;
+		uint32_t blocks;
+		uint32_t block_alloc;
+		LOG_PAIR *pair;			/*!< sources of each block */
+		uint32_t pairs;
+		uint32_t pair_alloc;
+		uint64_t *seen;			/*!< sources in current block (open addressing) */
+		uint32_t seen_mask;
+		LAZURITE_LOG_STATS stats;
+	};
+
+	struct lazurite_log_reader {
+		char dir[PATH_MAX];
+		int64_t from;
+		int64_t to;
+		uint64_t src_addr;
+		unsigned long *segment;	/*!< numbers of segments */
+		size_t segments;
+		size_t current;
+		int fd;
+		const uint8_t *map;
+		size_t map_size;
+		const LOG_SEGMENT *head;
+		bool sealed;
+		const LOG_BLOCK *block;
+		const uint32_t *block_id;	/*!< blocks of source. NULL = all blocks */
+		uint32_t block_count;
+		uint32_t block_pos;
+		uint64_t cursor;
+		uint64_t end;
+	};
+
+	static void log_path(char *path, const char *dir, unsigned long number)
+	{
+		snprintf(path,LOG_PATH_SIZE,"%s/%010lu" LOG_SUFFIX,dir,number);
+	}
+
+	/******************************************************************************/
+	/*! @brief numbers of segments in directory
+	  @param[in]      after    segments which are larger than this
+	  @return         number of segments <br> 0 > fail
+	 ******************************************************************************/
+	static int log_list(const char *dir, unsigned long after, bool all, unsigned long **list)
+	{
+		DIR *d;
+		struct dirent *e;
+		unsigned long number, *grown;
+		char *end;
+		size_t num = 0, alloc = 0;
+		size_t i, j;
+
+		*list = NULL;
+		d = opendir(dir);
+		if(!d) return -errno;
+		while((e = readdir(d))) {
+			number = strtoul(e->d_name,&end,10);
+			if((end == e->d_name) || strcmp(end,LOG_SUFFIX)) continue;
+			if(!all && (number <= after)) continue;
+			if(num == alloc) {
+				alloc = alloc ? alloc * 2 : 64;
+				grown = (unsigned long*)realloc(*list,sizeof(unsigned long) * alloc);
+				if(!grown) {
+					closedir(d);
+					free(*list);
+					*list = NULL;
+					return -ENOMEM;
+				}
+				*list = grown;
+			}
+			(*list)[num++] = number;
+		}
+		closedir(d);
+		// insertion sort. names are read almost in order
+		for(i=1;i<num;i++) {
+			number = (*list)[i];
+			for(j=i;(j>0) && ((*list)[j-1] > number);j--) (*list)[j] = (*list)[j-1];
+			(*list)[j] = number;
+		}
+		return num;
+	}
+
+	/******************************************************************************/
+	/*! @brief address in frame as little endian value
+	 ******************************************************************************/
+	static inline uint64_t log_addr(const uint8_t *raw, uint8_t offset, uint8_t len)
+	{
+		switch(len) {
+			case 0:
+				return LOG_NO_ADDR;
+			case 1:
+				return raw[offset];
+			case 2:
+				return mac_load16(raw + offset);
+			default:
+				return mac_load64(raw + offset);
+		}
+	}
+
+	/******************************************************************************/
+	/*! @brief create next segment
+	  @return         0=success <br> 0 > fail
+	 ******************************************************************************/
+	static int log_create(LAZURITE_LOG *log)
+	{
+		char path[LOG_PATH_SIZE];
+		LOG_SEGMENT *head;
+		int result;
+
+		log->number++;
+		log_path(path,log->dir,log->number);
+		log->fd = open(path,O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC,0644);
+		if(log->fd < 0) return -errno;
+		// blocks are reserved, so writing to the map never fails by full disk
+		result = posix_fallocate(log->fd,0,log->param.segment_size);
+		if(result == 0) {
+			log->map = (uint8_t*)mmap(NULL,log->param.segment_size,PROT_READ | PROT_WRITE,MAP_SHARED,log->fd,0);
+			if(log->map == MAP_FAILED) {
+				log->map = NULL;
+				result = errno;
+			}
+		}
+		if(result) {
+			close(log->fd);
+			log->fd = -1;
+			unlink(path);
+			return -result;
+		}
+		head = (LOG_SEGMENT*)log->map;
+		memcpy(head->magic,LOG_MAGIC,sizeof(head->magic));
+		head->header_len = sizeof(LOG_SEGMENT);
+		head->interval = log->param.index_interval;
+		log->used = sizeof(LOG_SEGMENT);
+		__atomic_store_n(&head->used,log->used,__ATOMIC_RELEASE);
+		log->records = 0;
+		log->blocks = 0;
+		log->pairs = 0;
+		log->min_time = INT64_MAX;
+		log->max_time = INT64_MIN;
+		log->stats.segments++;
+		return 0;
+	}
+
+	static int log_comparePair(const void *a, const void *b)
+	{
+		const LOG_PAIR *x = (const LOG_PAIR*)a;
+		const LOG_PAIR *y = (const LOG_PAIR*)b;
+		if(x->addr != y->addr) return x->addr < y->addr ? -1 : 1;
+		return (x->block > y->block) - (x->block < y->block);
+	}
+
+	/******************************************************************************/
+	/*! @brief write index and seal current segment
+	  @return         0=success <br> 0 > fail
+	 ******************************************************************************/
+	static int log_seal(LAZURITE_LOG *log)
+	{
+		char path[LOG_PATH_SIZE];
+		LOG_SEGMENT *head = (LOG_SEGMENT*)log->map;
+		LOG_SOURCE *source = NULL;
+		uint32_t *block_id = NULL;
+		uint64_t index_offset = LOG_ALIGN(log->used);
+		uint32_t sources = 0;
+		uint32_t i;
+		size_t len;
+		int result = 0;
+
+		if(log->fd < 0) return 0;
+		if(log->records == 0) {
+			// nothing is written
+			munmap(log->map,log->param.segment_size);
+			close(log->fd);
+			log_path(path,log->dir,log->number);
+			unlink(path);
+			log->map = NULL;
+			log->fd = -1;
+			log->number--;
+			log->stats.segments--;
+			return 0;
+		}
+
+		qsort(log->pair,log->pairs,sizeof(LOG_PAIR),log_comparePair);
+		source = (LOG_SOURCE*)malloc(sizeof(LOG_SOURCE) * (log->pairs + 1));
+		block_id = (uint32_t*)malloc(sizeof(uint32_t) * (log->pairs + 1));
+		if(!source || !block_id) {
+			result = -ENOMEM;
+		} else {
+			for(i=0;i<log->pairs;i++) {
+				if(!sources || (source[sources - 1].addr != log->pair[i].addr)) {
+					source[sources].addr = log->pair[i].addr;
+					source[sources].first = i;
+					source[sources].count = 0;
+					sources++;
+				}
+				source[sources - 1].count++;
+				block_id[i] = log->pair[i].block;
+			}
+			len = sizeof(LOG_BLOCK) * log->blocks;
+			if(pwrite(log->fd,log->block,len,index_offset) != (ssize_t)len) result = -errno;
+			else if(pwrite(log->fd,source,sizeof(LOG_SOURCE) * sources,index_offset + len) != (ssize_t)(sizeof(LOG_SOURCE) * sources)) result = -errno;
+			else if(pwrite(log->fd,block_id,sizeof(uint32_t) * log->pairs,index_offset + len + sizeof(LOG_SOURCE) * sources) !=
+					(ssize_t)(sizeof(uint32_t) * log->pairs)) result = -errno;
+		}
+		free(source);
+		free(block_id);
+
+		if(!result) {
+			head->min_time = log->min_time;
+			head->max_time = log->max_time;
+			head->index_offset = index_offset;
+			head->records = log->records;
+			head->blocks = log->blocks;
+			head->sources = sources;
+			__atomic_store_n(&head->used,log->used,__ATOMIC_RELEASE);
+			__atomic_store_n(&head->flags,head->flags | LOG_SEALED,__ATOMIC_RELEASE);
+		}
+		munmap(log->map,log->param.segment_size);
+		// reserved space after index is released
+		len = index_offset + sizeof(LOG_BLOCK) * log->blocks + sizeof(LOG_SOURCE) * sources + sizeof(uint32_t) * log->pairs;
+		if(!result && (len < log->param.segment_size) && (ftruncate(log->fd,len) != 0)) result = -errno;
+		close(log->fd);
+		log->map = NULL;
+		log->fd = -1;
+		if(result) log->stats.error = result;
+		return result;
+	}
+
+	/******************************************************************************/
+	/*! @brief append one frame to current segment. log->lock must be held.
+	 ******************************************************************************/
+	static int log_append(LAZURITE_LOG *log, const LAZURITE_FRAME *frame)
+	{
+		LOG_RECORD *record;
+		const MAC_LAYOUT *layout;
+		const uint8_t *raw = frame->raw;
+		struct timespec ts;
+		uint32_t record_len = LOG_ALIGN(sizeof(LOG_RECORD) + frame->len);
+		uint32_t slot;
+		void *grown;
+		int result;
+
+		if(log->used + record_len > log->param.segment_size) {
+			result = log_seal(log);
+			if(!result) result = log_create(log);
+			if(result) return result;
+		}
+		if((log->records % log->param.index_interval) == 0) {
+			if(log->blocks == log->block_alloc) {
+				grown = realloc(log->block,sizeof(LOG_BLOCK) * (log->block_alloc ? log->block_alloc * 2 : 256));
+				if(!grown) return -ENOMEM;
+				log->block = (LOG_BLOCK*)grown;
+				log->block_alloc = log->block_alloc ? log->block_alloc * 2 : 256;
+			}
+			log->block[log->blocks].offset = log->used;
+			log->block[log->blocks].min_time = INT64_MAX;
+			log->block[log->blocks].max_time = INT64_MIN;
+			log->blocks++;
+			memset(log->seen,0xff,sizeof(uint64_t) * (log->seen_mask + 1));
+		}
+
+		record = (LOG_RECORD*)(log->map + log->used);
+		record->record_len = record_len;
+		record->len = frame->len;
+		record->rssi = frame->rssi;
+		record->flags = 0;
+		record->reserved = 0;
+		if(frame->tv_sec == 0) {
+			clock_gettime(CLOCK_REALTIME,&ts);
+			record->time = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+		} else {
+			record->time = (int64_t)frame->tv_sec * 1000000000 + frame->tv_nsec;
+		}
+		if((frame->len >= 2) && (frame->len >= (layout = mac_getLayout(raw))->header_len)) {
+			record->addr_type = layout->addr_type;
+			if(layout->seq_offset) record->flags |= LOG_HAS_SEQ;
+			record->seq_num = layout->seq_offset ? raw[layout->seq_offset] : 0;
+			record->src_addr = log_addr(raw,layout->src_addr_offset,layout->src_addr_len);
+			record->dst_addr = log_addr(raw,layout->dst_addr_offset,layout->dst_addr_len);
+			record->src_panid = layout->src_panid_offset ? mac_load16(raw + layout->src_panid_offset) : 0xffff;
+			record->dst_panid = layout->dst_panid_offset ? mac_load16(raw + layout->dst_panid_offset) : 0xffff;
+		} else {
+			record->addr_type = 0;
+			record->seq_num = 0;
+			record->src_addr = LOG_NO_ADDR;
+			record->dst_addr = LOG_NO_ADDR;
+			record->src_panid = 0xffff;
+			record->dst_panid = 0xffff;
+		}
+		memcpy(record + 1,raw,frame->len);
+
+		// index
+		if(record->time < log->block[log->blocks - 1].min_time) log->block[log->blocks - 1].min_time = record->time;
+		if(record->time > log->block[log->blocks - 1].max_time) log->block[log->blocks - 1].max_time = record->time;
+		if(record->time < log->min_time) log->min_time = record->time;
+		if(record->time > log->max_time) log->max_time = record->time;
+		if(record->src_addr != LOG_NO_ADDR) {
+			slot = (record->src_addr * 0x9E3779B97F4A7C15ULL) >> 40;
+			for(;;) {
+				slot &= log->seen_mask;
+				if(log->seen[slot] == record->src_addr) break;
+				if(log->seen[slot] == LOG_NO_ADDR) {
+					log->seen[slot] = record->src_addr;
+					if(log->pairs == log->pair_alloc) {
+						grown = realloc(log->pair,sizeof(LOG_PAIR) * (log->pair_alloc ? log->pair_alloc * 2 : 1024));
+						if(!grown) return -ENOMEM;
+						log->pair = (LOG_PAIR*)grown;
+						log->pair_alloc = log->pair_alloc ? log->pair_alloc * 2 : 1024;
+					}
+					log->pair[log->pairs].addr = record->src_addr;
+					log->pair[log->pairs].block = log->blocks - 1;
+					log->pairs++;
+					break;
+				}
+				slot++;
+			}
+		}
+		log->used += record_len;
+		log->records++;
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief open log to write
+	  @param[in]      dir      directory of segments. created when it does not exist.
+	  @param[in]      *param   parameters. NULL = default
+	  @return         log <br> NULL = fail (errno is set)
+	  @exception      none
+	 ******************************************************************************/
+	extern "C" LAZURITE_LOG* lazurite_openLog(const char* dir, const LAZURITE_LOG_PARAM* param)
+	{
+		LAZURITE_LOG *log;
+		unsigned long *list;
+		uint32_t size;
+		int num;
+		int result;
+
+		if(!dir || (strlen(dir) >= PATH_MAX - 32)) {
+			errno = EINVAL;
+			return NULL;
+		}
+		if((mkdir(dir,0755) != 0) && (errno != EEXIST)) return NULL;
+		log = (LAZURITE_LOG*)calloc(1,sizeof(LAZURITE_LOG));
+		if(!log) return NULL;
+		strcpy(log->dir,dir);
+		if(param) log->param = *param;
+		if(!log->param.segment_size) log->param.segment_size = LOG_SEGMENT_SIZE;
+		if(!log->param.index_interval) log->param.index_interval = LOG_INDEX_INTERVAL;
+		if((log->param.segment_size < sizeof(LOG_SEGMENT) + LOG_ALIGN(sizeof(LOG_RECORD) + 256)) ||
+				(log->param.index_interval > 65536)) {
+			free(log);
+			errno = EINVAL;
+			return NULL;
+		}
+		for(size=2;size<log->param.index_interval * 2;size*=2);
+		log->seen_mask = size - 1;
+		log->seen = (uint64_t*)malloc(sizeof(uint64_t) * size);
+		log->fd = -1;
+
+		// segments are never reopened. new segment follows the last one
+		num = log_list(dir,0,true,&list);
+		if(num > 0) log->number = list[num - 1];
+		free(list);
+		result = log->seen ? (num < 0 ? num : log_create(log)) : -ENOMEM;
+		if(result) {
+			free(log->seen);
+			free(log);
+			errno = -result;
+			return NULL;
+		}
+		pthread_mutex_init(&log->lock,NULL);
+		return log;
+	}
+
+	/******************************************************************************/
+	/*! @brief append frames to log
+	  @return         number of frames written <br> 0 > fail
+	 ******************************************************************************/
+	extern "C" int lazurite_writeLog(LAZURITE_LOG* log, const LAZURITE_FRAME* frames, int num)
+	{
+		LOG_SEGMENT *head;
+		int result = 0;
+		int i;
+
+		if(!log || !frames || (num < 0)) return -EINVAL;
+		pthread_mutex_lock(&log->lock);
+		if(log->fd < 0) {
+			pthread_mutex_unlock(&log->lock);
+			return log->stats.error ? log->stats.error : -EBADF;
+		}
+		for(i=0;i<num;i++) {
+			result = log_append(log,&frames[i]);
+			if(result) break;
+			log->stats.frames++;
+			log->stats.bytes += frames[i].len;
+		}
+		// publish records to readers
+		head = (LOG_SEGMENT*)log->map;
+		if(head) __atomic_store_n(&head->used,log->used,__ATOMIC_RELEASE);
+		if(result) log->stats.error = result;
+		pthread_mutex_unlock(&log->lock);
+		return i ? i : result;
+	}
+
+	/******************************************************************************/
+	/*! @brief get counters of log
+	  @return         0=success <br> -EINVAL = parameter error
+	 ******************************************************************************/
+	extern "C" int lazurite_getLogStats(LAZURITE_LOG* log, LAZURITE_LOG_STATS* stats)
+	{
+		if(!log || !stats) return -EINVAL;
+		pthread_mutex_lock(&log->lock);
+		*stats = log->stats;
+		pthread_mutex_unlock(&log->lock);
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief seal current segment and close log
+	  @return         0=success <br> 0 > fail
+	 ******************************************************************************/
+	extern "C" int lazurite_closeLog(LAZURITE_LOG* log)
+	{
+		int result;
+
+		if(!log) return -EINVAL;
+		result = log_seal(log);
+		pthread_mutex_destroy(&log->lock);
+		free(log->block);
+		free(log->pair);
+		free(log->seen);
+		free(log);
+		return result;
+	}
+
+	/******************************************************************************/
+	/*! @brief unmap segment of reader
+	 ******************************************************************************/
+	static void log_unmap(LAZURITE_LOG_READER *reader)
+	{
+		if(reader->map) munmap((void*)reader->map,reader->map_size);
+		if(reader->fd >= 0) close(reader->fd);
+		reader->map = NULL;
+		reader->fd = -1;
+	}
+
+	/******************************************************************************/
+	/*! @brief map segment and decide blocks to be scanned
+	  @return         true = segment may have frames of query
+	 ******************************************************************************/
+	static bool log_map(LAZURITE_LOG_READER *reader, unsigned long number)
+	{
+		char path[LOG_PATH_SIZE];
+		const LOG_SEGMENT *head;
+		const LOG_SOURCE *source;
+		struct stat st;
+		uint64_t index_len;
+		uint32_t lo, hi, mid;
+
+		log_path(path,reader->dir,number);
+		reader->fd = open(path,O_RDONLY | O_CLOEXEC);
+		if(reader->fd < 0) return false;
+		if((fstat(reader->fd,&st) != 0) || ((size_t)st.st_size < sizeof(LOG_SEGMENT))) {
+			log_unmap(reader);
+			return false;
+		}
+		reader->map_size = st.st_size;
+		reader->map = (const uint8_t*)mmap(NULL,reader->map_size,PROT_READ,MAP_SHARED,reader->fd,0);
+		if(reader->map == MAP_FAILED) {
+			reader->map = NULL;
+			log_unmap(reader);
+			return false;
+		}
+		head = reader->head = (const LOG_SEGMENT*)reader->map;
+		if(memcmp(head->magic,LOG_MAGIC,sizeof(head->magic)) || (head->header_len < sizeof(LOG_SEGMENT))) {
+			log_unmap(reader);
+			return false;
+		}
+		reader->sealed = __atomic_load_n(&head->flags,__ATOMIC_ACQUIRE) & LOG_SEALED;
+		reader->block_pos = 0;
+		reader->cursor = reader->end = head->header_len;
+		if(!reader->sealed) return true;
+
+		index_len = sizeof(LOG_BLOCK) * (uint64_t)head->blocks + sizeof(LOG_SOURCE) * (uint64_t)head->sources;
+		if((head->index_offset + index_len > reader->map_size) || (head->used > head->index_offset)) {
+			// broken index. records are scanned
+			reader->sealed = false;
+			return true;
+		}
+		if((head->max_time < reader->from) || (head->min_time > reader->to)) {
+			log_unmap(reader);
+			return false;
+		}
+		reader->block = (const LOG_BLOCK*)(reader->map + head->index_offset);
+		reader->block_id = NULL;
+		reader->block_count = head->blocks;
+		if(reader->src_addr == LOG_NO_ADDR) return true;
+
+		// blocks of the source
+		source = (const LOG_SOURCE*)(reader->block + head->blocks);
+		lo = 0;
+		hi = head->sources;
+		while(lo < hi) {
+			mid = (lo + hi) / 2;
+			if(source[mid].addr < reader->src_addr) lo = mid + 1;
+			else hi = mid;
+		}
+		if((lo == head->sources) || (source[lo].addr != reader->src_addr) ||
+				((uint8_t*)((const uint32_t*)(source + head->sources) + source[lo].first + source[lo].count) >
+				 reader->map + reader->map_size)) {
+			log_unmap(reader);
+			return false;
+		}
+		reader->block_id = (const uint32_t*)(source + head->sources) + source[lo].first;
+		reader->block_count = source[lo].count;
+		return true;
+	}
+
+	/******************************************************************************/
+	/*! @brief range of next block to be scanned
+	  @return         true = cursor and end are set
+	 ******************************************************************************/
+	static bool log_nextBlock(LAZURITE_LOG_READER *reader)
+	{
+		const LOG_SEGMENT *head = reader->head;
+		uint64_t used;
+		uint32_t id;
+
+		if(!reader->sealed) {
+			// records written after last call
+			used = __atomic_load_n(&head->used,__ATOMIC_ACQUIRE);
+			if(used > reader->map_size) used = reader->map_size;
+			if(used <= reader->end) return false;
+			reader->end = used;
+			return true;
+		}
+		while(reader->block_pos < reader->block_count) {
+			id = reader->block_id ? reader->block_id[reader->block_pos] : reader->block_pos;
+			reader->block_pos++;
+			if(id >= head->blocks) continue;
+			if((reader->block[id].max_time < reader->from) || (reader->block[id].min_time > reader->to)) continue;
+			reader->cursor = reader->block[id].offset;
+			reader->end = (id + 1 < head->blocks) ? reader->block[id + 1].offset : head->used;
+			if(reader->end > head->index_offset) reader->end = head->index_offset;
+			return true;
+		}
+		return false;
+	}
+
+	/******************************************************************************/
+	/*! @brief add segments created after the last one of reader
+	  @return         number of segments added <br> 0 > fail
+	 ******************************************************************************/
+	static int log_refresh(LAZURITE_LOG_READER *reader)
+	{
+		unsigned long *list, *grown;
+		int num;
+
+		num = log_list(reader->dir,reader->segments ? reader->segment[reader->segments - 1] : 0,
+				reader->segments == 0,&list);
+		if(num <= 0) return num;
+		grown = (unsigned long*)realloc(reader->segment,sizeof(unsigned long) * (reader->segments + num));
+		if(!grown) {
+			free(list);
+			return -ENOMEM;
+		}
+		memcpy(grown + reader->segments,list,sizeof(unsigned long) * num);
+		free(list);
+		reader->segment = grown;
+		reader->segments += num;
+		return num;
+	}
+
+	/******************************************************************************/
+	/*! @brief open log to read
+	  @param[in]      dir      directory of segments
+	  @return         reader <br> NULL = fail (errno is set)
+	  @exception      none
+	 ******************************************************************************/
+	extern "C" LAZURITE_LOG_READER* lazurite_openLogReader(const char* dir)
+	{
+		LAZURITE_LOG_READER *reader;
+		LAZURITE_LOG_QUERY query;
+		struct stat st;
+
+		if(!dir || (strlen(dir) >= PATH_MAX - 32)) {
+			errno = EINVAL;
+			return NULL;
+		}
+		if(stat(dir,&st) != 0) return NULL;
+		reader = (LAZURITE_LOG_READER*)calloc(1,sizeof(LAZURITE_LOG_READER));
+		if(!reader) return NULL;
+		strcpy(reader->dir,dir);
+		reader->fd = -1;
+		memset(&query,0,sizeof(query));
+		query.src_addr = LOG_NO_ADDR;
+		lazurite_seekLog(reader,&query);
+		return reader;
+	}
+
+	/******************************************************************************/
+	/*! @brief start query
+	  @return         0=success <br> 0 > fail
+	 ******************************************************************************/
+	extern "C" int lazurite_seekLog(LAZURITE_LOG_READER* reader, const LAZURITE_LOG_QUERY* query)
+	{
+		unsigned long *list;
+		int num;
+
+		if(!reader || !query) return -EINVAL;
+		log_unmap(reader);
+		reader->from = (int64_t)query->from_sec * 1000000000 + query->from_nsec;
+		reader->to = ((query->to_sec == 0) && (query->to_nsec == 0)) ? INT64_MAX :
+			(int64_t)query->to_sec * 1000000000 + query->to_nsec;
+		reader->src_addr = query->src_addr;
+		num = log_list(reader->dir,0,true,&list);
+		if(num < 0) return num;
+		free(reader->segment);
+		reader->segment = list;
+		reader->segments = num;
+		reader->current = 0;
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief read frames which match query
+	  @return         number of frames <br> 0 = end of log <br> 0 > fail
+	 ******************************************************************************/
+	extern "C" int lazurite_readLog(LAZURITE_LOG_READER* reader, LAZURITE_FRAME* frames, int num)
+	{
+		const LOG_RECORD *record;
+		int count = 0;
+		int result;
+
+		if(!reader || !frames || (num <= 0)) return -EINVAL;
+		while(count < num) {
+			if(!reader->map) {
+				if(reader->current == reader->segments) {
+					result = log_refresh(reader);
+					if(result <= 0) {
+						if(!count && (result < 0)) return result;
+						break;
+					}
+				}
+				if(!log_map(reader,reader->segment[reader->current])) {
+					reader->current++;
+					continue;
+				}
+			}
+			if(reader->cursor >= reader->end) {
+				if(log_nextBlock(reader)) continue;
+				if(!reader->sealed) {
+					if(__atomic_load_n(&reader->head->flags,__ATOMIC_ACQUIRE) & LOG_SEALED) {
+						// records written before the segment was sealed
+						if(log_nextBlock(reader)) continue;
+					} else if((reader->current + 1 == reader->segments) && (log_refresh(reader) <= 0)) {
+						// segment which is being written is kept for next call
+						break;
+					}
+				}
+				log_unmap(reader);
+				reader->current++;
+				continue;
+			}
+			record = (const LOG_RECORD*)(reader->map + reader->cursor);
+			if((reader->cursor + sizeof(LOG_RECORD) > reader->end) || (record->record_len < sizeof(LOG_RECORD)) ||
+					(reader->cursor + record->record_len > reader->end) ||
+					(sizeof(LOG_RECORD) + record->len > record->record_len) || (record->len > sizeof(frames->raw))) {
+				// broken record. rest of block is skipped
+				reader->cursor = reader->end;
+				continue;
+			}
+			reader->cursor += record->record_len;
+			if((record->time < reader->from) || (record->time > reader->to)) continue;
+			if((reader->src_addr != LOG_NO_ADDR) && (record->src_addr != reader->src_addr)) continue;
+			frames[count].len = record->len;
+			frames[count].rssi = record->rssi;
+			frames[count].tv_sec = record->time / 1000000000;
+			frames[count].tv_nsec = record->time % 1000000000;
+			memcpy(frames[count].raw,record + 1,record->len);
+			mac_layoutFrame(&frames[count]);
+			count++;
+		}
+		return count;
+	}
+
+	/******************************************************************************/
+	/*! @brief close reader
+	  @return         0=success <br> -EINVAL = parameter error
+	 ******************************************************************************/
+	extern "C" int lazurite_closeLogReader(LAZURITE_LOG_READER* reader)
+	{
+		if(!reader) return -EINVAL;
+		log_unmap(reader);
+		free(reader->segment);
+		free(reader);
+		return 0;
+	}
+
+#ifdef __cplusplus
+};
+#endif
@@ -0,0 +1,468 @@
+/*!
+  @file mac-lazurite.cpp
+  @brief decoder of ieee802154e mac header <br>
+  used by lazurite_decMac, lazurite_readPayload, lazurite_readLink and lazurite_readBatch,
+  and lazurite_viewXxx which decode only the requested field. <br>
+  lazurite_decMac is dispatched to a decoder specialized for the layout (mac_decodeFixed). <br>
+  lazurite_decMacBatch classifies frame control of MAC_BATCH frames at once by AVX2/SSE2/NEON
+  (selected at compile time. -mavx2 for AVX2), or by C without them.
+
+  frame control (little endian)
+  bit      | 0-2        | 3       | 4       | 5       | 6          | 8        | 9      | 10-11         | 12-13     | 14-15
+  ---------| -----------| --------| --------| --------| -----------| ---------| -------| --------------| ----------| -------------
+  field    | frame_type | sec_enb | pending | ack_req | panid_comp | seq_comp | ielist | dst_addr_type | frame_ver | src_addr_type
+
+  addr_type = (dst_addr_type ? 4 : 0) + (src_addr_type ? 2 : 0) + panid_comp <br>
+  dst_panid is in the frame when addr_type is 1, 4 or 6, and src_panid when addr_type is 2.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "mac-lazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define MAC_MAX(a,b)				((a) > (b) ? (a) : (b))
+#define MAC_ADDR_LEN(m)				((m) == 3 ? 8 : (m))
+#define MAC_ADDR_TYPE(pc,d,s)		(((d) ? 4 : 0) + ((s) ? 2 : 0) + (pc))
+#define MAC_DST_PANID_LEN(pc,d,s)	((MAC_ADDR_TYPE(pc,d,s) == 1) || (MAC_ADDR_TYPE(pc,d,s) == 4) || (MAC_ADDR_TYPE(pc,d,s) == 6) ? 2 : 0)
+#define MAC_SRC_PANID_LEN(pc,d,s)	(MAC_ADDR_TYPE(pc,d,s) == 2 ? 2 : 0)
+	// offset of each field
+#define MAC_DST_PANID(sc)			((sc) ? 2 : 3)
+#define MAC_DST_ADDR(sc,pc,d,s)		(MAC_DST_PANID(sc) + MAC_DST_PANID_LEN(pc,d,s))
+#define MAC_SRC_PANID(sc,pc,d,s)	(MAC_DST_ADDR(sc,pc,d,s) + MAC_ADDR_LEN(d))
+#define MAC_SRC_ADDR(sc,pc,d,s)		(MAC_SRC_PANID(sc,pc,d,s) + MAC_SRC_PANID_LEN(pc,d,s))
+
+#define MAC_LAYOUT_ENTRY(sc,pc,d,s) { \
+		MAC_ADDR_TYPE(pc,d,s), \
+		(sc) ? 0 : 2, \
+		MAC_DST_PANID_LEN(pc,d,s) ? MAC_DST_PANID(sc) : 0, \
+		MAC_ADDR_LEN(d) ? MAC_DST_ADDR(sc,pc,d,s) : 0, \
+		MAC_ADDR_LEN(d), \
+		MAC_SRC_PANID_LEN(pc,d,s) ? MAC_SRC_PANID(sc,pc,d,s) : 0, \
+		MAC_ADDR_LEN(s) ? MAC_SRC_ADDR(sc,pc,d,s) : 0, \
+		MAC_ADDR_LEN(s), \
+		MAC_SRC_ADDR(sc,pc,d,s) + MAC_ADDR_LEN(s), \
+		MAC_MAX(MAC_ADDR_LEN(d) ? MAC_DST_ADDR(sc,pc,d,s) : 0, MAC_ADDR_LEN(s) ? MAC_SRC_ADDR(sc,pc,d,s) : 0) + 8 }
+#define MAC_LAYOUT_SRC(sc,pc,d) \
+		MAC_LAYOUT_ENTRY(sc,pc,d,0), MAC_LAYOUT_ENTRY(sc,pc,d,1), \
+		MAC_LAYOUT_ENTRY(sc,pc,d,2), MAC_LAYOUT_ENTRY(sc,pc,d,3)
+#define MAC_LAYOUT_DST(sc,pc) \
+		MAC_LAYOUT_SRC(sc,pc,0), MAC_LAYOUT_SRC(sc,pc,1), \
+		MAC_LAYOUT_SRC(sc,pc,2), MAC_LAYOUT_SRC(sc,pc,3)
+
+	/*! @brief
+	  layout of all combinations of seq_comp, panid_comp, dst_addr_type and src_addr_type.
+	  mac_getLayout
+	  */
+	const MAC_LAYOUT mac_layout[64] = {
+		MAC_LAYOUT_DST(0,0), MAC_LAYOUT_DST(0,1),
+		MAC_LAYOUT_DST(1,0), MAC_LAYOUT_DST(1,1)
+	};
+
+	// fields of frame control in SUBGHZ_MAC
+#define MAC_FC0(b)	{ (b) & 0x07, ((b) >> 3) & 0x01, ((b) >> 4) & 0x01, ((b) >> 5) & 0x01, ((b) >> 6) & 0x01 }
+#define MAC_FC1(b)	{ (b) & 0x01, ((b) >> 1) & 0x01, ((b) >> 2) & 0x03, ((b) >> 4) & 0x03, ((b) >> 6) & 0x03 }
+#define MAC_FC_4(f,b)	f(b), f((b) + 1), f((b) + 2), f((b) + 3)
+#define MAC_FC_16(f,b)	MAC_FC_4(f,b), MAC_FC_4(f,(b) + 4), MAC_FC_4(f,(b) + 8), MAC_FC_4(f,(b) + 12)
+#define MAC_FC_64(f,b)	MAC_FC_16(f,b), MAC_FC_16(f,(b) + 16), MAC_FC_16(f,(b) + 32), MAC_FC_16(f,(b) + 48)
+#define MAC_FC_256(f)	MAC_FC_64(f,0), MAC_FC_64(f,64), MAC_FC_64(f,128), MAC_FC_64(f,192)
+
+	/*! @brief
+	  frame_type, sec_enb, pending, ack_req and panid_comp of SUBGHZ_MAC by 1st byte of frame control.
+	  these uint8_t fields are in a row in SUBGHZ_MAC, and copied at once.
+	  */
+	static const uint8_t mac_fc0[256][5] = { MAC_FC_256(MAC_FC0) };
+
+	/*! @brief
+	  seq_comp, ielist, dst_addr_type, frame_ver and src_addr_type of SUBGHZ_MAC by 2nd byte of frame control
+	  */
+	static const uint8_t mac_fc1[256][5] = { MAC_FC_256(MAC_FC1) };
+
+	/*! @struct MAC_ADDR_MASK
+	  @brief internal use only
+	  8 byte field of address = (8 bytes from offset & mask) | fill, by dst_addr_type/src_addr_type.
+	  upper bytes of short address are 0. all bytes are 0xff when address is not in the frame.
+	  */
+	typedef struct {
+		uint8_t mask[8];
+		uint8_t fill[8];
+	} MAC_ADDR_MASK;
+
+	static const MAC_ADDR_MASK mac_addr_mask[4] = {
+		{{0,0,0,0,0,0,0,0}, {0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff}},
+		{{0xff,0,0,0,0,0,0,0}, {0,0,0,0,0,0,0,0}},
+		{{0xff,0xff,0,0,0,0,0,0}, {0,0,0,0,0,0,0,0}},
+		{{0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff}, {0,0,0,0,0,0,0,0}},
+	};
+
+	/******************************************************************************/
+	/*! @brief copy address to 8 byte field by 8 byte load
+	  raw must have 8 bytes from offset. (len >= load_len of layout)
+	 ******************************************************************************/
+	static inline void mac_loadAddr(uint8_t *addr, const uint8_t *raw, uint8_t offset, uint8_t type)
+	{
+		uint64_t value, mask, fill;
+		memcpy(&value,raw + offset,8);
+		memcpy(&mask,mac_addr_mask[type].mask,8);
+		memcpy(&fill,mac_addr_mask[type].fill,8);
+		value = (value & mask) | fill;
+		memcpy(addr,&value,8);
+	}
+
+	/******************************************************************************/
+	/*! @brief copy address to 8 byte field for frame shorter than load_len of layout
+	 ******************************************************************************/
+	static void mac_copyAddr(uint8_t *addr, const uint8_t *raw, uint8_t offset, uint8_t len)
+	{
+		memset(addr,len ? 0 : 0xff,8);
+		memcpy(addr,raw + offset,len);
+	}
+
+	int mac_decodeGeneric(SUBGHZ_MAC *mac, const uint8_t *raw, uint16_t len)
+	{
+		const MAC_LAYOUT *layout;
+
+		if((len < 2) || (len < (layout = mac_getLayout(raw))->header_len)) {
+			memset(mac,0,sizeof(SUBGHZ_MAC));
+			mac->payload_offset = len;
+			return -EBADMSG;
+		}
+		mac->header = mac_load16(raw);
+		memcpy(&mac->frame_type,mac_fc0[raw[0]],5);
+		memcpy(&mac->seq_comp,mac_fc1[raw[1]],5);
+		mac->addr_type = layout->addr_type;
+		mac->seq_num = layout->seq_offset ? raw[layout->seq_offset] : 0;
+		mac->dst_panid = layout->dst_panid_offset ? mac_load16(raw + layout->dst_panid_offset) : 0xffff;
+		mac->src_panid = layout->src_panid_offset ? mac_load16(raw + layout->src_panid_offset) : 0xffff;
+		if(len >= layout->load_len) {
+			mac_loadAddr(mac->dst_addr,raw,layout->dst_addr_offset,mac->dst_addr_type);
+			mac_loadAddr(mac->src_addr,raw,layout->src_addr_offset,mac->src_addr_type);
+		} else {
+			mac_copyAddr(mac->dst_addr,raw,layout->dst_addr_offset,layout->dst_addr_len);
+			mac_copyAddr(mac->src_addr,raw,layout->src_addr_offset,layout->src_addr_len);
+		}
+		mac->payload_offset = layout->header_len;
+		mac->payload_len = len - layout->header_len;
+		return len;
+	}
+
+	/******************************************************************************/
+	/*! @brief copy address of fixed length to 8 byte field
+	 ******************************************************************************/
+	template<int LEN>
+	static inline void mac_fixedAddr(uint8_t *addr, const uint8_t *raw)
+	{
+		memset(addr,LEN ? 0 : 0xff,8);
+		memcpy(addr,raw,LEN);
+	}
+
+	/******************************************************************************/
+	/*! @brief decoder for one layout of mac header
+	  all offsets are constant. 8bit address (addr_type 1) is not used by Lazurite, and
+	  these layouts and broken frames are passed to mac_decodeGeneric.
+	 ******************************************************************************/
+	template<int SC, int PC, int D, int S>
+	static int mac_decodeFixed(SUBGHZ_MAC *mac, const uint8_t *raw, uint16_t len)
+	{
+		enum {
+			SEQ = SC ? 0 : 2,
+			DST_PANID = MAC_DST_PANID_LEN(PC,D,S) ? MAC_DST_PANID(SC) : 0,
+			DST_ADDR = MAC_DST_ADDR(SC,PC,D,S),
+			SRC_PANID = MAC_SRC_PANID_LEN(PC,D,S) ? MAC_SRC_PANID(SC,PC,D,S) : 0,
+			SRC_ADDR = MAC_SRC_ADDR(SC,PC,D,S),
+			HEADER_LEN = MAC_SRC_ADDR(SC,PC,D,S) + MAC_ADDR_LEN(S)
+		};
+
+		if((D == 1) || (S == 1) || (len < HEADER_LEN)) return mac_decodeGeneric(mac,raw,len);
+		mac->header = mac_load16(raw);
+		memcpy(&mac->frame_type,mac_fc0[raw[0]],5);
+		memcpy(&mac->seq_comp,mac_fc1[raw[1]],5);
+		mac->addr_type = MAC_ADDR_TYPE(PC,D,S);
+		mac->seq_num = (SEQ != 0) ? raw[SEQ] : 0;
+		mac->dst_panid = (DST_PANID != 0) ? mac_load16(raw + DST_PANID) : 0xffff;
+		mac->src_panid = (SRC_PANID != 0) ? mac_load16(raw + SRC_PANID) : 0xffff;
+		mac_fixedAddr<MAC_ADDR_LEN(D)>(mac->dst_addr,raw + DST_ADDR);
+		mac_fixedAddr<MAC_ADDR_LEN(S)>(mac->src_addr,raw + SRC_ADDR);
+		mac->payload_offset = HEADER_LEN;
+		mac->payload_len = len - HEADER_LEN;
+		return len;
+	}
+
+#define MAC_DECODER_SRC(sc,pc,d) \
+		mac_decodeFixed<sc,pc,d,0>, mac_decodeFixed<sc,pc,d,1>, \
+		mac_decodeFixed<sc,pc,d,2>, mac_decodeFixed<sc,pc,d,3>
+#define MAC_DECODER_DST(sc,pc) \
+		MAC_DECODER_SRC(sc,pc,0), MAC_DECODER_SRC(sc,pc,1), \
+		MAC_DECODER_SRC(sc,pc,2), MAC_DECODER_SRC(sc,pc,3)
+
+	/*! @brief
+	  decoder of each layout. same index as mac_layout.
+	  */
+	static int (* const mac_decoder[64])(SUBGHZ_MAC *mac, const uint8_t *raw, uint16_t len) = {
+		MAC_DECODER_DST(0,0), MAC_DECODER_DST(0,1),
+		MAC_DECODER_DST(1,0), MAC_DECODER_DST(1,1)
+	};
+
+	int mac_decode(SUBGHZ_MAC *mac, const uint8_t *raw, uint16_t len)
+	{
+		if(len < 2) return mac_decodeGeneric(mac,raw,len);
+		return mac_decoder[mac_getLayout(raw) - mac_layout](mac,raw,len);
+	}
+
+	void mac_layoutFrame(LAZURITE_FRAME *frame)
+	{
+		const MAC_LAYOUT *layout;
+
+		if((frame->len < 2) || (frame->len < (layout = mac_getLayout(frame->raw))->header_len)) {
+			frame->seq_offset = 0;
+			frame->dst_panid_offset = 0;
+			frame->dst_addr_offset = 0;
+			frame->src_panid_offset = 0;
+			frame->src_addr_offset = 0;
+			frame->dst_addr_len = 0;
+			frame->src_addr_len = 0;
+			frame->addr_type = 0;
+			frame->status = -EBADMSG;
+			frame->payload_offset = frame->len;
+			frame->payload_len = 0;
+			return;
+		}
+		frame->seq_offset = layout->seq_offset;
+		frame->dst_panid_offset = layout->dst_panid_offset;
+		frame->dst_addr_offset = layout->dst_addr_offset;
+		frame->src_panid_offset = layout->src_panid_offset;
+		frame->src_addr_offset = layout->src_addr_offset;
+		frame->dst_addr_len = layout->dst_addr_len;
+		frame->src_addr_len = layout->src_addr_len;
+		frame->addr_type = layout->addr_type;
+		frame->status = 0;
+		frame->payload_offset = layout->header_len;
+		frame->payload_len = frame->len - layout->header_len;
+	}
+
+	/******************************************************************************/
+	/*! @brief layout of view
+	  @return         layout <br> NULL = frame is shorter than mac header
+	 ******************************************************************************/
+	static inline const MAC_LAYOUT* mac_viewLayout(const LAZURITE_VIEW *view)
+	{
+		const MAC_LAYOUT *layout;
+		if(view->len < 2) return NULL;
+		layout = mac_getLayout(view->raw);
+		if(view->len < layout->header_len) return NULL;
+		return layout;
+	}
+
+	extern "C" int lazurite_setView(LAZURITE_VIEW* view, const void* raw, uint16_t len)
+	{
+		if(!view || !raw) return -EINVAL;
+		view->raw = (const uint8_t*)raw;
+		view->len = len;
+		return 0;
+	}
+
+	extern "C" int lazurite_viewSeq(const LAZURITE_VIEW* view)
+	{
+		const MAC_LAYOUT *layout = mac_viewLayout(view);
+		if(!layout) return -EBADMSG;
+		if(!layout->seq_offset) return -ENOENT;
+		return view->raw[layout->seq_offset];
+	}
+
+	extern "C" int lazurite_viewDstPanid(const LAZURITE_VIEW* view)
+	{
+		const MAC_LAYOUT *layout = mac_viewLayout(view);
+		if(!layout) return -EBADMSG;
+		if(!layout->dst_panid_offset) return -ENOENT;
+		return mac_load16(view->raw + layout->dst_panid_offset);
+	}
+
+	extern "C" int lazurite_viewSrcPanid(const LAZURITE_VIEW* view)
+	{
+		const MAC_LAYOUT *layout = mac_viewLayout(view);
+		if(!layout) return -EBADMSG;
+		if(!layout->src_panid_offset) return -ENOENT;
+		return mac_load16(view->raw + layout->src_panid_offset);
+	}
+
+	extern "C" int lazurite_viewDstAddr(const LAZURITE_VIEW* view, const uint8_t** addr)
+	{
+		const MAC_LAYOUT *layout = mac_viewLayout(view);
+		if(!layout) return -EBADMSG;
+		*addr = layout->dst_addr_len ? view->raw + layout->dst_addr_offset : NULL;
+		return layout->dst_addr_len;
+	}
+
+	extern "C" int lazurite_viewSrcAddr(const LAZURITE_VIEW* view, const uint8_t** addr)
+	{
+		const MAC_LAYOUT *layout = mac_viewLayout(view);
+		if(!layout) return -EBADMSG;
+		*addr = layout->src_addr_len ? view->raw + layout->src_addr_offset : NULL;
+		return layout->src_addr_len;
+	}
+
+	extern "C" int lazurite_viewPayload(const LAZURITE_VIEW* view, const uint8_t** payload)
+	{
+		const MAC_LAYOUT *layout = mac_viewLayout(view);
+		if(!layout) return -EBADMSG;
+		*payload = view->raw + layout->header_len;
+		return view->len - layout->header_len;
+	}
+
+#define MAC_BATCH	32		/*!< frames classified at once */
+
+	/******************************************************************************/
+	/*! @brief index of mac_layout for MAC_BATCH frames
+	  @param[out]     *index  index of mac_layout
+	  @param[in]      *fc0    1st byte of frame control
+	  @param[in]      *fc1    2nd byte of frame control
+	  @note  same as mac_getLayout. bit shifts of 16bit lanes do not carry over
+	  to the next byte, because each byte is masked before shifting.
+	 ******************************************************************************/
+	static inline void mac_classify(uint8_t *index, const uint8_t *fc0, const uint8_t *fc1)
+	{
+#if defined(__AVX2__)
+		__m256i b0 = _mm256_loadu_si256((const __m256i*)fc0);
+		__m256i b1 = _mm256_loadu_si256((const __m256i*)fc1);
+		__m256i seq = _mm256_slli_epi16(_mm256_and_si256(b1,_mm256_set1_epi8(0x01)),5);
+		__m256i pc = _mm256_srli_epi16(_mm256_and_si256(b0,_mm256_set1_epi8(0x40)),2);
+		__m256i dst = _mm256_and_si256(b1,_mm256_set1_epi8(0x0c));
+		__m256i src = _mm256_srli_epi16(_mm256_and_si256(b1,_mm256_set1_epi8((char)0xc0)),6);
+		_mm256_storeu_si256((__m256i*)index,_mm256_or_si256(_mm256_or_si256(seq,pc),_mm256_or_si256(dst,src)));
+#elif defined(__SSE2__)
+		int i;
+		for(i=0;i<MAC_BATCH;i+=16) {
+			__m128i b0 = _mm_loadu_si128((const __m128i*)(fc0 + i));
+			__m128i b1 = _mm_loadu_si128((const __m128i*)(fc1 + i));
+			__m128i seq = _mm_slli_epi16(_mm_and_si128(b1,_mm_set1_epi8(0x01)),5);
+			__m128i pc = _mm_srli_epi16(_mm_and_si128(b0,_mm_set1_epi8(0x40)),2);
+			__m128i dst = _mm_and_si128(b1,_mm_set1_epi8(0x0c));
+			__m128i src = _mm_srli_epi16(_mm_and_si128(b1,_mm_set1_epi8((char)0xc0)),6);
+			_mm_storeu_si128((__m128i*)(index + i),_mm_or_si128(_mm_or_si128(seq,pc),_mm_or_si128(dst,src)));
+		}
+#elif defined(__ARM_NEON)
+		int i;
+		for(i=0;i<MAC_BATCH;i+=16) {
+			uint8x16_t b0 = vld1q_u8(fc0 + i);
+			uint8x16_t b1 = vld1q_u8(fc1 + i);
+			uint8x16_t seq = vshlq_n_u8(vandq_u8(b1,vdupq_n_u8(0x01)),5);
+			uint8x16_t pc = vshrq_n_u8(vandq_u8(b0,vdupq_n_u8(0x40)),2);
+			uint8x16_t dst = vandq_u8(b1,vdupq_n_u8(0x0c));
+			uint8x16_t src = vshrq_n_u8(b1,6);
+			vst1q_u8(index + i,vorrq_u8(vorrq_u8(seq,pc),vorrq_u8(dst,src)));
+		}
+#else
+		int i;
+		for(i=0;i<MAC_BATCH;i++) {
+			index[i] = ((fc1[i] & 0x01) << 5) | ((fc0[i] & 0x40) >> 2) | (fc1[i] & 0x0c) | (fc1[i] >> 6);
+		}
+#endif
+	}
+
+	/*! @brief
+	  64bit value of address = (8 bytes from offset & mask) | fill, by dst_addr_type/src_addr_type.
+	  */
+	static const uint64_t mac_addr64_mask[4] = {0, 0xffULL, 0xffffULL, ~0ULL};
+	static const uint64_t mac_addr64_fill[4] = {~0ULL, 0, 0, 0};
+
+	/******************************************************************************/
+	/*! @brief 64bit value of address for frame shorter than load_len of layout
+	 ******************************************************************************/
+	static uint64_t mac_copyAddr64(const uint8_t *raw, uint8_t offset, uint8_t len)
+	{
+		uint64_t value = 0;
+		int i;
+		if(!len) return ~0ULL;
+		for(i=len-1;i>=0;i--) {
+			value = (value << 8) | raw[offset + i];
+		}
+		return value;
+	}
+
+	/******************************************************************************/
+	/*! @brief fill columns of one frame
+	 ******************************************************************************/
+	static inline void mac_decodeColumns(LAZURITE_MAC_COLUMNS *columns, int i, const uint8_t *raw, uint16_t len, uint8_t index)
+	{
+		const MAC_LAYOUT *layout = &mac_layout[index];
+		uint64_t dst, src;
+		uint8_t dst_type = (index >> 2) & 0x03;
+		uint8_t src_type = index & 0x03;
+
+		if((len < 2) || (len < layout->header_len)) {
+			if(columns->status) columns->status[i] = -EBADMSG;
+			if(columns->frame_type) columns->frame_type[i] = 0;
+			if(columns->addr_type) columns->addr_type[i] = 0;
+			if(columns->seq_num) columns->seq_num[i] = 0;
+			if(columns->dst_panid) columns->dst_panid[i] = 0xffff;
+			if(columns->src_panid) columns->src_panid[i] = 0xffff;
+			if(columns->dst_short) columns->dst_short[i] = 0xffff;
+			if(columns->src_short) columns->src_short[i] = 0xffff;
+			if(columns->dst_addr) columns->dst_addr[i] = ~0ULL;
+			if(columns->src_addr) columns->src_addr[i] = ~0ULL;
+			if(columns->payload_offset) columns->payload_offset[i] = len;
+			if(columns->payload_len) columns->payload_len[i] = 0;
+			return;
+		}
+		if(len >= layout->load_len) {
+			dst = (mac_load64(raw + layout->dst_addr_offset) & mac_addr64_mask[dst_type]) | mac_addr64_fill[dst_type];
+			src = (mac_load64(raw + layout->src_addr_offset) & mac_addr64_mask[src_type]) | mac_addr64_fill[src_type];
+		} else {
+			dst = mac_copyAddr64(raw,layout->dst_addr_offset,layout->dst_addr_len);
+			src = mac_copyAddr64(raw,layout->src_addr_offset,layout->src_addr_len);
+		}
+		if(columns->status) columns->status[i] = 0;
+		if(columns->frame_type) columns->frame_type[i] = raw[0] & 0x07;
+		if(columns->addr_type) columns->addr_type[i] = layout->addr_type;
+		// offset 0 (not in the frame) reads frame control, and it is masked without branch
+		if(columns->seq_num) columns->seq_num[i] = raw[layout->seq_offset] & -(layout->seq_offset != 0);
+		if(columns->dst_panid) columns->dst_panid[i] = mac_load16(raw + layout->dst_panid_offset) | -(layout->dst_panid_offset == 0);
+		if(columns->src_panid) columns->src_panid[i] = mac_load16(raw + layout->src_panid_offset) | -(layout->src_panid_offset == 0);
+		if(columns->dst_short) columns->dst_short[i] = (uint16_t)dst;
+		if(columns->src_short) columns->src_short[i] = (uint16_t)src;
+		if(columns->dst_addr) columns->dst_addr[i] = dst;
+		if(columns->src_addr) columns->src_addr[i] = src;
+		if(columns->payload_offset) columns->payload_offset[i] = layout->header_len;
+		if(columns->payload_len) columns->payload_len[i] = len - layout->header_len;
+	}
+
+	extern "C" int lazurite_decMacBatch(LAZURITE_MAC_COLUMNS* columns, const void* const* raw, const uint16_t* len, int num)
+	{
+		uint8_t fc0[MAC_BATCH], fc1[MAC_BATCH], index[MAC_BATCH];
+		const uint8_t *frame;
+		int i, j, n;
+
+		if(!columns || !raw || !len || (num < 0)) return -EINVAL;
+		for(i=0;i<num;i+=MAC_BATCH) {
+			n = num - i < MAC_BATCH ? num - i : MAC_BATCH;
+			for(j=0;j<n;j++) {
+				frame = (const uint8_t*)raw[i + j];
+				fc0[j] = len[i + j] >= 2 ? frame[0] : 0;
+				fc1[j] = len[i + j] >= 2 ? frame[1] : 0;
+			}
+			for(;j<MAC_BATCH;j++) {
+				fc0[j] = fc1[j] = 0;
+			}
+			mac_classify(index,fc0,fc1);
+			for(j=0;j<n;j++) {
+				mac_decodeColumns(columns,i + j,(const uint8_t*)raw[i + j],len[i + j],index[j]);
+			}
+		}
+		return num;
+	}
+
+#ifdef __cplusplus
+};
+#endif
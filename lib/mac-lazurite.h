@@ -0,0 +1,122 @@
+/*!
+  @file mac-lazurite.h
+  @brief decoder of ieee802154e mac header <br>
+  internal use only. not installed.
+
+  layout of mac header is decided by only 6 bits of frame control
+  (seq_comp, panid_comp, dst_addr_type, src_addr_type), so all offsets are
+  taken from mac_layout[] at once and checked with the length of the frame.
+ */
+#ifndef _MAC_LAZURITE_H_
+#define _MAC_LAZURITE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "liblazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+	/*! @struct MAC_LAYOUT
+	  @brief internal use only
+	  offsets from top of raw. 0 = the field is not in the frame.
+	  */
+	typedef struct {
+		uint8_t addr_type;
+		uint8_t seq_offset;
+		uint8_t dst_panid_offset;
+		uint8_t dst_addr_offset;
+		uint8_t dst_addr_len;
+		uint8_t src_panid_offset;
+		uint8_t src_addr_offset;
+		uint8_t src_addr_len;
+		uint8_t header_len;		/*!< = offset of payload */
+		uint8_t load_len;		/*!< frame length needed to load both addresses by 8 bytes */
+	} MAC_LAYOUT;
+
+	extern const MAC_LAYOUT mac_layout[64];
+
+	/******************************************************************************/
+	/*! @brief layout of mac header
+	  @param[in]      *raw    frame. 2 bytes (frame control) are needed.
+	  @return         layout
+	  @exception      none
+	  @note  index = seq_comp(bit5) | panid_comp(bit4) | dst_addr_type(bit3-2) | src_addr_type(bit1-0)
+	 ******************************************************************************/
+	static inline const MAC_LAYOUT* mac_getLayout(const uint8_t *raw)
+	{
+		return &mac_layout[((raw[1] & 0x01) << 5) | ((raw[0] & 0x40) >> 2) | (raw[1] & 0x0c) | (raw[1] >> 6)];
+	}
+
+	/******************************************************************************/
+	/*! @brief little endian 16bit field
+	 ******************************************************************************/
+	static inline uint16_t mac_load16(const uint8_t *p)
+	{
+		return (uint16_t)(p[0] | (p[1] << 8));
+	}
+
+	/******************************************************************************/
+	/*! @brief little endian 64bit field
+	 ******************************************************************************/
+	static inline uint64_t mac_load64(const uint8_t *p)
+	{
+		uint64_t value;
+		memcpy(&value,p,8);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+		value = __builtin_bswap64(value);
+#endif
+		return value;
+	}
+
+	/******************************************************************************/
+	/*! @brief lower 16bit of source address
+	  @param[in]      *raw      frame which is longer than header_len of layout
+	  @param[in]      *layout   layout of raw
+	  @return         address <br> 0xffff = no source address
+	  @exception      none
+	 ******************************************************************************/
+	static inline uint16_t mac_getSrcShort(const uint8_t *raw, const MAC_LAYOUT *layout)
+	{
+		switch(layout->src_addr_len) {
+			case 0:
+				return 0xffff;
+			case 1:
+				return raw[layout->src_addr_offset];
+			default:
+				return mac_load16(raw + layout->src_addr_offset);
+		}
+	}
+
+	/******************************************************************************/
+	/*! @brief decode mac header
+	  @param[out]     *mac    result of decoding. cleared when frame is too short.
+	  @param[in]      *raw    frame
+	  @param[in]      len     length of raw
+	  @return         len <br> -EBADMSG = raw is shorter than mac header
+	  @exception      none
+	 ******************************************************************************/
+	extern int mac_decode(SUBGHZ_MAC *mac, const uint8_t *raw, uint16_t len);
+
+	/******************************************************************************/
+	/*! @brief decode mac header by mac_layout
+	  same as mac_decode. mac_decode calls decoder specialized for the layout
+	  of frame control, and this is used for the other layouts.
+	 ******************************************************************************/
+	extern int mac_decodeGeneric(SUBGHZ_MAC *mac, const uint8_t *raw, uint16_t len);
+
+	/******************************************************************************/
+	/*! @brief offsets of mac header in received frame
+	  @param[in,out]  *frame  raw and len are input. offsets and status are output.
+	  @return         none
+	  @exception      none
+	 ******************************************************************************/
+	extern void mac_layoutFrame(LAZURITE_FRAME *frame);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif	// _MAC_LAZURITE_H_
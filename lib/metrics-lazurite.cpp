@@ -0,0 +1,222 @@
+/*!
+  @file metrics-lazurite.cpp
+  @brief counters and latency histograms of context <br>
+  snapshot, text format of Prometheus and shared memory. see metrics-lazurite.h.
+
+  text format
+  @code
+  # TYPE lazurite_ioctl_calls_total counter
+  lazurite_ioctl_calls_total 1234
+  # TYPE lazurite_tx_failures_total counter
+  lazurite_tx_failures_total{errno="16"} 3
+  # TYPE lazurite_send_seconds histogram
+  lazurite_send_seconds_bucket{le="0.001048576"} 10
+  lazurite_send_seconds_bucket{le="+Inf"} 12
+  lazurite_send_seconds_sum 0.015
+  lazurite_send_seconds_count 12
+  @endcode
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "metrics-lazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define METRICS_WORDS	(sizeof(LAZURITE_METRICS) / 8)
+
+	extern void metrics_init(METRICS *metrics)
+	{
+		memset(&metrics->local,0,sizeof(metrics->local));
+		metrics->local.magic = LAZURITE_METRICS_MAGIC;
+		metrics->local.size = sizeof(LAZURITE_METRICS);
+		metrics->live = &metrics->local;
+		metrics->name = NULL;
+		metrics->shm = NULL;
+	}
+
+	/******************************************************************************/
+	/*! @brief copy counters word by word with atomic
+	 ******************************************************************************/
+	static void metrics_copy(LAZURITE_METRICS *dst, LAZURITE_METRICS *src)
+	{
+		uint64_t *d = (uint64_t*)dst;
+		uint64_t *s = (uint64_t*)src;
+		size_t i;
+
+		for(i=0;i<METRICS_WORDS;i++) __atomic_store_n(&d[i],__atomic_load_n(&s[i],__ATOMIC_RELAXED),__ATOMIC_RELAXED);
+	}
+
+	extern void metrics_snapshot(METRICS *metrics, LAZURITE_METRICS *snapshot)
+	{
+		metrics_copy(snapshot,metrics_live(metrics));
+	}
+
+	/******************************************************************************/
+	/*! @brief upper bound of bucket (ns, not included)
+	 ******************************************************************************/
+	static uint64_t metrics_upper(uint32_t index)
+	{
+		uint32_t exp;
+
+		if(index < LAZURITE_HISTOGRAM_SUB) return index + 1;
+		exp = index / LAZURITE_HISTOGRAM_SUB + 2;
+		return (uint64_t)(LAZURITE_HISTOGRAM_SUB + index % LAZURITE_HISTOGRAM_SUB + 1) << (exp - 3);
+	}
+
+	extern "C" uint64_t lazurite_getPercentile(const LAZURITE_HISTOGRAM* hist, double percent)
+	{
+		uint64_t target;
+		uint64_t sum = 0;
+		uint32_t i;
+
+		if(!hist || (hist->count == 0)) return 0;
+		if(percent < 0) percent = 0;
+		if(percent > 100) percent = 100;
+		target = (uint64_t)(hist->count * percent / 100);
+		if(target == 0) target = 1;
+		for(i=0;i<LAZURITE_HISTOGRAM_BUCKETS;i++) {
+			sum += hist->bucket[i];
+			if(sum >= target) return metrics_upper(i);
+		}
+		return metrics_upper(LAZURITE_HISTOGRAM_BUCKETS - 1);
+	}
+
+	static void metrics_counter(FILE *fp, const char *name, const char *help, uint64_t value)
+	{
+		fprintf(fp,"# HELP %s %s\n# TYPE %s counter\n%s %llu\n",name,help,name,name,(unsigned long long)value);
+	}
+
+	/******************************************************************************/
+	/*! @brief histogram. buckets are put together by each power of 2
+	 ******************************************************************************/
+	static void metrics_histogram(FILE *fp, const char *name, const char *help, const LAZURITE_HISTOGRAM *hist)
+	{
+		uint64_t sum = 0;
+		uint64_t upper;
+		uint32_t i;
+
+		fprintf(fp,"# HELP %s %s\n# TYPE %s histogram\n",name,help,name);
+		// last bucket has all values over it, so its bound is not written
+		for(i=0;i<LAZURITE_HISTOGRAM_BUCKETS-1;i++) {
+			sum += hist->bucket[i];
+			upper = metrics_upper(i);
+			if(upper & (upper - 1)) continue;
+			fprintf(fp,"%s_bucket{le=\"%.9g\"} %llu\n",name,upper * 1e-9,(unsigned long long)sum);
+		}
+		fprintf(fp,"%s_bucket{le=\"+Inf\"} %llu\n",name,(unsigned long long)hist->count);
+		fprintf(fp,"%s_sum %.9f\n",name,hist->sum * 1e-9);
+		fprintf(fp,"%s_count %llu\n",name,(unsigned long long)hist->count);
+	}
+
+	extern int metrics_write(METRICS *metrics, const char *path)
+	{
+		static LAZURITE_METRICS snapshot;
+		static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+		char tmp[PATH_MAX];
+		FILE *fp;
+		int result = 0;
+		int i;
+
+		if(snprintf(tmp,sizeof(tmp),"%s.tmp",path) >= (int)sizeof(tmp)) return -ENAMETOOLONG;
+		fp = fopen(tmp,"w");
+		if(!fp) return -errno;
+
+		// snapshot is too large for stack of small threads
+		pthread_mutex_lock(&lock);
+		metrics_snapshot(metrics,&snapshot);
+		metrics_counter(fp,"lazurite_ioctl_calls_total","ioctl of backend",snapshot.ioctl_calls);
+		metrics_counter(fp,"lazurite_ioctl_errors_total","ioctl which returned error",snapshot.ioctl_errors);
+		metrics_counter(fp,"lazurite_read_calls_total","read and recv of backend",snapshot.read_calls);
+		metrics_counter(fp,"lazurite_read_bytes_total","bytes read from backend",snapshot.read_bytes);
+		metrics_counter(fp,"lazurite_write_calls_total","write of backend",snapshot.write_calls);
+		metrics_counter(fp,"lazurite_write_bytes_total","bytes written to backend",snapshot.write_bytes);
+		metrics_counter(fp,"lazurite_rx_frames_total","frames received",snapshot.rx_frames);
+		metrics_counter(fp,"lazurite_tx_frames_total","frames sent",snapshot.tx_frames);
+		fprintf(fp,"# HELP lazurite_tx_failures_total failed send by errno (16 = CCA, 19 = ACK)\n# TYPE lazurite_tx_failures_total counter\n");
+		for(i=0;i<LAZURITE_METRICS_ERRNO;i++) {
+			if(!snapshot.tx_fail[i]) continue;
+			fprintf(fp,"lazurite_tx_failures_total{errno=\"%d\"} %llu\n",i,(unsigned long long)snapshot.tx_fail[i]);
+		}
+		metrics_histogram(fp,"lazurite_send_seconds","time of send",&snapshot.send);
+		metrics_histogram(fp,"lazurite_rx_syscall_seconds","time of read and recv of backend",&snapshot.rx_syscall);
+		metrics_histogram(fp,"lazurite_decode_seconds","time of decoding mac header",&snapshot.decode);
+		pthread_mutex_unlock(&lock);
+
+		if(ferror(fp)) result = -EIO;
+		if((fclose(fp) != 0) && !result) result = -errno;
+		if(!result && (rename(tmp,path) != 0)) result = -errno;
+		if(result) unlink(tmp);
+		return result;
+	}
+
+	extern int metrics_share(METRICS *metrics, const char *name)
+	{
+		LAZURITE_METRICS *shm;
+		int fd;
+		int err;
+
+		metrics->name = strdup(name);
+		if(!metrics->name) return -ENOMEM;
+		fd = shm_open(name,O_RDWR | O_CREAT | O_TRUNC,0644);
+		if(fd < 0) {
+			err = errno;
+			goto error;
+		}
+		if(ftruncate(fd,sizeof(LAZURITE_METRICS)) != 0) {
+			err = errno;
+			close(fd);
+			shm_unlink(name);
+			goto error;
+		}
+		// mapping of last sharing is replaced at the same address, so its old live stays valid
+		shm = (LAZURITE_METRICS*)mmap(metrics->shm,sizeof(LAZURITE_METRICS),PROT_READ | PROT_WRITE,
+				metrics->shm ? MAP_SHARED | MAP_FIXED : MAP_SHARED,fd,0);
+		err = errno;
+		close(fd);
+		if(shm == MAP_FAILED) {
+			shm_unlink(name);
+			goto error;
+		}
+		metrics->shm = shm;
+		metrics_copy(shm,&metrics->local);
+		__atomic_store_n(&metrics->live,shm,__ATOMIC_RELEASE);
+		return 0;
+
+	error:
+		free(metrics->name);
+		metrics->name = NULL;
+		return -err;
+	}
+
+	extern void metrics_unshare(METRICS *metrics)
+	{
+		if(!metrics->name) return;
+		metrics_copy(&metrics->local,metrics->shm);
+		__atomic_store_n(&metrics->live,&metrics->local,__ATOMIC_RELEASE);
+		shm_unlink(metrics->name);
+		free(metrics->name);
+		metrics->name = NULL;
+	}
+
+	extern void metrics_close(METRICS *metrics)
+	{
+		metrics_unshare(metrics);
+		if(metrics->shm) munmap(metrics->shm,sizeof(LAZURITE_METRICS));
+		metrics->shm = NULL;
+	}
+
+#ifdef __cplusplus
+};
+#endif
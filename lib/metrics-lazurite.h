@@ -0,0 +1,124 @@
+/*!
+  @file metrics-lazurite.h
+  @brief counters and latency histograms of context <br>
+  internal use only. not installed.
+
+  counters are updated by relaxed atomic add on every ioctl/read/write of backend, so they
+  are always on. live points to local or to shared memory of lazurite_shareMetrics, and the
+  same functions update both.
+ */
+#ifndef _METRICS_LAZURITE_H_
+#define _METRICS_LAZURITE_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include "liblazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+	/*! @struct METRICS
+	  @brief internal use only
+	  */
+	typedef struct {
+		LAZURITE_METRICS *live;		/*!< &local or shared memory */
+		LAZURITE_METRICS local;
+		char *name;					/*!< name of shared memory. NULL = not shared */
+		LAZURITE_METRICS *shm;		/*!< mapping of shared memory. kept until metrics_close */
+	} METRICS;
+
+	static inline uint64_t metrics_now(void)
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	}
+
+	static inline LAZURITE_METRICS* metrics_live(METRICS *metrics)
+	{
+		return __atomic_load_n(&metrics->live,__ATOMIC_RELAXED);
+	}
+
+	static inline void metrics_add(uint64_t *counter, uint64_t value)
+	{
+		__atomic_fetch_add(counter,value,__ATOMIC_RELAXED);
+	}
+
+	/******************************************************************************/
+	/*! @brief bucket of value
+	  under 2*LAZURITE_HISTOGRAM_SUB, bucket = value. above that, bucket is power of 2 and
+	  next 3 bits.
+	 ******************************************************************************/
+	static inline uint32_t metrics_bucket(uint64_t ns)
+	{
+		uint32_t exp;
+		uint32_t index;
+
+		if(ns < LAZURITE_HISTOGRAM_SUB) return ns;
+		exp = 63 - __builtin_clzll(ns);
+		index = (exp - 2) * LAZURITE_HISTOGRAM_SUB + ((ns >> (exp - 3)) & (LAZURITE_HISTOGRAM_SUB - 1));
+		return index < LAZURITE_HISTOGRAM_BUCKETS ? index : LAZURITE_HISTOGRAM_BUCKETS - 1;
+	}
+
+	static inline void metrics_record(LAZURITE_HISTOGRAM *hist, uint64_t ns)
+	{
+		metrics_add(&hist->bucket[metrics_bucket(ns)],1);
+		metrics_add(&hist->sum,ns);
+		metrics_add(&hist->count,1);
+	}
+
+	/******************************************************************************/
+	/*! @brief count result and time of send
+	  @param[in]      result    result of send_addr64/send_addr16
+	  @param[in]      start     metrics_now when send was started
+	  @return         ns of send
+	 ******************************************************************************/
+	static inline uint64_t metrics_sent(METRICS *metrics, int result, uint64_t start)
+	{
+		LAZURITE_METRICS *live = metrics_live(metrics);
+		uint64_t ns = metrics_now() - start;
+
+		if(result >= 0) metrics_add(&live->tx_frames,1);
+		else metrics_add(&live->tx_fail[-result < LAZURITE_METRICS_ERRNO ? -result : 0],1);
+		metrics_record(&live->send,ns);
+		return ns;
+	}
+
+	extern void metrics_init(METRICS *metrics);
+
+	/******************************************************************************/
+	/*! @brief copy of counters. each counter is loaded by atomic.
+	 ******************************************************************************/
+	extern void metrics_snapshot(METRICS *metrics, LAZURITE_METRICS *snapshot);
+
+	/******************************************************************************/
+	/*! @brief write text format of Prometheus
+	  @return         0=success <br> 0 > fail
+	 ******************************************************************************/
+	extern int metrics_write(METRICS *metrics, const char *path);
+
+	/******************************************************************************/
+	/*! @brief move counters to shared memory
+	  @return         0=success <br> 0 > fail
+	 ******************************************************************************/
+	extern int metrics_share(METRICS *metrics, const char *name);
+
+	/******************************************************************************/
+	/*! @brief move counters back to local and remove name of shared memory
+	  the mapping is not unmapped, because other threads may still hold the old live.
+	 ******************************************************************************/
+	extern void metrics_unshare(METRICS *metrics);
+
+	/******************************************************************************/
+	/*! @brief stop sharing and unmap shared memory. no thread may use counters.
+	 ******************************************************************************/
+	extern void metrics_close(METRICS *metrics);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif	// _METRICS_LAZURITE_H_
@@ -0,0 +1,309 @@
+/*!
+  @file neighbor-lazurite.cpp
+  @brief link quality of each neighbor node <br>
+  used by lazurite_setNeighborTable. see neighbor-lazurite.h.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include "neighbor-lazurite.h"
+#include "mac-lazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+	extern NEIGHBOR_TABLE* neighbor_create(const LAZURITE_NEIGHBOR_PARAM *param)
+	{
+		NEIGHBOR_TABLE *table;
+		unsigned long capacity = param->capacity ? param->capacity : NEIGHBOR_CAPACITY;
+		uint32_t slots;
+		void *entry;
+
+		if((param->ewma_shift > 8) || (capacity > (1UL << 20))) {
+			errno = EINVAL;
+			return NULL;
+		}
+		for(slots=NEIGHBOR_PROBE;slots<capacity;slots*=2);
+		table = (NEIGHBOR_TABLE*)calloc(1,sizeof(NEIGHBOR_TABLE));
+		if(!table) return NULL;
+		if(posix_memalign(&entry,64,sizeof(NEIGHBOR_ENTRY) * slots) != 0) {
+			free(table);
+			errno = ENOMEM;
+			return NULL;
+		}
+		memset(entry,0,sizeof(NEIGHBOR_ENTRY) * slots);
+		table->entry = (NEIGHBOR_ENTRY*)entry;
+		table->mask = slots - 1;
+		table->shift = param->ewma_shift ? param->ewma_shift : NEIGHBOR_EWMA_SHIFT;
+		pthread_mutex_init(&table->lock,NULL);
+		return table;
+	}
+
+	extern void neighbor_free(NEIGHBOR_TABLE *table)
+	{
+		if(!table) return;
+		pthread_mutex_destroy(&table->lock);
+		free(table->entry);
+		free(table);
+	}
+
+	static inline uint32_t neighbor_hash(uint64_t addr, uint8_t addr_len)
+	{
+		return (uint32_t)(((addr ^ addr_len) * 0x9e3779b97f4a7c15ULL) >> 32);
+	}
+
+	/******************************************************************************/
+	/*! @brief make seq of entry odd. spins while other writer has it.
+	 ******************************************************************************/
+	static inline void neighbor_lock(NEIGHBOR_ENTRY *entry)
+	{
+		uint32_t seq = __atomic_load_n(&entry->seq,__ATOMIC_RELAXED);
+
+		for(;;) {
+			if(!(seq & 1) && __atomic_compare_exchange_n(&entry->seq,&seq,seq + 1,true,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED)) break;
+			sched_yield();
+			seq = __atomic_load_n(&entry->seq,__ATOMIC_RELAXED);
+		}
+	}
+
+	static inline void neighbor_unlock(NEIGHBOR_ENTRY *entry)
+	{
+		__atomic_store_n(&entry->seq,__atomic_load_n(&entry->seq,__ATOMIC_RELAXED) + 1,__ATOMIC_RELEASE);
+	}
+
+	/******************************************************************************/
+	/*! @brief publish data of entry. seq of entry must be odd.
+	  words are stored by release, so a reader which loads one of them sees odd seq after that.
+	 ******************************************************************************/
+	static inline void neighbor_store(NEIGHBOR_ENTRY *entry, const NEIGHBOR_DATA *data)
+	{
+		size_t i;
+		for(i=0;i<NEIGHBOR_WORDS;i++) __atomic_store_n(&entry->data.word[i],data->word[i],__ATOMIC_RELEASE);
+	}
+
+	/******************************************************************************/
+	/*! @brief copy data of entry which is not being written
+	 ******************************************************************************/
+	static void neighbor_load(NEIGHBOR_ENTRY *entry, NEIGHBOR_DATA *data)
+	{
+		uint32_t before, after;
+		size_t i;
+
+		for(;;) {
+			before = __atomic_load_n(&entry->seq,__ATOMIC_ACQUIRE);
+			if(before & 1) {
+				sched_yield();
+				continue;
+			}
+			for(i=0;i<NEIGHBOR_WORDS;i++) data->word[i] = __atomic_load_n(&entry->data.word[i],__ATOMIC_ACQUIRE);
+			after = __atomic_load_n(&entry->seq,__ATOMIC_RELAXED);
+			if(before == after) return;
+		}
+	}
+
+	/******************************************************************************/
+	/*! @brief find entry of node without lock. key must be checked again after neighbor_lock.
+	 ******************************************************************************/
+	static NEIGHBOR_ENTRY* neighbor_find(NEIGHBOR_TABLE *table, uint64_t addr, uint8_t addr_len)
+	{
+		NEIGHBOR_ENTRY *entry;
+		uint32_t slot = neighbor_hash(addr,addr_len);
+		uint32_t i;
+
+		for(i=0;i<NEIGHBOR_PROBE;i++) {
+			entry = &table->entry[(slot + i) & table->mask];
+			if((__atomic_load_n(&entry->addr,__ATOMIC_RELAXED) == addr) &&
+					(__atomic_load_n(&entry->addr_len,__ATOMIC_RELAXED) == addr_len)) return entry;
+		}
+		return NULL;
+	}
+
+	/******************************************************************************/
+	/*! @brief entry of node with lock (neighbor_lock). new entry is made when node is not found.
+	  @param[out]     *data     current data of entry
+	 ******************************************************************************/
+	static NEIGHBOR_ENTRY* neighbor_acquire(NEIGHBOR_TABLE *table, uint64_t addr, uint8_t addr_len, NEIGHBOR_DATA *data)
+	{
+		NEIGHBOR_ENTRY *entry, *victim;
+		uint32_t slot, i;
+
+		for(;;) {
+			entry = neighbor_find(table,addr,addr_len);
+			if(entry) {
+				neighbor_lock(entry);
+				if((entry->addr == addr) && (entry->addr_len == addr_len)) {
+					*data = entry->data;
+					return entry;
+				}
+				// replaced by other node after it was found
+				neighbor_unlock(entry);
+				continue;
+			}
+
+			// new node. adding same node twice is prevented by table lock
+			pthread_mutex_lock(&table->lock);
+			entry = neighbor_find(table,addr,addr_len);
+			if(entry) {
+				pthread_mutex_unlock(&table->lock);
+				continue;
+			}
+			slot = neighbor_hash(addr,addr_len);
+			victim = NULL;
+			for(i=0;i<NEIGHBOR_PROBE;i++) {
+				entry = &table->entry[(slot + i) & table->mask];
+				if(!__atomic_load_n(&entry->addr_len,__ATOMIC_RELAXED)) {
+					victim = entry;
+					break;
+				}
+				if(!victim || (__atomic_load_n(&entry->stamp,__ATOMIC_RELAXED) < __atomic_load_n(&victim->stamp,__ATOMIC_RELAXED))) {
+					victim = entry;
+				}
+			}
+			neighbor_lock(victim);
+			__atomic_store_n(&victim->addr,addr,__ATOMIC_RELAXED);
+			__atomic_store_n(&victim->addr_len,addr_len,__ATOMIC_RELAXED);
+			pthread_mutex_unlock(&table->lock);
+			victim->seq_valid = false;
+			victim->rssi_valid = false;
+			victim->rssi_q8 = 0;
+			victim->ack_q8 = 0;
+			memset(data,0,sizeof(*data));
+			data->data.addr = addr;
+			data->data.addr_len = addr_len;
+			return victim;
+		}
+	}
+
+	static inline void neighbor_release(NEIGHBOR_ENTRY *entry, const NEIGHBOR_DATA *data, int64_t stamp)
+	{
+		neighbor_store(entry,data);
+		__atomic_store_n(&entry->stamp,stamp,__ATOMIC_RELAXED);
+		neighbor_unlock(entry);
+	}
+
+	static inline int32_t neighbor_ewma(int32_t avg, uint8_t value, uint8_t shift)
+	{
+		return avg + ((((int32_t)value << 8) - avg) / (1 << shift));
+	}
+
+	extern void neighbor_rx(NEIGHBOR_TABLE *table, const uint8_t *raw, uint16_t len, int rssi, time_t tv_sec, long tv_nsec)
+	{
+		const MAC_LAYOUT *layout;
+		NEIGHBOR_ENTRY *entry;
+		NEIGHBOR_DATA data;
+		LAZURITE_NEIGHBOR *node = &data.data;
+		uint64_t addr;
+		uint8_t addr_len;
+		uint8_t gap;
+
+		if((len < 2) || (len < (layout = mac_getLayout(raw))->header_len)) return;
+		switch(layout->src_addr_len) {
+			case 0:
+				return;
+			case 8:
+				addr = mac_load64(raw + layout->src_addr_offset);
+				addr_len = 8;
+				break;
+			default:
+				addr = mac_getSrcShort(raw,layout);
+				addr_len = 2;
+				break;
+		}
+
+		entry = neighbor_acquire(table,addr,addr_len,&data);
+		node->last_sec = tv_sec;
+		node->last_nsec = tv_nsec;
+		if(rssi >= 0) {
+			node->rssi = rssi;
+			if(!entry->rssi_valid) {
+				node->rssi_min = rssi;
+				node->rssi_max = rssi;
+				entry->rssi_q8 = rssi << 8;
+				entry->rssi_valid = true;
+			} else {
+				if(rssi < node->rssi_min) node->rssi_min = rssi;
+				if(rssi > node->rssi_max) node->rssi_max = rssi;
+				entry->rssi_q8 = neighbor_ewma(entry->rssi_q8,rssi,table->shift);
+			}
+			node->rssi_avg = entry->rssi_q8 / 256.0f;
+		}
+		node->rx_frames++;
+		if(layout->seq_offset) {
+			// gap of 128 or more is taken as frame out of order or reset of the node
+			gap = raw[layout->seq_offset] - entry->last_seq;
+			if(entry->seq_valid && (gap > 1) && (gap < 128)) node->rx_lost += gap - 1;
+			entry->last_seq = raw[layout->seq_offset];
+			entry->seq_valid = true;
+		}
+		neighbor_release(entry,&data,(int64_t)tv_sec * 1000000000 + tv_nsec);
+	}
+
+	extern void neighbor_tx(NEIGHBOR_TABLE *table, uint64_t addr, uint8_t addr_len, int result, int rssi)
+	{
+		NEIGHBOR_ENTRY *entry;
+		NEIGHBOR_DATA data;
+		LAZURITE_NEIGHBOR *node = &data.data;
+		struct timespec now;
+
+		clock_gettime(CLOCK_REALTIME,&now);
+		entry = neighbor_acquire(table,addr,addr_len,&data);
+		if(result >= 0) {
+			node->tx_success++;
+			node->last_sec = now.tv_sec;
+			node->last_nsec = now.tv_nsec;
+			if(rssi >= 0) {
+				node->ack_rssi = rssi;
+				entry->ack_q8 = entry->ack_q8 ? neighbor_ewma(entry->ack_q8,rssi,table->shift) : rssi << 8;
+				node->ack_rssi_avg = entry->ack_q8 / 256.0f;
+			}
+		} else if(result == -EBUSY) {
+			node->tx_cca_fail++;
+		} else if(result == -ENODEV) {
+			node->tx_ack_fail++;
+		} else {
+			node->tx_error++;
+		}
+		neighbor_release(entry,&data,(int64_t)now.tv_sec * 1000000000 + now.tv_nsec);
+	}
+
+	extern int neighbor_get(NEIGHBOR_TABLE *table, uint64_t addr, uint8_t addr_len, LAZURITE_NEIGHBOR *neighbor)
+	{
+		NEIGHBOR_ENTRY *entry;
+		NEIGHBOR_DATA data;
+
+		entry = neighbor_find(table,addr,addr_len);
+		if(!entry) return -ENOENT;
+		neighbor_load(entry,&data);
+		// replaced after it was found
+		if((data.data.addr != addr) || (data.data.addr_len != addr_len)) return -ENOENT;
+		*neighbor = data.data;
+		return 0;
+	}
+
+	extern int neighbor_list(NEIGHBOR_TABLE *table, LAZURITE_NEIGHBOR *neighbors, int num)
+	{
+		NEIGHBOR_ENTRY *entry;
+		NEIGHBOR_DATA data;
+		uint32_t i;
+		int count = 0;
+
+		for(i=0;(i<=table->mask) && (count<num);i++) {
+			entry = &table->entry[i];
+			if(!__atomic_load_n(&entry->addr_len,__ATOMIC_RELAXED)) continue;
+			neighbor_load(entry,&data);
+			// key is set before first data is stored
+			if(!data.data.addr_len) continue;
+			neighbors[count++] = data.data;
+		}
+		return count;
+	}
+
+#ifdef __cplusplus
+};
+#endif
@@ -0,0 +1,111 @@
+/*!
+  @file neighbor-lazurite.h
+  @brief link quality of each neighbor node <br>
+  internal use only. not installed.
+
+  the table has fixed number of slots, and a node is looked up in NEIGHBOR_PROBE slots
+  after hash of its address. each entry is a seqlock: writers of rx and tx path make
+  the sequence odd while they update the entry, and readers copy the entry again when
+  the sequence was changed, so a snapshot is consistent without blocking the radio.
+  only a new node takes the lock of table.
+ */
+#ifndef _NEIGHBOR_LAZURITE_H_
+#define _NEIGHBOR_LAZURITE_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "liblazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define NEIGHBOR_PROBE			8			/*!< slots searched for one node */
+#define NEIGHBOR_CAPACITY		256			/*!< default of capacity */
+#define NEIGHBOR_EWMA_SHIFT		3			/*!< default of ewma_shift. alpha = 1/8 */
+#define NEIGHBOR_WORDS			((sizeof(LAZURITE_NEIGHBOR) + 7) / 8)
+
+	/*! @union NEIGHBOR_DATA
+	  @brief internal use only
+	  snapshot of node. stored and loaded by words, so readers never see a torn word.
+	  */
+	typedef union {
+		LAZURITE_NEIGHBOR data;
+		uint64_t word[NEIGHBOR_WORDS];
+	} NEIGHBOR_DATA;
+
+	/*! @struct NEIGHBOR_ENTRY
+	  @brief internal use only
+	  one node. members other than seq, addr, addr_len and stamp are written only by the
+	  writer which made seq odd.
+	  */
+	typedef struct {
+		uint32_t seq;			/*!< seqlock. odd = being written */
+		uint8_t addr_len;		/*!< key. 0 = free */
+		uint64_t addr;			/*!< key. little endian value of address */
+		int64_t stamp;			/*!< ns of last update. the oldest node is replaced */
+		bool seq_valid;			/*!< last_seq is set */
+		bool rssi_valid;		/*!< rssi of a frame is set */
+		uint8_t last_seq;		/*!< sequence number of last frame */
+		int32_t rssi_q8;		/*!< EWMA of rssi x 256 */
+		int32_t ack_q8;			/*!< EWMA of rssi of ack x 256 */
+		NEIGHBOR_DATA data;
+	} __attribute__((aligned(64))) NEIGHBOR_ENTRY;
+
+	/*! @struct NEIGHBOR_TABLE
+	  @brief internal use only
+	  */
+	typedef struct {
+		pthread_mutex_t lock;	/*!< serialize adding nodes */
+		NEIGHBOR_ENTRY *entry;
+		uint32_t mask;			/*!< number of slots - 1 */
+		uint8_t shift;			/*!< alpha of EWMA = 1 / 2^shift */
+	} NEIGHBOR_TABLE;
+
+	/******************************************************************************/
+	/*! @brief allocate table
+	  @return         table <br> NULL = fail (errno is set)
+	 ******************************************************************************/
+	extern NEIGHBOR_TABLE* neighbor_create(const LAZURITE_NEIGHBOR_PARAM *param);
+
+	extern void neighbor_free(NEIGHBOR_TABLE *table);
+
+	/******************************************************************************/
+	/*! @brief update node by received frame
+	  @param[in]      *raw      frame
+	  @param[in]      len       length of raw
+	  @param[in]      rssi      rssi of frame. 0 > unknown
+	  @param[in]      tv_sec    time when frame was read (CLOCK_REALTIME as neighbor_tx)
+	  @param[in]      tv_nsec   time when frame was read
+	  @note  frames without tx address are ignored.
+	 ******************************************************************************/
+	extern void neighbor_rx(NEIGHBOR_TABLE *table, const uint8_t *raw, uint16_t len, int rssi, time_t tv_sec, long tv_nsec);
+
+	/******************************************************************************/
+	/*! @brief update node by result of send
+	  @param[in]      addr      little endian value of destination
+	  @param[in]      addr_len  2 or 8
+	  @param[in]      result    result of lazurite_send
+	  @param[in]      rssi      rssi of ack. 0 > unknown
+	 ******************************************************************************/
+	extern void neighbor_tx(NEIGHBOR_TABLE *table, uint64_t addr, uint8_t addr_len, int result, int rssi);
+
+	/******************************************************************************/
+	/*! @brief consistent copy of one node
+	  @return         0=success <br> -ENOENT = node is not in table
+	 ******************************************************************************/
+	extern int neighbor_get(NEIGHBOR_TABLE *table, uint64_t addr, uint8_t addr_len, LAZURITE_NEIGHBOR *neighbor);
+
+	/******************************************************************************/
+	/*! @brief consistent copies of nodes in table
+	  @return         number of nodes copied
+	 ******************************************************************************/
+	extern int neighbor_list(NEIGHBOR_TABLE *table, LAZURITE_NEIGHBOR *neighbors, int num);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif	// _NEIGHBOR_LAZURITE_H_
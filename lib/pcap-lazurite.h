@@ -0,0 +1,38 @@
+/*!
+  @file pcap-lazurite.h
+  @brief constants of pcap/pcapng file <br>
+  internal use only. not installed.
+
+  files are written in byte order of host. the byte order magic of section header
+  (or magic of pcap header) tells readers which one is used.
+ */
+#ifndef _PCAP_LAZURITE_H_
+#define _PCAP_LAZURITE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define PCAP_LINKTYPE_IEEE802_15_4_NOFCS	230		/*!< 802.15.4 frame without FCS */
+
+#define PCAPNG_SHB				0x0A0D0D0A	/*!< section header block */
+#define PCAPNG_IDB				0x00000001	/*!< interface description block */
+#define PCAPNG_EPB				0x00000006	/*!< enhanced packet block */
+#define PCAPNG_BYTE_ORDER		0x1A2B3C4D
+#define PCAPNG_OPT_END			0
+#define PCAPNG_OPT_COMMENT		1
+#define PCAPNG_OPT_SHB_USERAPPL	4
+#define PCAPNG_OPT_IF_TSRESOL	9
+#define PCAPNG_ALIGN(n)			(((n) + 3) & ~3)
+
+#define PCAP_MAGIC_USEC			0xA1B2C3D4	/*!< pcap header. timestamp is usec */
+#define PCAP_MAGIC_NSEC			0xA1B23C4D	/*!< pcap header. timestamp is nsec */
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif	// _PCAP_LAZURITE_H_
@@ -0,0 +1,58 @@
+/*!
+  @file probe-lazurite.h
+  @brief static tracepoints (USDT) of send, receive, decode and ioctl <br>
+  internal use only. not installed.
+
+  probes are made by sys/sdt.h (systemtap-sdt-dev) when it is found at build time.
+  a probe is a nop in code and a note in ELF, so its cost is nothing until bpftrace or
+  perf attaches to it. without sys/sdt.h, or with -DLAZURITE_NO_PROBES, they are removed.
+
+  provider is "lazurite". *_entry and *_return are pairs, so time of a call is the
+  difference of their timestamps. return probes of send also carry ns
+  measured by the library.
+  @code
+  send_entry          ctx, length, dst, dst_len (2 or 8), panid (0 for 64bit)
+  send_return         ctx, length, dst, result, ns
+  read_entry          ctx                       (also read_payload_entry, read_link_entry)
+  read_return         ctx, result, size       (also read_payload_return, read_link_return)
+  decmac_entry        raw_size
+  decmac_return       raw_size, result
+  ioctl_entry         ctx, cmd, arg
+  ioctl_return        ctx, cmd, result
+  write_entry         ctx, length
+  write_return        ctx, length, result
+  rx_syscall          ctx, size, result, ns
+  @endcode
+  dst is little endian value of 16bit or 64bit address. result of send is -EBUSY at CCA
+  fail and -ENODEV at ACK fail. ioctl and write between send_entry and send_return show
+  where the time of a send was spent.
+  @code
+  bpftrace -e 'usdt:/usr/lib/liblazurite.so:lazurite:send_return { @[arg3] = hist(arg4); }'
+  @endcode
+ */
+#ifndef _PROBE_LAZURITE_H_
+#define _PROBE_LAZURITE_H_
+
+#if !defined(LAZURITE_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PROBE_ENABLED	1
+#endif
+#endif
+
+#ifdef PROBE_ENABLED
+#define PROBE1(name,a)				DTRACE_PROBE1(lazurite,name,a)
+#define PROBE2(name,a,b)			DTRACE_PROBE2(lazurite,name,a,b)
+#define PROBE3(name,a,b,c)			DTRACE_PROBE3(lazurite,name,a,b,c)
+#define PROBE4(name,a,b,c,d)		DTRACE_PROBE4(lazurite,name,a,b,c,d)
+#define PROBE5(name,a,b,c,d,e)		DTRACE_PROBE5(lazurite,name,a,b,c,d,e)
+#else
+// arguments are not evaluated, but they are used
+#define PROBE1(name,a)				do { if(0) { (void)(a); } } while(0)
+#define PROBE2(name,a,b)			do { if(0) { (void)(a); (void)(b); } } while(0)
+#define PROBE3(name,a,b,c)			do { if(0) { (void)(a); (void)(b); (void)(c); } } while(0)
+#define PROBE4(name,a,b,c,d)		do { if(0) { (void)(a); (void)(b); (void)(c); (void)(d); } } while(0)
+#define PROBE5(name,a,b,c,d,e)		do { if(0) { (void)(a); (void)(b); (void)(c); (void)(d); (void)(e); } } while(0)
+#endif
+
+#endif	// _PROBE_LAZURITE_H_
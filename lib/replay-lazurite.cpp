@@ -0,0 +1,645 @@
+/*!
+  @file replay-lazurite.cpp
+  @brief replay of capture file for liblazurite <br>
+  lazurite_backend_replay receives frames of pcap/pcapng file instead of radio,
+  so lazurite_read, lazurite_readPayload, lazurite_readLink, dispatcher and rx thread
+  can be driven by recorded traffic.
+
+  @code
+  LAZURITE_REPLAY_PARAM param = {0};	// speed 0 = as fast as possible
+  lazurite_setReplay("rx.pcapng",&param);
+  lazurite_setBackend(&lazurite_backend_replay);
+  lazurite_init();
+  @endcode
+
+  link type 230 (IEEE 802.15.4 without FCS) and 195 (with FCS, removed) are replayed.
+  packets of other link types are skipped. RSSI is taken from comment "rssi=N"
+  written by lazurite_openCapture, and receiving time is timestamp in the file.<br>
+  the file is indexed when it is opened. descriptor is timerfd which is armed at the
+  time the next frame is due, so it can be used with poll/epoll like LazDriver.
+  frames are sent nowhere by write.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include "ioctl-lazurite.h"
+#include "liblazurite.h"
+#include "pcap-lazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define REPLAY_FRAME_SIZE		256		/*!< larger packets are skipped */
+#define REPLAY_LINKTYPE_FCS		195		/*!< IEEE 802.15.4 with FCS */
+#define REPLAY_MAX_IF			16		/*!< interfaces in a section of pcapng */
+#define REPLAY_MAC_ADDR			0x001D12D0FFFFFFFFULL	/*!< 64bit address of replay */
+
+	/*! @struct REPLAY_FRAME
+	  @brief internal use only
+	  index of frame in the file
+	  */
+	typedef struct {
+		size_t offset;
+		uint16_t len;
+		uint8_t rssi;
+		uint64_t ts;			/*!< nsec */
+	} REPLAY_FRAME;
+
+	/*! @struct REPLAY_NODE
+	  @brief internal use only
+	  state of one opened file
+	  */
+	typedef struct replay_node {
+		struct replay_node *next;
+		int fd;					/*!< timerfd. readable while next frame is due */
+		const uint8_t *data;	/*!< mapped file */
+		size_t size;
+		REPLAY_FRAME *frame;
+		uint32_t num;
+		uint32_t index;			/*!< next frame */
+		uint64_t ts_max;		/*!< latest timestamp of frames. end of a round of loop */
+		LAZURITE_REPLAY_PARAM param;
+		int64_t start;			/*!< monotonic time (nsec) which 1st frame is due */
+		bool armed;				/*!< timer is armed for a frame in future */
+		bool pending;			/*!< length has been read. frame is next */
+		const REPLAY_FRAME *cur;	/*!< frame being read */
+		uint8_t rx_rssi;
+		struct timespec rx_time;
+		uint16_t my_short_addr;
+	} REPLAY_NODE;
+
+	static pthread_mutex_t replay_lock = PTHREAD_MUTEX_INITIALIZER;
+	static REPLAY_NODE *replays = NULL;
+	static char replay_path[PATH_MAX];
+	static LAZURITE_REPLAY_PARAM replay_param;
+
+	/******************************************************************************/
+	/*! @brief find node of descriptor. replay_lock must be held.
+	 ******************************************************************************/
+	static REPLAY_NODE* replay_find(int fd)
+	{
+		REPLAY_NODE *node;
+		for(node=replays;node;node=node->next) {
+			if(node->fd == fd) return node;
+		}
+		return NULL;
+	}
+
+	static int64_t replay_now(void)
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	}
+
+	static uint32_t replay_get32(const uint8_t *p, bool swap)
+	{
+		uint32_t value;
+		memcpy(&value,p,4);
+		return swap ? __builtin_bswap32(value) : value;
+	}
+
+	static uint16_t replay_get16(const uint8_t *p, bool swap)
+	{
+		uint16_t value;
+		memcpy(&value,p,2);
+		return swap ? __builtin_bswap16(value) : value;
+	}
+
+	/******************************************************************************/
+	/*! @brief add packet to index
+	  @return         0=success <br> -ENOMEM
+	 ******************************************************************************/
+	static int replay_add(REPLAY_NODE *node, uint32_t *alloc, size_t offset, uint32_t len,
+			uint16_t linktype, uint64_t ts, uint8_t rssi)
+	{
+		REPLAY_FRAME *grown;
+
+		if(linktype == REPLAY_LINKTYPE_FCS) {
+			if(len < 2) return 0;
+			len -= 2;
+		} else if(linktype != PCAP_LINKTYPE_IEEE802_15_4_NOFCS) {
+			return 0;
+		}
+		if(len > REPLAY_FRAME_SIZE) return 0;
+		if(node->num == *alloc) {
+			*alloc = *alloc ? *alloc * 2 : 1024;
+			grown = (REPLAY_FRAME*)realloc(node->frame,sizeof(REPLAY_FRAME) * *alloc);
+			if(!grown) return -ENOMEM;
+			node->frame = grown;
+		}
+		node->frame[node->num].offset = offset;
+		node->frame[node->num].len = len;
+		node->frame[node->num].rssi = rssi;
+		node->frame[node->num].ts = ts;
+		if(ts > node->ts_max) node->ts_max = ts;
+		node->num++;
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief index packets of pcap file
+	  @return         0=success <br> -EINVAL = broken file
+	 ******************************************************************************/
+	static int replay_pcap(REPLAY_NODE *node)
+	{
+		const uint8_t *p = node->data;
+		uint32_t magic, len, alloc = 0;
+		uint16_t linktype;
+		uint64_t ts;
+		size_t offset;
+		bool swap, nsec;
+		int result;
+
+		magic = replay_get32(p,false);
+		swap = (magic == __builtin_bswap32(PCAP_MAGIC_USEC)) || (magic == __builtin_bswap32(PCAP_MAGIC_NSEC));
+		nsec = (magic == PCAP_MAGIC_NSEC) || (magic == __builtin_bswap32(PCAP_MAGIC_NSEC));
+		linktype = replay_get32(p + 20,swap);
+		for(offset=24;offset + 16 <= node->size;offset += 16 + len) {
+			len = replay_get32(p + offset + 8,swap);
+			if(offset + 16 + len > node->size) return -EINVAL;
+			ts = (uint64_t)replay_get32(p + offset,swap) * 1000000000ULL +
+				(uint64_t)replay_get32(p + offset + 4,swap) * (nsec ? 1 : 1000);
+			result = replay_add(node,&alloc,offset + 16,len,linktype,ts,0);
+			if(result) return result;
+		}
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief timestamp of pcapng to nsec
+	  @param[in]      tsresol   option if_tsresol. 0 = default (usec)
+	 ******************************************************************************/
+	static uint64_t replay_nsec(uint64_t ts, uint8_t tsresol)
+	{
+		uint8_t exp = tsresol & 0x7f;
+		uint64_t scale = 1;
+
+		if(!tsresol) return ts * 1000;
+		if(tsresol & 0x80) return (uint64_t)(((unsigned __int128)ts * 1000000000ULL) >> exp);
+		if(exp <= 9) {
+			while(exp++ < 9) scale *= 10;
+			return ts * scale;
+		}
+		while(exp-- > 9) scale *= 10;
+		return ts / scale;
+	}
+
+	/******************************************************************************/
+	/*! @brief RSSI in comment of packet ("rssi=N")
+	  @return         RSSI <br> 0 = no comment
+	 ******************************************************************************/
+	static uint8_t replay_rssi(const uint8_t *opt, const uint8_t *end, bool swap)
+	{
+		uint16_t code, len;
+		char comment[16];
+
+		while(opt + 4 <= end) {
+			code = replay_get16(opt,swap);
+			len = replay_get16(opt + 2,swap);
+			if((code == PCAPNG_OPT_END) || (opt + 4 + len > end)) break;
+			if((code == PCAPNG_OPT_COMMENT) && (len > 5) && (len < sizeof(comment)) &&
+					(memcmp(opt + 4,"rssi=",5) == 0)) {
+				memcpy(comment,opt + 9,len - 5);
+				comment[len - 5] = 0;
+				return strtoul(comment,NULL,10);
+			}
+			opt += 4 + PCAPNG_ALIGN(len);
+		}
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief index packets of pcapng file
+	  @return         0=success <br> -EINVAL = broken file
+	 ******************************************************************************/
+	static int replay_pcapng(REPLAY_NODE *node)
+	{
+		const uint8_t *p = node->data;
+		const uint8_t *opt, *end;
+		uint16_t linktype[REPLAY_MAX_IF];
+		uint8_t tsresol[REPLAY_MAX_IF];
+		uint32_t type, len, caplen, id, alloc = 0;
+		uint32_t interfaces = 0;
+		uint16_t code, optlen;
+		uint64_t ts;
+		size_t offset;
+		bool swap = false;
+		int result;
+
+		for(offset=0;offset + 12 <= node->size;offset += len) {
+			type = replay_get32(p + offset,swap);
+			if(type == PCAPNG_SHB) {
+				swap = replay_get32(p + offset + 8,false) != PCAPNG_BYTE_ORDER;
+				interfaces = 0;
+			}
+			len = replay_get32(p + offset + 4,swap);
+			if((len < 12) || (len & 3) || (offset + len > node->size)) return -EINVAL;
+			end = p + offset + len - 4;
+			switch(type) {
+				case PCAPNG_IDB:
+					if((len < 20) || (interfaces == REPLAY_MAX_IF)) break;
+					linktype[interfaces] = replay_get16(p + offset + 8,swap);
+					tsresol[interfaces] = 0;
+					for(opt = p + offset + 16;opt + 4 <= end;opt += 4 + PCAPNG_ALIGN(optlen)) {
+						code = replay_get16(opt,swap);
+						optlen = replay_get16(opt + 2,swap);
+						if(code == PCAPNG_OPT_END) break;
+						if((code == PCAPNG_OPT_IF_TSRESOL) && (optlen == 1)) tsresol[interfaces] = opt[4];
+					}
+					interfaces++;
+					break;
+				case PCAPNG_EPB:
+					if(len < 32) return -EINVAL;
+					id = replay_get32(p + offset + 8,swap);
+					caplen = replay_get32(p + offset + 20,swap);
+					if(p + offset + 28 + caplen > end) return -EINVAL;
+					if(id >= interfaces) break;
+					ts = ((uint64_t)replay_get32(p + offset + 12,swap) << 32) | replay_get32(p + offset + 16,swap);
+					result = replay_add(node,&alloc,offset + 28,caplen,linktype[id],replay_nsec(ts,tsresol[id]),
+							replay_rssi(p + offset + 28 + PCAPNG_ALIGN(caplen),end,swap));
+					if(result) return result;
+					break;
+				default:
+					break;
+			}
+		}
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief time (monotonic nsec) which timestamp of file is due
+	  timestamps may go back in a capture. one before 1st frame is due at start, and
+	  frames are taken in order of file, so it comes just after the frame before it.
+	 ******************************************************************************/
+	static inline int64_t replay_due(const REPLAY_NODE *node, uint64_t ts)
+	{
+		if(node->param.speed <= 0) return node->start;
+		if(ts <= node->frame[0].ts) return node->start;
+		return node->start + (int64_t)((ts - node->frame[0].ts) / node->param.speed);
+	}
+
+	/******************************************************************************/
+	/*! @brief arm timer for next frame after frames are taken. replay_lock must be held.
+	  timer is not touched while next frame is already due, because descriptor is kept readable
+	  by expiration which is not read.
+	 ******************************************************************************/
+	static void replay_arm(REPLAY_NODE *node, int64_t now)
+	{
+		struct itimerspec its;
+		uint64_t tmp;
+		int64_t due;
+
+		if((node->index == node->num) && node->param.loop && node->num) {
+			// next round starts when latest frame was due
+			node->start = replay_due(node,node->ts_max);
+			if(node->start < now) node->start = now;
+			node->index = 0;
+		}
+		memset(&its,0,sizeof(its));
+		if(node->index < node->num) {
+			due = replay_due(node,node->frame[node->index].ts);
+			if(due <= now) return;
+			its.it_value.tv_sec = due / 1000000000;
+			its.it_value.tv_nsec = due % 1000000000;
+		}
+		// clear expiration of the frame taken. timer is disarmed at end of file
+		if(read(node->fd,&tmp,sizeof(tmp)) < 0) {}
+		timerfd_settime(node->fd,TFD_TIMER_ABSTIME,&its,NULL);
+	}
+
+	/******************************************************************************/
+	/*! @brief next frame if it is due. replay_lock must be held.
+	 ******************************************************************************/
+	static const REPLAY_FRAME* replay_next(REPLAY_NODE *node, int64_t *now)
+	{
+		const REPLAY_FRAME *frame;
+
+		if(node->index >= node->num) return NULL;
+		frame = &node->frame[node->index];
+		if(node->param.speed > 0) {
+			if(!*now) *now = replay_now();
+			if(replay_due(node,frame->ts) > *now) return NULL;
+		}
+		node->index++;
+		return frame;
+	}
+
+	static int replay_load(uint16_t testmode)
+	{
+		return 0;
+	}
+
+	static int replay_unload(void)
+	{
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief open file and index frames
+	  @param[in]      path   file. "replay" or NULL = file of lazurite_setReplay
+	  @return         descriptor <br> 0 < fail
+	 ******************************************************************************/
+	static int replay_open(const char* path)
+	{
+		REPLAY_NODE *node;
+		struct stat st;
+		struct itimerspec its;
+		uint32_t magic;
+		int file, err;
+		int result = -EINVAL;
+
+		node = (REPLAY_NODE*)calloc(1,sizeof(REPLAY_NODE));
+		if(!node) return -1;
+		pthread_mutex_lock(&replay_lock);
+		if(!path || (strcmp(path,lazurite_backend_replay.path) == 0)) path = replay_path;
+		node->param = replay_param;
+		file = open(path,O_RDONLY | O_CLOEXEC);
+		pthread_mutex_unlock(&replay_lock);
+		if(file < 0) {
+			free(node);
+			return -1;
+		}
+		if((fstat(file,&st) == 0) && (st.st_size >= 24)) {
+			node->size = st.st_size;
+			node->data = (const uint8_t*)mmap(NULL,node->size,PROT_READ,MAP_PRIVATE,file,0);
+			if(node->data == MAP_FAILED) {
+				node->data = NULL;
+				result = -errno;
+			}
+		}
+		close(file);
+		if(node->data) {
+			magic = replay_get32(node->data,false);
+			if(magic == PCAPNG_SHB) result = replay_pcapng(node);
+			else if((magic == PCAP_MAGIC_USEC) || (magic == PCAP_MAGIC_NSEC) ||
+					(magic == __builtin_bswap32(PCAP_MAGIC_USEC)) || (magic == __builtin_bswap32(PCAP_MAGIC_NSEC))) {
+				result = replay_pcap(node);
+			}
+		}
+		if(!result) {
+			node->fd = timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK | TFD_CLOEXEC);
+			if(node->fd < 0) result = -errno;
+		}
+		if(result) {
+			err = -result;
+			if(node->data) munmap((void*)node->data,node->size);
+			free(node->frame);
+			free(node);
+			errno = err;
+			return -1;
+		}
+
+		// timer of 1st frame. expiration in the past makes descriptor readable at once
+		node->start = replay_now();
+		node->my_short_addr = REPLAY_MAC_ADDR & 0xffff;
+		memset(&its,0,sizeof(its));
+		its.it_value.tv_sec = node->start / 1000000000;
+		its.it_value.tv_nsec = node->start % 1000000000;
+		if(node->num) timerfd_settime(node->fd,TFD_TIMER_ABSTIME,&its,NULL);
+
+		pthread_mutex_lock(&replay_lock);
+		node->next = replays;
+		replays = node;
+		pthread_mutex_unlock(&replay_lock);
+		return node->fd;
+	}
+
+	static int replay_close(int fd)
+	{
+		REPLAY_NODE **pp;
+		REPLAY_NODE *node = NULL;
+
+		pthread_mutex_lock(&replay_lock);
+		for(pp=&replays;*pp;pp=&(*pp)->next) {
+			if((*pp)->fd == fd) {
+				node = *pp;
+				*pp = node->next;
+				break;
+			}
+		}
+		pthread_mutex_unlock(&replay_lock);
+		if(!node) {
+			errno = EBADF;
+			return -1;
+		}
+		close(node->fd);
+		munmap((void*)node->data,node->size);
+		free(node->frame);
+		free(node);
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief frames are not sent anywhere
+	 ******************************************************************************/
+	static int replay_write(int fd, const void* buf, size_t count)
+	{
+		return count;
+	}
+
+	static inline void replay_taken(REPLAY_NODE *node, const REPLAY_FRAME *frame)
+	{
+		node->rx_rssi = frame->rssi;
+		node->rx_time.tv_sec = frame->ts / 1000000000;
+		node->rx_time.tv_nsec = frame->ts % 1000000000;
+	}
+
+	/******************************************************************************/
+	/*! @brief read same as LazDriver
+	  1st read returns 2byte length of frame (0 = no frame is due), 2nd read returns the frame.
+	 ******************************************************************************/
+	static int replay_read(int fd, void* buf, size_t count)
+	{
+		REPLAY_NODE *node;
+		uint16_t len;
+		int64_t now = 0;
+		int result;
+
+		pthread_mutex_lock(&replay_lock);
+		node = replay_find(fd);
+		if(!node) {
+			pthread_mutex_unlock(&replay_lock);
+			errno = EBADF;
+			return -1;
+		}
+		if(!node->pending) {
+			if(count < sizeof(len)) {
+				pthread_mutex_unlock(&replay_lock);
+				errno = EINVAL;
+				return -1;
+			}
+			node->cur = replay_next(node,&now);
+			if(!node->cur) {
+				pthread_mutex_unlock(&replay_lock);
+				return 0;
+			}
+			node->pending = true;
+			replay_arm(node,now ? now : replay_now());
+			len = node->cur->len;
+			memcpy(buf,&len,sizeof(len));
+			result = sizeof(len);
+		} else {
+			result = count < node->cur->len ? count : node->cur->len;
+			memcpy(buf,node->data + node->cur->offset,result);
+			node->pending = false;
+			replay_taken(node,node->cur);
+		}
+		pthread_mutex_unlock(&replay_lock);
+		return result;
+	}
+
+	static inline void replay_copy(LAZURITE_FRAME* frame, const REPLAY_NODE *node, const REPLAY_FRAME *src)
+	{
+		frame->len = src->len;
+		frame->rssi = src->rssi;
+		frame->tv_sec = src->ts / 1000000000;
+		frame->tv_nsec = src->ts % 1000000000;
+		memcpy(frame->raw,node->data + src->offset,src->len);
+	}
+
+	/******************************************************************************/
+	/*! @brief take due frames under one lock
+	  @return         number of frames
+	 ******************************************************************************/
+	static int replay_recv(int fd, LAZURITE_FRAME* frames, int num)
+	{
+		REPLAY_NODE *node;
+		const REPLAY_FRAME *frame = NULL;
+		const REPLAY_FRAME *next;
+		int64_t now = 0;
+		int i = 0;
+
+		pthread_mutex_lock(&replay_lock);
+		node = replay_find(fd);
+		if(!node) {
+			pthread_mutex_unlock(&replay_lock);
+			errno = EBADF;
+			return -1;
+		}
+		if(node->pending && (num > 0)) {
+			frame = node->cur;
+			replay_copy(&frames[i++],node,frame);
+			node->pending = false;
+		}
+		for(;i<num;i++) {
+			next = replay_next(node,&now);
+			if(!next && node->param.loop && (node->index == node->num)) {
+				// loop starts again from top
+				replay_arm(node,now ? now : replay_now());
+				next = replay_next(node,&now);
+			}
+			if(!next) break;
+			frame = next;
+			replay_copy(&frames[i],node,frame);
+		}
+		if(i) {
+			replay_taken(node,frame ? frame : node->cur);
+			replay_arm(node,now ? now : replay_now());
+		}
+		pthread_mutex_unlock(&replay_lock);
+		return i;
+	}
+
+	/******************************************************************************/
+	/*! @brief IOCTL_PARAM/IOCTL_CMD of LazDriver
+	  setter returns the value which is set. command returns 0. receiving time and RSSI are of last frame.
+	 ******************************************************************************/
+	static int replay_ioctl(int fd, unsigned long cmd, unsigned long arg)
+	{
+		REPLAY_NODE *node;
+		int result = arg;
+
+		pthread_mutex_lock(&replay_lock);
+		node = replay_find(fd);
+		if(!node) {
+			pthread_mutex_unlock(&replay_lock);
+			errno = EBADF;
+			return -1;
+		}
+		switch(cmd) {
+			case IOCTL_PARAM | IOCTL_GET_MY_ADDR0:
+				result = (REPLAY_MAC_ADDR >> 48) & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_MY_ADDR1:
+				result = (REPLAY_MAC_ADDR >> 32) & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_MY_ADDR2:
+				result = (REPLAY_MAC_ADDR >> 16) & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_MY_ADDR3:
+				result = REPLAY_MAC_ADDR & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_MY_SHORT_ADDR:
+				result = node->my_short_addr;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_MY_SHORT_ADDR:
+				result = node->my_short_addr = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_RX_SEC1:
+				result = (node->rx_time.tv_sec >> 16) & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_RX_SEC0:
+				result = node->rx_time.tv_sec & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_RX_NSEC1:
+				result = (node->rx_time.tv_nsec >> 16) & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_RX_NSEC0:
+				result = node->rx_time.tv_nsec & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_RX_RSSI:
+				result = node->rx_rssi;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_EACK_DATA:
+			case IOCTL_PARAM | IOCTL_GET_EACK:
+				result = 0;
+				break;
+			default:
+				break;
+		}
+		pthread_mutex_unlock(&replay_lock);
+		return result;
+	}
+
+	extern "C" int lazurite_setReplay(const char* path, const LAZURITE_REPLAY_PARAM* param)
+	{
+		if(!path) return -EINVAL;
+		if(strlen(path) >= sizeof(replay_path)) return -ENAMETOOLONG;
+		pthread_mutex_lock(&replay_lock);
+		strcpy(replay_path,path);
+		if(param) replay_param = *param;
+		else memset(&replay_param,0,sizeof(replay_param));
+		pthread_mutex_unlock(&replay_lock);
+		return 0;
+	}
+
+	extern "C" const LAZURITE_BACKEND lazurite_backend_replay = {
+		"replay",
+		"replay",
+		replay_load,
+		replay_unload,
+		replay_open,
+		replay_close,
+		replay_ioctl,
+		replay_read,
+		replay_write,
+		replay_recv,
+	};
+
+#ifdef __cplusplus
+};
+#endif
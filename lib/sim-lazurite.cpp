@@ -0,0 +1,630 @@
+/*!
+  @file sim-lazurite.cpp
+  @brief simulated radio for liblazurite <br>
+  lazurite_backend_sim answers same IOCTL_PARAM/IOCTL_CMD as LazDriver and
+  delivers frames between instances in this process.
+
+  @code
+  lazurite_setBackend(&lazurite_backend_sim);
+  lazurite_init();
+  @endcode
+
+  every instance opened by lazurite_backend_sim.open() is one node on the same air.
+  a frame written by a node is received by other nodes which have same ch and
+  rxEnable, when panid and address are matched (or in promiscuous mode).
+  descriptor of a node is eventfd which is readable while frames are queued,
+  so it can be used with poll/epoll.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include "ioctl-lazurite.h"
+#include "liblazurite.h"
+
+#ifdef __cplusplus
+namespace lazurite
+{
+#endif
+
+#define SIM_RX_QUEUE	256		/*!< number of frames queued in a node */
+#define SIM_FRAME_SIZE	256		/*!< max size of frame */
+#define SIM_MAC_HIGH	0x001D12D000000000ULL	/*!< 64bit address of 1st node is SIM_MAC_HIGH + 1 */
+#define SIM_RSSI		200		/*!< rssi of received frame and ack */
+
+	/*! @struct SIM_FRAME
+	  @brief internal use only
+	  frame in rx queue of node
+	  */
+	typedef struct {
+		uint16_t len;
+		uint8_t rssi;
+		struct timespec time;
+		uint8_t data[SIM_FRAME_SIZE];
+	} SIM_FRAME;
+
+	/*! @struct SIM_SEND_MODE
+	  @brief internal use only
+	  parameters accessed by IOCTL_GET_SEND_MODE/IOCTL_SET_SEND_MODE
+	  */
+	typedef struct {
+		uint8_t addr_type;
+		uint8_t sense_time;
+		uint8_t tx_retry;
+		uint16_t tx_interval;
+		uint8_t cca_wait;
+	} SIM_SEND_MODE;
+
+	/*! @struct SIM_NODE
+	  @brief internal use only
+	  state of one simulated radio
+	  */
+	typedef struct sim_node {
+		struct sim_node *next;
+		int fd;					/*!< eventfd. not 0 while frames are queued */
+		// parameters
+		uint8_t ch;
+		uint8_t bps;
+		uint8_t pwr;
+		uint16_t my_panid;
+		uint16_t my_short_addr;
+		uint64_t my_addr64;
+		uint16_t dst_panid;
+		uint16_t dst_addr[4];	/*!< dst_addr[0] is lower 16bit */
+		bool begin;
+		bool rxon;
+		bool promiscuous;
+		bool ack_req;
+		bool broadcast;
+		uint8_t seq;
+		SIM_SEND_MODE mode;		/*!< send mode in use */
+		SIM_SEND_MODE stage;	/*!< send mode between GET_SEND_MODE and SET_SEND_MODE */
+		uint8_t eack_enb;
+		uint16_t eack_len;
+		uint8_t eack_data[16];
+		uint8_t tx_rssi;
+		// receiving
+		SIM_FRAME queue[SIM_RX_QUEUE];
+		uint16_t head;
+		uint16_t count;
+		uint32_t overflow;
+		bool pending;			/*!< length has been read. frame is next */
+		SIM_FRAME cur;			/*!< frame being read */
+		uint8_t rx_rssi;
+		struct timespec rx_time;
+	} SIM_NODE;
+
+	static pthread_mutex_t air_lock = PTHREAD_MUTEX_INITIALIZER;
+	static SIM_NODE *air = NULL;	/*!< all nodes in this process */
+	static uint32_t node_serial = 0;
+
+	/******************************************************************************/
+	/*! @brief find node of descriptor. air_lock must be held.
+	 ******************************************************************************/
+	static SIM_NODE* sim_find(int fd)
+	{
+		SIM_NODE *node;
+		for(node=air;node;node=node->next) {
+			if(node->fd == fd) return node;
+		}
+		return NULL;
+	}
+
+	static int sim_load(uint16_t testmode)
+	{
+		return 0;
+	}
+
+	static int sim_unload(void)
+	{
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief add new node to the air
+	  @param[in]      path   ignored
+	  @return         descriptor of node <br> 0 < fail
+	 ******************************************************************************/
+	static int sim_open(const char* path)
+	{
+		SIM_NODE *node;
+
+		node = (SIM_NODE*)calloc(1,sizeof(SIM_NODE));
+		if(!node) return -1;
+		node->fd = eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+		if(node->fd < 0) {
+			free(node);
+			return -1;
+		}
+		node->ch = 36;
+		node->bps = 100;
+		node->pwr = 20;
+		node->my_panid = 0xffff;
+		node->dst_panid = 0xffff;
+		node->dst_addr[0] = 0xffff;
+		node->ack_req = true;
+		node->broadcast = true;
+		node->mode.addr_type = 6;
+		node->mode.sense_time = 20;
+		node->mode.tx_retry = 3;
+		node->mode.tx_interval = 500;
+		node->mode.cca_wait = 7;
+		node->stage = node->mode;
+
+		pthread_mutex_lock(&air_lock);
+		node->my_addr64 = SIM_MAC_HIGH + (++node_serial);
+		node->my_short_addr = node->my_addr64 & 0xffff;
+		node->next = air;
+		air = node;
+		pthread_mutex_unlock(&air_lock);
+
+		return node->fd;
+	}
+
+	static int sim_close(int fd)
+	{
+		SIM_NODE **pp;
+		SIM_NODE *node = NULL;
+
+		pthread_mutex_lock(&air_lock);
+		for(pp=&air;*pp;pp=&(*pp)->next) {
+			if((*pp)->fd == fd) {
+				node = *pp;
+				*pp = node->next;
+				break;
+			}
+		}
+		pthread_mutex_unlock(&air_lock);
+		if(!node) {
+			errno = EBADF;
+			return -1;
+		}
+		close(node->fd);
+		free(node);
+		return 0;
+	}
+
+	/******************************************************************************/
+	/*! @brief build ieee802154e header of data frame
+	  @return         length of header
+	 ******************************************************************************/
+	static int sim_header(SIM_NODE *node, uint8_t *p, bool *unicast)
+	{
+		int offset = 0;
+		int i;
+		uint8_t addr_type = node->mode.addr_type & 0x07;
+		bool dst64 = node->dst_addr[1] || node->dst_addr[2] || node->dst_addr[3];
+		uint8_t addr_mode = dst64 ? 3 : 2;
+		uint16_t fc;
+
+		*unicast = (addr_type & 0x04) && (dst64 || (node->dst_addr[0] != 0xffff));
+
+		fc = 0x0001;									// data frame
+		if(*unicast && node->ack_req) fc |= 1 << 5;
+		if(addr_type & 0x01) fc |= 1 << 6;				// panid comp
+		if(addr_type & 0x04) fc |= addr_mode << 10;
+		fc |= 2 << 12;									// frame version
+		if(addr_type & 0x02) fc |= addr_mode << 14;
+		p[offset++] = fc & 0xff;
+		p[offset++] = fc >> 8;
+		p[offset++] = node->seq++;
+		// dst panid
+		if((addr_type == 1) || (addr_type == 4) || (addr_type == 6)) {
+			p[offset++] = node->dst_panid & 0xff;
+			p[offset++] = node->dst_panid >> 8;
+		}
+		// dst addr
+		if(addr_type & 0x04) {
+			for(i=0;i<(dst64 ? 4 : 1);i++) {
+				p[offset++] = node->dst_addr[i] & 0xff;
+				p[offset++] = node->dst_addr[i] >> 8;
+			}
+		}
+		// src panid
+		if(addr_type == 2) {
+			p[offset++] = node->my_panid & 0xff;
+			p[offset++] = node->my_panid >> 8;
+		}
+		// src addr
+		if(addr_type & 0x02) {
+			if(dst64) {
+				for(i=0;i<8;i++) p[offset++] = (node->my_addr64 >> (i*8)) & 0xff;
+			} else {
+				p[offset++] = node->my_short_addr & 0xff;
+				p[offset++] = node->my_short_addr >> 8;
+			}
+		}
+		return offset;
+	}
+
+	/******************************************************************************/
+	/*! @brief check whether rx node accepts frame of tx node
+	  @return         0 = not received <br> 1 = received <br> 2 = received by address
+	 ******************************************************************************/
+	static int sim_match(SIM_NODE *tx, SIM_NODE *rx)
+	{
+		uint8_t addr_type = tx->mode.addr_type & 0x07;
+		bool dst64 = tx->dst_addr[1] || tx->dst_addr[2] || tx->dst_addr[3];
+
+		if(!rx->begin || !rx->rxon) return 0;
+		if((rx->ch != tx->ch) || (rx->bps != tx->bps)) return 0;
+		if((addr_type == 1) || (addr_type == 4) || (addr_type == 6)) {
+			if((tx->dst_panid != rx->my_panid) && (tx->dst_panid != 0xffff))
+				return rx->promiscuous ? 1 : 0;
+		}
+		if(addr_type & 0x04) {
+			if(dst64) {
+				uint64_t dst = ((uint64_t)tx->dst_addr[3] << 48) | ((uint64_t)tx->dst_addr[2] << 32) |
+					((uint64_t)tx->dst_addr[1] << 16) | tx->dst_addr[0];
+				if(dst == rx->my_addr64) return 2;
+			} else {
+				if(tx->dst_addr[0] == rx->my_short_addr) return 2;
+				if((tx->dst_addr[0] == 0xffff) && rx->broadcast) return 1;
+			}
+			return rx->promiscuous ? 1 : 0;
+		}
+		return 1;
+	}
+
+	/******************************************************************************/
+	/*! @brief push frame to rx queue of node. air_lock must be held.
+	 ******************************************************************************/
+	static void sim_deliver(SIM_NODE *rx, const uint8_t *data, uint16_t len, const struct timespec *now)
+	{
+		SIM_FRAME *frame;
+
+		if(rx->count >= SIM_RX_QUEUE) {
+			rx->overflow++;
+			return;
+		}
+		frame = &rx->queue[(rx->head + rx->count) % SIM_RX_QUEUE];
+		frame->len = len;
+		frame->rssi = SIM_RSSI;
+		frame->time = *now;
+		memcpy(frame->data,data,len);
+		if(rx->count++ == 0) eventfd_write(rx->fd,1);
+	}
+
+	/******************************************************************************/
+	/*! @brief pop frame from rx queue of node. air_lock must be held.
+	 ******************************************************************************/
+	static void sim_pop(SIM_NODE *node, SIM_FRAME *frame)
+	{
+		eventfd_t tmp;
+
+		*frame = node->queue[node->head];
+		node->head = (node->head + 1) % SIM_RX_QUEUE;
+		if(--node->count == 0) eventfd_read(node->fd,&tmp);
+	}
+
+	/******************************************************************************/
+	/*! @brief send payload to the air
+	  @return         size of payload <br> -1 with errno. ENODEV = ACK Fail
+	 ******************************************************************************/
+	static int sim_write(int fd, const void* buf, size_t count)
+	{
+		SIM_NODE *tx, *rx;
+		uint8_t frame[SIM_FRAME_SIZE];
+		int len;
+		bool unicast;
+		bool acked = false;
+		struct timespec now;
+		int result;
+
+		pthread_mutex_lock(&air_lock);
+		tx = sim_find(fd);
+		if(!tx) {
+			pthread_mutex_unlock(&air_lock);
+			errno = EBADF;
+			return -1;
+		}
+		if(!tx->begin) {
+			pthread_mutex_unlock(&air_lock);
+			errno = EIO;
+			return -1;
+		}
+		len = sim_header(tx,frame,&unicast);
+		if(len + count >= SIM_FRAME_SIZE) {
+			tx->seq--;
+			pthread_mutex_unlock(&air_lock);
+			errno = EFBIG;
+			return -1;
+		}
+		memcpy(frame+len,buf,count);
+		len += count;
+
+		clock_gettime(CLOCK_REALTIME,&now);
+		for(rx=air;rx;rx=rx->next) {
+			if(rx == tx) continue;
+			result = sim_match(tx,rx);
+			if(result == 0) continue;
+			if(result == 2) acked = true;
+			sim_deliver(rx,frame,len,&now);
+		}
+		if(unicast && tx->ack_req) {
+			if(!acked) {
+				pthread_mutex_unlock(&air_lock);
+				errno = ENODEV;
+				return -1;
+			}
+			tx->tx_rssi = SIM_RSSI;
+		}
+		pthread_mutex_unlock(&air_lock);
+		return count;
+	}
+
+	/******************************************************************************/
+	/*! @brief read same as LazDriver
+	  1st read returns 2byte length of frame (0 = no frame), 2nd read returns the frame.
+	 ******************************************************************************/
+	static int sim_read(int fd, void* buf, size_t count)
+	{
+		SIM_NODE *node;
+		uint16_t len;
+		int result;
+
+		pthread_mutex_lock(&air_lock);
+		node = sim_find(fd);
+		if(!node) {
+			pthread_mutex_unlock(&air_lock);
+			errno = EBADF;
+			return -1;
+		}
+		if(!node->pending) {
+			if(node->count == 0) {
+				pthread_mutex_unlock(&air_lock);
+				return 0;
+			}
+			if(count < sizeof(len)) {
+				pthread_mutex_unlock(&air_lock);
+				errno = EINVAL;
+				return -1;
+			}
+			sim_pop(node,&node->cur);
+			node->pending = true;
+			len = node->cur.len;
+			memcpy(buf,&len,sizeof(len));
+			result = sizeof(len);
+		} else {
+			result = count < node->cur.len ? count : node->cur.len;
+			memcpy(buf,node->cur.data,result);
+			node->pending = false;
+			node->rx_rssi = node->cur.rssi;
+			node->rx_time = node->cur.time;
+		}
+		pthread_mutex_unlock(&air_lock);
+		return result;
+	}
+
+	static inline void sim_copy(LAZURITE_FRAME* frame, const SIM_FRAME* sim)
+	{
+		frame->len = sim->len;
+		frame->rssi = sim->rssi;
+		frame->tv_sec = sim->time.tv_sec;
+		frame->tv_nsec = sim->time.tv_nsec;
+		memcpy(frame->raw,sim->data,sim->len);
+	}
+
+	/******************************************************************************/
+	/*! @brief drain queued frames under one lock
+	  @return         number of frames
+	 ******************************************************************************/
+	static int sim_recv(int fd, LAZURITE_FRAME* frames, int num)
+	{
+		SIM_NODE *node;
+		int i = 0;
+
+		pthread_mutex_lock(&air_lock);
+		node = sim_find(fd);
+		if(!node) {
+			pthread_mutex_unlock(&air_lock);
+			errno = EBADF;
+			return -1;
+		}
+		if(node->pending && (num > 0)) {
+			sim_copy(&frames[i],&node->cur);
+			node->pending = false;
+			i++;
+		}
+		for(;(i<num) && node->count;i++) {
+			sim_pop(node,&node->cur);
+			sim_copy(&frames[i],&node->cur);
+		}
+		if(i) {
+			node->rx_rssi = node->cur.rssi;
+			node->rx_time = node->cur.time;
+		}
+		pthread_mutex_unlock(&air_lock);
+		return i;
+	}
+
+	/******************************************************************************/
+	/*! @brief IOCTL_PARAM/IOCTL_CMD of LazDriver
+	  setter returns the value which is set. command returns 0.
+	 ******************************************************************************/
+	static int sim_ioctl(int fd, unsigned long cmd, unsigned long arg)
+	{
+		SIM_NODE *node;
+		int result = 0;
+
+		pthread_mutex_lock(&air_lock);
+		node = sim_find(fd);
+		if(!node) {
+			pthread_mutex_unlock(&air_lock);
+			errno = EBADF;
+			return -1;
+		}
+		switch(cmd) {
+			case IOCTL_CMD | IOCTL_SET_BEGIN:
+				node->begin = true;
+				break;
+			case IOCTL_CMD | IOCTL_SET_CLOSE:
+				node->begin = false;
+				node->rxon = false;
+				break;
+			case IOCTL_CMD | IOCTL_SET_RXON:
+				node->rxon = true;
+				break;
+			case IOCTL_CMD | IOCTL_SET_RXOFF:
+				node->rxon = false;
+				break;
+			case IOCTL_CMD | IOCTL_GET_SEND_MODE:
+				node->stage = node->mode;
+				break;
+			case IOCTL_CMD | IOCTL_SET_SEND_MODE:
+				node->mode = node->stage;
+				break;
+			case IOCTL_CMD | IOCTL_SET_AES:
+				break;
+			case IOCTL_PARAM | IOCTL_SET_CH:
+				result = node->ch = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_MY_PANID:
+				result = node->my_panid = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_BPS:
+				result = node->bps = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_PWR:
+				result = node->pwr = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_DST_PANID:
+				result = node->dst_panid = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_DST_ADDR0:
+				result = node->dst_addr[0] = arg;
+				node->dst_addr[1] = node->dst_addr[2] = node->dst_addr[3] = 0;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_DST_ADDR1:
+				result = node->dst_addr[1] = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_DST_ADDR2:
+				result = node->dst_addr[2] = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_DST_ADDR3:
+				result = node->dst_addr[3] = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_MY_ADDR0:
+				result = (node->my_addr64 >> 48) & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_MY_ADDR1:
+				result = (node->my_addr64 >> 32) & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_MY_ADDR2:
+				result = (node->my_addr64 >> 16) & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_MY_ADDR3:
+				result = node->my_addr64 & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_MY_SHORT_ADDR:
+				result = node->my_short_addr;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_MY_SHORT_ADDR:
+				result = node->my_short_addr = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_RX_SEC1:
+				result = (node->rx_time.tv_sec >> 16) & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_RX_SEC0:
+				result = node->rx_time.tv_sec & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_RX_NSEC1:
+				result = (node->rx_time.tv_nsec >> 16) & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_RX_NSEC0:
+				result = node->rx_time.tv_nsec & 0xffff;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_RX_RSSI:
+				result = node->rx_rssi;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_TX_RSSI:
+				result = node->tx_rssi;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_ADDR_TYPE:
+				result = node->stage.addr_type;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_ADDR_TYPE:
+				result = node->stage.addr_type = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_SENSE_TIME:
+				result = node->stage.sense_time;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_SENSE_TIME:
+				result = node->stage.sense_time = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_TX_RETRY:
+				result = node->stage.tx_retry;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_TX_RETRY:
+				result = node->stage.tx_retry = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_TX_INTERVAL:
+				result = node->stage.tx_interval;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_TX_INTERVAL:
+				result = node->stage.tx_interval = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_GET_CCA_WAIT:
+				result = node->stage.cca_wait;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_CCA_WAIT:
+				result = node->stage.cca_wait = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_PROMISCUOUS:
+				node->promiscuous = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_ACK_REQ:
+				node->ack_req = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_BROADCAST:
+				node->broadcast = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_EACK_ENB:
+				node->eack_enb = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_EACK_LEN:
+				if(arg > sizeof(node->eack_data)) {
+					result = -1;
+					errno = EINVAL;
+					break;
+				}
+				result = node->eack_len = arg;
+				break;
+			case IOCTL_PARAM | IOCTL_SET_EACK_DATA:
+				memcpy(node->eack_data,(const void*)arg,node->eack_len);
+				break;
+			case IOCTL_PARAM | IOCTL_GET_EACK:
+				memcpy((void*)arg,node->eack_data,node->eack_len);
+				result = node->eack_len;
+				break;
+			default:
+				result = -1;
+				errno = EINVAL;
+				break;
+		}
+		pthread_mutex_unlock(&air_lock);
+		return result;
+	}
+
+	extern "C" const LAZURITE_BACKEND lazurite_backend_sim = {
+		"sim",
+		"sim",
+		sim_load,
+		sim_unload,
+		sim_open,
+		sim_close,
+		sim_ioctl,
+		sim_read,
+		sim_write,
+		sim_recv,
+	};
+
+#ifdef __cplusplus
+};
+#endif
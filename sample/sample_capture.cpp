@@ -0,0 +1,145 @@
+/*!
+  @file sample_capture.cpp
+  @brief about sample_capture <br>
+  sample code to capture all frames to pcapng file, which can be opened by Wireshark.
+
+  @subsection how to use <br>
+
+  paramete can be ommited. file is rotated by size (bytes) when the 6th parameter is given.
+
+  (ex)
+  @code
+  sample_capture 36 0xabcd 100 20 rx.pcapng
+  sample_capture 36 0xabcd 100 20 rx.pcapng 100000000
+  @endcode
+
+  when push Ctrl+C, process is quited.
+  */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+bool bStop;
+
+/*!
+  signal handler <br>
+  this process is executed, when Ctrl+C is pushed.
+  */
+void sigHandle(int sigName)
+{
+	bStop = true;
+	printf("sigHandle = %d\n",sigName);
+	return;
+}
+/*!
+  set signal handler for Ctrl+C
+  */
+
+int setSignal(int sigName)
+{
+	if(signal(sigName,sigHandle)==SIG_ERR) return -1;
+	return 0;
+}
+int main(int argc, char **argv)
+{
+	int result;
+	char* en;
+	uint8_t ch=36;
+	uint8_t rate=100;
+	uint8_t pwr=20;
+	uint16_t panid=0xabcd;
+	const char* path="rx.pcapng";
+	LAZURITE_CAPTURE_PARAM param;
+	LAZURITE_CAPTURE_STATS stats;
+	LAZURITE_CAPTURE* capture;
+	LAZURITE_FRAME frames[16];
+
+	// set Signal Trap
+	setSignal(SIGINT);
+
+	memset(&param,0,sizeof(param));
+	bStop = false;
+	if(argc>1) {
+		ch = strtol(argv[1],&en,0);
+	}
+	if(argc>2) {
+		panid = strtol(argv[2],&en,0);
+	}
+	if(argc>3) {
+		rate = strtol(argv[3],&en,0);
+	}
+	if(argc>4) {
+		pwr = strtol(argv[4],&en,0);
+	}
+	if(argc>5) {
+		path = argv[5];
+	}
+	if(argc>6) {
+		param.rotate_size = strtoul(argv[6],&en,0);
+	}
+
+	result = lazurite_init();
+	if(result == 256) {
+		printf("lazdriver.ko is already existed\n");
+	} else if(result < 0) {
+		fprintf(stderr,"fail to load lazdriver.ko(%d)\n",result);
+		return EXIT_FAILURE;
+	}
+
+	result = lazurite_begin(ch,panid,rate,pwr);
+	if(result < 0) {
+		printf("lazurite_begin fail = %d\n",result);
+		return EXIT_FAILURE;
+	}
+	result = lazurite_setPromiscuous(true);
+	if(result < 0) {
+		printf("lazurite_promiscuous fail = %d\n",result);
+		return EXIT_FAILURE;
+	}
+	capture = lazurite_openCapture(path,&param);
+	if(!capture) {
+		perror(path);
+		return EXIT_FAILURE;
+	}
+	// frames are written to file by rx thread, before they are got by lazurite_getRxFrames
+	lazurite_setCapture(capture);
+	result = lazurite_startRxThread(256,-1);
+	if(result < 0) {
+		printf("lazurite_startRxThread fail = %d\n",result);
+		return EXIT_FAILURE;
+	}
+	result = lazurite_rxEnable();
+	if(result < 0) {
+		printf("lazurite_rxEnable fail = %d\n",result);
+		return EXIT_FAILURE;
+	}
+
+	while(bStop == false)
+	{
+		result = lazurite_getRxFrames(frames,16,1000);
+		if(result < 0) break;
+		lazurite_getCaptureStats(capture,&stats);
+		printf("\rframes=%lu dropped=%lu files=%lu bytes=%llu",stats.frames,stats.dropped,stats.files,stats.bytes);
+		fflush(stdout);
+	}
+	printf("\n");
+
+	lazurite_stopRxThread();
+	lazurite_setCapture(NULL);
+	if((result = lazurite_closeCapture(capture)) !=0) {
+		printf("fail to write %s %d\n",path,result);
+	}
+	if((result = lazurite_close()) !=0) {
+		printf("fail to stop RF %d",result);
+	}
+	usleep(100000);
+	if((result = lazurite_remove()) !=0) {
+		printf("remove driver from kernel %d",result);
+	}
+	return 0;
+}
@@ -107,14 +107,22 @@ int main(int argc, char **argv)
 		char data[256];
 		uint16_t size;
 		uint8_t rssi;
+		result = lazurite_wait(100);
+		if(result < 0) {
+			printf("lazurite_wait fail = %d\n",result);
+			break;
+		}
+		if(result == 0) continue;
 		memset(data,0,sizeof(data));
 		result = lazurite_readLink(data,&size);
 		if(result >0 ) {
 			lazurite_getRxTime(&rxTime.tv_sec,&rxTime.tv_nsec);
 			rssi = lazurite_getRxRssi();
 			printf("%d-%d\t%d\t%s\n",rxTime.tv_sec,rxTime.tv_nsec,rssi,data);
+		} else {
+			// readable but no frame (driver without poll is always readable)
+			usleep(1000);
 		}
-		usleep(100000);
 	}
 
 	if((result = lazurite_close()) !=0) {
@@ -11,8 +11,12 @@
   @code
   test_raw 36 0xabcd 100 20
   test_raw 36 0xabcd
+  test_raw 36 0xabcd 100 20 "frame_type==1 && dst_panid==0xabcd && len>20"
   @endcode
 
+  5th parameter is filter of frames (lazurite_compileFilter).
+  frames which do not match are dropped in the library before they are copied.
+
   when push Ctrl+C, process is quited.
   */
 #include <string.h>
@@ -55,6 +59,8 @@ int main(int argc, char **argv)
 	uint8_t pwr=20;
 	uint16_t panid=0xabcd;
 	uint8_t myaddr_be[8];
+	LAZURITE_FILTER* filter = NULL;
+	int error_pos;
 
 	// set Signal Trap
 	setSignal(SIGINT);
@@ -82,6 +88,14 @@ int main(int argc, char **argv)
 	if(argc>4) {
 		pwr = strtol(argv[4],&en,0);
 	}
+	if(argc>5) {
+		filter = lazurite_compileFilter(argv[5],&error_pos);
+		if(!filter) {
+			fprintf(stderr,"filter error at %d: %s\n",error_pos,argv[5]);
+			return EXIT_FAILURE;
+		}
+		lazurite_setFilter(filter);
+	}
 
 	printf("short address:: %04x\n",lazurite_getMyAddress());
 	result = lazurite_getMyAddr64(myaddr_be);
@@ -119,7 +133,7 @@ int main(int argc, char **argv)
 		SUBGHZ_MAC mac;
 		char raw[256];
 		memset(raw,0,sizeof(raw));
-		result = lazurite_read(raw,&size);
+		result = lazurite_readTimeout(raw,&size,100);
 		if(result > 0 ) {
 			result = lazurite_decMac(&mac,raw,size);
 			printf("%02x\t%04x\t%02x%02x%02x%02x%02x%02x%02x%02x\t%04x\t%02x%02x%02x%02x%02x%02x%02x%02x\t",
@@ -145,7 +159,6 @@ int main(int argc, char **argv)
 				);
 			printf("%s\n", raw+mac.payload_offset);
 		}
-		usleep(100000);
 	}
 
 	if((result = lazurite_close()) !=0) {
@@ -155,5 +168,7 @@ int main(int argc, char **argv)
 	if((result = lazurite_remove()) !=0) {
 		printf("remove driver from kernel %d",result);
 	}
+	lazurite_setFilter(NULL);
+	lazurite_freeFilter(filter);
 	return 0;
 }
@@ -114,7 +114,7 @@ int main(int argc, char **argv)
 		SUBGHZ_MAC mac;
 		char raw[256];
 		memset(raw,0,sizeof(raw));
-		result = lazurite_read(raw,&size);
+		result = lazurite_readTimeout(raw,&size,100);
 		if(result > 0 ) {
 			result = lazurite_decMac(&mac,raw,size);
 			printf("%02x\t%04x\t%02x%02x%02x%02x%02x%02x%02x%02x\t%04x\t%02x%02x%02x%02x%02x%02x%02x%02x\t",
@@ -140,7 +140,6 @@ int main(int argc, char **argv)
 					);
 			printf("%s\n", raw+mac.payload_offset);
 		}
-		usleep(100000);
 	}
 
 	if((result = lazurite_close()) !=0) {
@@ -0,0 +1,111 @@
+/*!
+  @file test_shadow.cpp
+  @brief test of shadow of destination address <br>
+  runs on lazurite_backend_sim, so LazDriver is not needed.
+
+  node A sends to B and C by turns, with 64bit addresses which are different only in
+  lower 16bit, with 16bit addresses, and with both. DST_ADDR0 of driver clears DST_ADDR1..3,
+  so they must be set again when only DST_ADDR0 is changed.
+  each send must succeed, and the frame must arrive at its destination only.
+
+  @code
+  test_shadow
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+#define PANID	0xabcd
+#define FRAMES	8
+
+static LAZURITE_CTX* open_node(void)
+{
+	LAZURITE_CTX *ctx = lazurite_openCtx(&lazurite_backend_sim,NULL);
+	if(!ctx) return NULL;
+	lazurite_ctx_begin(ctx,36,PANID,100,20);
+	lazurite_ctx_rxEnable(ctx);
+	return ctx;
+}
+
+/*! number of frames in rx queue of node */
+static int drain(LAZURITE_CTX *ctx)
+{
+	char raw[256];
+	uint16_t size;
+	int count = 0;
+	while(lazurite_ctx_read(ctx,raw,&size) > 0) count++;
+	return count;
+}
+
+int main(int argc, char **argv)
+{
+	static const char *methods[] = {"send64le", "send64be", "send", "send/send64be"};
+	LAZURITE_CTX *node[3];
+	uint8_t addr_be[2][8];
+	uint8_t addr_le[2][8];
+	uint16_t addr16[2];
+	int errors = 0;
+	int m, i, j, k, result;
+
+	for(i=0;i<3;i++) {
+		node[i] = open_node();
+		if(!node[i]) {
+			fprintf(stderr,"open error\n");
+			return EXIT_FAILURE;
+		}
+	}
+	for(i=0;i<2;i++) {
+		lazurite_ctx_getMyAddr64(node[i+1],addr_be[i]);
+		for(k=0;k<8;k++) addr_le[i][k] = addr_be[i][7-k];
+		// not lower 16bit of 64bit address, so a frame sent by 16bit address by mistake is not acked
+		addr16[i] = 0x1000 + i;
+		lazurite_ctx_setMyAddress(node[i+1],addr16[i]);
+	}
+	if(memcmp(addr_be[0],addr_be[1],6) != 0) {
+		fprintf(stderr,"upper 48bit of addresses are different\n");
+		errors++;
+	}
+
+	for(m=0;m<(int)(sizeof(methods)/sizeof(methods[0]));m++) {
+		for(i=0;i<FRAMES;i++) {
+			j = i & 1;
+			switch(m) {
+				case 0:
+					result = lazurite_ctx_send64le(node[0],addr_le[j],"64le",4);
+					break;
+				case 1:
+					result = lazurite_ctx_send64be(node[0],addr_be[j],"64be",4);
+					break;
+				case 2:
+					result = lazurite_ctx_send(node[0],PANID,addr16[j],"16",2);
+					break;
+				default:
+					if(j) result = lazurite_ctx_send64be(node[0],addr_be[j],"64be",4);
+					else result = lazurite_ctx_send(node[0],PANID,addr16[j],"16",2);
+					break;
+			}
+			if(result < 0) {
+				fprintf(stderr,"%s: frame %d to node %c: %d\n",methods[m],i,'B' + j,result);
+				errors++;
+			}
+			if((drain(node[1 + j]) != 1) || (drain(node[2 - j]) != 0)) {
+				fprintf(stderr,"%s: frame %d is not delivered to node %c only\n",methods[m],i,'B' + j);
+				errors++;
+			}
+		}
+	}
+	for(i=0;i<3;i++) lazurite_closeCtx(node[i]);
+
+	printf("errors=%d\n",errors);
+	if(errors) {
+		printf("NG\n");
+		return EXIT_FAILURE;
+	}
+	printf("OK\n");
+	return 0;
+}
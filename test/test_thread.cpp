@@ -0,0 +1,185 @@
+/*!
+  @file test_thread.cpp
+  @brief stress test of rx thread and tx from other threads <br>
+  runs on lazurite_backend_sim, so LazDriver is not needed.
+  build with "make tsan" to run under ThreadSanitizer.
+
+  - rx thread of node A pushes frames into the ring, main thread gets them.
+  - node B and node C send to A from their own threads.
+  - another thread sends from A to B while rx thread of A is running.
+  - neighbor table of A is updated by both threads and read by main thread.
+
+  frames from each sender must arrive in order, without duplication and corruption.
+  snapshots of neighbor table must be consistent, and must count all frames at last.
+
+  @code
+  test_thread [frames]
+  @endcode
+ */
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../lib/liblazurite.h"
+
+using namespace lazurite;
+
+#define PANID	0xabcd
+#define SENDERS	2
+
+static int frames = 20000;
+static LAZURITE_CTX *node_a;
+static LAZURITE_CTX *node_b;
+static LAZURITE_CTX *node_c;
+static uint16_t addr_a;
+static uint16_t addr_b;
+static int finished;		/*!< number of senders finished */
+
+typedef struct {
+	LAZURITE_CTX *ctx;
+	uint16_t dst;
+	int id;
+	int sent;
+} SENDER;
+
+static void* sender_main(void* arg)
+{
+	SENDER *sender = (SENDER*)arg;
+	char payload[32];
+	int i;
+
+	for(i=0;i<frames;i++) {
+		snprintf(payload,sizeof(payload),"%d:%d",sender->id,i);
+		if(lazurite_ctx_send(sender->ctx,PANID,sender->dst,payload,strlen(payload)) >= 0) {
+			sender->sent++;
+		}
+		// give rx thread a chance. sim drops frames when its queue is full
+		if((i & 63) == 63) usleep(100);
+	}
+	__atomic_add_fetch(&finished,1,__ATOMIC_RELEASE);
+	return NULL;
+}
+
+static LAZURITE_CTX* open_node(void)
+{
+	LAZURITE_CTX *ctx = lazurite_openCtx(&lazurite_backend_sim,NULL);
+	if(!ctx) return NULL;
+	lazurite_ctx_begin(ctx,36,PANID,100,20);
+	lazurite_ctx_rxEnable(ctx);
+	return ctx;
+}
+
+/*! members of one snapshot must agree with each other */
+static int check_neighbors(void)
+{
+	LAZURITE_NEIGHBOR neighbors[8];
+	int errors = 0;
+	int n, i;
+
+	n = lazurite_ctx_getNeighbors(node_a,neighbors,8);
+	for(i=0;i<n;i++) {
+		if((neighbors[i].addr_len != 2) ||
+				(neighbors[i].rx_frames && ((neighbors[i].rssi < neighbors[i].rssi_min) || (neighbors[i].rssi > neighbors[i].rssi_max))) ||
+				(neighbors[i].tx_success && !neighbors[i].last_sec)) {
+			fprintf(stderr,"bad neighbor: 0x%04llx\n",(unsigned long long)neighbors[i].addr);
+			errors++;
+		}
+	}
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	static LAZURITE_FRAME slots[64];
+	LAZURITE_NEIGHBOR_PARAM param = {0};
+	LAZURITE_NEIGHBOR neighbors[8];
+	unsigned long counted = 0;
+	SENDER sender[SENDERS + 1];
+	pthread_t thread[SENDERS + 1];
+	int next[SENDERS];
+	int received = 0;
+	int errors = 0;
+	int id, seq;
+	int n, i;
+
+	if(argc>1) frames = strtol(argv[1],NULL,0);
+
+	node_a = open_node();
+	node_b = open_node();
+	node_c = open_node();
+	if(!node_a || !node_b || !node_c) {
+		fprintf(stderr,"open error\n");
+		return EXIT_FAILURE;
+	}
+	addr_a = lazurite_ctx_getMyAddress(node_a);
+	addr_b = lazurite_ctx_getMyAddress(node_b);
+	lazurite_ctx_setNeighborTable(node_a,&param);
+	if(lazurite_ctx_startRxThread(node_a,16,-1) != 0) {
+		fprintf(stderr,"startRxThread error\n");
+		return EXIT_FAILURE;
+	}
+
+	sender[0] = (SENDER){node_b,addr_a,0,0};
+	sender[1] = (SENDER){node_c,addr_a,1,0};
+	sender[2] = (SENDER){node_a,addr_b,2,0};
+	for(i=0;i<SENDERS;i++) {
+		next[i] = 0;
+	}
+	for(i=0;i<SENDERS+1;i++) {
+		pthread_create(&thread[i],NULL,sender_main,&sender[i]);
+	}
+
+	for(;;) {
+		n = lazurite_ctx_getRxFrames(node_a,slots,sizeof(slots)/sizeof(slots[0]),200);
+		if(n < 0) {
+			fprintf(stderr,"getRxFrames error %d\n",n);
+			errors++;
+			break;
+		}
+		errors += check_neighbors();
+		if(n == 0) {
+			if(__atomic_load_n(&finished,__ATOMIC_ACQUIRE) == SENDERS + 1) break;
+			continue;
+		}
+		for(i=0;i<n;i++) {
+			char text[64];
+			int len = slots[i].payload_len < 63 ? slots[i].payload_len : 63;
+			memcpy(text,slots[i].raw + slots[i].payload_offset,len);
+			text[len] = 0;
+			if((slots[i].status != 0) || (sscanf(text,"%d:%d",&id,&seq) != 2) ||
+					(id < 0) || (id >= SENDERS) || (seq < next[id])) {
+				fprintf(stderr,"bad frame: %s\n",text);
+				errors++;
+				continue;
+			}
+			next[id] = seq + 1;
+			received++;
+		}
+	}
+
+	for(i=0;i<SENDERS+1;i++) {
+		pthread_join(thread[i],NULL);
+	}
+	lazurite_ctx_stopRxThread(node_a);
+	n = lazurite_ctx_getNeighbors(node_a,neighbors,8);
+	for(i=0;i<n;i++) counted += neighbors[i].rx_frames;
+	if((counted != (unsigned long)received) || (lazurite_ctx_getNeighbor(node_a,addr_b,&neighbors[0]) != 0) ||
+			(neighbors[0].tx_success != (unsigned long)sender[2].sent)) {
+		fprintf(stderr,"neighbor table: rx %lu tx %lu\n",counted,neighbors[0].tx_success);
+		errors++;
+	}
+	lazurite_closeCtx(node_a);
+	lazurite_closeCtx(node_b);
+	lazurite_closeCtx(node_c);
+
+	printf("sent=%d received=%d (a->b sent=%d) errors=%d\n",
+			sender[0].sent + sender[1].sent,received,sender[2].sent,errors);
+	if(errors || (received > sender[0].sent + sender[1].sent)) {
+		printf("NG\n");
+		return EXIT_FAILURE;
+	}
+	printf("OK\n");
+	return 0;
+}